@@ -0,0 +1,47 @@
+// Test for the ChannelFormatConverterStream: 16 bit stereo is converted to mono
+// with writes which split the frames, so the incomplete frames must be kept.
+#include "Arduino.h"
+#include "AudioTools.h"
+
+using namespace audio_tools;
+
+const int frames = 100;
+const int write_size = 3;
+MemoryStream out(frames * sizeof(int16_t));
+ChannelFormatConverterStreamT<int16_t> converter(out);
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  out.begin();
+  bool ok = converter.begin(2, 1);
+  assert(ok);
+}
+
+void loop() {
+  // the mono result is the average of the two channels
+  int16_t data[frames * 2];
+  for (int j = 0; j < frames; j++) {
+    data[j * 2] = j * 300;
+    data[j * 2 + 1] = j * 300 + 2;
+  }
+  const uint8_t *p_data = (const uint8_t *)data;
+  size_t pos = 0;
+  while (pos < sizeof(data)) {
+    size_t n = sizeof(data) - pos < write_size ? sizeof(data) - pos : write_size;
+    size_t written = converter.write(p_data + pos, n);
+    assert(written == n);
+    pos += n;
+  }
+  assert(out.available() == frames * sizeof(int16_t));
+
+  int16_t result[frames];
+  size_t read = out.readBytes((uint8_t *)result, sizeof(result));
+  assert(read == sizeof(result));
+  for (int j = 0; j < frames; j++) {
+    int expected = j * 300 + 1;
+    int diff = result[j] - expected;
+    assert(diff >= -1 && diff <= 1);
+  }
+  Serial.println("Test OK");
+  exit(0);
+}
@@ -0,0 +1,49 @@
+// Test for the FormatConverterStream: 16 bit stereo is converted to 32 bit mono,
+// so the channel conversion (which is done first) must use the input bits.
+#include "Arduino.h"
+#include "AudioTools.h"
+
+using namespace audio_tools;
+
+const int frames = 100;
+MemoryStream out(frames * sizeof(int32_t));
+FormatConverterStream converter(out);
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  out.begin();
+  AudioBaseInfo from;
+  from.sample_rate = 44100;
+  from.channels = 2;
+  from.bits_per_sample = 16;
+  AudioBaseInfo to = from;
+  to.channels = 1;
+  to.bits_per_sample = 32;
+  bool ok = converter.begin(from, to);
+  assert(ok);
+}
+
+void loop() {
+  // the mono result is the average of the two channels
+  int16_t data[frames * 2];
+  for (int j = 0; j < frames; j++) {
+    data[j * 2] = j * 300;
+    data[j * 2 + 1] = j * 300 + 2;
+  }
+  size_t written = converter.write((uint8_t *)data, sizeof(data));
+  assert(written == sizeof(data));
+  assert(out.available() == frames * sizeof(int32_t));
+
+  int32_t result[frames];
+  size_t read = out.readBytes((uint8_t *)result, sizeof(result));
+  assert(read == sizeof(result));
+  for (int j = 0; j < frames; j++) {
+    int64_t expected = (int64_t)(j * 300 + 1) * 2147483647 / 32767;
+    // the scaling is done with float
+    int64_t diff = result[j] - expected;
+    int64_t tolerance = expected / 10000 + 2;
+    assert(diff >= -tolerance && diff <= tolerance);
+  }
+  Serial.println("Test OK");
+  exit(0);
+}
@@ -0,0 +1,131 @@
+// Test for the ID3 metadata processing: we build a file with an ID3v2 tag,
+// some audio data, an enhanced TAG+ and an ID3v1 tag and check
+// - the streaming parser MetaDataID3 reports the ID3v2 and the ID3v1 title
+// - the MetaDataFilter provides only the audio data
+// - the MetaDataID3Reader reads the tags from a MemoryStream
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioMetaData/MetaDataFilter.h"
+
+using namespace audio_tools;
+
+const int audio_len = 5000;
+Vector<uint8_t> file{0};
+int audio_start = 0;
+int v2_title = 0;
+int v1_title = 0;
+
+void add(const void *data, int len) {
+  for (int j = 0; j < len; j++) file.push_back(((const uint8_t *)data)[j]);
+}
+
+void addFill(uint8_t value, int len) {
+  for (int j = 0; j < len; j++) file.push_back(value);
+}
+
+/// ID3v2.4 text frame in UTF-8
+void addTextFrame(const char *id, const char *text) {
+  int len = strlen(text) + 1;
+  uint8_t size[4] = {0, 0, 0, (uint8_t)len};
+  uint8_t flags[2] = {0, 0};
+  uint8_t encoding = 3;
+  add(id, 4);
+  add(size, 4);
+  add(flags, 2);
+  add(&encoding, 1);
+  add(text, len - 1);
+}
+
+void createFile() {
+  // ID3v2 header: the size is patched at the end
+  uint8_t header[10] = {'I', 'D', '3', 4, 0, 0, 0, 0, 0, 0};
+  add(header, 10);
+  addTextFrame("TIT2", "V2Title");
+  addTextFrame("TPE1", "V2Artist");
+  addFill(0, 50);
+  int tag_size = file.size() - 10;
+  for (int j = 0; j < 4; j++) file[6 + j] = (tag_size >> (7 * (3 - j))) & 0x7F;
+  audio_start = file.size();
+  addFill(0x55, audio_len);
+  // enhanced tag: 227 bytes
+  char tag_ext[227] = {0};
+  memcpy(tag_ext, "TAG+", 4);
+  memcpy(tag_ext + 4, "ExtTitle", 8);
+  add(tag_ext, sizeof(tag_ext));
+  // ID3v1 tag: 128 bytes
+  char tag[128] = {0};
+  memcpy(tag, "TAG", 3);
+  memcpy(tag + 3, "V1Title", 7);
+  tag[127] = 17;
+  add(tag, sizeof(tag));
+}
+
+void metadataCallback(MetaDataType type, const char *str, int len) {
+  Serial.print("==> ");
+  Serial.print(toStr(type));
+  Serial.print(": ");
+  Serial.println(str);
+  if (type == Title && strncmp(str, "V2Title", 7) == 0) v2_title++;
+  if (type == Title && strstr(str, "V1Title") != nullptr) v1_title++;
+}
+
+/// Decoder for the MetaDataFilter which checks that we only get the audio data
+struct CheckingDecoder {
+  int len = 0;
+  size_t write(uint8_t *data, size_t size) {
+    for (size_t j = 0; j < size; j++) assert(data[j] == 0x55);
+    len += size;
+    return size;
+  }
+};
+
+void testStreaming() {
+  MetaDataID3 id3;
+  id3.setCallback(metadataCallback);
+  id3.begin();
+  id3.setInputSize(file.size());
+  for (int pos = 0; pos < file.size(); pos += 512) {
+    int len = min(512, file.size() - pos);
+    id3.write(file.data() + pos, len);
+  }
+  // ID3v1 must still be processed after the ID3v2 tag region
+  assert(v2_title == 1);
+  assert(v1_title == 1);
+}
+
+void testFilter() {
+  CheckingDecoder decoder;
+  MetaDataFilter<CheckingDecoder> filter(&decoder);
+  filter.begin();
+  filter.setInputSize(file.size());
+  for (int pos = 0; pos < file.size(); pos += 333) {
+    int len = min(333, file.size() - pos);
+    filter.write(file.data() + pos, len);
+  }
+  assert(decoder.len == audio_len);
+}
+
+void testReader() {
+  v2_title = 0;
+  MemoryStream in(file.data(), file.size());
+  in.begin();
+  MetaDataID3Reader reader;
+  reader.setCallback(metadataCallback);
+  bool ok = reader.read(in);
+  assert(ok);
+  assert(v2_title == 1);
+  size_t start = reader.audioStart();
+  assert(start == (size_t)audio_start);
+}
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  createFile();
+  testStreaming();
+  testFilter();
+  testReader();
+  Serial.println("Test OK");
+  exit(0);
+}
+
+void loop() {}
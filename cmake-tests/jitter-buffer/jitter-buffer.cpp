@@ -0,0 +1,144 @@
+// Test for the JitterBufferStream: the packets are sent as UDP datagrams over
+// the loopback interface. The pairs of packets are sent in reverse order, some
+// packets are sent twice and one packet is lost. The sequence numbers wrap
+// around and the requested number of slots (12) is rounded up to 16 slots.
+#include "Arduino.h"
+#include "AudioTools.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace audio_tools;
+
+const int packets = 200;
+const uint16_t start_seq = 65500;
+const int lost_idx = 50;
+
+/// Stream which is sending and receiving UDP datagrams: one write is one datagram
+class DatagramStream : public AudioStream {
+ public:
+  bool begin(uint16_t port = 0) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0) return false;
+    socklen_t len = sizeof(local);
+    return getsockname(fd, (sockaddr *)&local, &len) == 0;
+  }
+  void setTarget(DatagramStream &target) { remote = target.local; }
+  int available() override {
+    uint8_t tmp[1500];
+    ssize_t n = recv(fd, tmp, sizeof(tmp), MSG_PEEK | MSG_DONTWAIT);
+    return n > 0 ? n : 0;
+  }
+  size_t readBytes(uint8_t *data, size_t len) override {
+    ssize_t n = recv(fd, data, len, MSG_DONTWAIT);
+    return n > 0 ? n : 0;
+  }
+  size_t write(const uint8_t *data, size_t len) override {
+    ssize_t n = sendto(fd, data, len, 0, (sockaddr *)&remote, sizeof(remote));
+    return n > 0 ? n : 0;
+  }
+
+ protected:
+  int fd = -1;
+  sockaddr_in local;
+  sockaddr_in remote;
+};
+
+/// Collects the packets: one packet with the sequence number per write
+class PacketPrint : public AudioPrint {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    Packet p;
+    memcpy(p.data, data, len);
+    p.len = len;
+    result.push_back(p);
+    return len;
+  }
+  struct Packet {
+    uint8_t data[16];
+    size_t len;
+  };
+  Vector<Packet> result;
+};
+
+DatagramStream sender;
+DatagramStream receiver;
+JitterBufferStream jitter(receiver);
+PacketPrint packet_print;
+SequenceNumberPrint numbering(packet_print);
+Vector<uint16_t> received;
+int sent = 0;
+int duplicates = 0;
+
+void send(int idx) {
+  if (idx == lost_idx) return;
+  sender.write(packet_print.result[idx].data, packet_print.result[idx].len);
+}
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  bool ok = sender.begin();
+  assert(ok);
+  ok = receiver.begin();
+  assert(ok);
+  sender.setTarget(receiver);
+
+  // one stereo frame per packet which contains the sequence number
+  numbering.begin(start_seq);
+  for (int j = 0; j < packets; j++) {
+    uint16_t seq = start_seq + j;
+    int16_t frame[2] = {(int16_t)seq, (int16_t)seq};
+    numbering.write((uint8_t *)frame, sizeof(frame));
+  }
+
+  auto cfg = jitter.defaultConfig();
+  cfg.slots = 12;
+  cfg.min_depth = 8;
+  cfg.max_depth = 11;
+  cfg.adaptive = false;
+  ok = jitter.begin(cfg);
+  assert(ok);
+}
+
+void loop() {
+  // send the next pair in reverse order: every 5th pair twice
+  if (sent < packets) {
+    send(sent + 1);
+    send(sent);
+    if (sent % 10 == 0) {
+      send(sent + 1);
+      duplicates++;
+    }
+    sent += 2;
+  }
+
+  int16_t frame[2];
+  for (int j = 0; j < 2; j++) {
+    if (jitter.readBytes((uint8_t *)frame, sizeof(frame)) == sizeof(frame)) {
+      received.push_back((uint16_t)frame[0]);
+    }
+    assert(jitter.depth() <= 16);
+  }
+
+  if (received.size() >= packets) {
+    // the lost packet is replaced by the prior packet
+    for (int j = 0; j < packets; j++) {
+      uint16_t expected = start_seq + (j == lost_idx ? j - 1 : j);
+      assert(received[j] == expected);
+    }
+    auto &stat = jitter.statistics();
+    assert(stat.lost == 1);
+    assert(stat.late == 0);
+    assert(stat.dropped == 0);
+    assert(stat.duplicates == (uint32_t)duplicates);
+    Serial.println("Test OK");
+    exit(0);
+  }
+  assert(sent < packets + 20);
+}
@@ -0,0 +1,125 @@
+// Test for the pull mode decoding with decode(): an IMA ADPCM WAV file is decoded
+// in small steps and the result is compared with the push mode decoding. The
+// output of the decoder must be restored after each decode() call.
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioCodecs/CodecWavIMA.h"
+
+using namespace audio_tools;
+
+const int blocks = 8;
+const int block_align = 36;
+const int frames_per_block = 65;
+const int pull_size = 100;
+
+/// Provides access to the actual output of the decoder
+class TestDecoder : public WavIMADecoder {
+ public:
+  Print *output() { return out; }
+};
+
+/// Collects the decoded data
+class DataPrint : public AudioPrint {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    for (size_t j = 0; j < len; j++) result.push_back(data[j]);
+    return len;
+  }
+  Vector<uint8_t> result;
+};
+
+Vector<uint8_t> wav;
+
+void add16(uint16_t value) {
+  wav.push_back(value & 0xFF);
+  wav.push_back(value >> 8);
+}
+
+void add32(uint32_t value) {
+  add16(value & 0xFFFF);
+  add16(value >> 16);
+}
+
+void addTag(const char *tag) {
+  for (int j = 0; j < 4; j++) wav.push_back(tag[j]);
+}
+
+/// Mono IMA ADPCM file with some arbitrary sound data
+void createWAV() {
+  int data_len = blocks * block_align;
+  addTag("RIFF");
+  add32(4 + 28 + 8 + data_len);
+  addTag("WAVE");
+  addTag("fmt ");
+  add32(20);
+  add16(WAVE_FORMAT_IMA_ADPCM);
+  add16(1);
+  add32(8000);
+  add32(8000 * block_align / frames_per_block);
+  add16(block_align);
+  add16(4);
+  add16(2);
+  add16(frames_per_block);
+  addTag("data");
+  add32(data_len);
+  for (int b = 0; b < blocks; b++) {
+    add16(b * 1000);
+    wav.push_back(b * 3);
+    wav.push_back(0);
+    for (int j = 0; j < block_align - 4; j++) wav.push_back(j * 7 + b);
+  }
+}
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  createWAV();
+
+  // push mode
+  DataPrint push_out;
+  TestDecoder push_decoder;
+  push_decoder.setOutputStream(push_out);
+  push_decoder.begin();
+  push_decoder.write(wav.data(), wav.size());
+  size_t expected_size = blocks * frames_per_block * 2;
+  assert(push_out.result.size() == expected_size);
+
+  // pull mode w/o output
+  MemoryStream in(wav.data(), wav.size());
+  in.begin();
+  TestDecoder decoder;
+  decoder.setInputStream(in);
+  decoder.begin();
+  bool is_pull = decoder.isPullSupported();
+  assert(is_pull);
+  Vector<uint8_t> pulled;
+  uint8_t buffer[pull_size];
+  while (true) {
+    size_t len = decoder.decode(buffer, pull_size);
+    assert(len <= pull_size);
+    assert(decoder.output() == nullptr);
+    if (len == 0) break;
+    for (size_t j = 0; j < len; j++) pulled.push_back(buffer[j]);
+  }
+  assert(pulled.size() == expected_size);
+  for (int j = 0; j < pulled.size(); j++) {
+    assert(pulled[j] == push_out.result[j]);
+  }
+
+  // pull mode with output: the output is restored
+  MemoryStream in2(wav.data(), wav.size());
+  in2.begin();
+  DataPrint out2;
+  TestDecoder decoder2;
+  decoder2.setOutputStream(out2);
+  decoder2.setInputStream(in2);
+  decoder2.begin();
+  size_t len = decoder2.decode(buffer, pull_size);
+  assert(len == pull_size);
+  assert(decoder2.output() == &out2);
+  assert(out2.result.size() == 0);
+}
+
+void loop() {
+  Serial.println("Test OK");
+  exit(0);
+}
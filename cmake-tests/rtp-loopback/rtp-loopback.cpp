@@ -0,0 +1,101 @@
+// Test for the RTPSenderStream and RTPReceiverStream: the PCM data is written
+// with an odd number of bytes, so that the samples are split between the writes.
+// We check the sequence numbers, the timestamps and the L16 network byte order
+// of the packets and compare the depacketized PCM data with the original data.
+#include "Arduino.h"
+#include "AudioTools.h"
+
+using namespace audio_tools;
+
+const int packets = 12;
+const int write_size = 333;
+
+/// Collects the packets: one packet per write
+class PacketPrint : public AudioPrint {
+ public:
+  size_t write(const uint8_t *data, size_t len) override {
+    for (size_t j = 0; j < len; j++) data_all.push_back(data[j]);
+    lengths.push_back(len);
+    return len;
+  }
+  Vector<uint8_t> data_all;
+  Vector<int> lengths;
+};
+
+PacketPrint packet_print;
+RTPSenderStream sender(packet_print);
+RTPReceiverStream receiver;
+Vector<int16_t> pcm;
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+
+  auto cfg = sender.defaultConfig();
+  cfg.sample_rate = 8000;
+  cfg.channels = 2;
+  cfg.bits_per_sample = 16;
+  cfg.format = RTP_L16;
+  cfg.packet_time_ms = 20;
+  cfg.max_depth = 15;
+  bool ok = sender.begin(cfg);
+  assert(ok);
+  ok = receiver.begin(cfg);
+  assert(ok);
+  uint16_t start_seq = sender.sequenceNumber();
+  uint32_t start_timestamp = sender.rtpTimestamp();
+
+  // 160 frames per packet
+  const int frames = 160;
+  const int payload_size = frames * 4;
+  for (int j = 0; j < packets * payload_size / 2; j++) {
+    pcm.push_back((int16_t)(j * 37 - 20000));
+  }
+  const uint8_t *p_data = (const uint8_t *)pcm.data();
+  size_t total = pcm.size() * 2;
+  size_t pos = 0;
+  while (pos < total) {
+    size_t n = total - pos < write_size ? total - pos : write_size;
+    size_t written = sender.write(p_data + pos, n);
+    assert(written == n);
+    pos += n;
+  }
+  assert(packet_print.lengths.size() == packets);
+
+  // check the packets
+  int offset = 0;
+  for (int j = 0; j < packets; j++) {
+    int len = packet_print.lengths[j];
+    const uint8_t *p_packet = packet_print.data_all.data() + offset;
+    RTPHeaderInfo header;
+    ok = RTPHeader::parse(p_packet, len, header);
+    assert(ok);
+    assert(header.payload_len == payload_size);
+    assert(header.seq == (uint16_t)(start_seq + j));
+    assert(header.timestamp == start_timestamp + j * frames);
+    assert(header.marker == (j == 0));
+    // L16 is big endian
+    const uint8_t *p_payload = p_packet + header.header_len;
+    for (int i = 0; i < frames * 2; i++) {
+      int16_t sample = (int16_t)((p_payload[i * 2] << 8) | p_payload[i * 2 + 1]);
+      assert(sample == pcm[j * frames * 2 + i]);
+    }
+    size_t accepted = receiver.write(p_packet, len);
+    assert(accepted == (size_t)len);
+    offset += len;
+  }
+  auto &stat = receiver.statistics();
+  assert(stat.packets == packets);
+  assert(stat.lost == 0);
+}
+
+void loop() {
+  // compare the depacketized PCM data
+  Vector<int16_t> result(pcm.size());
+  size_t len = receiver.readBytes((uint8_t *)result.data(), pcm.size() * 2);
+  assert(len == pcm.size() * 2);
+  for (int j = 0; j < pcm.size(); j++) {
+    assert(result[j] == pcm[j]);
+  }
+  Serial.println("Test OK");
+  exit(0);
+}
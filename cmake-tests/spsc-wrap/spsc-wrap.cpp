@@ -0,0 +1,57 @@
+// Test for the RingBufferSPSC: the head and tail counters start just before
+// SIZE_MAX, so that they wrap around while we write and read the data in
+// chunks of different sizes. The capacity is rounded up to a power of 2.
+#include "Arduino.h"
+#include "AudioTools.h"
+#include "AudioTools/BufferSPSC.h"
+#include <stdint.h>
+
+using namespace audio_tools;
+
+/// Provides access to the counters
+class TestBuffer : public RingBufferSPSC<int16_t> {
+ public:
+  TestBuffer(int size) : RingBufferSPSC<int16_t>(size) {}
+  void setCounters(size_t value) {
+    head.store(value);
+    tail.store(value);
+  }
+};
+
+TestBuffer buffer(100);
+int16_t next_write = 0;
+int16_t next_read = 0;
+int total = 0;
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  int size = buffer.size();
+  assert(size == 128);
+  buffer.setCounters(SIZE_MAX - 300);
+}
+
+void loop() {
+  int16_t data[77];
+  // write a chunk
+  int len = 1 + total % 77;
+  for (int j = 0; j < len; j++) data[j] = next_write + j;
+  int written = buffer.writeArray(data, len);
+  next_write += written;
+
+  // read a chunk of a different size
+  int peeked = buffer.peek();
+  int available = buffer.available();
+  int read = buffer.readArray(data, 1 + (total * 7) % 53);
+  assert(read == 0 || peeked == next_read);
+  assert(read <= available);
+  for (int j = 0; j < read; j++) {
+    assert(data[j] == next_read);
+    next_read++;
+  }
+  total += read;
+
+  if (total > 2000) {
+    Serial.println("Test OK");
+    exit(0);
+  }
+}
@@ -0,0 +1,115 @@
+// Test for the AudioSyncWriter and AudioSyncReader: the data is sent over a
+// local socket pair. The socket of the writer only accepts parts of each
+// write, so that the writer needs to continue short writes. The output only
+// accepts small parts of each write, so that the reader needs to retry and
+// may grant the credits only for the accepted data.
+#include "Arduino.h"
+#include "AudioTools.h"
+#include <thread>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace audio_tools;
+
+const size_t total = 500000;
+const size_t window = 4096;
+uint8_t data[total];
+
+/// Stream which is reading and writing a socket: a write is limited to max_write bytes
+class SocketStream : public AudioStream {
+ public:
+  void begin(int fd, size_t max_write = 0) {
+    this->fd = fd;
+    this->max_write = max_write;
+  }
+  int available() override {
+    int n = 0;
+    ioctl(fd, FIONREAD, &n);
+    return n;
+  }
+  size_t readBytes(uint8_t *data, size_t len) override {
+    pollfd p{fd, POLLIN, 0};
+    if (poll(&p, 1, 1000) <= 0) return 0;
+    ssize_t n = ::read(fd, data, len);
+    return n > 0 ? n : 0;
+  }
+  size_t write(const uint8_t *data, size_t len) override {
+    if (max_write > 0 && len > max_write) len = max_write;
+    size_t result = 0;
+    while (result < len) {
+      ssize_t n = ::write(fd, data + result, len - result);
+      if (n <= 0) break;
+      result += n;
+    }
+    return result;
+  }
+
+ protected:
+  int fd = -1;
+  size_t max_write = 0;
+};
+
+/// Output which accepts max 100 bytes per write and checks the received data
+class CheckingOutput : public AudioPrint {
+ public:
+  size_t write(const uint8_t *buffer, size_t len) override {
+    if (len > 100) len = 100;
+    for (size_t j = 0; j < len; j++) {
+      assert(pos < total);
+      assert(buffer[j] == data[pos]);
+      pos++;
+    }
+    return len;
+  }
+  size_t pos = 0;
+};
+
+SocketStream sender;
+SocketStream receiver;
+CheckingOutput out;
+CopyDecoder decoder;
+EncodedAudioStream decoded(&out, &decoder);
+AudioSyncReader reader(receiver, decoded);
+std::thread *p_writer = nullptr;
+size_t received = 0;
+
+void writeAll() {
+  AudioSyncWriter writer(sender);
+  AudioBaseInfo info;
+  info.sample_rate = 44100;
+  info.channels = 2;
+  info.bits_per_sample = 16;
+  bool ok = writer.begin(info, PCM);
+  assert(ok);
+  for (size_t pos = 0; pos < total; pos += 3000) {
+    size_t len = total - pos < 3000 ? total - pos : 3000;
+    size_t written = writer.write(data + pos, len);
+    assert(written == len);
+  }
+  writer.end();
+}
+
+void setup() {
+  AudioLogger::instance().begin(Serial, AudioLogger::Warning);
+  for (size_t j = 0; j < total; j++) data[j] = (j * 131) >> 3;
+  int sv[2];
+  int rc = socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+  assert(rc == 0);
+  sender.begin(sv[0], 7);
+  receiver.begin(sv[1]);
+  reader.setWindowSize(window);
+  p_writer = new std::thread(writeAll);
+}
+
+void loop() {
+  received += reader.copy();
+  // the data must not be confirmed before it was written to the output
+  assert(received == out.pos);
+  if (received == total) {
+    p_writer->join();
+    Serial.println("Test OK");
+    exit(0);
+  }
+}
@@ -0,0 +1,57 @@
+/**
+ * @file player-url_cached-i2s.ino
+ * @brief The downloaded files are stored on the SD drive, so that a repeated
+ * selection of the same url is played from the file. Live streams are buffered
+ * in a file ring buffer.
+ *
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+
+#include "AudioTools.h"
+#include "AudioCodecs/CodecMP3Helix.h"
+#include "AudioLibs/AudioSourceURLCached.h"
+#include "SD.h"
+
+const char *urls[] = {
+  "https://pschatzmann.github.io/Resources/audio/audio.mp3",
+  "https://pschatzmann.github.io/Resources/audio/audio-8000.mp3",
+  "http://stream.srg-ssr.ch/m/rsj/mp3_128"
+};
+const char *wifi = "wifi";
+const char *password = "password";
+
+URLStream urlStream(wifi, password);
+AudioSourceURLCached<fs::SDFS, File> source(SD, urlStream, urls, "audio/mp3");
+I2SStream i2s;
+MP3DecoderHelix decoder;
+AudioPlayer player(source, i2s, decoder);
+File ring_file;
+
+void setup() {
+  Serial.begin(115200);
+  AudioLogger::instance().begin(Serial, AudioLogger::Info);
+
+  // setup SD
+  while (!SD.begin(PIN_CS)) {
+    Serial.println("SD.begin failed");
+    delay(1000);
+  }
+
+  // setup cache: max 20 MB
+  source.setCache("/cache", 20 * 1024 * 1024);
+  // buffer live streams in a 1 MB file
+  ring_file = SD.open("/cache/ring.bin", "w+");
+  source.setLiveBuffer(ring_file, 1024 * 1024);
+
+  // setup output
+  auto cfg = i2s.defaultConfig(TX_MODE);
+  i2s.begin(cfg);
+
+  // setup player
+  player.begin();
+}
+
+void loop() {
+  player.copy();
+}
@@ -5,6 +5,7 @@
  * @brief Audio Player
  */
 
+#include "AudioBasic/Collections/Allocator.h"
 #include "AudioBasic/Collections/Vector.h"
 #include "AudioBasic/Collections/List.h"
 #include "AudioBasic/Collections/Stack.h"
@@ -0,0 +1,180 @@
+#pragma once
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <new>
+#include "AudioTools/AudioLogger.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Memory allocator which is used by the collections: The default
+ * implementation uses malloc and free. Subclasses can provide the memory from
+ * a different source (e.g. a preallocated pool).
+ * @ingroup collections
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class Allocator {
+  public:
+    virtual ~Allocator() = default;
+
+    /// Allocates zero initialized memory: returns nullptr if this is not possible
+    virtual void* allocate(size_t size) {
+        void* result = malloc(size);
+        if (result != nullptr) memset(result, 0, size);
+        return result;
+    }
+
+    /// Releases the memory
+    virtual void free(void* memory) {
+        ::free(memory);
+    }
+
+    /// Allocates and constructs an object
+    template <class T>
+    T* create() {
+        void* memory = allocate(sizeof(T));
+        return memory == nullptr ? nullptr : new (memory) T();
+    }
+
+    /// Destructs and releases an object
+    template <class T>
+    void remove(T* obj) {
+        if (obj == nullptr) return;
+        obj->~T();
+        free(obj);
+    }
+
+    /// Allocates and constructs an array of objects
+    template <class T>
+    T* createArray(size_t len) {
+        T* result = (T*)allocate(sizeof(T) * len);
+        if (result != nullptr) {
+            for (size_t j = 0; j < len; j++) new (result + j) T();
+        }
+        return result;
+    }
+
+    /// Destructs and releases an array of objects
+    template <class T>
+    void removeArray(T* array, size_t len) {
+        if (array == nullptr) return;
+        for (size_t j = 0; j < len; j++) array[j].~T();
+        free(array);
+    }
+
+    /// Provides the shared default allocator
+    static Allocator &defaultAllocator() {
+        static Allocator self;
+        return self;
+    }
+};
+
+/**
+ * @brief Allocator which provides fixed size blocks from a preallocated memory area, so
+ * that after the setup no heap allocations are needed. This is e.g. useful for the nodes
+ * of a List or Vectors with a known max capacity. Requests which are bigger then the block
+ * size or which can not be served because the pool is exhausted are forwarded to the
+ * backing allocator.
+ * @ingroup collections
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AllocatorPool : public Allocator {
+  public:
+    /// Allocates the pool with block_count blocks of block_size bytes from the backing allocator
+    AllocatorPool(size_t block_size, size_t block_count,
+                  Allocator &backing = Allocator::defaultAllocator()) {
+        p_backing = &backing;
+        size_t size = alignedSize(block_size) * block_count;
+        uint8_t* memory = (uint8_t*)backing.allocate(size);
+        if (memory == nullptr) {
+            LOGE("AllocatorPool: not enough memory for %d bytes", (int)size);
+            return;
+        }
+        is_owner = true;
+        setup(memory, size, block_size);
+    }
+
+    /// Uses the provided memory area (e.g. a static array) for the pool
+    AllocatorPool(uint8_t* memory, size_t size, size_t block_size,
+                  Allocator &backing = Allocator::defaultAllocator()) {
+        p_backing = &backing;
+        setup(memory, size, block_size);
+    }
+
+    ~AllocatorPool() {
+        if (is_owner) p_backing->free(p_memory);
+    }
+
+    void* allocate(size_t size) override {
+        if (size > block_size || p_free == nullptr) {
+            LOGW("AllocatorPool: using backing allocator for %d bytes", (int)size);
+            return p_backing->allocate(size);
+        }
+        Block* result = p_free;
+        p_free = p_free->next;
+        free_count--;
+        memset(result, 0, block_size);
+        return result;
+    }
+
+    void free(void* memory) override {
+        if (memory == nullptr) return;
+        if (!isInPool(memory)) {
+            p_backing->free(memory);
+            return;
+        }
+        Block* block = (Block*)memory;
+        block->next = p_free;
+        p_free = block;
+        free_count++;
+    }
+
+    /// Size of the individual blocks
+    size_t blockSize() { return block_size; }
+
+    /// Number of blocks which are still available
+    size_t available() { return free_count; }
+
+  protected:
+    struct Block {
+        Block* next;
+    };
+    Allocator* p_backing = nullptr;
+    uint8_t* p_memory = nullptr;
+    size_t memory_size = 0;
+    size_t block_size = 0;
+    size_t free_count = 0;
+    Block* p_free = nullptr;
+    bool is_owner = false;
+
+    /// blocks are aligned to pointer size and can hold the free list pointer
+    static size_t alignedSize(size_t size) {
+        size_t align = sizeof(void*) > sizeof(double) ? sizeof(void*) : sizeof(double);
+        if (size < sizeof(Block)) size = sizeof(Block);
+        return (size + align - 1) / align * align;
+    }
+
+    void setup(uint8_t* memory, size_t size, size_t blockSize) {
+        block_size = alignedSize(blockSize);
+        p_memory = memory;
+        memory_size = size;
+        // build the free list
+        size_t count = size / block_size;
+        for (size_t j = count; j > 0; j--) {
+            Block* block = (Block*)(memory + (j - 1) * block_size);
+            block->next = p_free;
+            p_free = block;
+        }
+        free_count = count;
+    }
+
+    bool isInPool(void* memory) {
+        uint8_t* ptr = (uint8_t*)memory;
+        return ptr >= p_memory && ptr < p_memory + memory_size;
+    }
+};
+
+}  // namespace audio_tools
@@ -3,11 +3,14 @@
 #  include "InitializerList.h" 
 #endif
 #include <stddef.h>
+#include "AudioBasic/Collections/Allocator.h"
 
 namespace audio_tools {
 
 /**
- * @brief Double linked list
+ * @brief Double linked list: The nodes are allocated with the Allocator, so
+ * that e.g. an AllocatorPool with a block size of sizeof(List<T>::Node) can be used
+ * to avoid heap allocations.
  * @ingroup collections
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -99,6 +102,11 @@ class List {
 
         /// Default constructor
         List() { link(); };
+        /// Constructor which defines the allocator for the nodes
+        List(Allocator &allocator) { 
+            p_allocator = &allocator;
+            link(); 
+        };
         /// copy constructor
         List(const List&ref) = default;
 
@@ -135,7 +143,7 @@ class List {
         }
 
         bool push_back(T data){
-            Node *node = new Node();
+            Node *node = p_allocator->create<Node>();
             if (node==nullptr) return false;
             node->data = data;
 
@@ -152,7 +160,7 @@ class List {
         }
 
         bool push_front(T data){
-            Node *node = new Node();
+            Node *node = p_allocator->create<Node>();
             if (node==nullptr) return false;
             node->data = data;
 
@@ -169,7 +177,7 @@ class List {
         }
 
         bool insert(Iterator it, const T& data){
-            Node *node = new Node();
+            Node *node = p_allocator->create<Node>();
             if (node==nullptr) return false;
             node->data = data;
 
@@ -211,7 +219,7 @@ class List {
             p_prior->next = p_next;
             p_next->prior = p_prior;
 
-            delete p_delete;
+            p_allocator->remove(p_delete);
             record_count--;    
 
             validate();
@@ -231,7 +239,7 @@ class List {
             p_prior->next = p_next;
             p_next->prior = p_prior;
 
-            delete p_delete;
+            p_allocator->remove(p_delete);
             record_count--;
 
             validate();
@@ -251,7 +259,7 @@ class List {
             p_prior->next = p_next;
             p_next->prior = p_prior;
 
-            delete p_delete;
+            p_allocator->remove(p_delete);
             record_count--;    
             return true;
         }
@@ -281,6 +289,12 @@ class List {
             return record_count;
         }
 
+        /// Defines the allocator for the nodes: this needs to be called before any data is added
+        void setAllocator(Allocator &allocator){
+            clear();
+            p_allocator = &allocator;
+        }
+
         bool empty() {
             return size()==0;
         }
@@ -308,6 +322,7 @@ class List {
         Node first; // empty dummy first node which which is always before the first data node 
         Node last; // empty dummy last node which which is always after the last data node 
         size_t record_count=0;
+        Allocator *p_allocator = &Allocator::defaultAllocator();
 
         void link(){
             first.next = &last;
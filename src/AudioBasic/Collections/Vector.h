@@ -2,11 +2,14 @@
 #ifdef USE_INITIALIZER_LIST
 #  include "InitializerList.h" 
 #endif
+#include "AudioBasic/Collections/Allocator.h"
+
 namespace audio_tools {
 
 /**
  * @brief Vector implementation which provides the most important methods as defined by std::vector. This class it is quite handy 
- * to have and most of the times quite better then dealing with raw c arrays.
+ * to have and most of the times quite better then dealing with raw c arrays. The capacity grows geometrically and the memory
+ * is managed by an Allocator, so that a preallocated pool can be used.
  * @ingroup collections
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -108,24 +111,25 @@ class Vector {
 #endif
 
     /// default constructor
-    inline Vector(size_t len = 20) {
+    inline Vector(size_t len = 20, Allocator &allocator = Allocator::defaultAllocator()) {
+      p_allocator = &allocator;
       resize_internal(len, false);
     }
 
     /// allocate size and initialize array
     inline Vector(int size, T value) {
-      resize(size);
-      for (int j=0;j< size;j++){
-        p_data[j] = value;
-      }
+      resize(size, value);
     }
 
-    inline Vector(Vector<T> &&moveFrom) = default;
-
+    /// move constructor
+    inline Vector(Vector<T> &&moveFrom) {
+      swap(moveFrom);
+    }
 
     /// copy constructor
-    inline Vector(Vector<T> &copyFrom) {
-      resize_internal(copyFrom.size(), false);
+    inline Vector(const Vector<T> &copyFrom) {
+      p_allocator = copyFrom.p_allocator;
+      if (!resize_internal(copyFrom.size(), false)) return;
       for (int j=0;j<copyFrom.size();j++){
         p_data[j] = copyFrom[j];
       }
@@ -134,8 +138,8 @@ class Vector {
 
     /// legacy constructor with pointer range
     inline Vector(T *from, T *to) {
+      if (!resize_internal(to - from, false)) return;
       this->len = to - from; 
-      resize_internal(this->len, false);
       for (size_t j=0;j<this->len;j++){
         p_data[j] = from[j];
       }
@@ -143,16 +147,23 @@ class Vector {
 
     /// Destructor
     virtual  ~Vector() {
-      clear();
-      shrink_to_fit();
-      delete [] this->p_data;
+      releaseData(p_data, bufferLen);
+    }
+
+    /// Defines the allocator: this needs to be called before any data is added
+    void setAllocator(Allocator &allocator){
+      releaseData(p_data, bufferLen);
+      p_data = nullptr;
+      bufferLen = 0;
+      len = 0;
+      p_allocator = &allocator;
     }
 
     inline void clear() {
       len = 0;
     }
     
-    inline int size() {
+    inline int size() const {
       return len;
     }
     
@@ -160,17 +171,31 @@ class Vector {
         return size()==0;
     }
 
-    inline void push_back(T value){
-      resize_internal(len+1, true);
-      p_data[len] = value;
+    /// Adds the value at the end: returns false if we could not allocate the memory
+    inline bool push_back(T value){
+      if (!grow(len+1)) return false;
+      p_data[len] = static_cast<T&&>(value);
       len++;
+      return true;
     }
 
-    inline void push_front(T value){
-      resize_internal(len+1, true);
-      memmove(p_data,p_data+1,len*sizeof(T));
-      p_data[0] = value;
+    /// Adds the value at the start: returns false if we could not allocate the memory
+    inline bool push_front(T value){
+      if (!grow(len+1)) return false;
+      for (int j=len;j>0;j--){
+        p_data[j] = static_cast<T&&>(p_data[j-1]);
+      }
+      p_data[0] = static_cast<T&&>(value);
       len++;
+      return true;
+    }
+
+    /// Makes sure that we can store the indicated number of elements w/o reallocation
+    inline bool reserve(int newCapacity){
+      if (newCapacity>bufferLen){
+        return resize_internal(newCapacity, true);
+      }
+      return true;
     }
 
     inline void pop_back(){
@@ -182,8 +207,8 @@ class Vector {
     inline void pop_front(){
         if (len>0) {
           len--;
-          if (len>0){
-            memmove(p_data, p_data+1,len*sizeof(T));
+          for (int j=0;j<len;j++){
+            p_data[j] = static_cast<T&&>(p_data[j+1]);
           }
         }
     }
@@ -191,7 +216,7 @@ class Vector {
 
     inline void assign(iterator v1, iterator v2) {
         size_t newLen = v2 - v1; 
-        resize_internal(newLen, false);
+        if (!resize_internal(newLen, false)) return;
         this->len = newLen;
         int pos = 0;
         for (auto ptr = v1; ptr != v2; ptr++) {
@@ -200,7 +225,7 @@ class Vector {
     }
 
     inline void assign(size_t number, T value) {
-        resize_internal(number, false);
+        if (!resize_internal(number, false)) return;
         this->len = number;
         for (int j=0;j<number;j++){
             p_data[j]=value;
@@ -212,14 +237,17 @@ class Vector {
       T *dataCpy = p_data;
       int bufferLenCpy = bufferLen;
       int lenCpy = len;
+      Allocator *allocatorCpy = p_allocator;
       // swap this
       p_data = in.p_data;
       len = in.len;
       bufferLen = in.bufferLen;
+      p_allocator = in.p_allocator;
       // swp in
       in.p_data = dataCpy;
       in.len = lenCpy;
       in.bufferLen = bufferLenCpy;
+      in.p_allocator = allocatorCpy;
     }
 
     inline T &operator[](int index) {
@@ -227,8 +255,9 @@ class Vector {
       return p_data[index];
     }
 
-    inline Vector<T> &operator=(Vector<T> &copyFrom) {
-      resize_internal(copyFrom.size(), false);
+    inline Vector<T> &operator=(const Vector<T> &copyFrom) {
+      if (this==&copyFrom) return *this;
+      if (!resize_internal(copyFrom.size(), false)) return *this;
       for (int j=0;j<copyFrom.size();j++){
         p_data[j] = copyFrom[j];
       }
@@ -236,6 +265,11 @@ class Vector {
       return *this;
     }
 
+    inline Vector<T> &operator=(Vector<T> &&moveFrom) {
+      swap(moveFrom);
+      return *this;
+    }
+
     inline T &operator[] (const int index) const {
       return p_data[index];
     }
@@ -250,17 +284,19 @@ class Vector {
       return false;
     }
 
-    inline void shrink_to_fit() {
-        resize_internal(this->len, true, true);
+    /// Releases the unused capacity: returns false if we could not allocate the memory
+    inline bool shrink_to_fit() {
+        return resize_internal(this->len, true, true);
     }
 
     int capacity(){
       return this->bufferLen;
     }
 
+    /// Changes the size: returns false if we could not allocate the memory (the size stays unchanged)
     inline bool resize(int newSize){
         int oldSize = this->len;
-        resize_internal(newSize, true);
+        if (!resize_internal(newSize, true)) return false;
         this->len = newSize;        
         return this->len!=oldSize;
     }
@@ -281,11 +317,10 @@ class Vector {
     inline void erase(iterator it) {
       int pos = it.pos();
       if (pos<len){
-          int lenToEnd = len - pos - 1;
-          // call destructor on data to be erased
-          p_data[pos].~T();
           // shift values by 1 position
-          memmove((void*) &p_data[pos],(void*)(&p_data[pos+1]),lenToEnd*sizeof(T));
+          for (int j=pos;j<len-1;j++){
+            p_data[j] = static_cast<T&&>(p_data[j+1]);
+          }
           // make sure that we have a valid object at the end
           p_data[len-1] = T();
           len--;
@@ -304,32 +339,51 @@ class Vector {
     int bufferLen=0;
     int len = 0;
     T *p_data = nullptr;
+    Allocator *p_allocator = &Allocator::defaultAllocator();
+
+    /// amortized geometric growth
+    inline bool grow(int minSize) {
+      if (minSize>bufferLen || p_data==nullptr){
+        int newSize = bufferLen + bufferLen / 2;
+        if (newSize<minSize) newSize = minSize;
+        if (newSize<4) newSize = 4;
+        if (resize_internal(newSize, true)) return true;
+        // try again with the minimum size
+        return newSize>minSize && resize_internal(minSize, true);
+      }
+      return true;
+    }
 
-    inline void resize_internal(int newSize, bool copy, bool shrink=false)  {
-      if (newSize<=0) return;
-      //bool withNewSize = false;
+    /// (Re)allocates the buffer: returns false and keeps the old data if we could not allocate the memory
+    inline bool resize_internal(int newSize, bool copy, bool shrink=false)  {
+      if (newSize<=0) return true;
       if (newSize>bufferLen || this->p_data==nullptr ||shrink){
-        //withNewSize = true;            
         T* oldData = p_data;
         int oldBufferLen = this->bufferLen;
-        this->p_data = new T[newSize+1];
+        // we allocate one additional element
+        this->p_data = p_allocator->createArray<T>(newSize+1);
+        if (this->p_data==nullptr){
+          LOGE("Vector: not enough memory for %d elements", newSize);
+          p_data = oldData;
+          return false;
+        }
         this->bufferLen = newSize;  
         if (oldData != nullptr) {
           if(copy && this->len > 0){
-              memcpy((void*)p_data,(void*) oldData, this->len*sizeof(T));
+            int copyLen = this->len < newSize ? this->len : newSize;
+            for (int j=0;j<copyLen;j++){
+              p_data[j] = static_cast<T&&>(oldData[j]);
+            }
           }
-          if (shrink){
-            cleanup(oldData, newSize, oldBufferLen);
-          }
-          delete [] oldData;            
+          releaseData(oldData, oldBufferLen);
         }  
       }
-      assert(p_data!=nullptr);
+      return true;
     }
 
-    void cleanup(T*p_data, int from, int to){
-      for (int j=from;j<to;j++){
-        p_data[j].~T();
+    void releaseData(T* data, int bufferLen){
+      if (data!=nullptr){
+        p_allocator->removeArray(data, bufferLen+1);
       }
     }
 };
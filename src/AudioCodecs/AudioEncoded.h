@@ -5,8 +5,84 @@
 #include "AudioTools/AudioStreams.h"
 #include "AudioTools/AudioTypes.h"
 
+/// Size of the encoded data which is read from the input in one step in the pull mode
+#ifndef DECODER_PULL_READ_SIZE
+#define DECODER_PULL_READ_SIZE 256
+#endif
+
 namespace audio_tools {
 
+/**
+ * @brief Output target for the pull mode decoding: the decoded data is written directly into 
+ * the buffer which was defined with setTarget() and what does not fit is kept for the next call.
+ * @ingroup codecs
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DecoderPullBuffer : public AudioPrint {
+public:
+  /// Defines the target buffer and fills it with the surplus of the last call
+  void setTarget(uint8_t *out, size_t max) {
+    p_target = out;
+    max_len = max;
+    len = surplus_len - surplus_pos;
+    if (len > max_len) len = max_len;
+    if (len > 0) memcpy(p_target, surplus.data() + surplus_pos, len);
+    surplus_pos += len;
+    if (surplus_pos == surplus_len) {
+      surplus_pos = 0;
+      surplus_len = 0;
+    }
+  }
+
+  size_t write(const uint8_t *data, size_t size) override {
+    size_t copy = max_len - len;
+    if (copy > size) copy = size;
+    if (copy > 0) memcpy(p_target + len, data, copy);
+    len += copy;
+    // keep the rest
+    size_t rest = size - copy;
+    if (rest > 0) {
+      if ((int)(surplus_len + rest) > surplus.size()) surplus.resize(surplus_len + rest);
+      memcpy(surplus.data() + surplus_len, data + copy, rest);
+      surplus_len += rest;
+    }
+    return size;
+  }
+
+  int availableForWrite() override { return DEFAULT_BUFFER_SIZE; }
+
+  /// Detaches the target buffer: any further data is kept for the next call
+  void releaseTarget() {
+    p_target = nullptr;
+    max_len = 0;
+    len = 0;
+  }
+
+  /// Returns true if the target buffer is full
+  bool isFull() { return len >= max_len; }
+
+  /// Number of bytes in the target buffer
+  size_t size() { return len; }
+
+  /// Number of bytes which are kept for the next call
+  size_t surplusSize() { return surplus_len - surplus_pos; }
+
+  void clear() {
+    len = 0;
+    surplus_pos = 0;
+    surplus_len = 0;
+  }
+
+protected:
+  uint8_t *p_target = nullptr;
+  size_t max_len = 0;
+  size_t len = 0;
+  Vector<uint8_t> surplus{0};
+  size_t surplus_pos = 0;
+  size_t surplus_len = 0;
+};
+
 /**
  * @brief Docoding of encoded audio into PCM data
  * @ingroup codecs
@@ -35,7 +111,64 @@ public:
   }
   virtual void setOutputStream(Print &out_stream) override = 0;
   // Th decoding result is PCM data
-  virtual bool isResultPCM() { return true;} 
+  virtual bool isResultPCM() { return true;}
+
+  /// Provides the byte position in the encoded data for the indicated time in ms: returns -1 if seeking is not supported
+  virtual long seekPosition(uint32_t timeMs) { return -1; }
+  /// Notifies the decoder that the encoded input has been moved to the indicated byte position (as determined by seekPosition())
+  virtual void setSeekPosition(size_t pos, uint32_t timeMs) {}
+  /// Defines the total size of the encoded input in bytes, which can be used to calculate the duration
+  virtual void setInputSize(size_t size) {}
+  /// Provides the actual playing position in ms: 0 if not supported
+  virtual uint32_t positionMs() { return 0; }
+  /// Provides the total playing time in ms: 0 if not known
+  virtual uint32_t durationMs() { return 0; }
+
+  /// Defines the input for the pull mode decoding with decode()
+  virtual void setInputStream(Stream &in) { p_input = &in; }
+  /// Returns true if the decoder supports the pull mode with decode()
+  virtual bool isPullSupported() { return false; }
+  /// Pull mode: reads the encoded data from the input and decodes it directly into the buffer. Returns the number of bytes.
+  virtual size_t decode(uint8_t *out, size_t max) { return 0; }
+  /// Number of decoded bytes which are kept from the last decode() call
+  virtual size_t decodeSurplus() { return pull_buffer.surplusSize(); }
+  /// Packet loss concealment: writes a replacement for a lost packet to the output, using the (optional)
+  /// next packet for the forward error correction. Returns false if this is not supported.
+  virtual bool conceal(const uint8_t *next, size_t next_len) { return false; }
+
+protected:
+  Stream *p_input = nullptr;
+  DecoderPullBuffer pull_buffer;
+
+  /// Removes the output which was defined with setOutputStream(): the decoded data is discarded
+  virtual void clearOutputStream() {
+    static NullStream null_out;
+    Print &print = null_out;
+    setOutputStream(print);
+  }
+
+  /// Pull mode for decoders which provide the result via the output: the output is temporarily
+  /// replaced by the pull buffer and the previous (or undefined) output is restored at the end
+  size_t decodeViaOutput(uint8_t *out, size_t max, Print *p_previous) {
+    if (p_input == nullptr) return 0;
+    Print &print = pull_buffer;
+    setOutputStream(print);
+    pull_buffer.setTarget(out, max);
+    uint8_t data[DECODER_PULL_READ_SIZE];
+    while (!pull_buffer.isFull()) {
+      size_t len = p_input->readBytes(data, DECODER_PULL_READ_SIZE);
+      if (len == 0) break;
+      write(data, len);
+    }
+    size_t result = pull_buffer.size();
+    pull_buffer.releaseTarget();
+    if (p_previous != nullptr) {
+      setOutputStream(*p_previous);
+    } else {
+      clearOutputStream();
+    }
+    return result;
+  }
 };
 
 /**
@@ -137,6 +270,15 @@ public:
   /// Process a single read operation - to be called in the loop
   virtual bool copy() = 0;
 
+  /// Moves to the indicated time in ms: the decoder repositions the input itself. Returns false if not supported
+  virtual bool seek(uint32_t timeMs) { return false; }
+
+  /// Provides the actual playing position in ms: 0 if not supported
+  virtual uint32_t positionMs() { return 0; }
+
+  /// Provides the total duration in ms: 0 if not known
+  virtual uint32_t durationMs() { return 0; }
+
 protected:
   virtual size_t readBytes(uint8_t *buffer, size_t len) = 0;
 };
@@ -467,6 +609,9 @@ public:
 
   int available() override {
     if (p_stream==nullptr) return 0;
+    if (decoder_ptr->isPullSupported()) {
+      return p_stream->available()>0 || decoder_ptr->decodeSurplus()>0 ? DEFAULT_BUFFER_SIZE : 0;
+    }
     decode(reqested_bytes);
     return decoded_buffer.available();
   }
@@ -474,6 +619,14 @@ public:
   size_t readBytes(uint8_t *buffer, size_t length) override {
     TRACED();
     if (p_stream==nullptr) return 0;
+    // the decoder writes directly into the buffer
+    if (decoder_ptr->isPullSupported()) {
+      if (!is_setup) {
+        is_setup = true;
+        decoder_ptr->setInputStream(*p_stream);
+      }
+      return decoder_ptr->decode(buffer, length);
+    }
     decode(reqested_bytes);
     return decoded_buffer.readArray(buffer, length);
   }
@@ -91,6 +91,21 @@ class Decoder8Bit : public AudioDecoder {
             return p_print->write((uint8_t*)buffer.data(), in_size*sizeof(int16_t));
         }
 
+        bool isPullSupported() override { return true; }
+
+        /// Pull mode: the 8 bit data is read into the second half of the buffer and expanded in place
+        size_t decode(uint8_t *data, size_t max) override {
+            if (p_input==nullptr) return 0;
+            size_t samples = max / sizeof(int16_t);
+            int8_t* pt8 = (int8_t*) data + samples;
+            samples = p_input->readBytes((uint8_t*)pt8, samples);
+            int16_t* pt16 = (int16_t*) data;
+            for (size_t j=0;j<samples;j++){
+                pt16[j] = pt8[j]*258;
+            }
+            return samples*sizeof(int16_t);
+        }
+
         virtual operator bool() override {
             return active;
         }
@@ -39,6 +39,7 @@ class AACDecoderHelix : public AudioDecoder  {
          */
         AACDecoderHelix(Print &out_stream){
             TRACED();
+            p_out = &out_stream;
             aac = new libhelix::AACDecoderHelix(out_stream);
             if (aac==nullptr){
                 LOGE("Not enough memory for libhelix");
@@ -54,6 +55,7 @@ class AACDecoderHelix : public AudioDecoder  {
          */
         AACDecoderHelix(Print &out_stream, AudioBaseInfoDependent &bi){
             TRACED();
+            p_out = &out_stream;
             aac = new libhelix::AACDecoderHelix(out_stream);
             if (aac==nullptr){
                 LOGE("Not enough memory for libhelix");
@@ -73,6 +75,7 @@ class AACDecoderHelix : public AudioDecoder  {
         /// Defines the output Stream
         virtual void setOutputStream(Print &out_stream){
             TRACED();
+            p_out = &out_stream;
             if (aac!=nullptr) aac->setOutput(out_stream);
         }
 
@@ -109,6 +112,13 @@ class AACDecoderHelix : public AudioDecoder  {
             return aac==nullptr ? 0 : aac->write(aac_data, len);
         }
 
+        bool isPullSupported() override { return true; }
+
+        /// Pull mode: the decoded frames are collected directly in the buffer
+        size_t decode(uint8_t *buffer, size_t max) override {
+            return decodeViaOutput(buffer, max, p_out);
+        }
+
         /// checks if the class is active 
         virtual operator bool(){
             return aac!=nullptr && (bool)*aac;
@@ -158,7 +168,14 @@ class AACDecoderHelix : public AudioDecoder  {
         }
 
     protected:
+        /// libhelix needs an output: the decoded data is discarded
+        void clearOutputStream() override {
+            AudioDecoder::clearOutputStream();
+            p_out = nullptr;
+        }
+
         libhelix::AACDecoderHelix *aac=nullptr;
+        Print *p_out=nullptr;
 
 };
 
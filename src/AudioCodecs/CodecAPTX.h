@@ -10,6 +10,7 @@
  */
 #pragma once
 #include "AudioCodecs/AudioEncoded.h"
+#include "AudioCodecs/FrameAssembler.h"
 #include "openaptx.h"
 
 /** 
@@ -219,6 +220,10 @@ class APTXEncoder : public AudioEncoder {
     TRACEI();
     input_buffer.resize(4 * 2);
     output_buffer.resize(100 * (is_hd ? 6 : 4));
+    // 4 stereo samples are encoded into 4 (or 6 for HD) bytes
+    assembler.setAlignment(sizeof(int16_t));
+    assembler.begin(input_buffer.size() * sizeof(int16_t), is_hd ? 6 : 4,
+                    output_buffer.size());
 
     LOGI("input_buffer.size: %d", input_buffer.size());
     LOGI("output_buffer.size: %d", output_buffer.size());
@@ -268,44 +273,12 @@ class APTXEncoder : public AudioEncoder {
   virtual size_t write(const void *in_ptr, size_t in_size) {
     LOGI("write: %d", in_size);
     if (ctx == nullptr) return 0;
-    size_t output_written = 0;
-
-    // process all bytes
-    int16_t *in_ptr16 = (int16_t *)in_ptr;
-    int in_samples = in_size / 2;
-    for (int j = 0; j < in_samples; j++) {
-      input_buffer[input_pos++].setAndScale16(in_ptr16[j]);
-
-      // if input_buffer is full we encode
-      if (input_pos >= input_buffer.size()) {
-        size_t result = aptx_encode(
-            ctx, (const uint8_t *)input_buffer.data(), input_buffer.size() * 3,
-            output_buffer.data() + output_pos,
-            output_buffer.size() - output_pos, &output_written);
-
-        output_pos += output_written;
 
-        if (result != input_buffer.size() * 3) {
-          LOGW("encode requested: %d, eff: %d", input_buffer.size() * 3,
-               result);
-        }
-
-        // if output buffer is full we write the result
-        if (output_pos + output_pos >= output_buffer.size()) {
-          int written =
-              p_print->write((const uint8_t *)output_buffer.data(), output_pos);
-          if (written != output_pos) {
-            LOGE("write requested: %d eff: %d", output_pos, written);
-          }
-          // restart at beginning of output buffer
-          output_pos = 0;
-        }
-        // restart at beginning of input buffer
-        input_pos = 0;
-      }
-    }
-
-    return in_size;
+    // encode blocks of 4 stereo samples
+    return assembler.write((const uint8_t *)in_ptr, in_size, *p_print,
+                           [this](const uint8_t *block, uint8_t *result) {
+                             return encodeBlock((const int16_t *)block, result);
+                           });
   }
 
  protected:
@@ -313,10 +286,24 @@ class APTXEncoder : public AudioEncoder {
   AudioBaseInfo info;
   Vector<int24_t> input_buffer{4 * 2};
   Vector<uint8_t> output_buffer;
-  int input_pos = 0;
-  int output_pos = 0;
+  FrameAssembler assembler;
   Print *p_print = nullptr;
   struct aptx_context *ctx = nullptr;
+
+  /// Converts the 16 bit samples to 24 bits and encodes them: returns the number of bytes
+  size_t encodeBlock(const int16_t *block, uint8_t *result) {
+    for (int j = 0; j < input_buffer.size(); j++) {
+      input_buffer[j].setAndScale16(block[j]);
+    }
+    size_t output_written = 0;
+    size_t processed =
+        aptx_encode(ctx, (const uint8_t *)input_buffer.data(),
+                    input_buffer.size() * 3, result, is_hd ? 6 : 4, &output_written);
+    if (processed != input_buffer.size() * 3) {
+      LOGW("encode requested: %d, eff: %d", input_buffer.size() * 3, processed);
+    }
+    return output_written;
+  }
 };
 
 }  // namespace audio_tools
\ No newline at end of file
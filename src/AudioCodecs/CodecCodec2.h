@@ -18,6 +18,7 @@
 #pragma once
 
 #include "AudioCodecs/AudioEncoded.h"
+#include "AudioCodecs/FrameAssembler.h"
 #include "codec2.h"
 
 /** 
@@ -110,8 +111,8 @@ public:
       return;
     }
 
-    result_buffer.resize(codec2_samples_per_frame(p_codec2));
-    input_buffer.resize(codec2_bytes_per_frame(p_codec2));
+    assembler.begin(codec2_bytes_per_frame(p_codec2),
+                    codec2_samples_per_frame(p_codec2) * sizeof(int16_t));
 
     if (p_notify != nullptr) {
       p_notify->setAudioInfo(cfg);
@@ -140,12 +141,12 @@ public:
       return 0;
     }
 
-    uint8_t *p_byte = (uint8_t *)data;
-    for (int j = 0; j < length; j++) {
-      processByte(p_byte[j]);
-    }
-
-    return length;
+    // decode complete frames
+    return assembler.write((const uint8_t *)data, length, *p_print,
+                           [this](const uint8_t *frame, uint8_t *result) -> size_t {
+                             codec2_decode(p_codec2, (int16_t *)result, frame);
+                             return codec2_samples_per_frame(p_codec2) * sizeof(int16_t);
+                           });
   }
 
 protected:
@@ -154,23 +155,8 @@ protected:
   AudioBaseInfo cfg;
   AudioBaseInfoDependent *p_notify = nullptr;
   bool is_active = false;
-  Vector<uint8_t> input_buffer;
-  Vector<int16_t> result_buffer;
-  int input_pos = 0;
+  FrameAssembler assembler;
   int bits_per_second=2400;
-
-  /// Build decoding buffer and decode when frame is full
-  void processByte(uint8_t byte) {
-    // add byte to buffer
-    input_buffer[input_pos++] = byte;
-
-    // decode if buffer is full
-    if (input_pos >= input_buffer.size()) {
-      codec2_decode(p_codec2, result_buffer.data(), input_buffer.data());
-      p_print->write((uint8_t*)result_buffer.data(), result_buffer.size()*2);
-      input_pos = 0;
-    }
-  }
 };
 
 /**
@@ -227,8 +213,9 @@ public:
       return;
     }
 
-    input_buffer.resize(codec2_samples_per_frame(p_codec2)*sizeof(int16_t));
-    result_buffer.resize(codec2_bytes_per_frame(p_codec2));
+    assembler.setAlignment(sizeof(int16_t));
+    assembler.begin(codec2_samples_per_frame(p_codec2) * sizeof(int16_t),
+                    codec2_bytes_per_frame(p_codec2));
     is_active = true;
   }
 
@@ -252,12 +239,12 @@ public:
       LOGE("inactive");
       return 0;
     }
-    // encode bytes
-    uint8_t *p_byte = (uint8_t *)in_ptr;
-    for (int j = 0; j < in_size; j++) {
-      processByte(p_byte[j]);
-    }
-    return in_size;
+    // encode complete frames
+    return assembler.write((const uint8_t *)in_ptr, in_size, *p_print,
+                           [this](const uint8_t *frame, uint8_t *result) -> size_t {
+                             codec2_encode(p_codec2, result, (int16_t *)frame);
+                             return codec2_bytes_per_frame(p_codec2);
+                           });
   }
 
 protected:
@@ -265,21 +252,8 @@ protected:
   Print *p_print = nullptr;
   struct CODEC2 *p_codec2;
   bool is_active = false;
-  int buffer_pos = 0;
-  Vector<uint8_t> input_buffer;
-  Vector<uint8_t> result_buffer;
+  FrameAssembler assembler;
   int bits_per_second=2400;
-
-  // add byte to decoding buffer and decode if buffer is full
-  void processByte(uint8_t byte) {
-    input_buffer[buffer_pos++] = byte;
-    if (buffer_pos >= input_buffer.size()) {
-      // encode
-      codec2_encode(p_codec2, result_buffer.data(),(int16_t*)input_buffer.data());
-      p_print->write(result_buffer.data(), result_buffer.size());
-      buffer_pos = 0;
-    }
-  }
 };
 
 } // namespace audio_tools
\ No newline at end of file
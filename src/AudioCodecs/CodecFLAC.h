@@ -32,6 +32,9 @@ namespace audio_tools {
 /**
  * @brief Decoder for FLAC. Depends on https://github.com/pschatzmann/arduino-libflac. We support an efficient streaming API and an very memory intensitiv standard interface. So 
  * you should prefer the streaming interface where you call setOutputStream() before the begin and copy() in the loop.
+ * Seeking is provided by the StreamingDecoder interface (seek(), positionMs() and durationMs()) and needs an input
+ * which was defined with setInputFile(): libflac repositions the file itself, so in difference to the MP3 and WAV
+ * decoders this is not using AudioDecoder::seekPosition() and it can not be driven by the AudioPlayer.
  * Validated with http://www.2l.no/hires/
  * @ingroup codec-flac
  * @author Phil Schatzmann
@@ -75,10 +78,17 @@ class FLACDecoder : public StreamingDecoder {
 
     FLAC__stream_decoder_set_md5_checking(decoder, false);
 
+    // seeking is only supported if the input is a file
+    FLAC__StreamDecoderSeekCallback seek_cb = isSeekable() ? seek_callback : nullptr;
+    FLAC__StreamDecoderTellCallback tell_cb = isSeekable() ? tell_callback : nullptr;
+    FLAC__StreamDecoderLengthCallback length_cb = isSeekable() ? length_callback : nullptr;
+    FLAC__StreamDecoderEofCallback eof_cb = isSeekable() ? eof_callback : nullptr;
+    sample_pos = 0;
+
     if (is_ogg){
-      init_status = FLAC__stream_decoder_init_ogg_stream( decoder, read_callback, nullptr, nullptr, nullptr, nullptr, write_callback, nullptr, error_callback, this);
+      init_status = FLAC__stream_decoder_init_ogg_stream( decoder, read_callback, seek_cb, tell_cb, length_cb, eof_cb, write_callback, nullptr, error_callback, this);
     } else {
-      init_status = FLAC__stream_decoder_init_stream( decoder, read_callback, nullptr, nullptr, nullptr, nullptr, write_callback, nullptr, error_callback, this);
+      init_status = FLAC__stream_decoder_init_stream( decoder, read_callback, seek_cb, tell_cb, length_cb, eof_cb, write_callback, nullptr, error_callback, this);
     }
 
     if (init_status != FLAC__STREAM_DECODER_INIT_STATUS_OK) {
@@ -109,6 +119,48 @@ class FLACDecoder : public StreamingDecoder {
   /// then feeding the decoder with write: just call copy() in the loop
   void setInputStream(Stream &input) {
     p_input = &input;
+    p_file = nullptr;
+  }
+
+  /// Stream Interface with seek support: the input must provide seek(), position() and size() like
+  /// the Arduino File classes. Call this method before begin().
+  template <class F>
+  void setInputFile(F &file) {
+    p_input = &file;
+    p_file = &file;
+    file_seek = [](void *f, uint64_t pos) { return (bool)((F *)f)->seek(pos); };
+    file_position = [](void *f) { return (uint64_t)((F *)f)->position(); };
+    file_size = [](void *f) { return (uint64_t)((F *)f)->size(); };
+  }
+
+  /// Moves to the indicated time in ms: this is using the seek table of the file if available
+  /// (otherwise libflac is doing a binary search). Only supported if the input was defined with setInputFile()
+  bool seek(uint32_t timeMs) override {
+    if (!is_active || !isSeekable()) return false;
+    FLAC__uint64 sample = (FLAC__uint64)timeMs * FLAC__stream_decoder_get_sample_rate(decoder) / 1000;
+    FLAC__uint64 total = FLAC__stream_decoder_get_total_samples(decoder);
+    if (total > 0 && sample >= total) sample = total - 1;
+    if (!FLAC__stream_decoder_seek_absolute(decoder, sample)) {
+      LOGE("FLAC__stream_decoder_seek_absolute: %u ms", (unsigned)timeMs);
+      // after a failed seek the decoder must be flushed
+      FLAC__stream_decoder_flush(decoder);
+      return false;
+    }
+    sample_pos = sample;
+    return true;
+  }
+
+  /// Provides the actual playing position in ms
+  uint32_t positionMs() override {
+    int rate = is_active ? FLAC__stream_decoder_get_sample_rate(decoder) : 0;
+    return rate == 0 ? 0 : sample_pos * 1000 / rate;
+  }
+
+  /// Provides the duration in ms from the STREAMINFO: 0 if not known
+  uint32_t durationMs() override {
+    if (!is_active) return 0;
+    int rate = FLAC__stream_decoder_get_sample_rate(decoder);
+    return rate == 0 ? 0 : FLAC__stream_decoder_get_total_samples(decoder) * 1000 / rate;
   }
 
   virtual void setOutputStream(Print &out_stream) { p_print = &out_stream; }
@@ -145,6 +197,37 @@ class FLACDecoder : public StreamingDecoder {
   Stream *p_input = nullptr;
   uint64_t time_last_read = 0;
   uint64_t read_timeout_ms = FLAC_READ_TIMEOUT_MS;
+  // file based input which supports seeking
+  void *p_file = nullptr;
+  bool (*file_seek)(void *file, uint64_t pos) = nullptr;
+  uint64_t (*file_position)(void *file) = nullptr;
+  uint64_t (*file_size)(void *file) = nullptr;
+  FLAC__uint64 sample_pos = 0;
+
+  /// Check if the input supports seeking
+  bool isSeekable() { return p_file != nullptr; }
+
+  static FLAC__StreamDecoderSeekStatus seek_callback(const FLAC__StreamDecoder *decoder, FLAC__uint64 absolute_byte_offset, void *client_data) {
+    FLACDecoder *self = (FLACDecoder *)client_data;
+    return self->file_seek(self->p_file, absolute_byte_offset) ? FLAC__STREAM_DECODER_SEEK_STATUS_OK : FLAC__STREAM_DECODER_SEEK_STATUS_ERROR;
+  }
+
+  static FLAC__StreamDecoderTellStatus tell_callback(const FLAC__StreamDecoder *decoder, FLAC__uint64 *absolute_byte_offset, void *client_data) {
+    FLACDecoder *self = (FLACDecoder *)client_data;
+    *absolute_byte_offset = self->file_position(self->p_file);
+    return FLAC__STREAM_DECODER_TELL_STATUS_OK;
+  }
+
+  static FLAC__StreamDecoderLengthStatus length_callback(const FLAC__StreamDecoder *decoder, FLAC__uint64 *stream_length, void *client_data) {
+    FLACDecoder *self = (FLACDecoder *)client_data;
+    *stream_length = self->file_size(self->p_file);
+    return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
+  }
+
+  static FLAC__bool eof_callback(const FLAC__StreamDecoder *decoder, void *client_data) {
+    FLACDecoder *self = (FLACDecoder *)client_data;
+    return self->file_position(self->p_file) >= self->file_size(self->p_file);
+  }
 
 
   /// Check if input is directly from stream - instead of writes
@@ -213,6 +296,13 @@ class FLACDecoder : public StreamingDecoder {
       }
     }
 
+    // update the playing position
+    if (frame->header.number_type == FLAC__FRAME_NUMBER_TYPE_SAMPLE_NUMBER) {
+      self->sample_pos = frame->header.number.sample_number + frame->header.blocksize;
+    } else {
+      self->sample_pos += frame->header.blocksize;
+    }
+
     // write audio data
     int bps = FLAC__stream_decoder_get_bits_per_sample(decoder);
     int16_t sample;
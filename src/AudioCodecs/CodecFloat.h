@@ -94,6 +94,27 @@ class DecoderFloat : public AudioDecoder {
             return p_print->write((uint8_t*)buffer.data(), samples*sizeof(int16_t));
         }
 
+        bool isPullSupported() override { return true; }
+
+        /// Pull mode: the floats are read into the free part of the buffer and converted in place
+        size_t decode(uint8_t *data, size_t max) override {
+            if (p_input==nullptr) return 0;
+            size_t result = 0;
+            while (max - result >= sizeof(float)){
+                size_t requested = (max - result) / sizeof(float) * sizeof(float);
+                size_t len = p_input->readBytes(data + result, requested);
+                int samples = len / sizeof(float);
+                float* p_float = (float*) (data + result);
+                int16_t* p_int = (int16_t*) (data + result);
+                for (int j=0;j<samples;j++){
+                    p_int[j] = p_float[j]*32767;
+                }
+                result += samples * sizeof(int16_t);
+                if (len < requested) break;
+            }
+            return result;
+        }
+
         virtual operator bool() override {
             return active;
         }
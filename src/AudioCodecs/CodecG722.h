@@ -9,11 +9,13 @@
 #pragma once
 
 #include "AudioCodecs/AudioEncoded.h"
+#include "AudioCodecs/FrameAssembler.h"
 #include "g722_codec.h"
 
 // size in bytes
 #define G722_PCM_SIZE 80
 #define G722_ENC_SIZE 40
+#define G722_DEC_SIZE 10
 
 /** 
  * @defgroup codec-g722 g722
@@ -50,8 +52,8 @@ class G722Decoder : public AudioDecoder {
 
   virtual void begin() {
     TRACEI();
-    input_buffer.resize(10);
-    result_buffer.resize(40);
+    // max 2 samples per code (16000 samples per second)
+    assembler.begin(G722_DEC_SIZE, G722_DEC_SIZE * 2 * sizeof(int16_t));
 
     g722_dctx = g722_decoder_new(cfg.sample_rate, options);
     if (g722_dctx == nullptr) {
@@ -86,12 +88,13 @@ class G722Decoder : public AudioDecoder {
       return 0;
     }
 
-    uint8_t *p_byte = (uint8_t *)data;
-    for (int j = 0; j < length; j++) {
-      processByte(p_byte[j]);
-    }
-
-    return length;
+    // decode complete frames
+    return assembler.write((const uint8_t *)data, length, *p_print,
+                           [this](const uint8_t *frame, uint8_t *result) -> size_t {
+                             int result_samples = g722_decode(g722_dctx, frame, G722_DEC_SIZE,
+                                                              (int16_t *)result);
+                             return result_samples * sizeof(int16_t);
+                           });
   }
 
  protected:
@@ -99,30 +102,9 @@ class G722Decoder : public AudioDecoder {
   G722_DEC_CTX *g722_dctx=nullptr;
   AudioBaseInfo cfg;
   AudioBaseInfoDependent *p_notify = nullptr;
-  Vector<uint8_t> input_buffer;
-  Vector<uint8_t> result_buffer;
+  FrameAssembler assembler;
   int options = G722_SAMPLE_RATE_8000;
-  int input_pos = 0;
   bool is_active = false;
-
-  /// Build decoding buffer and decode when frame is full
-  void processByte(uint8_t byte) {
-    // add byte to buffer
-    input_buffer[input_pos++] = byte;
-
-    // decode if buffer is full
-    if (input_pos >= input_buffer.size()) {
-      int result_samples = g722_decode(g722_dctx, input_buffer.data(), input_buffer.size(),
-                  (int16_t *)result_buffer.data());
-
-      if (result_samples*2>result_buffer.size()){
-        LOGE("Decoder:Result buffer too small: %d -> %d",result_buffer.size(),result_samples*2);
-      }
-
-      p_print->write(result_buffer.data(), result_samples);
-      input_pos = 0;
-    }
-  }
 };
 
 /**
@@ -159,8 +141,8 @@ class G722Encoder : public AudioEncoder {
       return;
     }
 
-    input_buffer.resize(G722_PCM_SIZE);
-    result_buffer.resize(G722_ENC_SIZE);
+    assembler.setAlignment(sizeof(int16_t));
+    assembler.begin(G722_PCM_SIZE, G722_ENC_SIZE);
     is_active = true;
   }
 
@@ -184,40 +166,21 @@ class G722Encoder : public AudioEncoder {
       LOGE("inactive");
       return 0;
     }
-    // encode bytes
-    uint8_t *p_byte = (uint8_t *)in_ptr;
-    for (int j = 0; j < in_size; j++) {
-      processByte(p_byte[j]);
-    }
-    return in_size;
+    // encode complete frames
+    return assembler.write((const uint8_t *)in_ptr, in_size, *p_print,
+                           [this](const uint8_t *frame, uint8_t *result) -> size_t {
+                             return g722_encode(g722_ectx, (const int16_t *)frame,
+                                                G722_PCM_SIZE / 2, result);
+                           });
   }
 
  protected:
   AudioBaseInfo cfg;
   Print *p_print = nullptr;
   G722_ENC_CTX *g722_ectx = nullptr;
-  Vector<uint8_t> input_buffer;
-  Vector<uint8_t> result_buffer;
+  FrameAssembler assembler;
   int options = G722_SAMPLE_RATE_8000;
-  int buffer_pos = 0;
   bool is_active = false;
-
-  // add byte to decoding buffer and decode if buffer is full
-  void processByte(uint8_t byte) {
-    input_buffer[buffer_pos++] = byte;
-    if (buffer_pos >= input_buffer.size()) {
-      // convert for little endian
-      int samples = input_buffer.size() / 2;
-      // encode
-     int result_len = g722_encode(g722_ectx,(const int16_t*) input_buffer.data(), samples,
-                  result_buffer.data());
-      if (result_len>result_buffer.size()){
-        LOGE("Encoder:Result buffer too small: %d -> %d",result_buffer.size(),result_len);
-      }
-      p_print->write(result_buffer.data(), result_len);
-      buffer_pos = 0;
-    }
-  }
 };
 
 }  // namespace audio_tools
\ No newline at end of file
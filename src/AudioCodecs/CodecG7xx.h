@@ -1,5 +1,7 @@
 #pragma once
 
+#include "AudioCodecs/FrameAssembler.h"
+
 extern "C"{
   #include "g72x.h"
 }
@@ -77,6 +79,8 @@ class G7xxDecoder : public AudioDecoder {
     in_bits = 0;
     out_size = sizeof(int16_t);
     g72x_init_state(&state);
+    // one code per sample
+    assembler.begin(1, out_size);
 
     is_active = true;
   }
@@ -101,13 +105,27 @@ class G7xxDecoder : public AudioDecoder {
       return 0;
     }
 
-    uint8_t *p_byte = (uint8_t *)data;
-    for (int j = 0; j < length; j++) {
-      sample = (*dec_routine)(p_byte[j], AUDIO_ENCODING_LINEAR, &state);
-      p_print->write((uint8_t*)&sample, out_size);
-    }
+    return assembler.write((const uint8_t *)data, length, *p_print,
+                           [this](const uint8_t *code, uint8_t *result) -> size_t {
+                             int16_t sample = decodeSample(*code);
+                             memcpy(result, &sample, sizeof(int16_t));
+                             return sizeof(int16_t);
+                           });
+  }
 
-    return length;
+  bool isPullSupported() override { return true; }
+
+  /// Pull mode: the codes are read into the second half of the buffer and decoded in place
+  size_t decode(uint8_t *data, size_t max) override {
+    if (!is_active || p_input == nullptr) return 0;
+    size_t samples = max / sizeof(int16_t);
+    uint8_t *p_byte = data + samples;
+    samples = p_input->readBytes(p_byte, samples);
+    int16_t *p_result = (int16_t *)data;
+    for (size_t j = 0; j < samples; j++) {
+      p_result[j] = decodeSample(p_byte[j]);
+    }
+    return samples * sizeof(int16_t);
   }
 
  protected:
@@ -125,6 +143,11 @@ class G7xxDecoder : public AudioDecoder {
   int dec_bits;
   unsigned int in_buffer = 0;
   int in_bits = 0;
+  FrameAssembler assembler;
+
+  virtual int16_t decodeSample(uint8_t code) {
+    return (*dec_routine)(code, AUDIO_ENCODING_LINEAR, &state);
+  }
 
 };
 
@@ -173,6 +196,9 @@ class G7xxEncoder : public AudioEncoder {
     g72x_init_state(&state);
     out_buffer = 0;
     out_bits = 0;
+    // one code per sample
+    assembler.setAlignment(sizeof(int16_t));
+    assembler.begin(sizeof(int16_t), 1);
 
     is_active = true;
   }
@@ -206,15 +232,12 @@ class G7xxEncoder : public AudioEncoder {
       LOGE("inactive");
       return 0;
     }
-    // encode bytes
-    int16_t *p_16 = (int16_t *)in_ptr;
-    int samples = byte_count / sizeof(int16_t);
-    for (int j = 0; j < samples; j++) {
-        code = (*enc_routine)(p_16[j], AUDIO_ENCODING_LINEAR, &state);
-        p_print->write(&code, 1);
-    }
-   
-    return byte_count;
+    // encode samples
+    return assembler.write((const uint8_t *)in_ptr, byte_count, *p_print,
+                           [this](const uint8_t *sample, uint8_t *result) -> size_t {
+                             *result = encodeSample(*(const int16_t *)sample);
+                             return 1;
+                           });
   }
 
  protected:
@@ -231,6 +254,11 @@ class G7xxEncoder : public AudioEncoder {
   int enc_bits;
   unsigned int out_buffer = 0;
   int out_bits = 0;
+  FrameAssembler assembler;
+
+  virtual uint8_t encodeSample(int16_t sample) {
+    return (*enc_routine)(sample, AUDIO_ENCODING_LINEAR, &state);
+  }
 
 };
 
@@ -308,24 +336,12 @@ class G711Encoder : public G7xxEncoder {
     this->enc = enc;
     assert(this->enc!=nullptr);
   };
-  size_t write(const void *in_ptr, size_t in_size) override {
-    LOGD("write: %d", in_size);
-    if (!is_active) {
-      LOGE("inactive");
-      return 0;
-    }
-    // encode bytes
-    int samples = in_size/2;
-    int16_t *p_16 = (int16_t *)in_ptr;
-    uint8_t buffer[samples];
-    for (int j = 0; j < samples; j++) {
-	      buffer[j] = enc(p_16[j]);
-    }
-    p_print->write(buffer,samples);
-    return in_size;
-  }
   protected:
   uint8_t(*enc)(int)=nullptr;
+
+  uint8_t encodeSample(int16_t sample) override {
+    return enc(sample);
+  }
 };
 
 
@@ -344,22 +360,12 @@ class G711Decoder : public G7xxDecoder {
     assert(this->dec!=nullptr);
   };
 
-  size_t write(const void *in_ptr, size_t in_size) override {
-    LOGD("write: %d", in_size);
-    if (!is_active) {
-      LOGE("inactive");
-      return 0;
-    }
-    // decode bytes
-    uint8_t *p_8 = (uint8_t *)in_ptr;
-    for (int j = 0; j < in_size; j++) {
-	      int16_t result = dec(p_8[j]);
-        p_print->write((uint8_t*)&result,sizeof(int16_t));
-    }
-    return in_size;
-  }
   protected:
   int (*dec)(uint8_t a_val)=nullptr;
+
+  int16_t decodeSample(uint8_t code) override {
+    return dec(code);
+  }
 };
 
 
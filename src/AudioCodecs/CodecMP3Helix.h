@@ -3,6 +3,7 @@
 #include "Stream.h"
 #include "AudioCodecs/AudioEncoded.h"
 #include "AudioMetaData/MetaDataFilter.h"
+#include "AudioCodecs/MP3SeekTable.h"
 #include "MP3DecoderHelix.h"
 
 namespace audio_tools {
@@ -71,6 +72,7 @@ class MP3DecoderHelix : public AudioDecoder  {
 
         /// Defines the output Stream
         virtual void setOutputStream(Print &outStream){
+            p_out = &outStream;
             if (mp3!=nullptr) mp3->setOutput(outStream);
         }
 
@@ -82,6 +84,7 @@ class MP3DecoderHelix : public AudioDecoder  {
                 mp3->begin();
                 filter.begin();
             } 
+            seek_table.begin();
         }
 
         /// Releases the reserved memory
@@ -107,14 +110,53 @@ class MP3DecoderHelix : public AudioDecoder  {
         size_t write(const void* mp3Data, size_t len) {
             LOGD("%s: %zu", LOG_METHOD, len);
             if (mp3==nullptr) return 0;
+            seek_table.write((const uint8_t*)mp3Data, len);
             return use_filter ? filter.write((uint8_t*)mp3Data, len): mp3->write((uint8_t*)mp3Data, len);
         }
 
+        bool isPullSupported() override { return true; }
+
+        /// Pull mode: the decoded frames are collected directly in the buffer
+        size_t decode(uint8_t *buffer, size_t max) override {
+            return decodeViaOutput(buffer, max, p_out);
+        }
+
         /// checks if the class is active 
         operator bool(){
             return mp3!=nullptr && (bool) *mp3;
         }
 
+        /// Provides the byte position for the indicated time: using the Xing/VBRI table or the frame index
+        long seekPosition(uint32_t timeMs) override {
+            return seek_table.seekPosition(timeMs);
+        }
+
+        /// The input was repositioned: we discard the buffered data
+        void setSeekPosition(size_t pos, uint32_t timeMs) override {
+            seek_table.setSeekPosition(pos, timeMs);
+            filter.setPosition(pos);
+            if (mp3!=nullptr) {
+                mp3->end();
+                mp3->begin();
+            }
+        }
+
+        /// Defines the file size which is used to estimate the duration
+        void setInputSize(size_t size) override {
+            seek_table.setInputSize(size);
+            filter.setInputSize(size);
+        }
+
+        /// Provides the playing position in ms
+        uint32_t positionMs() override {
+            return seek_table.positionMs();
+        }
+
+        /// Provides the duration in ms
+        uint32_t durationMs() override {
+            return seek_table.durationMs();
+        }
+
         libhelix::MP3DecoderHelix *driver() {
             return mp3;
         }
@@ -169,8 +211,16 @@ class MP3DecoderHelix : public AudioDecoder  {
         }
 
     protected:
+        /// libhelix needs an output: the decoded data is discarded
+        void clearOutputStream() override {
+            AudioDecoder::clearOutputStream();
+            p_out = nullptr;
+        }
+
         libhelix::MP3DecoderHelix *mp3=nullptr;
+        Print *p_out=nullptr;
         MetaDataFilter<libhelix::MP3DecoderHelix> filter;
+        MP3SeekTable seek_table;
         bool use_filter = false;
 
 };
@@ -11,6 +11,7 @@
 #endif
 
 #include "AudioCodecs/AudioEncoded.h"
+#include "AudioCodecs/MP3SeekTable.h"
 #include "minimp3.h"
 
 /** 
@@ -54,6 +55,7 @@ class MP3DecoderMini : public AudioDecoder {
     buffer.resize(buffer_size);
     pcm.resize(MINIMP3_MAX_SAMPLES_PER_FRAME);
     buffer_pos = 0;
+    seek_table.begin();
     active = true;
   }
 
@@ -74,6 +76,7 @@ class MP3DecoderMini : public AudioDecoder {
   size_t write(const void *data, size_t len) {
     LOGD("write: %zu", len);
     if (active) {
+      seek_table.write((const uint8_t *)data, len);
       if (buffer_pos+len>=buffer.size()){
         decode(len);
       }
@@ -98,6 +101,27 @@ class MP3DecoderMini : public AudioDecoder {
     sample_rate_limit = limit;
   }
 
+  /// Provides the byte position for the indicated time: using the Xing/VBRI table or the frame index
+  long seekPosition(uint32_t timeMs) override {
+    return seek_table.seekPosition(timeMs);
+  }
+
+  /// The input was repositioned: we discard the buffered data
+  void setSeekPosition(size_t pos, uint32_t timeMs) override {
+    seek_table.setSeekPosition(pos, timeMs);
+    ::mp3dec_init(&mp3d);
+    buffer_pos = 0;
+  }
+
+  /// Defines the file size which is used to estimate the duration
+  void setInputSize(size_t size) override { seek_table.setInputSize(size); }
+
+  /// Provides the playing position in ms
+  uint32_t positionMs() override { return seek_table.positionMs(); }
+
+  /// Provides the duration in ms
+  uint32_t durationMs() override { return seek_table.durationMs(); }
+
  protected:
   AudioBaseInfo audio_info;
   AudioBaseInfoDependent *audioBaseInfoSupport = nullptr;
@@ -108,6 +132,7 @@ class MP3DecoderMini : public AudioDecoder {
   size_t buffer_pos = 0;
   Vector<uint8_t> buffer;
   Vector<mp3d_sample_t> pcm;
+  MP3SeekTable seek_table;
   #ifdef MINIMP3_FLOAT_OUTPUT
   Vector<int16_t> pcm16;
   #endif
@@ -155,7 +155,8 @@ class OpusAudioDecoder : public AudioDecoder {
 
   void begin() override {
     TRACED();
-    outbuf.resize(cfg.max_buffer_size);
+    // max_buffer_size is the max frame size in samples (per channel)
+    outbuf.resize(cfg.max_buffer_size * cfg.channels * sizeof(int16_t));
     assert(outbuf.data() != nullptr);
     
     int err;
@@ -190,17 +191,26 @@ class OpusAudioDecoder : public AudioDecoder {
     int in_band_forware_error_correction = 0;
     int out_samples = opus_decode(
         dec, (uint8_t *)in_ptr, in_size, (opus_int16 *)outbuf.data(),
-        cfg.max_buffer_size, in_band_forware_error_correction);
-    if (out_samples < 0) {
-      LOGE("opus_decode: %s", opus_strerror(out_samples));
-    } else if (out_samples > 0) {
-      // write data to final destination
-      int out_bytes = out_samples * cfg.channels * sizeof(int16_t);
-      p_print->write(outbuf.data(), out_bytes);
-    }
+        maxFrameSamples(), in_band_forware_error_correction);
+    if (out_samples > 0) frame_samples = out_samples;
+    writeResult(out_samples);
     return in_size;
   }
 
+  /// Packet loss concealment: uses the in-band FEC of the next packet if available, otherwise the Opus PLC
+  bool conceal(const uint8_t *next, size_t next_len) override {
+    if (!active || p_print == nullptr || frame_samples == 0) return false;
+    // the frame size must match the duration of the lost packet
+    int out_samples =
+        next != nullptr && next_len > 0
+            ? opus_decode(dec, next, next_len, (opus_int16 *)outbuf.data(),
+                          frame_samples, 1)
+            : opus_decode(dec, nullptr, 0, (opus_int16 *)outbuf.data(),
+                          frame_samples, 0);
+    writeResult(out_samples);
+    return out_samples > 0;
+  }
+
   operator bool() override { return active; }
 
  protected:
@@ -210,6 +220,20 @@ class OpusAudioDecoder : public AudioDecoder {
   OpusDecoder *dec;
   bool active;
   Vector<uint8_t> outbuf{0};
+  int frame_samples = 0;
+
+  /// Max number of samples (per channel) which fit into the output buffer
+  int maxFrameSamples() { return cfg.max_buffer_size; }
+
+  void writeResult(int out_samples) {
+    if (out_samples < 0) {
+      LOGE("opus_decode: %s", opus_strerror(out_samples));
+    } else if (out_samples > 0) {
+      // write data to final destination
+      int out_bytes = out_samples * cfg.channels * sizeof(int16_t);
+      p_print->write(outbuf.data(), out_bytes);
+    }
+  }
 };
 
 /**
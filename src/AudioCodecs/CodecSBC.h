@@ -9,6 +9,7 @@
 #pragma once
 
 #include "AudioCodecs/AudioEncoded.h"
+#include "AudioCodecs/FrameAssembler.h"
 #include "sbc.h"
 #include "sbc/formats.h"
 
@@ -31,15 +32,9 @@ namespace audio_tools {
 class SBCDecoder : public AudioDecoder {
  public:
   SBCDecoder(int bufferSize = 8192) {
-    result_buffer = new uint8_t[bufferSize];
     result_buffer_size = bufferSize;
   }
 
-  ~SBCDecoder() {
-    if (result_buffer != nullptr) delete[] result_buffer;
-    if (input_buffer != nullptr) delete[] input_buffer;
-  }
-
   virtual AudioBaseInfo audioInfo() { return info; }
 
   virtual void begin() {
@@ -84,9 +79,10 @@ class SBCDecoder : public AudioDecoder {
     }
 
     if (!is_first){
-      for (int j = 0; j < count; j++) {
-        processByte(start[j]);
-      }
+      assembler.write(start, count, *p_print,
+                      [this](const uint8_t *frame, uint8_t *result) -> size_t {
+                        return decodeFrame(frame, result);
+                      });
     }
 
     return length;
@@ -99,11 +95,9 @@ class SBCDecoder : public AudioDecoder {
   sbc_t sbc;
   bool is_first = true;
   bool is_active = false;
-  uint8_t *result_buffer = nullptr;
+  FrameAssembler assembler;
   int result_buffer_size;
   int framelen;
-  uint8_t *input_buffer = nullptr;
-  int input_pos = 0;
 
   /// Process audio info
   void setupAudioInfo() {
@@ -147,34 +141,20 @@ class SBCDecoder : public AudioDecoder {
       // setup audio info
       setupAudioInfo();
 
-      // setup input buffer for subsequent decoding stpes
-      setupInputBuffer(frame_len);
+      // setup frame assembly for subsequent decoding stpes
+      LOGI("codesize: %d", (int)sbc_get_codesize(&sbc));
+      assembler.begin(frame_len, sbc_get_codesize(&sbc), result_buffer_size);
     }
 
     return frame_len;
   }
 
-  void setupInputBuffer(int len) {
-    LOGI("input_buffer: %d", len);
-    if (input_buffer != nullptr) delete[] input_buffer;
-    input_buffer = new uint8_t[len];
-  }
-
-  /// Build decoding buffer and decode when frame is full
-  void processByte(uint8_t byte) {
-    // add byte to buffer
-    input_buffer[input_pos++] = byte;
-
-    // decode if buffer is full
-    if (input_pos >= framelen) {
-      size_t result_len = 0;
-      sbc_decode(&sbc, input_buffer, framelen, result_buffer,
-                 result_buffer_size, &result_len);
-      if (result_len > 0) {
-        p_print->write(result_buffer, result_len);
-      }
-      input_pos = 0;
-    }
+  /// Decodes one frame: returns the number of PCM bytes
+  size_t decodeFrame(const uint8_t *frame, uint8_t *result) {
+    size_t result_len = 0;
+    sbc_decode(&sbc, frame, framelen, result, sbc_get_codesize(&sbc),
+               &result_len);
+    return result_len;
   }
 };
 
@@ -196,12 +176,6 @@ class SBCEncoder : public AudioEncoder {
     this->bitpool = bitpool;
     this->snr = snr;
     this->result_buffer_size = resultBufferSize;
-    result_buffer = new uint8_t[resultBufferSize];
-  }
-
-  ~SBCEncoder() {
-    if (result_buffer != nullptr) delete[] result_buffer;
-    if (buffer != nullptr) delete[] buffer;
   }
 
   void begin(AudioBaseInfo bi) {
@@ -213,12 +187,10 @@ class SBCEncoder : public AudioEncoder {
     TRACEI();
     is_first = true;
     is_active = setup();
-    int codesize = sbc_get_codesize(&sbc);
-    if (codesize != current_codesize) {
-      if (buffer != nullptr) delete[] buffer;
-      buffer = new uint8_t[codesize];
-      current_codesize = codesize;
-    }
+    current_codesize = sbc_get_codesize(&sbc);
+    assembler.setAlignment(sizeof(int16_t));
+    assembler.begin(current_codesize, sbc_get_frame_length(&sbc),
+                    result_buffer_size);
   }
 
   virtual void end() {
@@ -241,14 +213,11 @@ class SBCEncoder : public AudioEncoder {
       LOGE("inactive");
       return 0;
     }
-    const uint8_t *start = (const uint8_t *)in_ptr;
-
-    // encode bytes
-    for (int j = 0; j < in_size; j++) {
-      processByte(start[j]);
-    }
-
-    return in_size;
+    // encode complete blocks
+    return assembler.write((const uint8_t *)in_ptr, in_size, *p_print,
+                           [this](const uint8_t *block, uint8_t *result) -> size_t {
+                             return encodeBlock(block, result);
+                           });
   }
 
  protected:
@@ -258,11 +227,8 @@ class SBCEncoder : public AudioEncoder {
   bool is_first = true;
   bool is_active = false;
   int current_codesize = 0;
-  uint8_t *buffer = nullptr;
-  int buffer_pos = 0;
-  uint8_t *result_buffer = nullptr;
+  FrameAssembler assembler;
   int result_buffer_size = 0;
-  int result_size = 0;
   int subbands = 4;
   int blocks = 4;
   int bitpool = 32;
@@ -315,24 +281,14 @@ class SBCEncoder : public AudioEncoder {
     return true;
   }
 
-  // add byte to decoding buffer and decode if buffer is full
-  void processByte(uint8_t byte) {
-    buffer[buffer_pos++] = byte;
-    if (buffer_pos >= current_codesize) {
-      ssize_t written;
-      // Encodes ONE input block into ONE output block */
-      // ssize_t sbc_encode(sbc_t *sbc, const void *input, size_t input_len,
-      // void *output, size_t output_len, ssize_t *written);
-      sbc_encode(&sbc, buffer, current_codesize, result_buffer + result_size,
-                 result_buffer_size - result_size, &written);
-      result_size += written;
-      if (result_size + written >= result_buffer_size) {
-        LOGI("result_size: %d (%d)", result_size, written);
-        p_print->write(result_buffer, result_size);
-        result_size = 0;
-      }
-      buffer_pos = 0;
-    }
+  /// Encodes ONE input block into ONE output frame: returns the number of bytes
+  size_t encodeBlock(const uint8_t *block, uint8_t *result) {
+    ssize_t written = 0;
+    // ssize_t sbc_encode(sbc_t *sbc, const void *input, size_t input_len,
+    // void *output, size_t output_len, ssize_t *written);
+    sbc_encode(&sbc, block, current_codesize, result,
+               sbc_get_frame_length(&sbc), &written);
+    return written > 0 ? written : 0;
   }
 };
 
@@ -157,6 +157,11 @@ class WAVHeader  {
             return headerInfo;
         }
 
+        /// Provides the position of the sound data in the file
+        size_t soundPos() {
+            return sound_pos;
+        }
+
     protected:
         struct WAVAudioInfo headerInfo;
         uint8_t buffer[44];
@@ -291,6 +296,7 @@ class WAVDecoder : public AudioDecoder {
             TRACED();
             isFirst = true;
             active = true;
+            sound_bytes = 0;
         }
 
         void end() {
@@ -351,17 +357,21 @@ class WAVDecoder : public AudioDecoder {
                             if (isValid){
                                 LOGI("isValid: %s", isValid ? "true":"false");
                                 audioBaseInfoSupport->setAudioInfo(bi);
-                                // write prm data from first record
-                                LOGI("WAVDecoder writing first sound data");
-                                result = out->write(sound_ptr, len);
                             } else {
                                 LOGE("isValid: %s", isValid ? "true":"false");
                             }
                         }
+                        if (isValid && len>0){
+                            // write prm data from first record
+                            LOGI("WAVDecoder writing first sound data");
+                            result = out->write(sound_ptr, len);
+                            sound_bytes += len;
+                        }
                     }
                     
                 } else if (isValid)  {
                     result = out->write((uint8_t*)in_ptr, in_size);
+                    sound_bytes += in_size;
                 }
             }
             header.end();
@@ -376,17 +386,98 @@ class WAVDecoder : public AudioDecoder {
             return write(buffer, len);
         }
 
+        bool isPullSupported() override { return true; }
+
+        /// Pull mode: after the header the PCM data is read directly into the buffer
+        size_t decode(uint8_t *buffer, size_t max) override {
+            if (!active || p_input==nullptr) return 0;
+            pull_buffer.setTarget(buffer, max);
+            if (isFirst){
+                // the header is parsed with the push logic: the sound data of the first record goes to the buffer
+                Print *p_previous = out;
+                out = &pull_buffer;
+                uint8_t data[DECODER_PULL_READ_SIZE];
+                while (isFirst){
+                    size_t len = p_input->readBytes(data, DECODER_PULL_READ_SIZE);
+                    if (len==0) break;
+                    write(data, len);
+                }
+                out = p_previous;
+            }
+            size_t result = pull_buffer.size();
+            pull_buffer.releaseTarget();
+            if (!isFirst && isValid && result<max){
+                size_t len = p_input->readBytes(buffer+result, max-result);
+                sound_bytes += len;
+                result += len;
+            }
+            return result;
+        }
+
         virtual operator bool() {
             return active;
         }
 
+        /// Provides the byte position for the indicated time: the result is aligned to full frames
+        long seekPosition(uint32_t timeMs) override {
+            if (isFirst || !isValid || bytesPerSecond()==0) return -1;
+            uint64_t frames = (uint64_t) timeMs * header.audioInfo().sample_rate / 1000;
+            uint64_t offset = frames * frameSize();
+            WAVAudioInfo &info = header.audioInfo();
+            if (!info.is_streamed && offset > info.data_length){
+                offset = info.data_length;
+            }
+            return header.soundPos() + offset;
+        }
+
+        /// The input was repositioned: the following writes contain the sound data from this position
+        void setSeekPosition(size_t pos, uint32_t timeMs) override {
+            sound_bytes = pos > header.soundPos() ? pos - header.soundPos() : 0;
+        }
+
+        /// Defines the file size which is used for the duration if the header does not provide the data length
+        void setInputSize(size_t size) override {
+            input_size = size;
+        }
+
+        /// Provides the playing position in ms
+        uint32_t positionMs() override {
+            int bps = bytesPerSecond();
+            return bps == 0 ? 0 : sound_bytes * 1000 / bps;
+        }
+
+        /// Provides the duration in ms
+        uint32_t durationMs() override {
+            int bps = bytesPerSecond();
+            if (bps == 0) return 0;
+            WAVAudioInfo &info = header.audioInfo();
+            if (!info.is_streamed && info.data_length > 0){
+                return (uint64_t) info.data_length * 1000 / bps;
+            }
+            if (input_size > header.soundPos()){
+                return (uint64_t) (input_size - header.soundPos()) * 1000 / bps;
+            }
+            return 0;
+        }
+
     protected:
         WAVHeader header;
-        Print *out;
+        Print *out = nullptr;
         AudioBaseInfoDependent *audioBaseInfoSupport;
         bool isFirst = true;
         bool isValid = true;
         bool active;
+        uint64_t sound_bytes = 0;
+        size_t input_size = 0;
+
+        int frameSize() {
+            WAVAudioInfo &info = header.audioInfo();
+            return info.block_align > 0 ? info.block_align : info.channels * info.bits_per_sample / 8;
+        }
+
+        int bytesPerSecond() {
+            return header.audioInfo().sample_rate * frameSize();
+        }
 
 };
 
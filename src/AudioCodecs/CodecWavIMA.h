@@ -407,13 +407,15 @@ class WavIMADecoder : public AudioDecoder {
                             if (isValid) {
                                 LOGI("isValid: %s", isValid ? "true" : "false");
                                 audioBaseInfoSupport->setAudioInfo(bi);
-                                // write prm data from first record
-                                LOGI("WavIMADecoder writing first sound data");
-                                processInput(sound_ptr, len);
                             } else {
                                 LOGE("isValid: %s", isValid ? "true" : "false");
                             }
                         }
+                        if (isValid) {
+                            // write prm data from first record
+                            LOGI("WavIMADecoder writing first sound data");
+                            processInput(sound_ptr, len);
+                        }
                     }
                 } else if (isValid) {
                     processInput((uint8_t*)in_ptr, in_size);
@@ -430,13 +432,20 @@ class WavIMADecoder : public AudioDecoder {
             return write(buffer, len);
         }
 
+        bool isPullSupported() override { return true; }
+
+        /// Pull mode: the decoded blocks are written into the buffer, the rest is kept for the next call
+        size_t decode(uint8_t *buffer, size_t max) override {
+            return active || decodeSurplus() > 0 ? decodeViaOutput(buffer, max, out) : 0;
+        }
+
         virtual operator bool() {
             return active;
         }
 
     protected:
         WavIMAHeader header;
-        Print *out;
+        Print *out = nullptr;
         AudioBaseInfoDependent *audioBaseInfoSupport;
         bool isFirst = true;
         bool isValid = true;
@@ -450,6 +459,10 @@ class WavIMADecoder : public AudioDecoder {
         size_t samples_per_decoded_block = 0;
         IMAState ima_states[2];
 
+        void clearOutputStream() override {
+            out = nullptr;
+        }
+
         int16_t decodeSample(uint8_t sample, int channel = 0) {
             int step_index = ima_states[channel].step_index;
             int32_t step = ima_step_table[step_index];
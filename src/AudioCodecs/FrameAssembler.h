@@ -0,0 +1,123 @@
+#pragma once
+
+#include "AudioConfig.h"
+#include "AudioTools/AudioLogger.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Max number of result bytes which are collected before they are written to the output
+#ifndef FRAME_ASSEMBLER_RESULT_SIZE
+#define FRAME_ASSEMBLER_RESULT_SIZE 1024
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Splits the written data into frames of a fixed size for codecs which process
+ * one frame at a time: complete frames are processed directly from the provided data and
+ * only the incomplete tail is copied, so that it can be completed with the next write.
+ * The results of the frames are collected and written to the output with a single write
+ * at the end of each write() call (or when the result buffer is full).
+ * @ingroup codecs
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FrameAssembler {
+ public:
+  FrameAssembler() = default;
+
+  /// Defines the frame size, the max result size of one frame and the size of the result buffer
+  bool begin(int frameSize, int resultFrameSize,
+             int resultSize = FRAME_ASSEMBLER_RESULT_SIZE) {
+    if (frameSize <= 0 || resultFrameSize <= 0) {
+      LOGE("Invalid frame size: %d -> %d", frameSize, resultFrameSize);
+      return false;
+    }
+    frame_size = frameSize;
+    result_frame_size = resultFrameSize;
+    if (resultSize < resultFrameSize) resultSize = resultFrameSize;
+    // make sure that we can collect complete frames only
+    resultSize = resultSize / resultFrameSize * resultFrameSize;
+    frame.resize(frame_size);
+    result.resize(resultSize);
+    frame_pos = 0;
+    result_pos = 0;
+    return true;
+  }
+
+  /// Defines the required alignment of a frame (e.g. 2 if the codec accesses the data as int16_t)
+  void setAlignment(int alignment) { this->alignment = alignment < 1 ? 1 : alignment; }
+
+  /// Discards the incomplete frame and any unwritten result
+  void clear() {
+    frame_pos = 0;
+    result_pos = 0;
+  }
+
+  /// Processes the data: fn(const uint8_t *frame, uint8_t *result) is called for each
+  /// complete frame and returns the number of result bytes (max resultFrameSize)
+  template <typename Fn>
+  size_t write(const uint8_t *data, size_t len, Print &out, Fn fn) {
+    if (frame_size == 0) return 0;
+    size_t pos = 0;
+    // complete the frame from the last write
+    if (frame_pos > 0) {
+      size_t n = frame_size - frame_pos;
+      if (n > len) n = len;
+      memcpy(frame.data() + frame_pos, data, n);
+      frame_pos += n;
+      pos = n;
+      if (frame_pos < frame_size) return len;
+      process(frame.data(), out, fn);
+      frame_pos = 0;
+    }
+    // complete frames are processed w/o copy if they are properly aligned
+    while (len - pos >= (size_t)frame_size) {
+      const uint8_t *p_frame = data + pos;
+      if ((uintptr_t)p_frame % alignment != 0) {
+        memcpy(frame.data(), p_frame, frame_size);
+        p_frame = frame.data();
+      }
+      process(p_frame, out, fn);
+      pos += frame_size;
+    }
+    // keep the tail
+    frame_pos = len - pos;
+    if (frame_pos > 0) memcpy(frame.data(), data + pos, frame_pos);
+    flush(out);
+    return len;
+  }
+
+  /// Writes the collected result to the output
+  void flush(Print &out) {
+    if (result_pos > 0) {
+      size_t written = out.write(result.data(), result_pos);
+      if (written != result_pos) {
+        LOGE("write requested: %d eff: %d", result_pos, (int)written);
+      }
+      result_pos = 0;
+    }
+  }
+
+  /// Provides the number of bytes of the incomplete frame
+  int pending() { return frame_pos; }
+
+  /// Provides the frame size
+  int frameSize() { return frame_size; }
+
+ protected:
+  Vector<uint8_t> frame{0};
+  Vector<uint8_t> result{0};
+  int frame_size = 0;
+  int result_frame_size = 0;
+  int frame_pos = 0;
+  int result_pos = 0;
+  int alignment = 1;
+
+  template <typename Fn>
+  void process(const uint8_t *p_frame, Print &out, Fn &fn) {
+    if (result.size() - result_pos < result_frame_size) flush(out);
+    result_pos += fn(p_frame, result.data() + result_pos);
+  }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "AudioConfig.h"
+#include "AudioTools/AudioLogger.h"
+#include "AudioBasic/Collections/Vector.h"
+#include "AudioTools/MP3FrameHeader.h"
+
+/// Number of frames between two entries of the lazily built frame index
+#ifndef MP3_SEEK_INDEX_STEP
+#define MP3_SEEK_INDEX_STEP 20
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Determines the byte positions for time based seeking in MPEG audio (mp3) data.
+ * The encoded data is just passed through the write() method and we use the Xing/Info
+ * or VBRI table of content if it is available in the first frame. Otherwise we build a
+ * frame index lazily (one entry every MP3_SEEK_INDEX_STEP frames) while the data is
+ * played, so that we can jump back to any position which was already played. Positions
+ * which are not covered by any table are estimated from the average frame size.
+ * The frame bodies are skipped, so only the frame headers are parsed.
+ * @ingroup codecs
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MP3SeekTable {
+ public:
+  /// Resets all information: to be called when a new file is started
+  void begin() {
+    pos = 0;
+    next_frame = 0;
+    hdr_len = 0;
+    frame_no = 0;
+    is_synced = false;
+    is_exact = true;
+    is_first_frame_done = false;
+    data_start = 0;
+    first = MP3FrameHeader();
+    first_frame.resize(0);
+    first_frame_len = 0;
+    index.resize(0);
+    xing_frames = 0;
+    xing_bytes = 0;
+    has_toc = false;
+    vbri_toc.resize(0);
+  }
+
+  /// Defines the total size of the mp3 data (e.g. the file size)
+  void setInputSize(size_t size) { total_size = size; }
+
+  /// Provides the defined total size
+  size_t inputSize() { return total_size; }
+
+  /// Processes the next encoded data
+  void write(const uint8_t *data, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+      // skip the frame body
+      if (pos < next_frame) {
+        size_t n = next_frame - pos;
+        if (n > len - i) n = len - i;
+        collectFirstFrame(data + i, n);
+        i += n;
+        pos += n;
+        continue;
+      }
+      // collect header data
+      hdr[hdr_len++] = data[i++];
+      pos++;
+      if (hdr_len < hdrRequired()) continue;
+      processHeader();
+    }
+  }
+
+  /// Provides the byte position for the indicated time in ms: -1 if we do not have enough information yet
+  long seekPosition(uint32_t timeMs) {
+    if (first.sample_rate == 0) return -1;
+    uint64_t target_frame = (uint64_t)timeMs * first.sample_rate / 1000 / first.samples_per_frame;
+    seek_exact = false;
+    long result = -1;
+    uint32_t duration = durationMs();
+    if (has_toc && xing_bytes > 0 && duration > 0) {
+      result = tocPosition(timeMs, duration);
+    } else if (vbri_toc.size() > 0) {
+      result = vbriPosition(target_frame);
+    } else if (target_frame / MP3_SEEK_INDEX_STEP < (uint64_t)index.size()) {
+      int idx = target_frame / MP3_SEEK_INDEX_STEP;
+      seek_exact = true;
+      target_frame = (uint64_t)idx * MP3_SEEK_INDEX_STEP;
+      result = index[idx];
+    } else {
+      result = data_start + target_frame * averageFrameSize();
+    }
+    if (total_size > 0 && result >= (long)total_size) result = total_size;
+    seek_frame = target_frame;
+    LOGI("seekPosition %u ms -> frame %u -> pos %ld", (unsigned)timeMs, (unsigned)target_frame, result);
+    return result;
+  }
+
+  /// Notifies that the data continues at the indicated position which was determined by seekPosition()
+  void setSeekPosition(size_t newPos, uint32_t timeMs) {
+    pos = newPos;
+    next_frame = newPos;
+    hdr_len = 0;
+    frame_no = seek_frame;
+    // only data which was reached from an index entry is reliable for extending the index
+    is_exact = seek_exact;
+    is_synced = seek_exact;
+  }
+
+  /// Provides the playing position in ms based on the processed frames
+  uint32_t positionMs() {
+    if (first.sample_rate == 0) return 0;
+    return (uint64_t)frame_no * first.samples_per_frame * 1000 / first.sample_rate;
+  }
+
+  /// Provides the duration in ms: 0 if not known
+  uint32_t durationMs() {
+    if (first.sample_rate == 0) return 0;
+    if (xing_frames > 0) {
+      return (uint64_t)xing_frames * first.samples_per_frame * 1000 / first.sample_rate;
+    }
+    if (total_size > data_start) {
+      uint64_t frames = (total_size - data_start) / averageFrameSize();
+      return frames * first.samples_per_frame * 1000 / first.sample_rate;
+    }
+    return 0;
+  }
+
+  /// Provides the header information of the first frame
+  MP3FrameHeader &frameHeader() { return first; }
+
+  /// Number of entries in the lazily built frame index
+  int indexSize() { return index.size(); }
+
+ protected:
+  size_t pos = 0;            // absolute position of the next byte
+  size_t next_frame = 0;     // absolute position of the next frame header
+  size_t data_start = 0;     // position of the first frame after the ID3v2 tag
+  size_t total_size = 0;
+  uint8_t hdr[10];
+  int hdr_len = 0;
+  uint64_t frame_no = 0;
+  uint64_t seek_frame = 0;
+  bool is_synced = false;
+  bool is_exact = true;
+  bool seek_exact = false;
+  bool is_first_frame_done = false;
+  MP3FrameHeader first;
+  Vector<uint8_t> first_frame{0};
+  int first_frame_len = 0;
+  Vector<uint32_t> index{0};
+  // Xing/Info
+  uint32_t xing_frames = 0;
+  uint32_t xing_bytes = 0;
+  bool has_toc = false;
+  uint8_t toc[100];
+  // VBRI: bytes per entry
+  Vector<uint32_t> vbri_toc{0};
+  int vbri_frames_per_entry = 0;
+
+  /// An ID3v2 tag at the start needs a 10 byte header
+  int hdrRequired() {
+    if (pos - hdr_len == 0 && hdr_len >= 3 && memcmp(hdr, "ID3", 3) == 0) return 10;
+    return 4;
+  }
+
+  void processHeader() {
+    size_t hdr_pos = pos - hdr_len;
+    // skip ID3v2 tag at the beginning
+    if (hdr_len == 10) {
+      uint32_t size = ((hdr[6] & 0x7f) << 21) | ((hdr[7] & 0x7f) << 14) | ((hdr[8] & 0x7f) << 7) | (hdr[9] & 0x7f);
+      if (hdr[5] & 0x10) size += 10;  // footer
+      data_start = 10 + size;
+      next_frame = data_start;
+      hdr_len = 0;
+      LOGI("ID3v2 tag: mp3 data starts at %u", (unsigned)data_start);
+      return;
+    }
+
+    MP3FrameHeader header;
+    if (header.parse(hdr) && isCompatible(header)) {
+      hdr_len = 0;
+      is_synced = true;
+      next_frame = hdr_pos + header.frame_length;
+      if (first.sample_rate == 0) {
+        first = header;
+        data_start = hdr_pos;
+        first_frame.resize(header.frame_length);
+        memcpy(first_frame.data(), hdr, 4);
+        first_frame_len = 4;
+      }
+      addIndex(hdr_pos);
+      frame_no++;
+    } else {
+      // search the next sync word
+      if (is_synced) {
+        LOGD("mp3 frame sync lost at %u", (unsigned)hdr_pos);
+        is_exact = false;
+      }
+      is_synced = false;
+      memmove(hdr, hdr + 1, hdr_len - 1);
+      hdr_len--;
+    }
+  }
+
+  /// After the first frame we only accept frames with the same format
+  bool isCompatible(MP3FrameHeader &header) {
+    if (first.sample_rate == 0) return true;
+    return header.version == first.version && header.layer == first.layer &&
+           header.sample_rate == first.sample_rate;
+  }
+
+  void addIndex(size_t hdr_pos) {
+    if (is_exact && frame_no % MP3_SEEK_INDEX_STEP == 0 &&
+        frame_no / MP3_SEEK_INDEX_STEP == (uint64_t)index.size()) {
+      index.push_back(hdr_pos);
+    }
+  }
+
+  /// Collects the data of the first frame to evaluate the Xing or VBRI header
+  void collectFirstFrame(const uint8_t *data, size_t len) {
+    if (is_first_frame_done || first_frame.size() == 0) return;
+    int n = first_frame.size() - first_frame_len;
+    if ((int)len < n) n = len;
+    memcpy(first_frame.data() + first_frame_len, data, n);
+    first_frame_len += n;
+    if (first_frame_len == first_frame.size()) {
+      is_first_frame_done = true;
+      parseXing(first_frame.data(), first_frame.size());
+      parseVBRI(first_frame.data(), first_frame.size());
+      first_frame.resize(0);
+    }
+  }
+
+  uint32_t readInt(const uint8_t *p, int bytes) {
+    uint32_t result = 0;
+    for (int j = 0; j < bytes; j++) result = (result << 8) | p[j];
+    return result;
+  }
+
+  void parseXing(const uint8_t *frame, int len) {
+    int off = first.xingOffset();
+    if (off + 8 > len) return;
+    if (memcmp(frame + off, "Xing", 4) != 0 && memcmp(frame + off, "Info", 4) != 0) return;
+    uint32_t flags = readInt(frame + off + 4, 4);
+    off += 8;
+    if ((flags & 1) && off + 4 <= len) {
+      xing_frames = readInt(frame + off, 4);
+      off += 4;
+    }
+    if ((flags & 2) && off + 4 <= len) {
+      xing_bytes = readInt(frame + off, 4);
+      off += 4;
+    }
+    if ((flags & 4) && off + 100 <= len) {
+      memcpy(toc, frame + off, 100);
+      has_toc = true;
+    }
+    if (xing_bytes == 0 && total_size > data_start) xing_bytes = total_size - data_start;
+    LOGI("Xing header: frames %u, bytes %u, toc %d", (unsigned)xing_frames, (unsigned)xing_bytes, has_toc);
+  }
+
+  void parseVBRI(const uint8_t *frame, int len) {
+    const int off = 4 + 32;
+    if (off + 26 > len || memcmp(frame + off, "VBRI", 4) != 0) return;
+    xing_frames = readInt(frame + off + 14, 4);
+    int entries = readInt(frame + off + 18, 2);
+    int scale = readInt(frame + off + 20, 2);
+    int entry_size = readInt(frame + off + 22, 2);
+    vbri_frames_per_entry = readInt(frame + off + 24, 2);
+    if (entry_size < 1 || entry_size > 4 || off + 26 + entries * entry_size > len) return;
+    vbri_toc.resize(entries);
+    for (int j = 0; j < entries; j++) {
+      vbri_toc[j] = readInt(frame + off + 26 + j * entry_size, entry_size) * scale;
+    }
+    LOGI("VBRI header: frames %u, entries %d", (unsigned)xing_frames, entries);
+  }
+
+  /// Position from the Xing table of content (percentage based with 256 steps)
+  long tocPosition(uint32_t timeMs, uint32_t duration) {
+    float percent = 100.0f * timeMs / duration;
+    if (percent > 99.999f) percent = 99.999f;
+    int a = (int)percent;
+    float fa = toc[a];
+    float fb = a < 99 ? toc[a + 1] : 256.0f;
+    float fx = fa + (fb - fa) * (percent - a);
+    return data_start + (long)(fx / 256.0f * xing_bytes);
+  }
+
+  /// Position from the VBRI table of content
+  long vbriPosition(uint64_t targetFrame) {
+    long result = data_start;
+    uint64_t frames = 0;
+    for (int j = 0; j < vbri_toc.size(); j++) {
+      if (frames + vbri_frames_per_entry > targetFrame) {
+        // interpolate in the entry
+        result += vbri_toc[j] * (targetFrame - frames) / vbri_frames_per_entry;
+        return result;
+      }
+      frames += vbri_frames_per_entry;
+      result += vbri_toc[j];
+    }
+    return result;
+  }
+
+  /// Average frame size from the index or the first frame
+  uint32_t averageFrameSize() {
+    if (xing_frames > 0 && xing_bytes > 0) return xing_bytes / xing_frames;
+    if (index.size() > 1) {
+      return (index[index.size() - 1] - index[0]) / ((index.size() - 1) * MP3_SEEK_INDEX_STEP);
+    }
+    return first.frame_length > 0 ? first.frame_length : 1;
+  }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "AudioCodecs/AudioEncoded.h"
+#include "AudioTools/MimeDetector.h"
+
+/// Number of bytes which are collected before the format is determined
+#ifndef MULTI_DECODER_SNIFF_SIZE
+#define MULTI_DECODER_SNIFF_SIZE 160
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Decoder which determines the format from the first bytes of the data
+ * (with the help of the MimeDetector) and forwards the data to the registered decoder
+ * for the mime type. The format is determined only once after each begin(), so that
+ * a playlist can mix formats. The decoders can be registered as objects or with a
+ * factory method, so that they are only allocated when needed.
+ * @ingroup codecs
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MultiDecoder : public AudioDecoder {
+  public:
+    MultiDecoder() = default;
+
+    ~MultiDecoder() {
+        releaseDecoder();
+    }
+
+    /// Registers a decoder object for the indicated mime type
+    void addDecoder(AudioDecoder &decoder, const char* mime) {
+        DecoderInfo info;
+        info.mime = mime;
+        info.decoder = &decoder;
+        decoders.push_back(info);
+    }
+
+    /// Registers a factory method which creates the decoder for the indicated mime type
+    void addDecoder(AudioDecoder* (*create)(), const char* mime) {
+        DecoderInfo info;
+        info.mime = mime;
+        info.create = create;
+        decoders.push_back(info);
+    }
+
+    /// Provides access to the MimeDetector e.g. to add custom checks
+    MimeDetector &mimeDetector() {
+        return detector;
+    }
+
+    void setOutputStream(Print &out_stream) override {
+        p_print = &out_stream;
+        if (p_decoder != nullptr) p_decoder->setOutputStream(out_stream);
+    }
+
+    void setNotifyAudioChange(AudioBaseInfoDependent &bi) override {
+        p_bi = &bi;
+        if (p_decoder != nullptr) p_decoder->setNotifyAudioChange(bi);
+    }
+
+    /// Restarts the format determination
+    void begin() override {
+        TRACED();
+        releaseDecoder();
+        sniff_len = 0;
+        actual_mime = nullptr;
+        is_active = true;
+    }
+
+    void end() override {
+        TRACED();
+        // process short data which did not fill the sniff buffer
+        if (p_decoder == nullptr && actual_mime == nullptr && sniff_len > 0) {
+            selectDecoderFor(nullptr, 0);
+        }
+        releaseDecoder();
+        is_active = false;
+    }
+
+    /// Selects the decoder for the indicated mime type (e.g. from the http content type) w/o
+    /// checking the data
+    bool selectDecoder(const char* mime) {
+        releaseDecoder();
+        DecoderInfo* info = findDecoder(mime);
+        if (info == nullptr) {
+            LOGW("No decoder for %s", mime == nullptr ? "n/a" : mime);
+            return false;
+        }
+        p_decoder = info->decoder;
+        if (p_decoder == nullptr) {
+            p_decoder = info->create();
+            is_created = true;
+        }
+        actual_mime = mime;
+        if (p_print != nullptr) p_decoder->setOutputStream(*p_print);
+        if (p_bi != nullptr) p_decoder->setNotifyAudioChange(*p_bi);
+        p_decoder->setInputSize(input_size);
+        p_decoder->begin();
+        return true;
+    }
+
+    size_t write(const void* data, size_t len) override {
+        if (p_decoder != nullptr) {
+            return p_decoder->write(data, len);
+        }
+        if (actual_mime != nullptr) {
+            // format not supported: we ignore the data
+            return len;
+        }
+        // collect the data for the format detection
+        size_t copy_len = MULTI_DECODER_SNIFF_SIZE - sniff_len;
+        if (copy_len > len) copy_len = len;
+        memcpy(sniff_buffer + sniff_len, data, copy_len);
+        sniff_len += copy_len;
+        if (sniff_len < MULTI_DECODER_SNIFF_SIZE) return len;
+
+        selectDecoderFor((const uint8_t*)data + copy_len, len - copy_len);
+        return len;
+    }
+
+    /// Provides the mime type which was determined from the data
+    const char* mime() {
+        return actual_mime;
+    }
+
+    /// Provides the active decoder (or nullptr)
+    AudioDecoder* decoder() {
+        return p_decoder;
+    }
+
+    AudioBaseInfo audioInfo() override {
+        return p_decoder != nullptr ? p_decoder->audioInfo() : no_info;
+    }
+
+    bool isResultPCM() override {
+        return p_decoder != nullptr ? p_decoder->isResultPCM() : true;
+    }
+
+    long seekPosition(uint32_t timeMs) override {
+        return p_decoder != nullptr ? p_decoder->seekPosition(timeMs) : -1;
+    }
+
+    void setSeekPosition(size_t pos, uint32_t timeMs) override {
+        if (p_decoder != nullptr) p_decoder->setSeekPosition(pos, timeMs);
+    }
+
+    void setInputSize(size_t size) override {
+        input_size = size;
+        if (p_decoder != nullptr) p_decoder->setInputSize(size);
+    }
+
+    uint32_t positionMs() override {
+        return p_decoder != nullptr ? p_decoder->positionMs() : 0;
+    }
+
+    uint32_t durationMs() override {
+        return p_decoder != nullptr ? p_decoder->durationMs() : 0;
+    }
+
+    operator bool() override {
+        return is_active;
+    }
+
+  protected:
+    struct DecoderInfo {
+        const char* mime = nullptr;
+        AudioDecoder* decoder = nullptr;
+        AudioDecoder* (*create)() = nullptr;
+    };
+    Vector<DecoderInfo> decoders;
+    MimeDetector detector;
+    AudioDecoder* p_decoder = nullptr;
+    bool is_created = false;
+    bool is_active = false;
+    Print* p_print = nullptr;
+    AudioBaseInfoDependent* p_bi = nullptr;
+    AudioBaseInfo no_info;
+    const char* actual_mime = nullptr;
+    uint8_t sniff_buffer[MULTI_DECODER_SNIFF_SIZE];
+    size_t sniff_len = 0;
+    size_t input_size = 0;
+
+    /// Finds the decoder for the mime: e.g. audio/ogg also matches audio/ogg;codecs=opus
+    DecoderInfo* findDecoder(const char* mime) {
+        if (mime == nullptr) return nullptr;
+        for (auto &info : decoders) {
+            if (strcmp(info.mime, mime) == 0) return &info;
+        }
+        for (auto &info : decoders) {
+            if (strncmp(info.mime, mime, strlen(info.mime)) == 0) return &info;
+        }
+        return nullptr;
+    }
+
+    /// Determines the format from the collected data and writes it to the selected decoder
+    void selectDecoderFor(const uint8_t* remaining, size_t len) {
+        const char* mime = detector.detect(sniff_buffer, sniff_len);
+        if (mime == nullptr || !selectDecoder(mime)) {
+            LOGW("Unknown Data Format: Content will be ignored...");
+            actual_mime = "n/a";
+            return;
+        }
+        p_decoder->write(sniff_buffer, sniff_len);
+        if (len > 0) {
+            p_decoder->write(remaining, len);
+        }
+    }
+
+    void releaseDecoder() {
+        if (p_decoder != nullptr) {
+            p_decoder->end();
+            if (is_created) delete p_decoder;
+        }
+        p_decoder = nullptr;
+        is_created = false;
+    }
+};
+
+}  // namespace audio_tools
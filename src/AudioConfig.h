@@ -46,6 +46,30 @@
 #define LOG_PRINTF_BUFFER_SIZE 256
 #define LOG_METHOD __PRETTY_FUNCTION__
 
+// Log statements below this level (0=Debug, 1=Info, 2=Warning, 3=Error) are removed at compile time
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL 0
+#endif
+
+// Compile time log levels of the modules which log in the audio processing path
+#ifndef LOG_LEVEL_COPY
+#define LOG_LEVEL_COPY LOG_COMPILE_LEVEL
+#endif
+
+#ifndef LOG_LEVEL_RESAMPLE
+#define LOG_LEVEL_RESAMPLE LOG_COMPILE_LEVEL
+#endif
+
+#ifndef LOG_LEVEL_MIXER
+#define LOG_LEVEL_MIXER LOG_COMPILE_LEVEL
+#endif
+
+// Change USE_DEFERRED_LOGGING to true to record the log statements in a lock free queue
+// which is printed by AudioLoggerDeferred::instance().process(): needs std::atomic
+#ifndef USE_DEFERRED_LOGGING
+#define USE_DEFERRED_LOGGING false
+#endif
+
 // cheange USE_CHECK_MEMORY to 1 to activate memory checks
 #define USE_CHECK_MEMORY 0
 #if USE_CHECK_MEMORY
@@ -380,7 +380,8 @@ protected:
  * We reduce the channels to 1 to calculate the pitch shift and provides the
  * pitch shifted result in the correct number of channels. The pitch shifting
  * is done with the help of a buffer that can have potentially multiple
- * implementations.
+ * implementations. For a better quality and an independent change of the tempo
+ * you can use the TimeStretchStream (AudioEffects/TimeStretch.h).
  * @ingroup transform
  * @tparam T
  * @tparam BufferT
@@ -0,0 +1,428 @@
+#pragma once
+#include <math.h>
+#include <string.h>
+#include "AudioConfig.h"
+#include "AudioTools/AudioPrint.h"
+#include "AudioBasic/Collections/Vector.h"
+#include "AudioLibs/FFT/FFTReal.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Algorithm which is used by the TimeStretchStream
+ * @ingroup effects
+ */
+enum TimeStretchMode {
+    /// Waveform similarity overlap add: good for speech and low cpu usage
+    TimeStretchWSOLA,
+    /// Phase vocoder: good for music
+    TimeStretchPhaseVocoder
+};
+
+/**
+ * @brief Configuration for the TimeStretchStream
+ * @ingroup effects
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct TimeStretchConfig : public AudioBaseInfo {
+    TimeStretchConfig() {
+        channels = 2;
+        sample_rate = 44100;
+        bits_per_sample = 16;
+    }
+    /// Playback speed: e.g. 2.0 is double the tempo (supported range 0.5 - 2.0)
+    float speed = 1.0f;
+    /// Pitch factor: e.g. 2.0 is one octave higher
+    float pitch = 1.0f;
+    TimeStretchMode mode = TimeStretchWSOLA;
+    /// WSOLA: length of the overlapping segments in ms
+    int window_ms = 20;
+    /// WSOLA: the similarity search is done in the range of +- search_ms
+    int search_ms = 5;
+    /// Phase vocoder: fft length (power of 2)
+    int fft_size = 2048;
+};
+
+/**
+ * @brief Abstract time stretch algorithm which works on interleaved float frames. One
+ * step reads inputFrames() frames and provides hop() output frames. All buffers are
+ * allocated in begin().
+ * @ingroup effects
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class TimeStretchEngine {
+  public:
+    virtual ~TimeStretchEngine() = default;
+    virtual bool begin(TimeStretchConfig &cfg) = 0;
+    /// Defines the ratio of the input hop to the output hop: > 1.0 makes the audio shorter
+    void setRatio(float ratio) { this->ratio = ratio; }
+    /// Number of input frames which are needed for one step
+    virtual int inputFrames() = 0;
+    /// Number of output frames of one step
+    virtual int hop() = 0;
+    /// Processes one step and returns the number of input frames which can be removed
+    virtual int step(const float* in, float* out) = 0;
+
+  protected:
+    float ratio = 1.0f;
+    float pos_fraction = 0.0f;
+    int channels = 1;
+
+    /// Determines the integer analysis hop and keeps the fractional part for the next step
+    int analysisHop() {
+        pos_fraction += ratio * hop();
+        int result = (int)pos_fraction;
+        pos_fraction -= result;
+        return result;
+    }
+};
+
+/**
+ * @brief Waveform similarity overlap add (WSOLA): Hann windowed segments are added with a
+ * fixed output hop of half the window length. The input segment is searched within the
+ * tolerance around the nominal position so that it matches best with the natural
+ * continuation of the previous segment.
+ * @ingroup effects
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class WSOLAStretch : public TimeStretchEngine {
+  public:
+    bool begin(TimeStretchConfig &cfg) override {
+        channels = cfg.channels;
+        window_len = cfg.sample_rate * cfg.window_ms / 1000;
+        window_len -= window_len % 2;
+        if (window_len < 16) window_len = 16;
+        tolerance = cfg.sample_rate * cfg.search_ms / 1000;
+        window.resize(window_len);
+        for (int j = 0; j < window_len; j++) {
+            window[j] = 0.5f - 0.5f * cosf(2.0f * PI * j / window_len);
+        }
+        acc.resize(window_len * channels);
+        memset(acc.data(), 0, acc.size() * sizeof(float));
+        natural.resize(window_len / 2);
+        has_natural = false;
+        pos_fraction = 0.0f;
+        return true;
+    }
+
+    int inputFrames() override { return window_len + 2 * tolerance; }
+
+    int hop() override { return window_len / 2; }
+
+    int step(const float* in, float* out) override {
+        int offset = has_natural ? bestOffset(in) : tolerance;
+        // overlap add the selected segment
+        const float* segment = in + offset * channels;
+        for (int j = 0; j < window_len; j++) {
+            for (int ch = 0; ch < channels; ch++) {
+                acc[j * channels + ch] += window[j] * segment[j * channels + ch];
+            }
+        }
+        // the natural continuation is the basis for the next search
+        int half = hop();
+        for (int j = 0; j < half; j++) natural[j] = mono(segment + (half + j) * channels);
+        has_natural = true;
+
+        // output the completed part and shift the accumulator
+        int hop_samples = half * channels;
+        memcpy(out, acc.data(), hop_samples * sizeof(float));
+        memmove(acc.data(), acc.data() + hop_samples, hop_samples * sizeof(float));
+        memset(acc.data() + hop_samples, 0, hop_samples * sizeof(float));
+        return analysisHop();
+    }
+
+  protected:
+    int window_len = 0;
+    int tolerance = 0;
+    bool has_natural = false;
+    Vector<float> window;
+    Vector<float> acc;
+    Vector<float> natural;
+
+    float mono(const float* frame) {
+        float result = 0;
+        for (int ch = 0; ch < channels; ch++) result += frame[ch];
+        return result;
+    }
+
+    /// Finds the offset with the max normalized cross correlation: we use every 2nd sample and offset
+    int bestOffset(const float* in) {
+        int half = hop();
+        int result = tolerance;
+        float best = -1e30f;
+        for (int offset = 0; offset <= 2 * tolerance; offset += 2) {
+            const float* segment = in + offset * channels;
+            float corr = 0.0f;
+            float energy = 1e-9f;
+            for (int j = 0; j < half; j += 2) {
+                float value = mono(segment + j * channels);
+                corr += value * natural[j];
+                energy += value * value;
+            }
+            float score = corr / sqrtf(energy);
+            if (score > best) {
+                best = score;
+                result = offset;
+            }
+        }
+        return result;
+    }
+};
+
+/**
+ * @brief Phase vocoder: The spectrum of Hann windowed frames is determined with a fft with
+ * an output hop of 1/4 of the fft length. The phases are advanced with the estimated true
+ * frequency of each bin, so that the result can be resynthesized with a different hop.
+ * @ingroup effects
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PhaseVocoderStretch : public TimeStretchEngine {
+  public:
+    ~PhaseVocoderStretch() { delete p_fft; }
+
+    bool begin(TimeStretchConfig &cfg) override {
+        channels = cfg.channels;
+        int len = 16;
+        while (len < cfg.fft_size) len *= 2;
+        if (len != cfg.fft_size) LOGW("fft_size must be a power of 2: using %d", len);
+        if (p_fft == nullptr || fft_len != len) {
+            delete p_fft;
+            p_fft = new ffft::FFTReal<float>(len);
+        }
+        fft_len = len;
+        int bins = fft_len / 2 + 1;
+        window.resize(fft_len);
+        for (int j = 0; j < fft_len; j++) {
+            window[j] = 0.5f - 0.5f * cosf(2.0f * PI * j / fft_len);
+        }
+        x.resize(fft_len);
+        f.resize(fft_len);
+        last_phase.resize(bins * channels);
+        sum_phase.resize(bins * channels);
+        acc.resize(fft_len * channels);
+        memset(acc.data(), 0, acc.size() * sizeof(float));
+        is_first = true;
+        prev_hop = hop();
+        pos_fraction = 0.0f;
+        return true;
+    }
+
+    int inputFrames() override { return fft_len; }
+
+    int hop() override { return fft_len / 4; }
+
+    int step(const float* in, float* out) override {
+        int half = fft_len / 2;
+        // hann^2 with a hop of 1/4 sums up to 1.5
+        float scale = 1.0f / (fft_len * 1.5f);
+        for (int ch = 0; ch < channels; ch++) {
+            for (int j = 0; j < fft_len; j++) x[j] = window[j] * in[j * channels + ch];
+            p_fft->do_fft(f.data(), x.data());
+            float* p_last = last_phase.data() + ch * (half + 1);
+            float* p_sum = sum_phase.data() + ch * (half + 1);
+            for (int k = 0; k <= half; k++) {
+                // the imaginary part of FFTReal has the opposite sign
+                float re = f[k];
+                float im = (k == 0 || k == half) ? 0.0f : -f[half + k];
+                float magnitude = sqrtf(re * re + im * im);
+                float phase = atan2f(im, re);
+                if (is_first) {
+                    p_sum[k] = phase;
+                } else {
+                    float omega = 2.0f * PI * k / fft_len;
+                    float delta = phase - p_last[k] - omega * prev_hop;
+                    delta -= 2.0f * PI * roundf(delta / (2.0f * PI));
+                    p_sum[k] += (omega + delta / prev_hop) * hop();
+                    p_sum[k] -= 2.0f * PI * roundf(p_sum[k] / (2.0f * PI));
+                }
+                p_last[k] = phase;
+                f[k] = magnitude * cosf(p_sum[k]);
+                if (k > 0 && k < half) f[half + k] = -magnitude * sinf(p_sum[k]);
+            }
+            p_fft->do_ifft(f.data(), x.data());
+            for (int j = 0; j < fft_len; j++) {
+                acc[j * channels + ch] += window[j] * x[j] * scale;
+            }
+        }
+        is_first = false;
+
+        // output the completed part and shift the accumulator
+        int hop_samples = hop() * channels;
+        memcpy(out, acc.data(), hop_samples * sizeof(float));
+        memmove(acc.data(), acc.data() + hop_samples, (acc.size() - hop_samples) * sizeof(float));
+        memset(acc.data() + acc.size() - hop_samples, 0, hop_samples * sizeof(float));
+        prev_hop = analysisHop();
+        if (prev_hop < 1) prev_hop = 1;
+        return prev_hop;
+    }
+
+  protected:
+    ffft::FFTReal<float>* p_fft = nullptr;
+    int fft_len = 0;
+    int prev_hop = 1;
+    bool is_first = true;
+    Vector<float> window;
+    Vector<float> x;
+    Vector<float> f;
+    Vector<float> last_phase;
+    Vector<float> sum_phase;
+    Vector<float> acc;
+};
+
+/**
+ * @brief Changes the tempo w/o changing the pitch (e.g. to play podcasts at a different speed)
+ * and/or changes the pitch w/o changing the tempo. The time stretching is done with WSOLA or a
+ * phase vocoder and the pitch shift by resampling the time stretched result with a linear
+ * interpolation. Only 16 bit data is supported.
+ * @ingroup effects
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class TimeStretchStream : public AudioPrint {
+  public:
+    TimeStretchStream(Print &out) { p_out = &out; }
+
+    TimeStretchConfig defaultConfig() {
+        TimeStretchConfig c;
+        return c;
+    }
+
+    bool begin(TimeStretchConfig cfg) {
+        TRACED();
+        if (cfg.bits_per_sample != 16) {
+            LOGE("Unsupported bits_per_sample: %d", cfg.bits_per_sample);
+            return false;
+        }
+        this->cfg = cfg;
+        AudioPrint::setAudioInfo(cfg);
+        p_engine = cfg.mode == TimeStretchWSOLA ? (TimeStretchEngine*)&wsola : (TimeStretchEngine*)&vocoder;
+        if (!p_engine->begin(this->cfg)) return false;
+        input.resize(p_engine->inputFrames() * cfg.channels);
+        input_len = 0;
+        skip = 0;
+        hop_buffer.resize(p_engine->hop() * cfg.channels);
+        last_frame.resize(cfg.channels);
+        for (int ch = 0; ch < cfg.channels; ch++) last_frame[ch] = 0.0f;
+        output.resize(hop_buffer.size());
+        resample_pos = 0.0f;
+        setSpeed(cfg.speed);
+        setPitch(cfg.pitch);
+        active = true;
+        return true;
+    }
+
+    void end() { active = false; }
+
+    /// Defines the tempo: e.g. 1.5 plays 50% faster
+    void setSpeed(float speed) {
+        if (speed < 0.5f) speed = 0.5f;
+        if (speed > 2.0f) speed = 2.0f;
+        cfg.speed = speed;
+        updateRatio();
+    }
+
+    /// Defines the pitch factor: e.g. 2.0 is one octave higher
+    void setPitch(float pitch) {
+        if (pitch < 0.5f) pitch = 0.5f;
+        if (pitch > 2.0f) pitch = 2.0f;
+        cfg.pitch = pitch;
+        updateRatio();
+    }
+
+    float speed() { return cfg.speed; }
+
+    float pitch() { return cfg.pitch; }
+
+    size_t write(const uint8_t *data, size_t len) override {
+        if (!active) return 0;
+        const int16_t* samples = (const int16_t*)data;
+        int sample_count = len / sizeof(int16_t);
+        int needed = p_engine->inputFrames() * cfg.channels;
+        int pos = 0;
+        while (pos < sample_count) {
+            // skip the input which was consumed by the last step but not available yet
+            if (skip > 0) {
+                int skip_len = skip < sample_count - pos ? skip : sample_count - pos;
+                skip -= skip_len;
+                pos += skip_len;
+                continue;
+            }
+            // fill the input buffer
+            int copy = needed - input_len;
+            if (copy > sample_count - pos) copy = sample_count - pos;
+            for (int j = 0; j < copy; j++) input[input_len + j] = samples[pos + j];
+            input_len += copy;
+            pos += copy;
+            if (input_len < needed) break;
+
+            // process a step and remove the consumed input
+            int consumed = p_engine->step(input.data(), hop_buffer.data()) * cfg.channels;
+            if (consumed > input_len) {
+                skip = consumed - input_len;
+                consumed = input_len;
+            }
+            memmove(input.data(), input.data() + consumed, (input_len - consumed) * sizeof(float));
+            input_len -= consumed;
+            writeResampled(hop_buffer.data(), p_engine->hop());
+        }
+        return len;
+    }
+
+    int availableForWrite() override { return p_out->availableForWrite(); }
+
+  protected:
+    TimeStretchConfig cfg;
+    Print* p_out = nullptr;
+    TimeStretchEngine* p_engine = nullptr;
+    WSOLAStretch wsola;
+    PhaseVocoderStretch vocoder;
+    Vector<float> input;
+    int input_len = 0;
+    int skip = 0;
+    Vector<float> hop_buffer;
+    Vector<float> last_frame;
+    Vector<int16_t> output;
+    float resample_pos = 0.0f;
+    bool active = false;
+
+    /// the time stretch needs to compensate the change of the duration by the resampling
+    void updateRatio() {
+        if (p_engine != nullptr) p_engine->setRatio(cfg.speed / cfg.pitch);
+    }
+
+    /// Resamples the frames by the pitch factor and writes them as int16_t
+    void writeResampled(const float* frames, int count) {
+        int channels = cfg.channels;
+        int out_len = 0;
+        float step = cfg.pitch;
+        while (resample_pos < count - 1) {
+            int idx = floorf(resample_pos);
+            float frac = resample_pos - idx;
+            for (int ch = 0; ch < channels; ch++) {
+                float a = idx < 0 ? last_frame[ch] : frames[idx * channels + ch];
+                float b = frames[(idx + 1) * channels + ch];
+                output[out_len++] = clip(a + (b - a) * frac);
+            }
+            if (out_len + channels > output.size()) {
+                p_out->write((uint8_t*)output.data(), out_len * sizeof(int16_t));
+                out_len = 0;
+            }
+            resample_pos += step;
+        }
+        resample_pos -= count;
+        for (int ch = 0; ch < channels; ch++) last_frame[ch] = frames[(count - 1) * channels + ch];
+        if (out_len > 0) p_out->write((uint8_t*)output.data(), out_len * sizeof(int16_t));
+    }
+
+    int16_t clip(float value) {
+        if (value > 32767.0f) return 32767;
+        if (value < -32768.0f) return -32768;
+        return (int16_t)value;
+    }
+};
+
+}  // namespace audio_tools
@@ -2,6 +2,7 @@
 #include <math.h>
 #include "AudioTools/AudioPrint.h"
 #include "AudioBasic/Int24.h"
+#include "AudioBasic/Collections/Vector.h"
 
 /** 
  * @defgroup equilizer Equilizer
@@ -230,4 +231,425 @@ class Equilizer3Bands : public AudioStream {
 
 };
 
+/// Number of frames which are processed as one block by the ParametricEQ
+#ifndef EQ_BLOCK_SIZE
+#define EQ_BLOCK_SIZE 32
+#endif
+
+/**
+ * @brief Filter types of the bands of the ParametricEQ
+ * @ingroup equilizer
+ */
+enum EQBandType { EQPeak, EQLowShelf, EQHighShelf, EQLowPass, EQHighPass, EQBandPass, EQNotch };
+
+/**
+ * @brief Definition of a band of the ParametricEQ
+ * @ingroup equilizer
+ */
+struct EQBand {
+    EQBandType type = EQPeak;
+    float frequency = 1000.0f;
+    /// gain in dB for peak and shelf filters
+    float gain_db = 0.0f;
+    float q = 0.707f;
+};
+
+/**
+ * @brief Biquad coefficients (normalized with a0) which are calculated with the formulas
+ * from the Audio EQ Cookbook by Robert Bristow-Johnson
+ * @ingroup equilizer
+ */
+struct EQCoefficients {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+
+    void calculate(EQBand &band, int sampleRate) {
+        float A = powf(10.0f, band.gain_db / 40.0f);
+        float w0 = 2.0f * (float)M_PI * band.frequency / sampleRate;
+        float cosw = cosf(w0);
+        float alpha = sinf(w0) / (2.0f * (band.q > 0.0f ? band.q : 0.707f));
+        float sqrtA2alpha = 2.0f * sqrtf(A) * alpha;
+        float a0 = 1.0f;
+        switch (band.type) {
+            case EQPeak:
+                b0 = 1.0f + alpha * A;
+                b1 = -2.0f * cosw;
+                b2 = 1.0f - alpha * A;
+                a0 = 1.0f + alpha / A;
+                a1 = -2.0f * cosw;
+                a2 = 1.0f - alpha / A;
+                break;
+            case EQLowShelf:
+                b0 = A * ((A + 1) - (A - 1) * cosw + sqrtA2alpha);
+                b1 = 2 * A * ((A - 1) - (A + 1) * cosw);
+                b2 = A * ((A + 1) - (A - 1) * cosw - sqrtA2alpha);
+                a0 = (A + 1) + (A - 1) * cosw + sqrtA2alpha;
+                a1 = -2 * ((A - 1) + (A + 1) * cosw);
+                a2 = (A + 1) + (A - 1) * cosw - sqrtA2alpha;
+                break;
+            case EQHighShelf:
+                b0 = A * ((A + 1) + (A - 1) * cosw + sqrtA2alpha);
+                b1 = -2 * A * ((A - 1) + (A + 1) * cosw);
+                b2 = A * ((A + 1) + (A - 1) * cosw - sqrtA2alpha);
+                a0 = (A + 1) - (A - 1) * cosw + sqrtA2alpha;
+                a1 = 2 * ((A - 1) - (A + 1) * cosw);
+                a2 = (A + 1) - (A - 1) * cosw - sqrtA2alpha;
+                break;
+            case EQLowPass:
+                b0 = (1.0f - cosw) / 2.0f;
+                b1 = 1.0f - cosw;
+                b2 = b0;
+                a0 = 1.0f + alpha;
+                a1 = -2.0f * cosw;
+                a2 = 1.0f - alpha;
+                break;
+            case EQHighPass:
+                b0 = (1.0f + cosw) / 2.0f;
+                b1 = -(1.0f + cosw);
+                b2 = b0;
+                a0 = 1.0f + alpha;
+                a1 = -2.0f * cosw;
+                a2 = 1.0f - alpha;
+                break;
+            case EQBandPass:
+                b0 = alpha;
+                b1 = 0.0f;
+                b2 = -alpha;
+                a0 = 1.0f + alpha;
+                a1 = -2.0f * cosw;
+                a2 = 1.0f - alpha;
+                break;
+            case EQNotch:
+                b0 = 1.0f;
+                b1 = -2.0f * cosw;
+                b2 = 1.0f;
+                a0 = 1.0f + alpha;
+                a1 = -2.0f * cosw;
+                a2 = 1.0f - alpha;
+                break;
+        }
+        b0 /= a0;
+        b1 /= a0;
+        b2 /= a0;
+        a1 /= a0;
+        a2 /= a0;
+    }
+
+    /// moves the coefficients by the factor (0 - 1.0) towards the target
+    void interpolate(const EQCoefficients &target, float factor) {
+        b0 += (target.b0 - b0) * factor;
+        b1 += (target.b1 - b1) * factor;
+        b2 += (target.b2 - b2) * factor;
+        a1 += (target.a1 - a1) * factor;
+        a2 += (target.a2 - a2) * factor;
+    }
+};
+
+/**
+ * @brief Biquad processing (direct form 1) with float values
+ * @ingroup equilizer
+ */
+struct EQKernelFloat {
+    typedef float Sample;
+    typedef EQCoefficients Coef;
+    struct State {
+        float x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    };
+
+    static void setup(Coef &coef, const EQCoefficients &from) { coef = from; }
+
+    /// moves the coefficients by frames / remaining towards the target
+    static void interpolate(Coef &coef, const Coef &target, int frames, int remaining) {
+        coef.interpolate(target, (float)frames / remaining);
+    }
+
+    static Sample fromInt16(int16_t value) { return value; }
+
+    static int16_t toInt16(Sample value) {
+        if (value > 32767.0f) return 32767;
+        if (value < -32768.0f) return -32768;
+        return (int16_t)value;
+    }
+
+    static void process(const Coef &c, State &s, Sample* data, int len) {
+        float x1 = s.x1, x2 = s.x2, y1 = s.y1, y2 = s.y2;
+        for (int j = 0; j < len; j++) {
+            float x0 = data[j];
+            float y0 = c.b0 * x0 + c.b1 * x1 + c.b2 * x2 - c.a1 * y1 - c.a2 * y2;
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = y0;
+            data[j] = y0;
+        }
+        s.x1 = x1;
+        s.x2 = x2;
+        s.y1 = y1;
+        s.y2 = y2;
+    }
+};
+
+/**
+ * @brief Biquad processing (direct form 1) with integers only: the coefficients are
+ * stored as Q26 and the samples with 8 additional fraction bits.
+ * @ingroup equilizer
+ */
+struct EQKernelFixed {
+    typedef int32_t Sample;
+    struct Coef {
+        int32_t b0 = 1 << 26, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    };
+    struct State {
+        int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    };
+
+    static void setup(Coef &coef, const EQCoefficients &from) {
+        coef.b0 = toQ26(from.b0);
+        coef.b1 = toQ26(from.b1);
+        coef.b2 = toQ26(from.b2);
+        coef.a1 = toQ26(from.a1);
+        coef.a2 = toQ26(from.a2);
+    }
+
+    /// moves the coefficients by frames / remaining towards the target with integers only
+    static void interpolate(Coef &coef, const Coef &target, int frames, int remaining) {
+        coef.b0 += step(coef.b0, target.b0, frames, remaining);
+        coef.b1 += step(coef.b1, target.b1, frames, remaining);
+        coef.b2 += step(coef.b2, target.b2, frames, remaining);
+        coef.a1 += step(coef.a1, target.a1, frames, remaining);
+        coef.a2 += step(coef.a2, target.a2, frames, remaining);
+    }
+
+    static Sample fromInt16(int16_t value) { return (int32_t)value << 8; }
+
+    static int16_t toInt16(Sample value) {
+        value = value >> 8;
+        if (value > 32767) return 32767;
+        if (value < -32768) return -32768;
+        return (int16_t)value;
+    }
+
+    static void process(const Coef &c, State &s, Sample* data, int len) {
+        int32_t x1 = s.x1, x2 = s.x2, y1 = s.y1, y2 = s.y2;
+        for (int j = 0; j < len; j++) {
+            int32_t x0 = data[j];
+            int64_t acc = (int64_t)c.b0 * x0 + (int64_t)c.b1 * x1 + (int64_t)c.b2 * x2 -
+                          (int64_t)c.a1 * y1 - (int64_t)c.a2 * y2;
+            int64_t y0 = acc >> 26;
+            // saturate to the range of the extended int16
+            if (y0 > (32767 << 8)) y0 = 32767 << 8;
+            if (y0 < (-32768 * 256)) y0 = -32768 * 256;
+            x2 = x1;
+            x1 = x0;
+            y2 = y1;
+            y1 = (int32_t)y0;
+            data[j] = y1;
+        }
+        s.x1 = x1;
+        s.x2 = x2;
+        s.y1 = y1;
+        s.y2 = y2;
+    }
+
+    static int32_t toQ26(float value) {
+        return (int32_t)(value * (float)(1 << 26) + (value < 0 ? -0.5f : 0.5f));
+    }
+
+    static int32_t step(int32_t from, int32_t to, int frames, int remaining) {
+        return (int32_t)((int64_t)(to - from) * frames / remaining);
+    }
+};
+
+/**
+ * @brief Configuration for the ParametricEQ
+ * @ingroup equilizer
+ */
+struct ConfigParametricEQ : public AudioBaseInfo {
+    ConfigParametricEQ() {
+        channels = 2;
+        bits_per_sample = 16;
+        sample_rate = 44100;
+    }
+    /// Number of frames over which the coefficients are changed when a band is updated
+    int smoothing_frames = 1024;
+};
+
+/**
+ * @brief Parametric equalizer with any number of bands (e.g. 10 or 31) which are
+ * implemented as cascaded biquad filters. The data is processed in blocks of
+ * EQ_BLOCK_SIZE frames for each channel. Changes of the bands are applied by interpolating
+ * the coefficients over smoothing_frames so that there is no zipper noise. The processing
+ * is defined by the kernel: use ParametricEQ (float) or ParametricEQFixed (integer only).
+ * Only 16 bits are supported.
+ * @ingroup equilizer
+ * @author pschatzmann
+ * @tparam Kernel
+ */
+template <class Kernel>
+class ParametricEQT : public AudioStream {
+  public:
+    ParametricEQT(Print &out) { p_print = &out; }
+
+    ParametricEQT(Stream &in) {
+        p_stream = &in;
+        p_print = &in;
+    }
+
+    ConfigParametricEQ defaultConfig() {
+        ConfigParametricEQ c;
+        return c;
+    }
+
+    /// Adds a band and returns its index
+    int addBand(EQBandType type, float frequency, float gainDb = 0.0f, float q = 0.707f) {
+        EQBand band;
+        band.type = type;
+        band.frequency = frequency;
+        band.gain_db = gainDb;
+        band.q = q;
+        BandInfo info;
+        info.band = band;
+        bands.push_back(info);
+        if (is_active) setupBand(bands.size() - 1, false);
+        return bands.size() - 1;
+    }
+
+    bool begin(ConfigParametricEQ config) {
+        cfg = config;
+        if (cfg.bits_per_sample != 16) {
+            LOGE("Only 16 bits supported: %d", cfg.bits_per_sample);
+            return false;
+        }
+        states.resize(bands.size() * cfg.channels);
+        for (int j = 0; j < states.size(); j++) states[j] = typename Kernel::State();
+        for (int j = 0; j < bands.size(); j++) setupBand(j, false);
+        is_active = true;
+        return true;
+    }
+
+    void end() override { is_active = false; }
+
+    void setAudioInfo(AudioBaseInfo info) override {
+        cfg.sample_rate = info.sample_rate;
+        cfg.channels = info.channels;
+        cfg.bits_per_sample = info.bits_per_sample;
+        begin(cfg);
+    }
+
+    /// Updates the band: the change is smoothed
+    void setBand(int idx, EQBand band) {
+        if (idx >= bands.size()) {
+            LOGE("Invalid band %d", idx);
+            return;
+        }
+        bands[idx].band = band;
+        if (is_active) setupBand(idx, true);
+    }
+
+    /// Updates the gain of the band: the change is smoothed
+    void setGain(int idx, float gainDb) {
+        if (idx >= bands.size()) {
+            LOGE("Invalid band %d", idx);
+            return;
+        }
+        EQBand band = bands[idx].band;
+        band.gain_db = gainDb;
+        setBand(idx, band);
+    }
+
+    /// Provides the definition of the band
+    EQBand &band(int idx) { return bands[idx].band; }
+
+    /// Number of bands
+    int size() { return bands.size(); }
+
+    size_t write(const uint8_t *data, size_t len) override {
+        if (is_active) filterSamples(data, len);
+        return p_print->write(data, len);
+    }
+
+    int availableForWrite() override { return p_print->availableForWrite(); }
+
+    size_t readBytes(uint8_t *data, size_t len) override {
+        if (p_stream == nullptr) return 0;
+        size_t result = p_stream->readBytes(data, len);
+        if (is_active) filterSamples(data, result);
+        return result;
+    }
+
+    int available() override { return p_stream != nullptr ? p_stream->available() : 0; }
+
+  protected:
+    struct BandInfo {
+        EQBand band;
+        typename Kernel::Coef coef;
+        typename Kernel::Coef target;
+        int remaining = 0;
+    };
+    ConfigParametricEQ cfg;
+    Print *p_print = nullptr;
+    Stream *p_stream = nullptr;
+    Vector<BandInfo> bands;
+    Vector<typename Kernel::State> states;
+    bool is_active = false;
+
+    /// Calculates the target coefficients in the format of the kernel
+    void setupBand(int idx, bool smooth) {
+        BandInfo &info = bands[idx];
+        EQCoefficients target;
+        target.calculate(info.band, cfg.sample_rate);
+        Kernel::setup(info.target, target);
+        if (smooth && cfg.smoothing_frames > 0) {
+            info.remaining = cfg.smoothing_frames;
+        } else {
+            info.coef = info.target;
+            info.remaining = 0;
+        }
+        // a new band starts with an empty state: the other bands are not changed
+        int old_size = states.size();
+        if (old_size < bands.size() * cfg.channels) {
+            states.resize(bands.size() * cfg.channels);
+            for (int j = old_size; j < states.size(); j++) states[j] = typename Kernel::State();
+        }
+    }
+
+    /// moves the coefficients towards the target
+    void updateCoefficients(int frames) {
+        for (int j = 0; j < bands.size(); j++) {
+            BandInfo &info = bands[j];
+            if (info.remaining <= 0) continue;
+            if (frames >= info.remaining) {
+                info.coef = info.target;
+                info.remaining = 0;
+            } else {
+                Kernel::interpolate(info.coef, info.target, frames, info.remaining);
+                info.remaining -= frames;
+            }
+        }
+    }
+
+    void filterSamples(const uint8_t *data, size_t len) {
+        int16_t *samples = (int16_t *)data;
+        int channels = cfg.channels;
+        int frames = len / sizeof(int16_t) / channels;
+        typename Kernel::Sample block[EQ_BLOCK_SIZE];
+        for (int start = 0; start < frames; start += EQ_BLOCK_SIZE) {
+            int count = frames - start < EQ_BLOCK_SIZE ? frames - start : EQ_BLOCK_SIZE;
+            updateCoefficients(count);
+            for (int ch = 0; ch < channels; ch++) {
+                int16_t *p_data = samples + start * channels + ch;
+                for (int j = 0; j < count; j++) block[j] = Kernel::fromInt16(p_data[j * channels]);
+                for (int b = 0; b < bands.size(); b++) {
+                    Kernel::process(bands[b].coef, states[b * channels + ch], block, count);
+                }
+                for (int j = 0; j < count; j++) p_data[j * channels] = Kernel::toInt16(block[j]);
+            }
+        }
+    }
+};
+
+/// Parametric equalizer using float
+typedef ParametricEQT<EQKernelFloat> ParametricEQ;
+/// Parametric equalizer using integers only
+typedef ParametricEQT<EQKernelFixed> ParametricEQFixed;
+
 } // namespace
\ No newline at end of file
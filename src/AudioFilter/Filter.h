@@ -54,7 +54,8 @@ class NoFilter : Filter<T> {
  * @brief FIR Filter
  * Converted from
  * https://github.com/sebnil/FIR-filter-Arduino-Library/tree/master/src
- * You can use https://www.arc.id.au/FilterDesign.html to design the filter
+ * You can use https://www.arc.id.au/FilterDesign.html to design the filter.
+ * For long filters (e.g. impulse responses) use the ConvolutionStream.
  * @ingroup filter
  * @author Pieter P tttapa  / pschatzmann
  * @copyright GNU General Public License v3.0
@@ -78,7 +79,7 @@ class FIR : public Filter<T> {
       x[i_b] = value;
       T b_terms = 0;
       T *b_shift = &coeff_b[lenB - i_b - 1];
-      for (uint8_t i = 0; i < lenB; i++) {
+      for (uint16_t i = 0; i < lenB; i++) {
         b_terms += b_shift[i] * x[i] ; 
       }
       i_b++;
@@ -97,8 +98,8 @@ class FIR : public Filter<T> {
       return b_terms;
     }
   private:
-    const uint8_t lenB;
-    uint8_t i_b = 0;
+    const uint16_t lenB;
+    uint16_t i_b = 0;
     T *x;
     T *coeff_b;
     T factor;
@@ -147,10 +148,10 @@ class IIR : public Filter<T> {
     T a_terms = 0;
     T *a_shift = &coeff_a[lenA - i_a - 1];
 
-    for (uint8_t i = 0; i < lenB; i++) {
+    for (uint16_t i = 0; i < lenB; i++) {
       b_terms += x[i] * b_shift[i];
     }
-    for (uint8_t i = 0; i < lenA; i++) {
+    for (uint16_t i = 0; i < lenA; i++) {
       a_terms += y[i] * a_shift[i];
     }
 
@@ -175,8 +176,8 @@ class IIR : public Filter<T> {
 
  private:
   T factor;
-  const uint8_t lenB, lenA;
-  uint8_t i_b = 0, i_a = 0;
+  const uint16_t lenB, lenA;
+  uint16_t i_b = 0, i_a = 0;
   T *x;
   T *y;
   T *coeff_b;
@@ -0,0 +1,275 @@
+#pragma once
+
+#include "AudioLibs/AudioFFT.h"
+#include "AudioCodecs/CodecWAV.h"
+#include "AudioBasic/Collections/Vector.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Configuration for the ConvolutionStream
+ * @ingroup fft
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct ConvolutionConfig : public AudioBaseInfo {
+    ConvolutionConfig() {
+        channels = 2;
+        sample_rate = 44100;
+        bits_per_sample = 16;
+    }
+    /// Frames per partition (power of 2): this is the latency. Bigger values need less cpu.
+    int partition_size = 512;
+    /// Factor for the convolved signal
+    float wet = 1.0f;
+    /// Factor for the original signal
+    float dry = 0.0f;
+};
+
+/**
+ * @brief Convolution with long impulse responses (e.g. reverb or room correction with
+ * 10k - 100k taps) using a uniformly partitioned overlap-save algorithm: The impulse
+ * response is split into partitions of partition_size frames which are transformed
+ * once. For each block we need only one fft and one reverse fft of twice the partition
+ * size and the complex multiplication with the spectra of the past blocks. The impulse
+ * response can have one channel (which is used for all channels) or the same number
+ * of channels as the audio data. It can be provided as float array or as WAV file.
+ * Only 16 bit data is supported and the FFTDriver must support the reverse fft (e.g.
+ * FFTDriverRealFFT or FFTDriverKissFFT).
+ * @ingroup fft
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class ConvolutionStream : public AudioPrint {
+  public:
+    ConvolutionStream(Print &out, FFTDriver &driver) {
+        p_out = &out;
+        p_driver = &driver;
+    }
+
+    ConvolutionConfig defaultConfig() {
+        ConvolutionConfig c;
+        return c;
+    }
+
+    /// Defines the impulse response as interleaved float values (in the range of -1.0 to 1.0)
+    void setImpulseResponse(const float* ir, int frames, int channels = 1) {
+        ir_data.resize(frames * channels);
+        memcpy(ir_data.data(), ir, frames * channels * sizeof(float));
+        ir_frames = frames;
+        ir_channels = channels;
+    }
+
+    /// Loads the impulse response from a 16 bit WAV file
+    bool setImpulseResponse(Stream &wav) {
+        IRCollector collector(ir_data);
+        WAVDecoder decoder(collector, collector);
+        decoder.begin();
+        uint8_t buffer[512];
+        int len;
+        while ((len = wav.readBytes(buffer, 512)) > 0) {
+            decoder.write(buffer, len);
+        }
+        AudioBaseInfo info = decoder.audioInfo();
+        if (info.bits_per_sample != 16 || info.channels <= 0) {
+            LOGE("Unsupported impulse response: bits_per_sample: %d", info.bits_per_sample);
+            return false;
+        }
+        ir_channels = info.channels;
+        ir_frames = ir_data.size() / ir_channels;
+        LOGI("impulse response: %d frames, %d channels", ir_frames, ir_channels);
+        return ir_frames > 0;
+    }
+
+    bool begin(ConvolutionConfig cfg) {
+        TRACED();
+        this->cfg = cfg;
+        AudioPrint::setAudioInfo(cfg);
+        if (cfg.bits_per_sample != 16) {
+            LOGE("Unsupported bits_per_sample: %d", cfg.bits_per_sample);
+            return false;
+        }
+        if (ir_channels != 1 && ir_channels != cfg.channels) {
+            LOGE("Invalid channels of impulse response: %d", ir_channels);
+            return false;
+        }
+        if (!p_driver->isReverseFFT()) {
+            LOGE("FFTDriver does not support the reverse fft");
+            return false;
+        }
+        block = 16;
+        while (block < cfg.partition_size) block *= 2;
+        fft_len = block * 2;
+        bins = block + 1;
+        if (!p_driver->begin(fft_len)) return false;
+
+        partitions = (ir_frames + block - 1) / block;
+        if (partitions == 0) partitions = 1;
+        LOGI("partitions: %d of %d frames", partitions, block);
+
+        // transform the impulse response partitions
+        ir_spectra.resize(ir_channels * partitions * bins * 2);
+        for (int ch = 0; ch < ir_channels; ch++) {
+            for (int p = 0; p < partitions; p++) {
+                for (int j = 0; j < fft_len; j++) {
+                    int frame = p * block + j;
+                    float value = j < block && frame < ir_frames ? ir_data[frame * ir_channels + ch] : 0.0f;
+                    p_driver->setValueFloat(j, value);
+                }
+                p_driver->fft();
+                float* spectrum = irSpectrum(ch, p);
+                FFTBin bin;
+                for (int k = 0; k < bins; k++) {
+                    p_driver->getBin(k, bin);
+                    spectrum[k * 2] = bin.real;
+                    spectrum[k * 2 + 1] = bin.img;
+                }
+            }
+        }
+
+        fdl.resize(cfg.channels * partitions * bins * 2);
+        memset(fdl.data(), 0, fdl.size() * sizeof(float));
+        fdl_pos = 0;
+        input.resize(cfg.channels * fft_len);
+        memset(input.data(), 0, input.size() * sizeof(float));
+        sum.resize(bins * 2);
+        output.resize(block * cfg.channels);
+        frame_pos = 0;
+        sample_pos = 0;
+        active = true;
+        return true;
+    }
+
+    void end() {
+        active = false;
+        p_driver->end();
+    }
+
+    /// Releases the memory of the impulse response which is not needed after begin()
+    void clearImpulseResponse() {
+        ir_data.resize(0);
+        ir_data.shrink_to_fit();
+    }
+
+    size_t write(const uint8_t *data, size_t len) override {
+        if (!active) return 0;
+        const int16_t* samples = (const int16_t*)data;
+        int count = len / sizeof(int16_t);
+        for (int j = 0; j < count; j++) {
+            // the new data is collected in the second half
+            input[sample_pos * fft_len + block + frame_pos] = samples[j];
+            if (++sample_pos >= cfg.channels) {
+                sample_pos = 0;
+                if (++frame_pos >= block) {
+                    processBlock();
+                    frame_pos = 0;
+                }
+            }
+        }
+        return len;
+    }
+
+    int availableForWrite() override { return p_out->availableForWrite(); }
+
+    /// Provides the latency in frames
+    int latency() { return block; }
+
+  protected:
+    /// Collects the decoded impulse response as float
+    class IRCollector : public AudioPrint {
+      public:
+        IRCollector(Vector<float> &data) : p_data(&data) { data.resize(0); }
+        size_t write(const uint8_t *buffer, size_t size) override {
+            const int16_t* samples = (const int16_t*)buffer;
+            for (size_t j = 0; j < size / 2; j++) p_data->push_back(samples[j] / 32768.0f);
+            return size;
+        }
+        Vector<float>* p_data;
+    };
+
+    ConvolutionConfig cfg;
+    Print* p_out = nullptr;
+    FFTDriver* p_driver = nullptr;
+    Vector<float> ir_data;
+    int ir_frames = 0;
+    int ir_channels = 1;
+    int block = 0;
+    int fft_len = 0;
+    int bins = 0;
+    int partitions = 0;
+    // spectra of the impulse response partitions
+    Vector<float> ir_spectra;
+    // frequency domain delay line with the spectra of the past input blocks
+    Vector<float> fdl;
+    int fdl_pos = 0;
+    Vector<float> input;
+    Vector<float> sum;
+    Vector<int16_t> output;
+    int frame_pos = 0;
+    int sample_pos = 0;
+    bool active = false;
+
+    float* irSpectrum(int ch, int partition) {
+        return ir_spectra.data() + (ch * partitions + partition) * bins * 2;
+    }
+
+    float* inputSpectrum(int ch, int pos) {
+        return fdl.data() + (ch * partitions + pos) * bins * 2;
+    }
+
+    void processBlock() {
+        float scale = 1.0f / fft_len;
+        FFTBin bin;
+        for (int ch = 0; ch < cfg.channels; ch++) {
+            float* in = input.data() + ch * fft_len;
+            // transform the last 2 blocks
+            for (int j = 0; j < fft_len; j++) p_driver->setValueFloat(j, in[j]);
+            p_driver->fft();
+            float* spectrum = inputSpectrum(ch, fdl_pos);
+            for (int k = 0; k < bins; k++) {
+                p_driver->getBin(k, bin);
+                spectrum[k * 2] = bin.real;
+                spectrum[k * 2 + 1] = bin.img;
+            }
+
+            // multiply and add the spectra
+            memset(sum.data(), 0, sum.size() * sizeof(float));
+            int ir_ch = ir_channels == 1 ? 0 : ch;
+            for (int p = 0; p < partitions; p++) {
+                int pos = fdl_pos - p;
+                if (pos < 0) pos += partitions;
+                const float* x = inputSpectrum(ch, pos);
+                const float* h = irSpectrum(ir_ch, p);
+                float* y = sum.data();
+                for (int k = 0; k < bins * 2; k += 2) {
+                    y[k] += x[k] * h[k] - x[k + 1] * h[k + 1];
+                    y[k + 1] += x[k] * h[k + 1] + x[k + 1] * h[k];
+                }
+            }
+
+            // the second half of the reverse fft is the valid result
+            for (int k = 0; k < bins; k++) {
+                bin.real = sum[k * 2];
+                bin.img = sum[k * 2 + 1];
+                p_driver->setBin(k, bin);
+            }
+            p_driver->rfft();
+            for (int j = 0; j < block; j++) {
+                float value = cfg.wet * p_driver->getValue(block + j) * scale + cfg.dry * in[block + j];
+                output[j * cfg.channels + ch] = clip(value);
+            }
+            // keep the actual block for the next round
+            memcpy(in, in + block, block * sizeof(float));
+        }
+        fdl_pos = (fdl_pos + 1) % partitions;
+        p_out->write((uint8_t*)output.data(), output.size() * sizeof(int16_t));
+    }
+
+    int16_t clip(float value) {
+        if (value > 32767.0f) return 32767;
+        if (value < -32768.0f) return -32768;
+        return (int16_t)(value < 0 ? value - 0.5f : value + 0.5f);
+    }
+};
+
+}  // namespace audio_tools
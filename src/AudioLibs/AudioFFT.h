@@ -57,7 +57,17 @@ struct AudioFFTConfig : public  AudioBaseInfo {
 };
 
 /**
- * @brief Abstract Class which defines the basic FFT functionality 
+ * @brief Complex value of a fft bin
+ * @ingroup fft
+ */
+struct FFTBin {
+    float real = 0;
+    float img = 0;
+};
+
+/**
+ * @brief Abstract Class which defines the basic FFT functionality. Drivers which 
+ * support the reverse fft (isReverseFFT()) also provide access to the bins.
  * @ingroup fft
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -71,6 +81,19 @@ class FFTDriver {
         virtual float magnitude(int idx) = 0;
         virtual float magnitudeFast(int idx) = 0;
         virtual bool isValid() = 0;
+
+        /// Returns true if the driver supports the reverse fft and the access to the bins
+        virtual bool isReverseFFT() { return false; }
+        /// Defines the input value w/o loss of precision
+        virtual void setValueFloat(int pos, float value) { setValue(pos, (int)value); }
+        /// Provides the result of the fft for the bin (0 to len/2)
+        virtual bool getBin(int idx, FFTBin &bin) { return false; }
+        /// Defines the bin (0 to len/2) for the reverse fft
+        virtual bool setBin(int idx, FFTBin &bin) { return false; }
+        /// Executes the reverse fft
+        virtual void rfft() { LOGE("reverse fft not supported"); }
+        /// Provides the result of the reverse fft: the values are not scaled (multiplied by len)
+        virtual float getValue(int pos) { return 0; }
 };
 
 /**
@@ -21,6 +21,7 @@ namespace audio_tools {
 class FFTDriverKissFFT : public FFTDriver {
     public:
         bool begin(int len) override {
+            this->len = len;
             if (p_fft_object==nullptr) p_fft_object = kiss_fft_alloc(len,0,nullptr,nullptr);
             if (p_data==nullptr) p_data = new kiss_fft_cpx[len];
             assert(p_fft_object!=nullptr);
@@ -30,10 +31,15 @@ class FFTDriverKissFFT : public FFTDriver {
 
         void end() override {
             if (p_fft_object!=nullptr) kiss_fft_free(p_fft_object);
+            if (p_fft_object_inv!=nullptr) kiss_fft_free(p_fft_object_inv);
             if (p_data!=nullptr) delete[] p_data;
+            p_fft_object = nullptr;
+            p_fft_object_inv = nullptr;
+            p_data = nullptr;
         }
         void setValue(int idx, int value) override {
             p_data[idx].r  = value; 
+            p_data[idx].i  = 0; 
         }
 
         void fft() override {
@@ -51,7 +57,42 @@ class FFTDriverKissFFT : public FFTDriver {
 
         virtual bool isValid() override{ return p_fft_object!=nullptr; }
 
+        bool isReverseFFT() override { return true; }
+
+        void setValueFloat(int idx, float value) override {
+            p_data[idx].r  = value; 
+            p_data[idx].i  = 0; 
+        }
+
+        bool getBin(int idx, FFTBin &bin) override {
+            bin.real = p_data[idx].r;
+            bin.img = p_data[idx].i;
+            return true;
+        }
+
+        /// Defines the bin and the conjugate complex mirror bin, so that the result is real
+        bool setBin(int idx, FFTBin &bin) override {
+            p_data[idx].r = bin.real;
+            p_data[idx].i = bin.img;
+            if (idx > 0 && idx < len/2) {
+                p_data[len - idx].r = bin.real;
+                p_data[len - idx].i = -bin.img;
+            }
+            return true;
+        }
+
+        void rfft() override {
+            if (p_fft_object_inv==nullptr) p_fft_object_inv = kiss_fft_alloc(len,1,nullptr,nullptr);
+            kiss_fft (p_fft_object_inv, p_data, p_data);    
+        }
+
+        float getValue(int idx) override {
+            return p_data[idx].r;
+        }
+
         kiss_fft_cfg p_fft_object=nullptr;
+        kiss_fft_cfg p_fft_object_inv=nullptr;
+        int len = 0;
         kiss_fft_cpx *p_data = nullptr; // real
 
 };
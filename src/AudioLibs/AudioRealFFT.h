@@ -33,6 +33,9 @@ class FFTDriverRealFFT : public FFTDriver {
             if (p_fft_object!=nullptr) delete p_fft_object;
             if (p_x!=nullptr) delete[] p_x;
             if (p_f!=nullptr) delete[] p_f;
+            p_fft_object = nullptr;
+            p_x = nullptr;
+            p_f = nullptr;
         }
         void setValue(int idx, int value) override{
             p_x[idx] = value; 
@@ -54,6 +57,33 @@ class FFTDriverRealFFT : public FFTDriver {
 
         virtual bool isValid() override{ return p_fft_object!=nullptr; }
 
+        bool isReverseFFT() override { return true; }
+
+        void setValueFloat(int idx, float value) override {
+            p_x[idx] = value;
+        }
+
+        /// FFTReal stores the real parts followed by the imaginary parts (with the opposite sign)
+        bool getBin(int idx, FFTBin &bin) override {
+            bin.real = p_f[idx];
+            bin.img = idx == 0 || idx == len/2 ? 0.0f : -p_f[len/2 + idx];
+            return true;
+        }
+
+        bool setBin(int idx, FFTBin &bin) override {
+            p_f[idx] = bin.real;
+            if (idx > 0 && idx < len/2) p_f[len/2 + idx] = -bin.img;
+            return true;
+        }
+
+        void rfft() override {
+            p_fft_object->do_ifft(p_f, p_x);
+        }
+
+        float getValue(int idx) override {
+            return p_x[idx];
+        }
+
         ffft::FFTReal <float> *p_fft_object=nullptr;
         float *p_x = nullptr; // real
         float *p_f = nullptr; // complex
@@ -142,6 +142,15 @@ public:
   /// Provides the number of files (The max index is size()-1)
   long size() { return idx.size();}
 
+  /// Moves the actual file to the indicated byte position
+  bool setStreamPosition(size_t pos) override { return file ? file.seek(pos) : false; }
+
+  /// Files support setStreamPosition()
+  bool isSeekSupported() override { return (bool)file; }
+
+  /// Provides the size of the actual file
+  size_t streamSize() override { return file ? file.size() : 0; }
+
 protected:
   SdSpiConfig *p_cfg = nullptr;
   AudioFs sd;
@@ -101,6 +101,15 @@ public:
   /// Provides the number of files (The max index is size()-1): WARNING this is very slow if you have a lot of files in many subdirectories
   long size() { return idx.size();}
 
+  /// Moves the actual file to the indicated byte position
+  bool setStreamPosition(size_t pos) override { return file ? file.seek(pos) : false; }
+
+  /// Files support setStreamPosition()
+  bool isSeekSupported() override { return (bool)file; }
+
+  /// Provides the size of the actual file
+  size_t streamSize() override { return file ? file.size() : 0; }
+
 protected:
   SDDirect<fs::SDFS,fs::File> idx{SD};
   File file;
@@ -0,0 +1,658 @@
+#pragma once
+
+#include "AudioConfig.h"
+#include "AudioBasic/StrExt.h"
+#include "AudioBasic/Collections/Vector.h"
+#include "AudioTools/AudioSource.h"
+#include "AudioHttp/HttpRequest.h"
+#include "AudioHttp/AbstractURLStream.h"
+#include "AudioLibs/FileRingBuffer.h"
+
+/// Max number of files in the cache
+#ifndef URL_CACHE_MAX_ENTRIES
+#define URL_CACHE_MAX_ENTRIES 100
+#endif
+
+/// Max size of all cached files in bytes
+#ifndef URL_CACHE_SIZE
+#define URL_CACHE_SIZE (50 * 1024 * 1024)
+#endif
+
+/// Data which is buffered for live streams before we start to provide it
+#ifndef URL_CACHE_PREBUFFER
+#define URL_CACHE_PREBUFFER (64 * 1024)
+#endif
+
+/// Size of the buffer which is used to move the data of live streams to the file
+#ifndef URL_CACHE_COPY_SIZE
+#define URL_CACHE_COPY_SIZE 1024
+#endif
+
+#define URL_CACHE_MAX_LINE 512
+#define URL_CACHE_MAX_PATH 100
+
+namespace audio_tools {
+
+/**
+ * @brief Index entry of a file in the URLCache
+ * @ingroup player
+ */
+struct URLCacheEntry {
+    uint32_t hash = 0;
+    uint32_t size = 0;
+    /// access sequence number for the LRU eviction
+    uint32_t last_used = 0;
+    StrExt etag;
+    StrExt last_modified;
+    StrExt url;
+};
+
+/**
+ * @brief Stores the downloaded files in a directory (e.g. on a SD drive): the file name is
+ * derived from the hash of the URL. The index file (cache.idx) records the URL, the size,
+ * the ETag and Last-Modified header values and the access sequence of each file, so that
+ * the total size can be limited by removing the least recently used files.
+ * @ingroup player
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam SDT file system class (e.g. SDFS)
+ * @tparam FileT file class (e.g. File)
+ */
+template <class SDT, class FileT>
+class URLCache {
+  public:
+    URLCache(SDT &sd) { p_sd = &sd; }
+
+    ~URLCache() { clearEntries(); }
+
+    /// Loads the index from the indicated directory
+    bool begin(const char *dir = "/cache", size_t maxSize = URL_CACHE_SIZE) {
+        TRACED();
+        cache_dir = dir;
+        max_size = maxSize;
+        if (!p_sd->exists(dir)) p_sd->mkdir(dir);
+        filePath(idx_path, "cache.idx");
+        loadIndex();
+        LOGI("cache: %d files with %u bytes", entries.size(), (unsigned)total_size);
+        return true;
+    }
+
+    /// Provides the entry for the url or nullptr if it is not cached
+    URLCacheEntry *find(const char *url) {
+        uint32_t hash = urlHash(url);
+        for (int j = 0; j < entries.size(); j++) {
+            if (entries[j]->hash == hash && entries[j]->url.equals(url)) return entries[j];
+        }
+        return nullptr;
+    }
+
+    /// Opens the cached file and marks it as recently used: the index is written with the next
+    /// change of the cache or with flush()
+    FileT open(URLCacheEntry *entry) {
+        entry->last_used = next_use++;
+        is_dirty = true;
+        char path[URL_CACHE_MAX_PATH];
+        return p_sd->open(hashPath(path, entry->hash, ".dat"));
+    }
+
+    /// Opens the temporary file which receives the downloaded data
+    FileT openDownload(const char *url) {
+        char path[URL_CACHE_MAX_PATH];
+        return openNew(hashPath(path, urlHash(url), ".tmp"));
+    }
+
+    /// Moves the completely downloaded file into the cache: the least recently used files
+    /// are removed if the cache is getting too big
+    bool commit(const char *url, size_t size, const char *etag, const char *lastModified) {
+        uint32_t hash = urlHash(url);
+        remove(url);
+        char data_path[URL_CACHE_MAX_PATH];
+        char temp_path[URL_CACHE_MAX_PATH];
+        hashPath(data_path, hash, ".dat");
+        hashPath(temp_path, hash, ".tmp");
+        p_sd->remove(data_path);
+        if (!p_sd->rename(temp_path, data_path)) {
+            LOGE("rename failed: %s", data_path);
+            return false;
+        }
+        URLCacheEntry *entry = new URLCacheEntry();
+        entry->hash = hash;
+        entry->size = size;
+        entry->last_used = next_use++;
+        entry->url = url;
+        entry->etag = etag;
+        entry->last_modified = lastModified;
+        entries.push_back(entry);
+        total_size += size;
+        while (entries.size() > URL_CACHE_MAX_ENTRIES || total_size > max_size) {
+            removeEntry(lruIndex());
+        }
+        saveIndex();
+        LOGI("cached: %s (%u bytes)", url, (unsigned)size);
+        return true;
+    }
+
+    /// Removes an incomplete download
+    void discard(const char *url) {
+        char path[URL_CACHE_MAX_PATH];
+        p_sd->remove(hashPath(path, urlHash(url), ".tmp"));
+    }
+
+    /// Removes the file of the url from the cache
+    void remove(const char *url) {
+        for (int j = 0; j < entries.size(); j++) {
+            if (entries[j]->hash == urlHash(url) && entries[j]->url.equals(url)) {
+                removeEntry(j);
+                saveIndex();
+                return;
+            }
+        }
+    }
+
+    /// Removes all files
+    void clear() {
+        while (entries.size() > 0) removeEntry(0);
+        saveIndex();
+    }
+
+    /// Writes the index if the usage of the files has changed
+    void flush() {
+        if (is_dirty) saveIndex();
+    }
+
+    /// Number of cached files
+    int count() { return entries.size(); }
+
+    /// Total size of the cached files in bytes
+    size_t totalSize() { return total_size; }
+
+    size_t maxSize() { return max_size; }
+
+  protected:
+    SDT *p_sd = nullptr;
+    Vector<URLCacheEntry *> entries;
+    const char *cache_dir = "/cache";
+    char idx_path[URL_CACHE_MAX_PATH];
+    size_t max_size = URL_CACHE_SIZE;
+    size_t total_size = 0;
+    uint32_t next_use = 1;
+    bool is_dirty = false;
+
+    uint32_t urlHash(const char *url) {
+        uint32_t hash = 2166136261u;
+        while (*url) {
+            hash = (hash ^ (uint8_t)*url++) * 16777619u;
+        }
+        return hash;
+    }
+
+    const char *filePath(char *result, const char *name) {
+        snprintf(result, URL_CACHE_MAX_PATH, "%s/%s", cache_dir, name);
+        return result;
+    }
+
+    /// Determines the file name from the hash of the url
+    const char *hashPath(char *result, uint32_t hash, const char *ext) {
+        snprintf(result, URL_CACHE_MAX_PATH, "%s/%08x%s", cache_dir, (unsigned)hash, ext);
+        return result;
+    }
+
+    const char *value(StrExt &str) { return str.c_str() != nullptr ? str.c_str() : ""; }
+
+    /// Opens the file for writing after deleting the old content
+    FileT openNew(const char *path) {
+        if (p_sd->exists(path)) {
+            p_sd->remove(path);
+        }
+        return p_sd->open(path, FILE_WRITE);
+    }
+
+    int lruIndex() {
+        int result = 0;
+        for (int j = 1; j < entries.size(); j++) {
+            if (entries[j]->last_used < entries[result]->last_used) result = j;
+        }
+        return result;
+    }
+
+    void removeEntry(int idx) {
+        URLCacheEntry *entry = entries[idx];
+        LOGI("removing from cache: %s", entry->url.c_str());
+        char path[URL_CACHE_MAX_PATH];
+        p_sd->remove(hashPath(path, entry->hash, ".dat"));
+        total_size -= entry->size;
+        entries.erase(entries.begin() + idx);
+        delete entry;
+    }
+
+    void clearEntries() {
+        for (int j = 0; j < entries.size(); j++) delete entries[j];
+        entries.clear();
+        total_size = 0;
+    }
+
+    /// Returns the next tab separated field and moves the pointer to the following one
+    char *nextField(char *&str) {
+        char *result = str;
+        char *end = strchr(str, '\t');
+        if (end != nullptr) {
+            *end = 0;
+            str = end + 1;
+        } else {
+            str += strlen(str);
+        }
+        return result;
+    }
+
+    /// Reads the index: each line contains hash, size, last_used, etag, last_modified and url
+    void loadIndex() {
+        clearEntries();
+        next_use = 1;
+        is_dirty = false;
+        if (!p_sd->exists(idx_path)) return;
+        FileT idx_file = p_sd->open(idx_path);
+        char line[URL_CACHE_MAX_LINE];
+        char path[URL_CACHE_MAX_PATH];
+        while (idx_file.available() > 0) {
+            size_t len = idx_file.readBytesUntil('\n', line, URL_CACHE_MAX_LINE - 1);
+            line[len] = 0;
+            char *str = line;
+            URLCacheEntry entry;
+            entry.hash = strtoul(nextField(str), nullptr, 16);
+            entry.size = strtoul(nextField(str), nullptr, 10);
+            entry.last_used = strtoul(nextField(str), nullptr, 10);
+            char *etag = nextField(str);
+            char *last_modified = nextField(str);
+            char *url = nextField(str);
+            // ignore invalid lines and files which have been deleted
+            if (strlen(url) == 0 || entry.hash != urlHash(url) ||
+                !p_sd->exists(hashPath(path, entry.hash, ".dat")))
+                continue;
+            URLCacheEntry *p_entry = new URLCacheEntry();
+            p_entry->hash = entry.hash;
+            p_entry->size = entry.size;
+            p_entry->last_used = entry.last_used;
+            p_entry->etag = etag;
+            p_entry->last_modified = last_modified;
+            p_entry->url = url;
+            entries.push_back(p_entry);
+            total_size += entry.size;
+            if (entry.last_used >= next_use) next_use = entry.last_used + 1;
+        }
+        idx_file.close();
+    }
+
+    void saveIndex() {
+        is_dirty = false;
+        FileT idx_file = openNew(idx_path);
+        char line[URL_CACHE_MAX_LINE];
+        for (int j = 0; j < entries.size(); j++) {
+            URLCacheEntry *entry = entries[j];
+            int len = snprintf(line, URL_CACHE_MAX_LINE, "%08x\t%u\t%u\t%s\t%s\t%s\n",
+                               (unsigned)entry->hash, (unsigned)entry->size,
+                               (unsigned)entry->last_used, value(entry->etag),
+                               value(entry->last_modified), entry->url.c_str());
+            if (len >= URL_CACHE_MAX_LINE) {
+                LOGW("url too long: %s", entry->url.c_str());
+                continue;
+            }
+            idx_file.write((const uint8_t *)line, len);
+        }
+        idx_file.close();
+    }
+};
+
+/**
+ * @brief AudioSource for the AudioPlayer which provides the audio data from an array of
+ * urls like AudioSourceURL, but the downloaded files are stored in a URLCache, so that a
+ * repeated selection is served from the file. The cached file is validated with the ETag and
+ * Last-Modified values (If-None-Match/If-Modified-Since): if the server is not reachable we
+ * use the cached file. Live streams (no Content-Length or ICY) are not cached: if a
+ * file has been defined with setLiveBuffer() they are buffered in a FileRingBuffer, which
+ * acts as a large jitter buffer.
+ * @ingroup player
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam SDT file system class (e.g. SDFS)
+ * @tparam FileT file class (e.g. File)
+ */
+template <class SDT, class FileT>
+class AudioSourceURLCached : public AudioSource {
+  public:
+    template <typename T, size_t N>
+    AudioSourceURLCached(SDT &sd, AbstractURLStream &urlStream, T (&urlArray)[N],
+                         const char *mime, int startPos = 0)
+        : cache(sd) {
+        TRACED();
+        this->actual_stream = &urlStream;
+        this->mime = mime;
+        this->urlArray = urlArray;
+        this->max = N;
+        this->pos = startPos - 1;
+        this->timeout_auto_next_value = 20000;
+        tee.p_source = this;
+    }
+
+    /// Defines the directory and the max size of the cache
+    void setCache(const char *dir, size_t maxSize = URL_CACHE_SIZE) {
+        cache_dir = dir;
+        cache_size = maxSize;
+    }
+
+    /// If false we use the cached files without asking the server if they have changed
+    void setValidation(bool validate) { is_validation = validate; }
+
+    /// Live streams are buffered in the indicated file: it must be open for reading and writing
+    bool setLiveBuffer(FileT &file, size_t size = FILE_RING_BUFFER_SIZE,
+                       size_t prebuffer = URL_CACHE_PREBUFFER) {
+        live.prebuffer = prebuffer < size ? prebuffer : size;
+        return live.ring.begin(file, size);
+    }
+
+    /// Setup Wifi URL
+    virtual void begin() override {
+        TRACED();
+        cache.begin(cache_dir, cache_size);
+        this->pos = 0;
+    }
+
+    /// Closes the actual stream and writes the cache index
+    void end() {
+        closeActual();
+        cache.flush();
+    }
+
+    /// Opens the selected url from the array
+    Stream *selectStream(int idx) override {
+        pos = idx;
+        if (pos < 0) {
+            pos = 0;
+            LOGI("url array out of limits: %d -> %d", idx, pos);
+        }
+        if (pos >= max) {
+            pos = max - 1;
+            LOGI("url array out of limits: %d -> %d", idx, pos);
+        }
+        LOGI("selectStream: %d/%d -> %s", pos, max - 1, urlArray[pos]);
+        return selectStream(urlArray[pos]);
+    }
+
+    /// Opens the next url from the array
+    Stream *nextStream(int offset) override {
+        pos += offset;
+        if (pos < 0 || pos >= max) {
+            pos = 0;
+        }
+        LOGI("nextStream: %d/%d -> %s", pos, max - 1, urlArray[pos]);
+        return selectStream(pos);
+    }
+
+    /// Opens the Previous url from the array
+    Stream *previousStream(int offset) override {
+        pos -= offset;
+        if (pos < 0 || pos >= max) {
+            pos = max - 1;
+        }
+        LOGI("previousStream: %d/%d -> %s", pos, max - 1, urlArray[pos]);
+        return selectStream(pos);
+    }
+
+    /// Opens the selected url: from the cache if possible
+    Stream *selectStream(const char *path) override {
+        LOGI("selectStream: %s", path);
+        closeActual();
+        actual_url = path;
+        URLCacheEntry *entry = cache.find(path);
+        if (entry != nullptr && !is_validation) {
+            return openCached(entry);
+        }
+
+        // request the data only if it has changed
+        HttpRequestHeader &header = actual_stream->httpRequest().header();
+        header.clear();
+        if (entry != nullptr) {
+            if (!entry->etag.isEmpty()) header.put("If-None-Match", entry->etag.c_str());
+            if (!entry->last_modified.isEmpty())
+                header.put("If-Modified-Since", entry->last_modified.c_str());
+        }
+        bool ok = actual_stream->begin(path, mime);
+        is_url_active = true;
+        HttpRequest &request = actual_stream->httpRequest();
+        if (entry != nullptr) {
+            if (!ok) {
+                int status = request.reply().statusCode();
+                if (status == 304) {
+                    LOGI("not modified: %s", path);
+                } else {
+                    LOGW("request failed with %d: using cached file", status);
+                }
+                closeActual();
+                return openCached(entry);
+            }
+            // the content has changed
+            cache.remove(path);
+        }
+        if (!ok) return actual_stream;
+
+        size_t size = request.getReceivedContentLength();
+        bool is_live = size == 0 || request.reply().get("icy-metaint") != nullptr;
+        if (is_live) {
+            if (live.ring) {
+                LOGI("live stream: using file buffer");
+                live.begin(*actual_stream);
+                return &live;
+            }
+            return actual_stream;
+        }
+        if (size > cache.maxSize()) {
+            LOGW("file too big for cache: %u", (unsigned)size);
+            return actual_stream;
+        }
+        tee.begin(cache.openDownload(path), size, request.reply().get("ETag"),
+                  request.reply().get("Last-Modified"));
+        actual_size = size;
+        return &tee;
+    }
+
+    int index() { return pos; }
+
+    const char *toStr() { return urlArray[pos]; }
+
+    /// Sets the timeout of the URL Stream in milliseconds
+    void setTimeout(int millisec) override { actual_stream->setTimeout(millisec); }
+
+    // provides go not to the next on error
+    virtual bool isAutoNext() override { return true; };
+
+    // only the ICYStream supports this
+    bool setMetadataCallback(void (*fn)(MetaDataType info, const char *str, int len),
+                             ID3TypeSelection sel = SELECT_ICY) override {
+        TRACEI();
+        return actual_stream->setMetadataCallback(fn);
+    }
+
+    /// Provides the size of the actual file: 0 for live streams
+    size_t streamSize() override { return actual_size; }
+
+    /// Provides access to the cache
+    URLCache<SDT, FileT> &urlCache() { return cache; }
+
+    /// True if the actual stream is served from the cache
+    bool isCached() { return is_file_open; }
+
+    /// Number of times the live buffer was empty
+    int liveUnderflowCount() { return live.underflows; }
+
+  protected:
+    /// Writes the data which is read from the url to the cache file
+    class TeeStream : public Stream {
+      public:
+        AudioSourceURLCached *p_source = nullptr;
+        FileT file;
+        size_t size = 0;
+        size_t count = 0;
+        bool active = false;
+        StrExt etag;
+        StrExt last_modified;
+
+        void begin(FileT f, size_t len, const char *eTag, const char *lastModified) {
+            file = f;
+            size = len;
+            count = 0;
+            etag = eTag;
+            last_modified = lastModified;
+            active = (bool)file;
+            if (!active) LOGE("could not create cache file");
+        }
+
+        /// Removes the incomplete file
+        void end() {
+            if (!active) return;
+            active = false;
+            file.close();
+            p_source->cache.discard(p_source->actual_url.c_str());
+        }
+
+        int available() override { return p_source->actual_stream->available(); }
+
+        size_t readBytes(uint8_t *data, size_t len) override {
+            size_t result = p_source->actual_stream->readBytes(data, len);
+            if (active && result > 0) {
+                if (file.write(data, result) != result) {
+                    LOGE("write to cache failed");
+                    end();
+                    return result;
+                }
+                count += result;
+                if (count >= size) {
+                    active = false;
+                    file.close();
+                    p_source->cache.commit(p_source->actual_url.c_str(), count, etag.c_str(),
+                                           last_modified.c_str());
+                }
+            }
+            return result;
+        }
+
+        int read() override {
+            uint8_t result = 0;
+            return readBytes(&result, 1) == 1 ? result : -1;
+        }
+
+        int peek() override { return -1; }
+
+        size_t write(const uint8_t *data, size_t len) override { return 0; }
+
+        size_t write(uint8_t ch) override { return 0; }
+    };
+
+    /// Provides the data of a live stream via the FileRingBuffer
+    class LiveStream : public Stream {
+      public:
+        FileRingBuffer<FileT> ring{0};
+        Stream *p_in = nullptr;
+        size_t prebuffer = URL_CACHE_PREBUFFER;
+        bool is_buffering = true;
+        int underflows = 0;
+        uint8_t buffer[URL_CACHE_COPY_SIZE];
+
+        void begin(Stream &in) {
+            p_in = &in;
+            ring.reset();
+            is_buffering = true;
+        }
+
+        int available() override {
+            fill();
+            return is_buffering ? 0 : ring.available();
+        }
+
+        size_t readBytes(uint8_t *data, size_t len) override {
+            fill();
+            if (is_buffering) return 0;
+            size_t result = ring.readBytes(data, len);
+            if (ring.available() == 0) {
+                LOGW("live buffer underflow: buffering");
+                underflows++;
+                is_buffering = true;
+            }
+            return result;
+        }
+
+        int read() override {
+            uint8_t result = 0;
+            return readBytes(&result, 1) == 1 ? result : -1;
+        }
+
+        int peek() override { return -1; }
+
+        size_t write(const uint8_t *data, size_t len) override { return 0; }
+
+        size_t write(uint8_t ch) override { return 0; }
+
+      protected:
+        /// Moves the received data to the file
+        void fill() {
+            while (true) {
+                int len = p_in->available();
+                if (len > ring.availableForWrite()) len = ring.availableForWrite();
+                if (len > URL_CACHE_COPY_SIZE) len = URL_CACHE_COPY_SIZE;
+                if (len <= 0) break;
+                size_t n = p_in->readBytes(buffer, len);
+                if (n == 0) break;
+                ring.write(buffer, n);
+            }
+            if (is_buffering &&
+                (ring.available() >= prebuffer || ring.availableForWrite() == 0)) {
+                is_buffering = false;
+            }
+        }
+    };
+
+    URLCache<SDT, FileT> cache;
+    TeeStream tee;
+    LiveStream live;
+    FileT file;
+    AbstractURLStream *actual_stream = nullptr;
+    StrExt actual_url;
+    const char **urlArray;
+    int pos = 0;
+    int max = 0;
+    const char *mime = nullptr;
+    const char *cache_dir = "/cache";
+    size_t cache_size = URL_CACHE_SIZE;
+    size_t actual_size = 0;
+    bool is_validation = true;
+    bool is_url_active = false;
+    bool is_file_open = false;
+
+    Stream *openCached(URLCacheEntry *entry) {
+        file = cache.open(entry);
+        if (!file) {
+            LOGE("could not open cached file: %s", entry->url.c_str());
+            StrExt url(actual_url.c_str());
+            cache.remove(url.c_str());
+            return selectStream(url.c_str());
+        }
+        LOGI("using cached file: %s", entry->url.c_str());
+        is_file_open = true;
+        actual_size = entry->size;
+        return &file;
+    }
+
+    void closeActual() {
+        // an incomplete download is removed
+        tee.end();
+        if (is_file_open) {
+            file.close();
+            is_file_open = false;
+        }
+        if (is_url_active) {
+            actual_stream->end();
+            is_url_active = false;
+        }
+        actual_size = 0;
+    }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "AudioConfig.h"
+#include "AudioTools/AudioLogger.h"
+
+/// Size of the file ring buffer in bytes
+#ifndef FILE_RING_BUFFER_SIZE
+#define FILE_RING_BUFFER_SIZE 500000
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief A file (e.g. SD) backed Ring Buffer that we can use to receive
+ * streaming audio. We expect an open file as parameter: the
+ * file must support the stream interface and the seek method and it must
+ * be opened for reading and writing. The file needs to stay
+ * valid as long as the buffer is used.
+ * @ingroup buffers
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam F file class (e.g. File)
+ */
+template <class F> class FileRingBuffer : public Stream {
+public:
+  /**
+   * @brief Construct a new Ring Buffer File Stream object
+   *
+   * @param size maximum file size
+   * @param autoRemoveOldestDataIfFull if true we overwrite the oldest data,
+   * otherwise we limit the written data to the available space
+   */
+  FileRingBuffer(size_t size = FILE_RING_BUFFER_SIZE,
+                 bool autoRemoveOldestDataIfFull = false) {
+    this->max_size = size;
+    this->auto_flush = autoRemoveOldestDataIfFull;
+  }
+
+  /// Defines the file and the size
+  bool begin(F &file, size_t size) {
+    max_size = size;
+    return begin(file);
+  }
+
+  /// Defines the file: the file must be open for reading and writing
+  bool begin(F &file) {
+    TRACED();
+    p_file = &file;
+    reset();
+    active = max_size > 0;
+    return active;
+  }
+
+  void end() { active = false; }
+
+  /// Empties the buffer
+  void reset() {
+    read_pos = 0;
+    write_pos = 0;
+    available_bytes = 0;
+  }
+
+  /// Write at the end of the ring buffer
+  size_t write(const uint8_t *data, size_t len) override {
+    if (!active)
+      return 0;
+    size_t write_len = len;
+
+    // limit write len to available space
+    if (write_len > (size_t)availableForWrite()) {
+      if (auto_flush && write_len <= max_size) {
+        // remove oldest data to make space
+        size_t to_free = write_len - availableForWrite();
+        read_pos = (read_pos + to_free) % max_size;
+        available_bytes -= to_free;
+      } else {
+        // limit data to write
+        write_len = availableForWrite();
+      }
+    }
+    if (write_len == 0) {
+      LOGD("FileRingBuffer is full");
+      return 0;
+    }
+
+    // we might need to write in 2 parts: at the end and at the start
+    size_t part_at_end = write_len;
+    if (write_pos + write_len > max_size) {
+      part_at_end = max_size - write_pos;
+    }
+    size_t part_at_start = write_len - part_at_end;
+
+    size_t result = writeAt(write_pos, data, part_at_end);
+    if (result == part_at_end && part_at_start > 0) {
+      result += writeAt(0, data + part_at_end, part_at_start);
+    }
+    write_pos = (write_pos + result) % max_size;
+    available_bytes += result;
+    return result;
+  }
+
+  size_t write(uint8_t ch) override { return write(&ch, 1); }
+
+  /// Read from the beginning of the ring buffer
+  size_t readBytes(uint8_t *data, size_t len) override {
+    if (!active)
+      return 0;
+    // if we do not have enough data we limit the size
+    size_t read_len = len > available_bytes ? available_bytes : len;
+    if (read_len == 0)
+      return 0;
+    // if we read at the end we need to read in 2 parts
+    size_t part_at_end = read_len;
+    if (read_pos + read_len > max_size) {
+      part_at_end = max_size - read_pos;
+    }
+    size_t part_at_start = read_len - part_at_end;
+
+    size_t result = readAt(read_pos, data, part_at_end);
+    if (result == part_at_end && part_at_start > 0) {
+      result += readAt(0, data + part_at_end, part_at_start);
+    }
+    read_pos = (read_pos + result) % max_size;
+    available_bytes -= result;
+    return result;
+  }
+
+  int read() override {
+    uint8_t result = 0;
+    return readBytes(&result, 1) == 1 ? result : -1;
+  }
+
+  int peek() override {
+    uint8_t result = 0;
+    if (!active || available_bytes == 0)
+      return -1;
+    return readAt(read_pos, &result, 1) == 1 ? result : -1;
+  }
+
+  int available() override { return available_bytes; }
+
+  int availableForWrite() override { return max_size - available_bytes; }
+
+  /// Provides the size of the buffer
+  size_t size() { return max_size; }
+
+  operator bool() { return active; }
+
+protected:
+  bool active = false;
+  bool auto_flush;
+  size_t max_size;
+  size_t read_pos = 0;
+  size_t write_pos = 0;
+  size_t available_bytes = 0;
+  F *p_file = nullptr;
+
+  size_t writeAt(size_t pos, const uint8_t *data, size_t len) {
+    if (!p_file->seek(pos)) {
+      LOGE("seek: %u", (unsigned)pos);
+      return 0;
+    }
+    size_t result = p_file->write(data, len);
+    if (result != len) {
+      LOGE("write failed: %u instead of %u", (unsigned)result, (unsigned)len);
+    }
+    return result;
+  }
+
+  size_t readAt(size_t pos, uint8_t *data, size_t len) {
+    if (!p_file->seek(pos)) {
+      LOGE("seek: %u", (unsigned)pos);
+      return 0;
+    }
+    size_t result = p_file->readBytes(data, len);
+    if (result != len) {
+      LOGE("read failed: %u instead of %u", (unsigned)result, (unsigned)len);
+    }
+    return result;
+  }
+};
+
+} // namespace audio_tools
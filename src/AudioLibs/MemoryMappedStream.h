@@ -0,0 +1,162 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdint.h>
+#include "AudioBasic/StrExt.h"
+#include "AudioTools/AudioStreams.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Read only access to a file which is mapped into memory (Linux, macOS): The data is
+ * provided by the operating system via page faults, so we do not need any read system calls
+ * and with readSpan() we can even avoid any copy. This is useful for big WAV or RAW files.
+ * @ingroup io
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MemoryMappedStream : public AudioStream {
+  public:
+    MemoryMappedStream() = default;
+
+    MemoryMappedStream(const char *path) { setPath(path); }
+
+    ~MemoryMappedStream() { end(); }
+
+    /// Defines the file: the path is copied
+    void setPath(const char *path) { this->path = path; }
+
+    /// Opens the file and maps it into memory
+    bool begin() override {
+        TRACED();
+        end();
+        if (path.isEmpty()) {
+            LOGE("path not defined");
+            return false;
+        }
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            LOGE("open failed: %s", path.c_str());
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            LOGE("invalid file: %s", path.c_str());
+            end();
+            return false;
+        }
+        // on 32 bit systems we can not map files > 4GB
+        if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+            LOGE("file too big: %s", path.c_str());
+            end();
+            return false;
+        }
+        file_size = st.st_size;
+        void *result = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (result == MAP_FAILED) {
+            LOGE("mmap failed: %s", path.c_str());
+            end();
+            return false;
+        }
+        buffer = (const uint8_t *)result;
+        // we usually read the data sequentially
+        madvise(result, file_size, MADV_SEQUENTIAL);
+        read_pos = 0;
+        LOGI("mapped %s: %lu bytes", path.c_str(), (unsigned long)file_size);
+        return true;
+    }
+
+    bool begin(const char *path) {
+        setPath(path);
+        return begin();
+    }
+
+    /// Unmaps and closes the file
+    void end() override {
+        if (buffer != nullptr) munmap((void *)buffer, file_size);
+        if (fd >= 0) ::close(fd);
+        buffer = nullptr;
+        fd = -1;
+        file_size = 0;
+        read_pos = 0;
+    }
+
+    int available() override {
+        if (buffer == nullptr) return 0;
+        if (read_pos >= file_size && is_loop) read_pos = 0;
+        size_t result = file_size - read_pos;
+        // limit the result to the range of int
+        return result > 0x7FFFFFFF ? 0x7FFFFFFF : result;
+    }
+
+    size_t readBytes(uint8_t *data, size_t len) override {
+        size_t count = 0;
+        while (count < len) {
+            const uint8_t *span;
+            size_t result = readSpan(span, len - count);
+            if (result == 0) break;
+            memcpy(data + count, span, result);
+            count += result;
+        }
+        return count;
+    }
+
+    /// Zero copy read: provides a pointer to the next (max len) bytes and advances the read position
+    size_t readSpan(const uint8_t *&data, size_t len) {
+        size_t avail = available();
+        if (avail == 0) {
+            data = nullptr;
+            return 0;
+        }
+        if (len > avail) len = avail;
+        data = buffer + read_pos;
+        read_pos += len;
+        return len;
+    }
+
+    int read() override {
+        int result = peek();
+        if (result >= 0) read_pos++;
+        return result;
+    }
+
+    int peek() override { return available() > 0 ? buffer[read_pos] : -1; }
+
+    /// The file is read only
+    size_t write(const uint8_t *data, size_t len) override { return not_supported(0); }
+
+    int availableForWrite() override { return 0; }
+
+    /// Sets the read position
+    bool seek(size_t pos) {
+        if (pos > file_size) return false;
+        read_pos = pos;
+        return true;
+    }
+
+    /// Provides the actual read position
+    size_t position() { return read_pos; }
+
+    /// Provides the size of the file
+    size_t size() { return file_size; }
+
+    /// Provides the mapped data
+    const uint8_t *data() { return buffer; }
+
+    /// Restart at the beginning when we reach the end
+    void setLoop(bool loop) { is_loop = loop; }
+
+    operator bool() { return buffer != nullptr; }
+
+  protected:
+    StrExt path;
+    int fd = -1;
+    const uint8_t *buffer = nullptr;
+    size_t file_size = 0;
+    size_t read_pos = 0;
+    bool is_loop = false;
+};
+
+}  // namespace audio_tools
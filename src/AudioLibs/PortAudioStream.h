@@ -5,7 +5,10 @@
  */
 
 #include "AudioTools.h"
+#include "AudioTools/BufferSPSC.h"
 #include "portaudio.h"
+#include <thread>
+#include <chrono>
 
 namespace audio_tools {
 
@@ -28,6 +31,19 @@ class PortAudioConfig : public AudioBaseInfo {
 
         bool is_input = false;
         bool is_output = true;
+        /// PortAudio pulls the data in a callback from a lock free ring buffer which is filled by write()
+        bool use_callback = false;
+        /// frames per buffer: 0 lets PortAudio decide
+        int frames_per_buffer = 0;
+        /// suggested latency in seconds: 0 uses the low latency default of the device
+        float suggested_latency = 0;
+        /// size of the ring buffers in callback mode in bytes: 0 uses 4 times the latency
+        int buffer_size = 0;
+        /// max time in ms that write() and readBytes() wait for space/data in callback mode
+        int timeout_ms = 1000;
+        /// device index: -1 uses the default device
+        int input_device = -1;
+        int output_device = -1;
 };
 
 /**
@@ -105,24 +121,47 @@ class PortAudioStream : public AudioStream {
                 }
 
                 // calculate frames
-                int bytes = info.bits_per_sample / 8;
-                int buffer_frames = paFramesPerBufferUnspecified; //buffer_size / bytes / info.channels;
+                unsigned long buffer_frames = info.frames_per_buffer > 0 ? info.frames_per_buffer : paFramesPerBufferUnspecified;
+                PaStreamParameters input_parameters, output_parameters;
+                bool has_input = info.is_input && setupParameters(input_parameters, true);
+                bool has_output = info.is_output && setupParameters(output_parameters, false);
+                if (!has_input && !has_output){
+                    LOGE("No PortAudio device");
+                    return false;
+                }
+
+                // setup ring buffers for callback mode
+                resetCounters();
+                if (info.use_callback){
+                    int size = ringBufferSize(has_input ? input_parameters.suggestedLatency : output_parameters.suggestedLatency);
+                    LOGI("ring buffer size: %d", size);
+                    in_buffer.resize(has_input ? size : 0);
+                    out_buffer.resize(has_output ? size : 0);
+                }
 
                 // Open an audio I/O stream. 
-                LOGD("Pa_OpenDefaultStream");
-                err = Pa_OpenDefaultStream( &stream,
-                    info.is_input ? info.channels : 0,    // no input channels 
-                    info.is_output ? info.channels : 0,   // no output 
-                    getFormat(info.bits_per_sample),      // format  
+                LOGD("Pa_OpenStream");
+                err = Pa_OpenStream( &stream,
+                    has_input ? &input_parameters : nullptr,
+                    has_output ? &output_parameters : nullptr,
                     info.sample_rate,                     // sample rate
                     buffer_frames,                        // frames per buffer 
-                    nullptr,   
-                    nullptr ); 
-                LOGD("Pa_OpenDefaultStream - done");
+                    paNoFlag,
+                    info.use_callback ? streamCallback : nullptr,   
+                    info.use_callback ? this : nullptr); 
+                LOGD("Pa_OpenStream - done");
                 if( err != paNoError && err!= paOutputUnderflow ) {
                     LOGE(  "PortAudio error: %s\n", Pa_GetErrorText( err ) );
                     return false;
                 }
+                const PaStreamInfo *stream_info = Pa_GetStreamInfo(stream);
+                if (stream_info!=nullptr){
+                    LOGI("latency input: %f output: %f", stream_info->inputLatency, stream_info->outputLatency);
+                }
+                // in callback mode we start the input immediately
+                if (info.use_callback && has_input){
+                    startStream();
+                }
             } else {
                 LOGI("basic audio information is missing...");
                 return false;
@@ -132,6 +171,7 @@ class PortAudioStream : public AudioStream {
 
         void end() override {
             TRACED();
+            if (stream==nullptr) return;
             err = Pa_StopStream( stream );
             if( err != paNoError ) {
                 LOGE(  "PortAudio error: %s\n", Pa_GetErrorText( err ) );
@@ -141,6 +181,7 @@ class PortAudioStream : public AudioStream {
             if( err != paNoError ) {
                 LOGE(  "PortAudio error: %s\n", Pa_GetErrorText( err ) );
             }
+            stream = nullptr;
             stream_started = false;
         }
 
@@ -150,10 +191,17 @@ class PortAudioStream : public AudioStream {
 
         size_t write(const uint8_t* data, size_t len) override {  
             LOGD("write: %zu", len);
+            size_t result = 0;
+            if (stream!=nullptr && info.use_callback){
+                // the stream has no output direction
+                if (out_buffer.size()==0) return 0;
+                // prefill the ring buffer before we start the stream
+                result = out_buffer.writeArray(data, len);
+                startStream();
+                return result + writeRingBuffer(data + result, len - result);
+            }
 
             startStream();
-
-            size_t result = 0;
             if (stream!=nullptr){
                 int bytes = info.bits_per_sample / 8;
                 int frames = len / bytes / info.channels;
@@ -161,6 +209,9 @@ class PortAudioStream : public AudioStream {
                 if( err == paNoError ) {
                     LOGD("Pa_WriteStream: %zu", len);
                     result = len;
+                } else if (err == paOutputUnderflowed) {
+                    underrun_count++;
+                    result = len;
                 } else {
                     LOGE("PortAudio error: %s", Pa_GetErrorText( err ) );
                 }
@@ -173,32 +224,165 @@ class PortAudioStream : public AudioStream {
         size_t readBytes( uint8_t *data, size_t len) override { 
             LOGD("readBytes: %zu", len);
             size_t result = 0;
-            if (stream!=nullptr){
+            if (stream!=nullptr && info.use_callback){
+                // the stream has no input direction
+                if (in_buffer.size()==0) return 0;
+                result = readRingBuffer(data, len);
+            } else if (stream!=nullptr){
                 int bytes = info.bits_per_sample / 8;
                 int frames = len / bytes / info.channels;
                 err = Pa_ReadStream( stream, data, frames );
                 if( err == paNoError ) {
                     result = len;
+                } else if (err == paInputOverflowed) {
+                    overrun_count++;
+                    result = len;
                 } else {
                     LOGE(  "PortAudio error: %s\n", Pa_GetErrorText( err ) );
                 }
             } else {
                 LOGW("stream is null")
             }
-            return len;            
+            return result;            
         }
 
         int available() override {
+            if (info.use_callback) return in_buffer.available();
             return DEFAULT_BUFFER_SIZE;
         }
 
+        int availableForWrite() override {
+            if (info.use_callback) return out_buffer.availableForWrite();
+            return DEFAULT_BUFFER_SIZE;
+        }
+
+        /// Number of output buffers which could not be filled completely
+        uint32_t underruns() {
+            return underrun_count;
+        }
+
+        /// Number of input buffers which could not be stored completely
+        uint32_t overruns() {
+            return overrun_count;
+        }
+
+        /// Output latency in ms: device latency + buffered data (measured in callback mode)
+        float latencyMs() {
+            if (!info.use_callback){
+                const PaStreamInfo *stream_info = stream!=nullptr ? Pa_GetStreamInfo(stream) : nullptr;
+                return stream_info!=nullptr ? stream_info->outputLatency * 1000.0f : 0.0f;
+            }
+            return output_latency_us / 1000.0f + bytesToMs(out_buffer.available());
+        }
+
+        /// Measured round trip latency from the ADC to the DAC in ms for full duplex in callback mode:
+        /// device latency + the data buffered in the input and output ring buffers
+        float roundTripLatencyMs() {
+            return round_trip_latency_us / 1000.0f + bytesToMs(in_buffer.available()) + bytesToMs(out_buffer.available());
+        }
+
 
     protected:
         PaStream *stream = nullptr;
         PaError err = paNoError;
         PortAudioConfig info;
         bool stream_started = false;
-        int buffer_size = 10*1024;
+        RingBufferSPSC<uint8_t> in_buffer;
+        RingBufferSPSC<uint8_t> out_buffer;
+        std::atomic<uint32_t> underrun_count{0};
+        std::atomic<uint32_t> overrun_count{0};
+        std::atomic<int32_t> output_latency_us{0};
+        std::atomic<int32_t> round_trip_latency_us{0};
+
+        bool setupParameters(PaStreamParameters &parameters, bool isInput){
+            int device = isInput ? info.input_device : info.output_device;
+            parameters.device = device >= 0 ? device : (isInput ? Pa_GetDefaultInputDevice() : Pa_GetDefaultOutputDevice());
+            if (parameters.device == paNoDevice) return false;
+            const PaDeviceInfo *device_info = Pa_GetDeviceInfo(parameters.device);
+            if (device_info == nullptr) return false;
+            parameters.channelCount = info.channels;
+            parameters.sampleFormat = getFormat(info.bits_per_sample);
+            parameters.suggestedLatency = info.suggested_latency > 0 ? info.suggested_latency 
+                : (isInput ? device_info->defaultLowInputLatency : device_info->defaultLowOutputLatency);
+            parameters.hostApiSpecificStreamInfo = nullptr;
+            LOGI("%s device: %s", isInput ? "input" : "output", device_info->name);
+            return true;
+        }
+
+        void resetCounters() {
+            underrun_count = 0;
+            overrun_count = 0;
+            output_latency_us = 0;
+            round_trip_latency_us = 0;
+        }
+
+        int frameSize() {
+            return info.bits_per_sample / 8 * info.channels;
+        }
+
+        float bytesToMs(int bytes) {
+            return 1000.0f * bytes / frameSize() / info.sample_rate;
+        }
+
+        int ringBufferSize(float latency) {
+            if (info.buffer_size > 0) return info.buffer_size;
+            int frames = latency * info.sample_rate * 4;
+            int min_frames = info.frames_per_buffer > 0 ? 4 * info.frames_per_buffer : 1024;
+            return (frames > min_frames ? frames : min_frames) * frameSize();
+        }
+
+        /// Copies the data to the output ring buffer: waits for space up to the timeout
+        size_t writeRingBuffer(const uint8_t* data, size_t len){
+            if (len==0) return 0;
+            size_t result = out_buffer.writeArray(data, len);
+            auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(info.timeout_ms);
+            while (result < len && stream_started && std::chrono::steady_clock::now() < timeout){
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                result += out_buffer.writeArray(data + result, len - result);
+            }
+            return result;
+        }
+
+        /// Reads the data from the input ring buffer: waits for data up to the timeout
+        size_t readRingBuffer(uint8_t* data, size_t len){
+            size_t result = in_buffer.readArray(data, len);
+            auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(info.timeout_ms);
+            while (result < len && stream_started && std::chrono::steady_clock::now() < timeout){
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                result += in_buffer.readArray(data + result, len - result);
+            }
+            return result;
+        }
+
+        /// PortAudio callback: input and output are processed in the same call, so they are always aligned
+        static int streamCallback(const void *input, void *output, unsigned long frames, 
+                                  const PaStreamCallbackTimeInfo* time_info, 
+                                  PaStreamCallbackFlags flags, void *user_data){
+            PortAudioStream *self = (PortAudioStream*) user_data;
+            int bytes = frames * self->frameSize();
+            if (input != nullptr){
+                int written = self->in_buffer.writeArray((const uint8_t*)input, bytes);
+                if (written < bytes || (flags & paInputOverflow)) self->overrun_count++;
+            }
+            if (output != nullptr){
+                int read = self->out_buffer.readArray((uint8_t*)output, bytes);
+                if (read < bytes){
+                    memset((uint8_t*)output + read, 0, bytes - read);
+                    self->underrun_count++;
+                } else if (flags & paOutputUnderflow){
+                    self->underrun_count++;
+                }
+            }
+            if (time_info != nullptr){
+                if (output != nullptr){
+                    self->output_latency_us = (time_info->outputBufferDacTime - time_info->currentTime) * 1000000.0;
+                }
+                if (input != nullptr && output != nullptr){
+                    self->round_trip_latency_us = (time_info->outputBufferDacTime - time_info->inputBufferAdcTime) * 1000000.0;
+                }
+            }
+            return paContinue;
+        }
 
 
         PaSampleFormat getFormat(int bitLength){
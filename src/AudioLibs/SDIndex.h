@@ -1,6 +1,19 @@
 #pragma once
 
 #define MAX_FILE_LEN 256
+#define SDINDEX_HEADER_SIZE 8
+#define SDINDEX_LOUDNESS_RECORD_SIZE 12
+/// Open mode to update a file in place with seek and write
+#ifndef SDINDEX_FILE_UPDATE
+#  ifdef ESP32
+#    define SDINDEX_FILE_UPDATE "r+"
+#  else
+#    define SDINDEX_FILE_UPDATE (O_RDWR | O_CREAT)
+#  endif
+#endif
+#ifndef SDINDEX_COPY_SIZE
+#define SDINDEX_COPY_SIZE 512
+#endif
 
 // Special logic for SDTFAT
 #ifdef SDT_FAT_VERSION
@@ -12,7 +25,14 @@ namespace audio_tools {
 
 /**
  * @brief We store all the relevant file names in an sequential index
- * file. Form there we can access them via an index
+ * file. Form there we can access them via an index. In addition we
+ * write a binary offset table (idx-pos.bin) with a fixed width entry per
+ * file, so that the access of a file name by index is a single seek and read
+ * and the size is determined from the file size. A directory table
+ * (idx-dir.txt) records the index range of each directory, so that we can
+ * rebuild the index for individual directories. The loudness of the files
+ * (e.g. determined with the LoudnessStream) can be cached in a fixed width 
+ * table (idx-loud.bin) which is validated with the hash of the file name.
  */
 template<class SDT, class FileT>
 class SDIndex {
@@ -28,16 +48,18 @@ class SDIndex {
       this->file_name_pattern = file_name_pattern;
       idx_path = filePathString(startDir,"idx.txt");
       idx_defpath = filePathString(startDir,"idx-def.txt");
+      idx_pospath = filePathString(startDir,"idx-pos.bin");
+      idx_dirpath = filePathString(startDir,"idx-dir.txt");
+      idx_loudpath = filePathString(startDir,"idx-loud.bin");
+      index_size = -1;
       int idx_file_size = indexFileTSize();
       LOGI("Index file size: %d", idx_file_size);
       String keyNew = String(startDir) + "|" + extension + "|" + file_name_pattern;
       String keyOld = getIndexDef();
-      if (setupIndex && (keyNew != keyOld || idx_file_size==0)) {
-        FileT idxfile = p_sd->open(idx_path.c_str(), FILE_WRITE);
+      if (setupIndex && (keyNew != keyOld || idx_file_size==0 || !isOffsetTableValid())) {
         LOGW("Creating index file");
-        listDir(idxfile, startDir);
+        createIndex();
         LOGI("Indexing completed");
-        idxfile.close();
         // update index definition file
         saveIndexDef(keyNew);
       } 
@@ -57,79 +79,203 @@ class SDIndex {
     /// Access file name by index
     const char *operator[](int idx) {
       // return null when inx too big
-      if (max_idx>=0 && idx>max_idx) {
-        LOGE("idx %d > size %d", idx, max_idx);
+      if (idx<0 || idx>=size()) {
+        LOGE("idx %d > size %ld", idx, index_size);
         return nullptr;
       }
-      // find record
-      FileT idxfile = p_sd->open(idx_path.c_str());
-      int count=0;
-
-      if (idxfile.available()==0){
-        LOGE("Index file is empty");
-      }
+      // determine the position in the index file
+      FileT posfile = p_sd->open(idx_pospath.c_str());
+      uint32_t offset = readOffset(posfile, idx);
+      posfile.close();
 
-      bool found = false;
-      while (idxfile.available()>0 && !found) {
-        result = idxfile.readStringUntil('\n');
-
-        // result c-string
-        char *c_str = (char*)result.c_str();
-        // remove potential cr character - hax to avoid any allocations
-        int lastPos = result.length()-1;
-        if (c_str[lastPos]==13){
-          c_str[lastPos] = 0;
-        }
-        
-        LOGD("%d -> %s", count, c_str);
-        if (count==idx) {
-          found=true;
-        }
-        count++;
-      }
-      if (!found){
-        max_idx = count;
+      // read the record
+      FileT idxfile = p_sd->open(idx_path.c_str());
+      if (!idxfile.seek(offset)){
+        LOGE("Index file seek failed: %u", (unsigned) offset);
+        idxfile.close();
+        return nullptr;
       }
+      size_t len = idxfile.readBytesUntil('\n', name_buffer, MAX_FILE_LEN-1);
       idxfile.close();
-
-      return found ? result.c_str(): nullptr;
+      // remove potential cr character
+      if (len>0 && name_buffer[len-1]==13){
+        len--;
+      }
+      name_buffer[len] = 0;
+      LOGD("%d -> %s", idx, name_buffer);
+      return name_buffer;
     }
 
+    /// Number of files in the index: determined from the size of the offset table
     long size() {
-      if (max_idx==-1){
-        FileT idxfile = p_sd->open(idx_path.c_str());
-        int count=0;
+      if (index_size==-1){
+        FileT posfile = p_sd->open(idx_pospath.c_str());
+        size_t file_size = posfile ? posfile.size() : 0;
+        posfile.close();
+        index_size = file_size > SDINDEX_HEADER_SIZE ? (file_size - SDINDEX_HEADER_SIZE) / sizeof(uint32_t) : 0;
+      }
+      return index_size;
+    }
 
-        while (idxfile.available()>0) {
-          result = idxfile.readStringUntil('\n');
-          // result c-string
-          char *c_str = (char*)result.c_str();        
-          count++;
+    /// Rebuilds the index only for the indicated directory (incl. the subdirectories): 
+    /// the entries of all other directories are copied from the existing index.  
+    bool updateDirectory(const char* dirPath){
+      TRACED();
+      String dir = normalizedPath(dirPath);
+      long start, end;
+      if (dir == normalizedPath(start_dir) || !findDirectory(dir.c_str(), start, end)){
+        LOGW("Directory not indexed - rebuilding index: %s", dir.c_str());
+        createIndex();
+        return true;
+      }
+      LOGI("Updating index for %s: %ld - %ld", dir.c_str(), start, end);
+      long count = size();
+      String tmp_path = idx_path + ".tmp";
+      String tmp_pospath = idx_pospath + ".tmp";
+      String tmp_dirpath = idx_dirpath + ".tmp";
+
+      FileT old_idx = p_sd->open(idx_path.c_str());
+      FileT old_pos = p_sd->open(idx_pospath.c_str());
+      FileT old_dir = p_sd->open(idx_dirpath.c_str());
+      FileT new_idx = openNew(tmp_path.c_str());
+      FileT new_pos = openNew(tmp_pospath.c_str());
+      FileT new_dir = openNew(tmp_dirpath.c_str());
+      uint32_t idx_size = old_idx.size();
+      uint32_t start_offset = start < count ? readOffset(old_pos, start) : idx_size;
+      uint32_t end_offset = end < count ? readOffset(old_pos, end) : idx_size;
+
+      // entries before the directory are unchanged
+      writeHeader(new_pos);
+      copyBytes(old_idx, 0, start_offset, new_idx);
+      copyOffsets(old_pos, 0, start, new_pos, 0);
+
+      // list the directory again
+      setupWriter(&new_pos, &new_dir, start, start_offset);
+      setupPathStack(dir.c_str());
+      listDir(new_idx, dir.c_str());
+      file_path_stack.clear();
+      long new_end = entry_count;
+      uint32_t new_end_offset = idx_pos;
+      resetWriter();
+
+      // entries after the directory are moved
+      copyBytes(old_idx, end_offset, idx_size, new_idx);
+      copyOffsets(old_pos, end, count, new_pos, (int32_t)(new_end_offset - end_offset));
+      copyDirectoryTable(old_dir, new_dir, dir.c_str(), start, end, new_end - end);
+
+      old_idx.close();
+      old_pos.close();
+      old_dir.close();
+      new_idx.close();
+      new_pos.close();
+      new_dir.close();
+
+      // replace the index files
+      bool result = replaceFile(tmp_path, idx_path) 
+                    && replaceFile(tmp_pospath, idx_pospath) 
+                    && replaceFile(tmp_dirpath, idx_dirpath);
+      index_size = -1;
+      return result;
+    }
+
+    /// Caches the integrated loudness (LUFS) and true peak (dBTP) of the indicated entry in its fixed width record
+    bool setLoudness(int idx, float lufs, float peak_db){
+      const char* name = (*this)[idx];
+      if (name==nullptr) return false;
+      uint8_t record[SDINDEX_LOUDNESS_RECORD_SIZE];
+      uint32_t hash = nameHash(name);
+      memcpy(record, &hash, sizeof(hash));
+      memcpy(record+4, &lufs, sizeof(float));
+      memcpy(record+8, &peak_db, sizeof(float));
+
+      // update the fixed width record in place
+      if (!p_sd->exists(idx_loudpath.c_str())){
+        FileT created = openNew(idx_loudpath.c_str());
+        created.close();
+      }
+      FileT loud = p_sd->open(idx_loudpath.c_str(), SDINDEX_FILE_UPDATE);
+      if (!loud){
+        LOGE("open failed: %s", idx_loudpath.c_str());
+        return false;
+      }
+      uint32_t pos = idx * SDINDEX_LOUDNESS_RECORD_SIZE;
+      uint32_t size = loud.size();
+      bool ok = true;
+      if (size < pos){
+        // unknown entries are marked with 0xFF
+        uint8_t empty[SDINDEX_LOUDNESS_RECORD_SIZE];
+        memset(empty, 0xFF, SDINDEX_LOUDNESS_RECORD_SIZE);
+        ok = loud.seek(size);
+        for (uint32_t j=size; ok && j<pos; j+=SDINDEX_LOUDNESS_RECORD_SIZE){
+          ok = loud.write(empty, SDINDEX_LOUDNESS_RECORD_SIZE)==SDINDEX_LOUDNESS_RECORD_SIZE;
         }
-        idxfile.close();
-        max_idx = count;
       }
-      return max_idx;
+      ok = ok && loud.seek(pos) 
+              && loud.write(record, SDINDEX_LOUDNESS_RECORD_SIZE)==SDINDEX_LOUDNESS_RECORD_SIZE;
+      loud.close();
+      if (!ok) LOGE("setLoudness failed: %d", idx);
+      return ok;
+    }
+
+    /// Provides the cached loudness: returns false if it is not available or the index has changed
+    bool getLoudness(int idx, float &lufs, float &peak_db){
+      const char* name = (*this)[idx];
+      if (name==nullptr || !p_sd->exists(idx_loudpath.c_str())) return false;
+      uint8_t record[SDINDEX_LOUDNESS_RECORD_SIZE];
+      FileT loud = p_sd->open(idx_loudpath.c_str());
+      bool ok = loud.seek(idx * SDINDEX_LOUDNESS_RECORD_SIZE) 
+                && loud.read(record, SDINDEX_LOUDNESS_RECORD_SIZE)==SDINDEX_LOUDNESS_RECORD_SIZE;
+      loud.close();
+      uint32_t hash;
+      memcpy(&hash, record, sizeof(hash));
+      if (!ok || hash!=nameHash(name)) return false;
+      memcpy(&lufs, record+4, sizeof(float));
+      memcpy(&peak_db, record+8, sizeof(float));
+      return true;
     }
 
   protected:
-    String result;
     String idx_path;
     String idx_defpath;
+    String idx_pospath;
+    String idx_dirpath;
+    String idx_loudpath;
     SDT *p_sd = nullptr;
     List<String> file_path_stack;
     String file_path_str;
     const char* start_dir;    
+    char name_buffer[MAX_FILE_LEN];
     
     const char *ext = nullptr;
     const char *file_name_pattern = nullptr;
-    long max_idx=-1;
+    long index_size=-1;
+    // state used by listDir to write the offset and directory tables
+    FileT *p_posfile = nullptr;
+    FileT *p_dirfile = nullptr;
+    long entry_count = 0;
+    uint32_t idx_pos = 0;
 
     String filePathString(const char* name, const char* suffix){
       String result = name;
       return result.endsWith("/") ? result+suffix: result+"/"+suffix;
     }
 
+    /// Writes all index files from scratch
+    void createIndex() {
+      FileT idxfile = openNew(idx_path.c_str());
+      FileT posfile = openNew(idx_pospath.c_str());
+      FileT dirfile = openNew(idx_dirpath.c_str());
+      writeHeader(posfile);
+      setupWriter(&posfile, &dirfile, 0, 0);
+      listDir(idxfile, start_dir);
+      resetWriter();
+      file_path_stack.clear();
+      idxfile.close();
+      posfile.close();
+      dirfile.close();
+      index_size = -1;
+    }
+
     /// Writes the index file
     void listDir(Print &idxfile, const char *dirname) {
       LOGD("listDir: %s", dirname);
@@ -150,6 +296,7 @@ class SDIndex {
         return;
       }
 
+      long start = entry_count;
       rewind(root);
       FileT file = openNext(root);
       while (file) {
@@ -162,16 +309,205 @@ class SDIndex {
           const char* fn = fileNamePath(file);
           if (isValidAudioFile(file)) {
             LOGD("Adding file to index: %s", fn);
-            idxfile.println(fn);
+            writeEntry(idxfile, fn);
           } else {
             LOGD("Ignoring %s",fn);
           }
         }
         file = openNext(root);
       }
+      writeDirectoryEntry(start, entry_count, dirname);
       popPath();
     }
 
+    /// Defines the files and positions used by writeEntry
+    void setupWriter(FileT *posfile, FileT *dirfile, long count, uint32_t pos){
+      p_posfile = posfile;
+      p_dirfile = dirfile;
+      entry_count = count;
+      idx_pos = pos;
+    }
+
+    void resetWriter() {
+      setupWriter(nullptr, nullptr, 0, 0);
+    }
+
+    /// Writes the file name to the index and the offset to the offset table
+    void writeEntry(Print &idxfile, const char* fn){
+      if (p_posfile!=nullptr){
+        p_posfile->write((const uint8_t*)&idx_pos, sizeof(idx_pos));
+      }
+      idx_pos += idxfile.println(fn);
+      entry_count++;
+    }
+
+    /// Records the index range of a directory: "start end path"
+    void writeDirectoryEntry(long start, long end, const char* dirname){
+      if (p_dirfile!=nullptr){
+        p_dirfile->print(start);
+        p_dirfile->print(" ");
+        p_dirfile->print(end);
+        p_dirfile->print(" ");
+        p_dirfile->println(dirname);
+      }
+    }
+
+    /// Reads the next "start end path" record of the directory table
+    bool readDirectoryEntry(FileT &dirfile, long &start, long &end, char* &path){
+      if (dirfile.available()<=0) return false;
+      size_t len = dirfile.readBytesUntil('\n', name_buffer, MAX_FILE_LEN-1);
+      if (len>0 && name_buffer[len-1]==13){
+        len--;
+      }
+      name_buffer[len] = 0;
+      char *next;
+      start = strtol(name_buffer, &next, 10);
+      end = strtol(next, &next, 10);
+      path = *next==' ' ? next+1 : next;
+      return true;
+    }
+
+    /// Determines the index range of the indicated directory
+    bool findDirectory(const char* dir, long &start, long &end){
+      FileT dirfile = p_sd->open(idx_dirpath.c_str());
+      bool found = false;
+      char *path;
+      while (!found && dirfile && readDirectoryEntry(dirfile, start, end, path)){
+        found = strcmp(path, dir)==0;
+      }
+      dirfile.close();
+      return found;
+    }
+
+    /// Copies the directory table w/o the updated directory and its subdirectories and adjusts the ranges
+    void copyDirectoryTable(FileT &from, FileT &to, const char* dir, long start, long end, long delta){
+      long dir_start, dir_end;
+      char *path;
+      int dir_len = strlen(dir);
+      while (readDirectoryEntry(from, dir_start, dir_end, path)){
+        bool is_updated = strncmp(path, dir, dir_len)==0 && (path[dir_len]==0 || path[dir_len]=='/');
+        if (is_updated) continue;
+        if (dir_start >= end){
+          dir_start += delta;
+        }
+        if (dir_end >= end){
+          dir_end += delta;
+        }
+        to.print(dir_start);
+        to.print(" ");
+        to.print(dir_end);
+        to.print(" ");
+        to.println(path);
+      }
+    }
+
+    /// Copies the file content in the indicated range
+    void copyBytes(FileT &from, uint32_t start, uint32_t end, FileT &to){
+      uint8_t buffer[SDINDEX_COPY_SIZE];
+      from.seek(start);
+      uint32_t open = end - start;
+      while (open>0){
+        size_t len = from.read(buffer, open < SDINDEX_COPY_SIZE ? open : SDINDEX_COPY_SIZE);
+        if (len==0) break;
+        to.write(buffer, len);
+        open -= len;
+      }
+    }
+
+    /// Copies the offset table entries in the indicated index range adding the delta
+    void copyOffsets(FileT &from, long start, long end, FileT &to, int32_t delta){
+      uint32_t buffer[SDINDEX_COPY_SIZE / sizeof(uint32_t)];
+      const long max_count = SDINDEX_COPY_SIZE / sizeof(uint32_t);
+      from.seek(SDINDEX_HEADER_SIZE + start * sizeof(uint32_t));
+      long open = end - start;
+      while (open>0){
+        long count = open < max_count ? open : max_count;
+        size_t len = from.read((uint8_t*)buffer, count * sizeof(uint32_t)) / sizeof(uint32_t);
+        if (len==0) break;
+        for (size_t j=0; j<len; j++){
+          buffer[j] += delta;
+        }
+        to.write((const uint8_t*)buffer, len * sizeof(uint32_t));
+        open -= len;
+      }
+    }
+
+    /// Reads the offset of the indicated entry from the offset table
+    uint32_t readOffset(FileT &posfile, long idx){
+      uint32_t offset = 0;
+      if (!posfile.seek(SDINDEX_HEADER_SIZE + idx * sizeof(uint32_t))
+          || posfile.read((uint8_t*)&offset, sizeof(offset))!=sizeof(offset)){
+        LOGE("Offset table read failed for %ld", idx);
+      }
+      return offset;
+    }
+
+    /// The offset table starts with the magic and the record size
+    void writeHeader(FileT &posfile){
+      uint8_t header[SDINDEX_HEADER_SIZE] = {'A','I','D','X', 1, 0, sizeof(uint32_t), 0};
+      posfile.write(header, SDINDEX_HEADER_SIZE);
+    }
+
+    bool isOffsetTableValid() {
+      if (!p_sd->exists(idx_pospath.c_str())) return false;
+      FileT posfile = p_sd->open(idx_pospath.c_str());
+      uint8_t header[SDINDEX_HEADER_SIZE] = {0};
+      bool result = posfile.read(header, SDINDEX_HEADER_SIZE)==SDINDEX_HEADER_SIZE 
+                    && memcmp(header, "AIDX", 4)==0 && header[6]==sizeof(uint32_t);
+      posfile.close();
+      return result;
+    }
+
+    /// Sets up the path stack for the indicated directory relative to the start directory
+    void setupPathStack(const char* dir){
+      file_path_stack.clear();
+      const char* rel = dir + normalizedPath(start_dir).length();
+      while (*rel!=0){
+        while (*rel=='/') rel++;
+        const char* next = strchr(rel, '/');
+        int len = next==nullptr ? strlen(rel) : next-rel;
+        if (len>0){
+          // the last entry is removed again by listDir
+          pushPath(String(rel).substring(0, len).c_str());
+        }
+        rel += len;
+      }
+    }
+
+    /// FNV-1a hash of the file name to validate the cached loudness
+    uint32_t nameHash(const char* name){
+      uint32_t hash = 2166136261u;
+      while (*name){
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+      }
+      // reserved for unknown entries
+      return hash==0xFFFFFFFF ? 0 : hash;
+    }
+
+    /// Removes trailing /
+    String normalizedPath(const char* path){
+      String result = path;
+      while (result.length()>1 && result.endsWith("/")){
+        result.remove(result.length()-1);
+      }
+      return result;
+    }
+
+    /// Opens the file for writing after deleting the old content
+    FileT openNew(const char* path){
+      if (p_sd->exists(path)){
+        p_sd->remove(path);
+      }
+      return p_sd->open(path, FILE_WRITE);
+    }
+
+    bool replaceFile(String &from, String &to){
+      p_sd->remove(to.c_str());
+      bool result = p_sd->rename(from.c_str(), to.c_str());
+      if (!result) LOGE("rename failed: %s", to.c_str());
+      return result;
+    }
+
     bool isDirectory(FileT f) {
       bool result;
 #ifdef USE_SDFAT
@@ -233,14 +569,14 @@ class SDIndex {
       return key1;
     }
     void saveIndexDef(String keyNew){
-        FileT idxdef = p_sd->open(idx_defpath.c_str(), FILE_WRITE);
+        FileT idxdef = openNew(idx_defpath.c_str());
         idxdef.write((const uint8_t *)keyNew.c_str(), keyNew.length());
         idxdef.close();
     }
 
     size_t indexFileTSize() {
         FileT idxfile = p_sd->open(idx_path.c_str());
-        size_t result = idxfile.size();
+        size_t result = idxfile ? idxfile.size() : 0;
         idxfile.close();
         return result;
     }
@@ -1,4 +1,5 @@
 #pragma once
+#include <string.h>
 #include "AudioTools/AudioLogger.h"
 
 namespace audio_tools {
@@ -29,44 +30,65 @@ class MetaDataFilter {
         void begin() {
             TRACED();
             start = 0;
+            total_len = 0;
         }
 
-        /// Writes the data to the decoder 
+        /// Defines the size of the input: if known the ID3v1 tag at the end is removed as well
+        void setInputSize(size_t size){
+            input_size = size;
+        }
+
+        /// The input was repositioned (e.g. by seeking)
+        void setPosition(size_t pos){
+            total_len = pos;
+            start = 0;
+        }
+
+        /// Writes the data to the decoder: The ID3v2 tag is only expected at the beginning and 
+        /// the ID3v1 tag in the last 128 bytes, so we do not need to scan all the audio data
         size_t write(uint8_t* data, size_t len){
             TRACED();
             if (p_decoder==nullptr) return 0;
-            int pos=0; int meta_len=0;
-            if (findTag(data, len, pos, meta_len)){
-                LOGD("pos: %d len: %d",pos, meta_len);
-                if (start<pos){
-                    p_decoder->write(data+start,pos);
-                }
-
-                int start_idx2 = pos+meta_len;
-                int len2 =  len-start_idx2;    
-                if (start_idx2<len){
-                    // we still have some audio to write
-                    p_decoder->write(data+start_idx2,len2);
-                } else {
-                    // ignore audio of next write
-                    start = meta_len - len2;
-                }
-            } else {
-                // ignore start number of characters
-                if (start>=len){
-                    start -= len;
-                } else {
-                    p_decoder->write(data+start,len-start);
-                    start = 0;
-                }
+            size_t result = len;
+            // ID3v2 tag at the beginning
+            if (total_len==0 && len>=sizeof(ID3v2) && memcmp(data, "ID3", 3)==0){
+                memcpy(&tagv2, data, sizeof(ID3v2));   
+                start = sizeof(ID3v2) + calcSizeID3v2(tagv2.size);
+                LOGD("ID3 len: %d", start);
+            }
+            // ignore start number of characters
+            size_t skip = start < len ? start : len;
+            start -= skip;
+            total_len += skip;
+            data += skip;
+            len -= skip;
+            // ID3v1 tag in the last 128 bytes which might be preceded by the 227 bytes of TAG+
+            size_t write_len = len;
+            size_t tag_pos = 0;
+            size_t tag_len = 0;
+            if (isTagAt(data, len, 128 + 227, "TAG+", tag_pos)){
+                LOGD("TAG+");
+                tag_len = 128 + 227;
+            } else if (isTagAt(data, len, 128, "TAG", tag_pos)){
+                LOGD("TAG");
+                tag_len = 128;
             }
-            return len;
+            if (tag_len>0){
+                write_len = tag_pos;
+                start = tag_len - (len - tag_pos);
+            }
+            if (write_len>0){
+                p_decoder->write(data, write_len);
+            }
+            total_len += len;
+            return result;
         }
 
     protected:
         Decoder *p_decoder=nullptr;
-        enum MetaType {TAG, TAG_PLUS, ID3};
-        int start = 0;
+        size_t start = 0;
+        size_t total_len = 0;
+        size_t input_size = 0;
         /// ID3 verion 2 TAG Header (10 bytes)
         struct ID3v2 {
             uint8_t header[3]; // ID3
@@ -75,29 +97,14 @@ class MetaDataFilter {
             uint8_t size[4];
         } tagv2;
 
-        /// determines if the data conatins a ID3v1 or ID3v2 tag
-        bool findTag(uint8_t* data, size_t len, int &pos_tag, int &meta_len){
-            MetaType tag_type;
-            if (find((const char*)data, len, pos_tag, tag_type)){
-                switch(tag_type){
-                    case TAG:
-                        LOGD("TAG");
-                        meta_len = 128;
-                        break;
-                    case TAG_PLUS:
-                        LOGD("TAG+");
-                        meta_len = 227;
-                        break;
-                    case ID3:
-                        LOGD("ID3");
-                        memcpy(&tagv2, data+pos_tag, sizeof(ID3v2));   
-                        meta_len = calcSizeID3v2(tagv2.size);
-                        break;
-
-                }
-                return true;
-            }
-            return false;
+        /// checks if the tag id is at the indicated distance from the end of the input 
+        bool isTagAt(uint8_t* data, size_t len, size_t from_end, const char* id, size_t &pos){
+            size_t id_len = strlen(id);
+            if (len==0 || input_size<from_end) return false;
+            size_t tag_start = input_size - from_end;
+            if (tag_start<total_len || tag_start + id_len > total_len + len) return false;
+            pos = tag_start - total_len;
+            return memcmp(data+pos, id, id_len)==0;
         }
 
         // calculate the synch save size for ID3v2
@@ -108,21 +115,6 @@ class MetaDataFilter {
             uint32_t byte3 = chars[3];
             return byte0 << 21 | byte1 << 14 | byte2 << 7 | byte3;
         }
-
-        /// find the tag position in the string;
-        bool find(const char*str, size_t len, int &pos, MetaType &type){
-            if (str==nullptr || len<=0) return false;
-            for (size_t j=0;j<=len-3;j++){
-                if (str[j]=='T' && str[j+1]=='A' && str[j+2]=='G'){
-                    type = str[j+3]=='+' ? TAG_PLUS : TAG;
-                    return true;
-                } else if (str[j]=='I' && str[j+1]=='D' && str[j+2]=='3'){
-                    type = ID3;
-                    return true;
-                }
-            }
-            return false;
-        }
 };
 
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include <ctype.h>
 #include "AbstractMetaData.h"
+#include "AudioBasic/Collections/Vector.h"
 
 /** 
  * @defgroup metadata-id3 ID3 
@@ -27,7 +28,7 @@ INLINE_VAR const char *genres[] = { "Classic Rock", "Country", "Dance", "Disco",
 enum ParseStatus { TagNotFound, PartialTagAtTail, TagFoundPartial, TagFoundComplete, TagProcessed};
 
 
-/// ID3 verion 1 TAG (130 bytes)
+/// ID3 verion 1 TAG (128 bytes)
 /// @ingroup metadata-id3
 struct ID3v1 {
     char header[3]; // TAG
@@ -35,7 +36,7 @@ struct ID3v1 {
     char artist[30];
     char album[30];
     char year[4];
-    char comment[30];
+    char comment[28];
     char zero_byte[1];    
     char track[1];    
     char genre;    
@@ -113,9 +114,15 @@ class MetaDataID3V1  : public MetaDataID3Base {
         end();
         status = TagNotFound;
         use_bytes_of_next_write = 0;
+        total_len = 0;
         memset(tag_str, 0, 5);
     }
 
+    /// Defines the total size of the input: if known we only collect the end of the data which contains the tags
+    void setInputSize(size_t size) {
+        input_size = size;
+    }
+
     /// Ends the processing and releases the memory
     void end() {
         if (tag!=nullptr){
@@ -130,7 +137,9 @@ class MetaDataID3V1  : public MetaDataID3Base {
 
     /// provide the (partial) data which might contain the meta data
     size_t write(const uint8_t* data, size_t len){
-        if (armed){ 
+        if (armed && input_size >= sizeof(ID3v1)){
+            collectTail(data, len);
+        } else if (armed){ 
             switch(status){
                 case TagNotFound:
                     processTagNotFound(data,len);
@@ -146,16 +155,48 @@ class MetaDataID3V1  : public MetaDataID3Base {
                     break;
             }
         }
+        total_len += len;
         return len;
     }
 
   protected:
+    size_t input_size = 0;
+    size_t total_len = 0;
     int use_bytes_of_next_write = 0;
     char tag_str[5] = "";
     ID3v1 *tag = nullptr;
     ID3v1Enhanced *tag_ext = nullptr;
     ParseStatus status = TagNotFound;
+    Vector<uint8_t> tail{0};
+
+    /// With a known input size we collect the last bytes which can contain the TAG+ and TAG
+    void collectTail(const uint8_t* data, size_t len) {
+        if (status == TagProcessed) return;
+        size_t region = min(input_size, sizeof(ID3v1) + sizeof(ID3v1Enhanced));
+        size_t region_start = input_size - region;
+        if (total_len + len <= region_start) return;
+        if (tail.size() != (int)region) tail.resize(region);
+        size_t from = total_len < region_start ? region_start - total_len : 0;
+        size_t to = total_len + from - region_start;
+        if (to >= region) return;
+        size_t copy_len = min(len - from, region - to);
+        memcpy(tail.data() + to, data + from, copy_len);
+        if (to + copy_len == region) processTail(region);
+    }
 
+    /// Processes the collected data: TAG+ is only valid in front of a TAG
+    void processTail(size_t region) {
+        status = TagProcessed;
+        uint8_t *p_tag = tail.data() + region - sizeof(ID3v1);
+        if (memcmp(p_tag, "TAG", 3) != 0) return;
+        tag = new ID3v1();
+        memcpy(tag, p_tag, sizeof(ID3v1));
+        if (region == sizeof(ID3v1) + sizeof(ID3v1Enhanced) && memcmp(tail.data(), "TAG+", 4) == 0){
+            tag_ext = new ID3v1Enhanced();
+            memcpy(tag_ext, tail.data(), sizeof(ID3v1Enhanced));
+        }
+        processNotify();
+    }
 
     /// try to find the metatdata tag in the provided data
     void processTagNotFound(const uint8_t* data, size_t len) {
@@ -165,7 +206,7 @@ class MetaDataID3V1  : public MetaDataID3Base {
             tag_ext = new ID3v1Enhanced();
             if (tag_ext!=nullptr){
                 if (len-pos>=sizeof(ID3v1Enhanced)){
-                    memcpy(tag,data+pos,sizeof(ID3v1Enhanced));
+                    memcpy(tag_ext,data+pos,sizeof(ID3v1Enhanced));
                     processNotify();                    
                 } else {
                     use_bytes_of_next_write = min(sizeof(ID3v1Enhanced), len-pos);
@@ -227,13 +268,13 @@ class MetaDataID3V1  : public MetaDataID3Base {
     /// We have the beginning of the metadata and need to process the remainder
     void processTagFoundPartial(const uint8_t* data, size_t len) {
         if (tag!=nullptr){
-            int remainder = sizeof(ID3v1) - use_bytes_of_next_write;
-            memcpy(tag,data+use_bytes_of_next_write,remainder);
+            int remainder = min(sizeof(ID3v1) - use_bytes_of_next_write, len);
+            memcpy((uint8_t*)tag+use_bytes_of_next_write,data,remainder);
             processNotify();                 
             use_bytes_of_next_write = 0;   
         } else if (tag_ext!=nullptr){
-            int remainder = sizeof(ID3v1Enhanced) - use_bytes_of_next_write;
-            memcpy(tag_ext,data+use_bytes_of_next_write,remainder);
+            int remainder = min(sizeof(ID3v1Enhanced) - use_bytes_of_next_write, len);
+            memcpy((uint8_t*)tag_ext+use_bytes_of_next_write,data,remainder);
             processNotify();                 
             use_bytes_of_next_write = 0;   
         }
@@ -258,7 +299,7 @@ class MetaDataID3V1  : public MetaDataID3Base {
             callback(Artist, tag->artist,strnlen(tag->artist,30));
             callback(Album, tag->album,strnlen(tag->album,30));        
             uint16_t genre = tag->genre;
-            if (genre < sizeof(genres)){
+            if (genre < sizeof(genres)/sizeof(genres[0])){
                 const char* genre_str = genres[genre];
                 callback(Genre, genre_str,strlen(genre_str));
             }
@@ -276,6 +317,11 @@ class MetaDataID3V1  : public MetaDataID3Base {
 #define ExtendedHeaderFlag 0x20
 #define ExperimentalIndicatorFlag 0x10
         
+/// Number of bytes at the beginning of the data which are scanned for the ID3v2 tag
+#ifndef ID3_V2_SCAN_LIMIT
+#define ID3_V2_SCAN_LIMIT 1600
+#endif
+
 // Relevant v2 Tags        
 INLINE_VAR const char* id3_v2_tags[] = {"TALB", "TOPE", "TPE1", "TIT2", "TCON"};
 
@@ -331,11 +377,7 @@ class MetaDataID3V2 : public MetaDataID3Base  {
 
     /// (re)starts the processing
     void begin() {
-        status = TagNotFound;
-        use_bytes_of_next_write = 0;
-        actual_tag = nullptr;
-        tag_active = false;
-        tag_processed = false;
+        end();
     }
     
     /// Ends the processing and releases the memory
@@ -345,6 +387,8 @@ class MetaDataID3V2 : public MetaDataID3Base  {
         actual_tag = nullptr;
         tag_active = false;
         tag_processed = false;
+        total_len = 0;
+        end_len = 0;
     }
 
     /// provide the (partial) data which might contain the meta data
@@ -413,15 +457,24 @@ class MetaDataID3V2 : public MetaDataID3Base  {
                 // if we have enough data for the header we process it
                 if (len>=pos+sizeof(ID3v2)){
                     memcpy(&tagv2, data+pos, sizeof(ID3v2));   
-                    end_len = total_len + calcSize(tagv2.size);
+                    end_len = total_len + pos + sizeof(ID3v2) + calcSize(tagv2.size);
                 }
+            } else if (total_len + len >= ID3_V2_SCAN_LIMIT) {
+                // the tag is at the beginning of the data: stop scanning
+                LOGI("No ID3v2 tag");
+                status = TagProcessed;
+                total_len += len;
+                return;
             }
         }
 
-        // deactivate tag processing when we are out of range
+        // stop the v2 processing when we are out of the tag region: ID3v1 is still processed
         if (end_len>0 && total_len>end_len){
+            LOGI("ID3v2 tag region passed");
             tag_active = false;
-            tag_processed = false;
+            status = TagProcessed;
+            total_len += len;
+            return;
         }
 
         
@@ -522,7 +575,7 @@ class MetaDataID3V2 : public MetaDataID3Base  {
                         // we just use the first entry
                         result[end_pos]=0;
                         int idx = atoi(result+1);
-                        if (idx>=0 && idx< (int)sizeof(genres)){
+                        if (idx>=0 && idx< (int)(sizeof(genres)/sizeof(genres[0]))){
                             strncpy((char*)result,genres[idx],256);
                         }
                     }
@@ -560,6 +613,11 @@ class MetaDataID3 : public AbstractMetaData {
         this->filter = sel;
     }
 
+    /// Defines the size of the input data (e.g. file size), so that ID3v1 scanning is limited to the end
+    void setInputSize(size_t size) {
+        id3v1.setInputSize(size);
+    }
+
     void begin() {
         TRACEI();
         id3v1.begin();
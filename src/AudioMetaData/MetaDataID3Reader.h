@@ -0,0 +1,398 @@
+#pragma once
+#include <string.h>
+#include <stdint.h>
+#include "AudioMetaData/MetaDataID3.h"
+
+#ifndef ID3_READER_BUFFER_SIZE
+#define ID3_READER_BUFFER_SIZE 256
+#endif
+
+namespace audio_tools {
+
+/// Location of an attached picture (APIC) in the file @ingroup metadata-id3
+struct ID3Picture {
+    char mime[32];
+    /// picture type as defined by ID3v2 (e.g. 3 = front cover)
+    uint8_t picture_type = 0;
+    /// absolute position of the image data in the file
+    uint32_t offset = 0;
+    /// size of the image data in bytes
+    uint32_t size = 0;
+    /// the image data is unsynchronized and can not be copied 1:1
+    bool unsynchronized = false;
+};
+
+/**
+ * @brief ID3 Meta Data Reader for seekable inputs (e.g. files or a MemoryStream): In
+ * difference to MetaDataID3, which needs to scan all the data, we only read the ID3v2
+ * header region at the beginning and the last 128 (resp. 355) bytes for ID3v1. All text
+ * frames are reported via the frame callback and attached pictures are reported with their
+ * position in the file, so that they can be loaded on demand. The input type needs to
+ * provide seek(pos), size() and readBytes(data, len).
+ * @ingroup metadata-id3
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MetaDataID3Reader {
+  public:
+    MetaDataID3Reader() = default;
+
+    /// Defines the callback for the common metadata (Title, Artist, Album, Genre)
+    void setCallback(void (*fn)(MetaDataType info, const char* str, int len)) {
+        callback = fn;
+    }
+
+    /// Defines the callback which receives all ID3v2 text frames with the frame id (e.g. TYER, TRCK)
+    void setFrameCallback(void (*fn)(const char* id, const char* str, int len)) {
+        frame_callback = fn;
+    }
+
+    /// Defines the callback which receives the location of attached pictures
+    void setPictureCallback(void (*fn)(ID3Picture &picture)) {
+        picture_callback = fn;
+    }
+
+    void setFilter(ID3TypeSelection sel) {
+        this->filter = sel;
+    }
+
+    /// Reads the metadata: returns true if some tag was found
+    template <class T>
+    bool read(T &in) {
+        TRACED();
+        size_t file_size = in.size();
+        tag_end = 0;
+        bool result = false;
+        if (filter & SELECT_ID3V2) {
+            result = readV2(in, file_size);
+        }
+        // ID3v1 is only reported if there was no ID3v2 tag
+        if (!result && (filter & SELECT_ID3V1)) {
+            result = readV1(in, file_size);
+        }
+        return result;
+    }
+
+    /// Provides the position of the audio data after the ID3v2 tag (0 if there is none)
+    size_t audioStart() {
+        return tag_end;
+    }
+
+  protected:
+    void (*callback)(MetaDataType info, const char* str, int len) = nullptr;
+    void (*frame_callback)(const char* id, const char* str, int len) = nullptr;
+    void (*picture_callback)(ID3Picture &picture) = nullptr;
+    int filter = SELECT_ID3;
+    uint8_t buffer[ID3_READER_BUFFER_SIZE];
+    char result[ID3_READER_BUFFER_SIZE];
+    uint8_t version = 0;
+    bool unsynchronized = false;
+    size_t tag_end = 0;
+
+    template <class T>
+    bool readAt(T &in, size_t pos, uint8_t* data, size_t len) {
+        return in.seek(pos) && in.readBytes(data, len) == len;
+    }
+
+    uint32_t synchsafe(const uint8_t* data) {
+        return (uint32_t)(data[0] & 0x7F) << 21 | (uint32_t)(data[1] & 0x7F) << 14 |
+               (uint32_t)(data[2] & 0x7F) << 7 | (data[3] & 0x7F);
+    }
+
+    uint32_t bigEndian(const uint8_t* data, int len) {
+        uint32_t result = 0;
+        for (int j = 0; j < len; j++) {
+            result = result << 8 | data[j];
+        }
+        return result;
+    }
+
+    /// Processes all frames of the ID3v2 tag
+    template <class T>
+    bool readV2(T &in, size_t file_size) {
+        ID3v2 header;
+        if (file_size < sizeof(ID3v2) || !readAt(in, 0, (uint8_t*)&header, sizeof(ID3v2))) return false;
+        if (memcmp(header.header, "ID3", 3) != 0 || header.version[0] < 2 || header.version[0] > 4) {
+            LOGI("No ID3v2 tag");
+            return false;
+        }
+        version = header.version[0];
+        unsynchronized = header.flags & 0x80;
+        size_t end = sizeof(ID3v2) + synchsafe(header.size);
+        tag_end = end + ((version == 4 && (header.flags & 0x10)) ? 10 : 0);
+        if (end > file_size) end = file_size;
+        LOGI("ID3v2.%d tag with %d bytes", version, (int)end);
+        // v2.2 uses the flag for compression which is not supported
+        if (version == 2 && (header.flags & 0x40)) return true;
+
+        size_t pos = sizeof(ID3v2);
+        if (version > 2 && (header.flags & 0x40)) {
+            // skip extended header
+            uint8_t ext[4];
+            if (!readAt(in, pos, ext, 4)) return true;
+            pos += version == 3 ? 4 + bigEndian(ext, 4) : synchsafe(ext);
+        }
+
+        int header_len = version == 2 ? 6 : 10;
+        while (pos + header_len <= end) {
+            uint8_t frame[10];
+            if (!readAt(in, pos, frame, header_len) || frame[0] == 0) break;  // padding
+            uint32_t size = version == 2 ? bigEndian(frame + 3, 3)
+                          : version == 3 ? bigEndian(frame + 4, 4) : synchsafe(frame + 4);
+            size_t data_pos = pos + header_len;
+            if (size == 0 || data_pos + size > end) break;
+            pos = data_pos + size;
+
+            char id[5] = {0};
+            memcpy(id, frame, version == 2 ? 3 : 4);
+            if (version == 2) mapV22(id);
+
+            // skip additional frame header data and unsupported frames
+            uint32_t skip = 0;
+            bool frame_unsync = unsynchronized;
+            if (version == 3) {
+                if (frame[9] & 0xC0) continue;  // compression or encryption
+                if (frame[9] & 0x20) skip += 1;  // grouping
+            } else if (version == 4) {
+                if (frame[9] & 0x0C) continue;  // compression or encryption
+                if (frame[9] & 0x40) skip += 1;  // grouping
+                if (frame[9] & 0x01) skip += 4;  // data length indicator
+                frame_unsync = frame_unsync || (frame[9] & 0x02);
+            }
+            if (skip >= size) continue;
+            processFrame(in, id, data_pos + skip, size - skip, frame_unsync);
+        }
+        return true;
+    }
+
+    /// Maps the ID3v2.2 3 character ids to the 4 character ids of ID3v2.3
+    void mapV22(char* id) {
+        static const char* ids[][2] = {{"TT2", "TIT2"}, {"TP1", "TPE1"}, {"TP2", "TPE2"},
+                                       {"TAL", "TALB"}, {"TCO", "TCON"}, {"TYE", "TYER"},
+                                       {"TRK", "TRCK"}, {"TPA", "TPOS"}, {"TCM", "TCOM"},
+                                       {"COM", "COMM"}, {"ULT", "USLT"}, {"PIC", "APIC"},
+                                       {"TXX", "TXXX"}, {"WXX", "WXXX"}};
+        for (auto &map : ids) {
+            if (memcmp(id, map[0], 3) == 0) {
+                memcpy(id, map[1], 4);
+                return;
+            }
+        }
+    }
+
+    template <class T>
+    void processFrame(T &in, const char* id, size_t pos, uint32_t size, bool unsync) {
+        LOGD("frame %s: %d bytes at %d", id, (int)size, (int)pos);
+        if (memcmp(id, "APIC", 4) == 0) {
+            processPicture(in, pos, size, unsync);
+            return;
+        }
+        bool is_text = id[0] == 'T' || memcmp(id, "COMM", 4) == 0 || memcmp(id, "USLT", 4) == 0 ||
+                       memcmp(id, "WXXX", 4) == 0;
+        bool is_url = id[0] == 'W' && !is_text;
+        if (!is_text && !is_url) return;
+
+        size_t len = size < sizeof(buffer) ? size : sizeof(buffer);
+        if (!readAt(in, pos, buffer, len)) return;
+        int text_len;
+        if (is_url) {
+            // url frames are ISO-8859-1 w/o encoding byte
+            text_len = decode(0, buffer, len);
+        } else {
+            uint8_t encoding = buffer[0];
+            size_t start = 1;
+            // skip language and content description
+            if (memcmp(id, "COMM", 4) == 0 || memcmp(id, "USLT", 4) == 0) {
+                start += 3;
+                start = skipString(encoding, buffer, start, len);
+            } else if (memcmp(id, "TXXX", 4) == 0 || memcmp(id, "WXXX", 4) == 0) {
+                start = skipString(encoding, buffer, start, len);
+            }
+            if (start >= len) return;
+            text_len = decode(memcmp(id, "WXXX", 4) == 0 ? 0 : encoding, buffer + start, len - start);
+        }
+        notify(id, text_len);
+    }
+
+    /// Determines the position of the image data w/o loading it
+    template <class T>
+    void processPicture(T &in, size_t pos, uint32_t size, bool unsync) {
+        if (picture_callback == nullptr) return;
+        size_t len = size < sizeof(buffer) ? size : sizeof(buffer);
+        if (!readAt(in, pos, buffer, len)) return;
+        ID3Picture picture;
+        memset(picture.mime, 0, sizeof(picture.mime));
+        uint8_t encoding = buffer[0];
+        size_t idx = 1;
+        if (version == 2) {
+            // 3 character image format
+            memcpy(picture.mime, buffer + 1, 3);
+            idx = 4;
+        } else {
+            size_t mime_end = skipString(0, buffer, idx, len);
+            size_t mime_len = mime_end - idx - 1;
+            memcpy(picture.mime, buffer + idx, mime_len < sizeof(picture.mime) ? mime_len : sizeof(picture.mime) - 1);
+            idx = mime_end;
+        }
+        if (idx >= len) return;
+        picture.picture_type = buffer[idx++];
+        // the description might be longer then the buffer: we search in chunks
+        size_t data_start = 0;
+        for (size_t chunk = idx; chunk < size; chunk += sizeof(buffer)) {
+            size_t chunk_len = size - chunk < sizeof(buffer) ? size - chunk : sizeof(buffer);
+            if (!readAt(in, pos + chunk, buffer, chunk_len)) return;
+            size_t end = skipString(encoding, buffer, 0, chunk_len);
+            if (end <= chunk_len) {
+                data_start = chunk + end;
+                break;
+            }
+        }
+        if (data_start == 0) return;
+        picture.offset = pos + data_start;
+        picture.size = size - data_start;
+        picture.unsynchronized = unsync;
+        LOGI("APIC %s: %d bytes at %d", picture.mime, (int)picture.size, (int)picture.offset);
+        picture_callback(picture);
+    }
+
+    /// Returns the position after the terminating 0 of the string (or len+1 if not found)
+    size_t skipString(uint8_t encoding, const uint8_t* data, size_t start, size_t len) {
+        bool wide = encoding == 1 || encoding == 2;
+        size_t j = start;
+        if (wide) {
+            for (; j + 1 < len; j += 2) {
+                if (data[j] == 0 && data[j + 1] == 0) return j + 2;
+            }
+        } else {
+            for (; j < len; j++) {
+                if (data[j] == 0) return j + 1;
+            }
+        }
+        return len + 1;
+    }
+
+    /// Converts the string to UTF-8 in the result: returns the length
+    int decode(uint8_t encoding, const uint8_t* data, size_t len) {
+        size_t out = 0;
+        const size_t max = sizeof(result) - 4;
+        if (encoding == 1 || encoding == 2) {
+            // UTF-16 with BOM (1) or big endian (2)
+            bool big_endian = true;
+            size_t j = 0;
+            if (encoding == 1 && len >= 2) {
+                big_endian = !(data[0] == 0xFF && data[1] == 0xFE);
+                if ((data[0] == 0xFF && data[1] == 0xFE) || (data[0] == 0xFE && data[1] == 0xFF)) j = 2;
+            }
+            for (; j + 1 < len && out < max; j += 2) {
+                uint16_t ch = big_endian ? data[j] << 8 | data[j + 1] : data[j + 1] << 8 | data[j];
+                if (ch == 0) break;
+                out += toUTF8(ch, result + out);
+            }
+        } else {
+            for (size_t j = 0; j < len && out < max; j++) {
+                if (data[j] == 0) break;
+                // ISO-8859-1 (0) needs to be converted, UTF-8 (3) is copied
+                out += encoding == 0 ? toUTF8(data[j], result + out) : (result[out] = data[j], 1);
+            }
+        }
+        result[out] = 0;
+        return out;
+    }
+
+    int toUTF8(uint16_t ch, char* out) {
+        if (ch < 0x80) {
+            out[0] = ch;
+            return 1;
+        } else if (ch < 0x800) {
+            out[0] = 0xC0 | (ch >> 6);
+            out[1] = 0x80 | (ch & 0x3F);
+            return 2;
+        }
+        out[0] = 0xE0 | (ch >> 12);
+        out[1] = 0x80 | ((ch >> 6) & 0x3F);
+        out[2] = 0x80 | (ch & 0x3F);
+        return 3;
+    }
+
+    /// executes the callbacks
+    void notify(const char* id, int len) {
+        if (frame_callback != nullptr) {
+            frame_callback(id, result, len);
+        }
+        if (callback == nullptr) return;
+        if (memcmp(id, "TALB", 4) == 0)
+            callback(Album, result, len);
+        else if (memcmp(id, "TPE1", 4) == 0 || memcmp(id, "TOPE", 4) == 0)
+            callback(Artist, result, len);
+        else if (memcmp(id, "TIT2", 4) == 0)
+            callback(Title, result, len);
+        else if (memcmp(id, "TCON", 4) == 0)
+            callback(Genre, genre(result), strlen(genre(result)));
+    }
+
+    /// converts (nn) genre ids to the name
+    const char* genre(const char* str) {
+        if (str[0] == '(') {
+            int idx = atoi(str + 1);
+            if (idx >= 0 && idx < (int)(sizeof(genres) / sizeof(genres[0]))) {
+                return genres[idx];
+            }
+        }
+        return str;
+    }
+
+    /// Reads the ID3v1 tag from the end of the file
+    template <class T>
+    bool readV1(T &in, size_t file_size) {
+        ID3v1 tag;
+        if (file_size < sizeof(ID3v1) + tag_end) return false;
+        if (!readAt(in, file_size - sizeof(ID3v1), (uint8_t*)&tag, sizeof(ID3v1))) return false;
+        if (memcmp(tag.header, "TAG", 3) != 0) {
+            LOGI("No ID3v1 tag");
+            return false;
+        }
+        ID3v1Enhanced tag_ext;
+        bool has_ext = file_size >= sizeof(ID3v1) + sizeof(ID3v1Enhanced) &&
+                       readAt(in, file_size - sizeof(ID3v1) - sizeof(ID3v1Enhanced), (uint8_t*)&tag_ext,
+                              sizeof(ID3v1Enhanced)) &&
+                       memcmp(tag_ext.header, "TAG+", 4) == 0;
+        if (has_ext) {
+            notifyV1("TIT2", tag.title, 30, tag_ext.title, 60);
+            notifyV1("TPE1", tag.artist, 30, tag_ext.artist, 60);
+            notifyV1("TALB", tag.album, 30, tag_ext.album, 60);
+        } else {
+            notifyV1("TIT2", tag.title, 30);
+            notifyV1("TPE1", tag.artist, 30);
+            notifyV1("TALB", tag.album, 30);
+        }
+        notifyV1("TYER", tag.year, 4);
+        if (tag.zero_byte[0] == 0 && tag.track[0] != 0) {
+            int len = snprintf(result, sizeof(result), "%d", tag.track[0]);
+            notify("TRCK", len);
+        }
+        if (has_ext && tag_ext.genre[0] != 0) {
+            notifyV1("TCON", tag_ext.genre, 30);
+        } else if ((uint8_t)tag.genre < sizeof(genres) / sizeof(genres[0])) {
+            const char* genre_str = genres[(uint8_t)tag.genre];
+            notifyV1("TCON", genre_str, strlen(genre_str));
+        }
+        return true;
+    }
+
+    /// reports the ID3v1 field: the enhanced tag provides the continuation
+    void notifyV1(const char* id, const char* str, int len, const char* ext = nullptr, int ext_len = 0) {
+        int l = strnlen(str, len);
+        memcpy(result, str, l);
+        if (ext != nullptr && l == len) {
+            int l2 = strnlen(ext, ext_len);
+            memcpy(result + l, ext, l2);
+            l += l2;
+        }
+        // remove trailing spaces
+        while (l > 0 && result[l - 1] == ' ') l--;
+        result[l] = 0;
+        if (l > 0) notify(id, l);
+    }
+};
+
+}  // namespace audio_tools
@@ -65,10 +65,17 @@
 #include "AudioTools/AudioStreamsConverter.h"
 #include "AudioTools/AudioPrint.h"
 #include "AudioTools/VolumeStream.h"
+#include "AudioTools/DynamicsStream.h"
+#include "AudioTools/LoudnessStream.h"
 #include "AudioTools/Resample.h"
+#include "AudioTools/AdaptiveResample.h"
+#include "AudioTools/VADStream.h"
 #include "AudioTools/AudioCopy.h"
 #include "AudioCodecs/AudioEncoded.h"
 #include "AudioCodecs/AudioCodecs.h"
+#include "AudioTools/JitterBuffer.h"
+#include "AudioTools/RTP.h"
+#include "AudioTools/AudioSync.h"
 #include "AudioEffects/SoundGenerator.h"
 #include "AudioEffects/AudioEffects.h"
 #include "AudioEffects/PitchShift.h"
@@ -91,6 +98,14 @@
 #  include "AudioTools/AudioSPDIF.h"
 #endif
 
+#if defined(USE_STD_CONCURRENCY) || defined(ESP32)
+#  include "AudioTools/AudioPipeline.h"
+#endif
+
+#if defined(USE_STD_CONCURRENCY)
+#  include "AudioTools/BatchTranscoder.h"
+#endif
+
 
 /**
  * ------------------------------------------------------------------------- 
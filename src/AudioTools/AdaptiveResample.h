@@ -0,0 +1,326 @@
+#pragma once
+
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/SynchronizedBuffers.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Default size of the buffer in frames
+#ifndef ADAPTIVE_RESAMPLE_BUFFER_FRAMES
+#define ADAPTIVE_RESAMPLE_BUFFER_FRAMES 4096
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief PI controller with anti windup: the output is limited to +/- limit
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PIController {
+  public:
+    PIController() = default;
+
+    void begin(float kp, float ki, float limit) {
+        this->kp = kp;
+        this->ki = ki;
+        this->limit = limit;
+        reset();
+    }
+
+    void reset() { integral = 0.0f; }
+
+    /// Updates the controller with the error and the elapsed time in seconds
+    float update(float error, float dt) {
+        integral += error * dt;
+        // anti windup: the integral alone must not exceed the limit
+        if (ki > 0.0f) {
+            float max_integral = limit / ki;
+            if (integral > max_integral) integral = max_integral;
+            if (integral < -max_integral) integral = -max_integral;
+        }
+        float result = kp * error + ki * integral;
+        if (result > limit) result = limit;
+        if (result < -limit) result = -limit;
+        return result;
+    }
+
+  protected:
+    float kp = 0.0f;
+    float ki = 0.0f;
+    float limit = 0.0f;
+    float integral = 0.0f;
+};
+
+/**
+ * @brief Config for AdaptiveResampleStream
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct AdaptiveResampleConfig : public AudioBaseInfo {
+    AdaptiveResampleConfig() {
+        sample_rate = 44100;
+        bits_per_sample = 16;
+        channels = 2;
+    }
+    /// Optional target sample rate: by default we output the input sample rate
+    int to_sample_rate = 0;
+    /// Size of the buffer in frames
+    int buffer_frames = ADAPTIVE_RESAMPLE_BUFFER_FRAMES;
+    /// Fill level of the buffer which we try to keep (in percent of the buffer size)
+    int target_fill_percent = 50;
+    /// Response time of the control loop in seconds
+    float control_time_s = 30.0f;
+    /// Max correction of the ratio in ppm
+    float max_correction_ppm = 1000.0f;
+    /// Max change of the ratio per frame in ppm, so that there are no audible jumps
+    float max_slew_ppm = 0.01f;
+};
+
+/**
+ * @brief Compensates the clock drift between a source and an output with independent
+ * clocks (e.g. UDPStream -> I2SStream): The source writes the data into a buffer and the
+ * output reads the data with readBytes(). The fill level of the buffer is monitored and a PI
+ * controller adjusts the resampling ratio, so that the fill level and therefore the latency
+ * stays constant. The ratio changes are smoothed and the samples are calculated with a
+ * cubic (Hermite) interpolation. The writing and reading can be done in different tasks
+ * on the ESP32 or if USE_STD_CONCURRENCY is defined: on all other platforms the Mutex does
+ * nothing, so both must be called from the same task.
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T sample type
+ */
+template <typename T>
+class AdaptiveResampleStream : public AudioStream {
+  public:
+    AdaptiveResampleStream() = default;
+
+    /// The resampled data is written to the output, limited by its availableForWrite()
+    AdaptiveResampleStream(Print &out) { setOutput(out); }
+
+    void setOutput(Print &out) { p_out = &out; }
+
+    AdaptiveResampleConfig defaultConfig() {
+        AdaptiveResampleConfig c;
+        return c;
+    }
+
+    bool begin() override { return begin(cfg); }
+
+    bool begin(AdaptiveResampleConfig config) {
+        TRACEI();
+        LockGuard guard(mutex);
+        cfg = config;
+        info = cfg;
+        if (cfg.channels <= 0 || cfg.sample_rate <= 0) {
+            LOGE("invalid audio info");
+            return false;
+        }
+        channels = cfg.channels;
+        buffer.resize(cfg.buffer_frames * channels);
+        memset(buffer.data(), 0, buffer.size() * sizeof(T));
+        // we keep one frame of history for the interpolation
+        read_frame = 1;
+        write_frame = 1;
+        frac = 0.0f;
+        target_fill = (float)cfg.buffer_frames * cfg.target_fill_percent / 100;
+        filtered_fill = target_fill;
+        nominal_step = cfg.to_sample_rate > 0 ? (float)cfg.sample_rate / cfg.to_sample_rate : 1.0f;
+        step = nominal_step;
+        correction = 0.0f;
+        applied = 0.0f;
+        out_rate = cfg.to_sample_rate > 0 ? cfg.to_sample_rate : cfg.sample_rate;
+        // the relative fill level changes with sample_rate / target_fill per second and unit
+        // of the correction: we use a damping of 0.5 because the fill level is quantized by
+        // the written blocks, so that a stronger proportional part would just hunt
+        float gain = (float)cfg.sample_rate / target_fill;
+        float omega = 1.0f / cfg.control_time_s;
+        controller.begin(omega / gain, omega * omega / gain,
+                         cfg.max_correction_ppm / 1000000.0f);
+        is_started = false;
+        overruns = 0;
+        underruns = 0;
+        is_active = true;
+        return true;
+    }
+
+    void end() override { is_active = false; }
+
+    /// Adds the data to the buffer: provide full frames only
+    size_t write(const uint8_t *data, size_t len) override {
+        if (!is_active) return 0;
+        size_t result = 0;
+        {
+            LockGuard guard(mutex);
+            int frames = len / sizeof(T) / channels;
+            int free = freeFrames();
+            if (frames > free) {
+                compact();
+                free = freeFrames();
+            }
+            if (frames > free) {
+                LOGW("buffer overrun: %d frames lost", frames - free);
+                overruns++;
+                frames = free;
+            }
+            memcpy(buffer.data() + write_frame * channels, data, frames * channels * sizeof(T));
+            write_frame += frames;
+            result = frames * channels * sizeof(T);
+        }
+        // push the data to the output
+        if (p_out != nullptr) {
+            int len = p_out->availableForWrite();
+            if (len > 0) {
+                out_buffer.resize(len);
+                size_t n = readBytes(out_buffer.data(), len);
+                if (n > 0) p_out->write(out_buffer.data(), n);
+            }
+        }
+        return result;
+    }
+
+    /// Provides the resampled data
+    size_t readBytes(uint8_t *data, size_t len) override {
+        if (!is_active) return 0;
+        LockGuard guard(mutex);
+        int frames = len / sizeof(T) / channels;
+        if (!is_started) {
+            // wait until we have reached the target fill level
+            if (fill() < target_fill) return 0;
+            is_started = true;
+        }
+        // smooth ratio change: we limit the change of the correction per frame
+        float max_change = cfg.max_slew_ppm / 1000000.0f * frames;
+        if (applied < correction) {
+            applied = applied + max_change > correction ? correction : applied + max_change;
+        } else if (applied > correction) {
+            applied = applied - max_change < correction ? correction : applied - max_change;
+        }
+        step = nominal_step * (1.0f + applied);
+        T *p_result = (T *)data;
+        int result = 0;
+        while (result < frames) {
+            // we need 2 frames after the actual position for the interpolation
+            if (read_frame + 2 >= write_frame) {
+                LOGW("buffer underrun");
+                underruns++;
+                is_started = false;
+                break;
+            }
+            const T *p0 = buffer.data() + (read_frame - 1) * channels;
+            for (int ch = 0; ch < channels; ch++) {
+                *p_result++ = interpolate(p0[ch], p0[ch + channels], p0[ch + 2 * channels],
+                                          p0[ch + 3 * channels], frac);
+            }
+            result++;
+            frac += step;
+            int advance = frac;
+            read_frame += advance;
+            frac -= advance;
+        }
+        updateControl(result);
+        return result * channels * sizeof(T);
+    }
+
+    int available() override {
+        LockGuard guard(mutex);
+        if (!is_started && fill() < target_fill) return 0;
+        int frames = (fill() - 2) / step;
+        return frames > 0 ? frames * channels * sizeof(T) : 0;
+    }
+
+    int availableForWrite() override {
+        LockGuard guard(mutex);
+        return (buffer.size() / channels - fill() - 1) * channels * sizeof(T);
+    }
+
+    /// Actual resampling ratio (input frames per output frame)
+    float ratio() { return step; }
+
+    /// Actual (smoothed) correction of the ratio in ppm
+    float correctionPpm() { return applied * 1000000.0f; }
+
+    /// Actual number of frames in the buffer
+    int fillLevel() { return fill(); }
+
+    /// Fill level which we try to keep
+    int targetFillLevel() { return target_fill; }
+
+    int overrunCount() { return overruns; }
+
+    int underrunCount() { return underruns; }
+
+  protected:
+    AdaptiveResampleConfig cfg;
+    Print *p_out = nullptr;
+    Vector<T> buffer{0};
+    Vector<uint8_t> out_buffer{0};
+#if defined(USE_STD_CONCURRENCY) && !defined(ESP32)
+    StdMutex mutex;
+#else
+    Mutex mutex;
+#endif
+    PIController controller;
+    int channels = 2;
+    int read_frame = 1;
+    int write_frame = 1;
+    float frac = 0.0f;
+    float step = 1.0f;
+    float nominal_step = 1.0f;
+    float correction = 0.0f;
+    float applied = 0.0f;
+    float target_fill = 0.0f;
+    float filtered_fill = 0.0f;
+    int out_rate = 44100;
+    bool is_active = false;
+    bool is_started = false;
+    int overruns = 0;
+    int underruns = 0;
+
+    int fill() { return write_frame - read_frame; }
+
+    int freeFrames() { return buffer.size() / channels - write_frame; }
+
+    /// Moves the unread data (with one frame of history) to the beginning of the buffer
+    void compact() {
+        int start = read_frame - 1;
+        if (start <= 0) return;
+        memmove(buffer.data(), buffer.data() + start * channels,
+                (write_frame - start) * channels * sizeof(T));
+        read_frame -= start;
+        write_frame -= start;
+    }
+
+    /// Updates the correction with the filtered fill level
+    void updateControl(int frames) {
+        if (frames == 0) return;
+        float dt = (float)frames / out_rate;
+        // low pass with 1/5 of the control time to remove the jitter of the block sizes
+        float alpha = dt / (cfg.control_time_s / 5.0f);
+        if (alpha > 1.0f) alpha = 1.0f;
+        filtered_fill += alpha * (fill() - filtered_fill);
+        // if the buffer is too full we need to consume faster
+        float error = (filtered_fill - target_fill) / target_fill;
+        correction = controller.update(error, dt);
+    }
+
+    /// 4 point cubic hermite interpolation between y1 and y2
+    T interpolate(float y0, float y1, float y2, float y3, float t) {
+        float c1 = 0.5f * (y2 - y0);
+        float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+        float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+        float result = ((c3 * t + c2) * t + c1) * t + y1;
+        return clip(result);
+    }
+
+    T clip(float value) {
+        float max_value = NumberConverter::maxValueT<T>();
+        if (value > max_value) return max_value;
+        if (value < -max_value) return -max_value;
+        return value;
+    }
+};
+
+}  // namespace audio_tools
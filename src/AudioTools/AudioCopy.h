@@ -6,6 +6,7 @@
 #include "AudioTools/Converter.h"
 #include "AudioTools/AudioLogger.h"
 #include "AudioTools/AudioStreams.h"
+#include "AudioTools/MimeDetector.h"
 
 #define NOT_ENOUGH_MEMORY_MSG "Could not allocate enough memory: %d bytes"
 
@@ -123,8 +124,7 @@ class StreamCopyT {
                 }
 
                 // determine mime
-                notifyMime(buffer.data(), bytes_to_read);
-                is_first = false;
+                notifyMime(buffer.data(), bytes_read);
 
                 // write data
                 result = write(bytes_read, delayCount);
@@ -133,7 +133,7 @@ class StreamCopyT {
                 if (onWrite!=nullptr) onWrite(onWriteObj, &buffer[0], result);
 
                 #ifndef COPY_LOG_OFF
-                LOGI("StreamCopy::copy %u -> %u -> %u bytes - in %u hops", (unsigned int)bytes_to_read,(unsigned int) bytes_read, (unsigned int)result, (unsigned int)delayCount);
+                LOGI_M(COPY, "StreamCopy::copy %u -> %u -> %u bytes - in %u hops", (unsigned int)bytes_to_read,(unsigned int) bytes_read, (unsigned int)result, (unsigned int)delayCount);
                 #endif
 
                 if (result==0){
@@ -267,6 +267,7 @@ class StreamCopyT {
         bool is_first = false;
         bool check_available_for_write = false;
         const char* actual_mime = nullptr;
+        MimeDetector mime_detector;
         int retryLimit = COPY_RETRY_LIMIT;
         int delay_on_no_data = COPY_DELAY_ON_NODATA;
 
@@ -289,7 +290,7 @@ class StreamCopyT {
                 
                 if (retry>1) {
                     delay(5);
-                    LOGI("try write - %d (open %ld bytes) ",retry, open);
+                    LOGI_M(COPY, "try write - %d (open %ld bytes) ",retry, open);
                 }
 
                 CHECK_MEMORY();
@@ -297,18 +298,12 @@ class StreamCopyT {
             return total;
         }
 
-        /// Update the mime type
+        /// Update the mime type: the format is only determined from the first data
         void notifyMime(void* data, size_t len){
-            if (len>4) {
-                const uint8_t *start = (const uint8_t *) data;
-                actual_mime = "audio/basic";
-                if (start[0]==0xFF && start[1]==0xF1){
-                    actual_mime = "audio/aac";
-                } else if (memcmp(start,"ID3",3) || start[0]==0xFF || start[0]==0xFE ){
-                    actual_mime = "audio/mpeg";
-                } else if (memcmp(start,"RIFF",4)){
-                    actual_mime = "audio/vnd.wave";
-                }
+            if (is_first && len>4) {
+                mime_detector.setDefaultMime("audio/basic");
+                actual_mime = mime_detector.detect((const uint8_t *) data, len);
+                is_first = false;
                 if (notifyMimeCallback!=nullptr){
                     notifyMimeCallback(actual_mime);
                 }
@@ -349,8 +344,7 @@ class StreamCopy : public StreamCopyT<uint8_t> {
                 result = from->readBytes((uint8_t*)&buffer[0], bytes_to_read);
 
                 // determine mime
-                notifyMime(buffer.data(), bytes_to_read);
-                is_first = false;
+                notifyMime(buffer.data(), result);
 
                 // callback with unconverted data
                 if (onWrite!=nullptr) onWrite(onWriteObj, buffer.data(), result);
@@ -359,7 +353,7 @@ class StreamCopy : public StreamCopyT<uint8_t> {
                 coverter_ptr->convert((uint8_t*)buffer.data(),  result );
                 write(result, delayCount);
                 #ifndef COPY_LOG_OFF
-                    LOGI("StreamCopy::copy %u bytes - in %u hops", (unsigned int)result,(unsigned int) delayCount);
+                    LOGI_M(COPY, "StreamCopy::copy %u bytes - in %u hops", (unsigned int)result,(unsigned int) delayCount);
                 #endif
             } else {
                 // give the processor some time 
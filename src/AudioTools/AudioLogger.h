@@ -128,6 +128,14 @@ class AudioLogger {
 }
 
 
+#if USE_DEFERRED_LOGGING
+#include "AudioTools/AudioLoggerDeferred.h"
+// Only the format pointer and the arguments are recorded: the output is done by AudioLoggerDeferred::process()
+#define LOG_OUT_PGMEM(level, fmt, ...) { \
+    AudioLoggerDeferred::instance().log(level, __FILE__, __LINE__, fmt, ##__VA_ARGS__); \
+}
+#define LOG_OUT(level, fmt, ...) LOG_OUT_PGMEM(level, fmt, ##__VA_ARGS__)
+#else
 //#define LOG_OUT(level, fmt, ...) {AudioLogger::instance().prefix(__FILE__,__LINE__, level);cont char PROGMEM *fmt_P=F(fmt); snprintf_P(AudioLogger::instance().str(), LOG_PRINTF_BUFFER_SIZE, fmt,  ##__VA_ARGS__); AudioLogger::instance().println();}
 #define LOG_OUT_PGMEM(level, fmt, ...) { \
     AudioLogger::instance().prefix(__FILE__,__LINE__, level); \
@@ -140,12 +148,19 @@ class AudioLogger {
     snprintf(AudioLogger::instance().str(), LOG_PRINTF_BUFFER_SIZE, fmt,  ##__VA_ARGS__); \
     AudioLogger::instance().println();\
 }
+#endif
 
-// Log statments which store the fmt string in Progmem
-#define LOGD(fmt, ...) if (AudioLogger::instance().level()<=AudioLogger::Debug) { LOG_OUT_PGMEM(AudioLogger::Debug, fmt, ##__VA_ARGS__);}
-#define LOGI(fmt, ...) if (AudioLogger::instance().level()<=AudioLogger::Info) { LOG_OUT_PGMEM(AudioLogger::Info, fmt, ##__VA_ARGS__);}
-#define LOGW(fmt, ...) if (AudioLogger::instance().level()<=AudioLogger::Warning) { LOG_OUT_PGMEM(AudioLogger::Warning, fmt, ##__VA_ARGS__);}
-#define LOGE(fmt, ...) if (AudioLogger::instance().level()<=AudioLogger::Error) { LOG_OUT_PGMEM(AudioLogger::Error, fmt, ##__VA_ARGS__);}
+// Log statments which store the fmt string in Progmem: levels below LOG_COMPILE_LEVEL are removed by the compiler
+#define LOGD(fmt, ...) if (LOG_COMPILE_LEVEL<=0 && AudioLogger::instance().level()<=AudioLogger::Debug) { LOG_OUT_PGMEM(AudioLogger::Debug, fmt, ##__VA_ARGS__);}
+#define LOGI(fmt, ...) if (LOG_COMPILE_LEVEL<=1 && AudioLogger::instance().level()<=AudioLogger::Info) { LOG_OUT_PGMEM(AudioLogger::Info, fmt, ##__VA_ARGS__);}
+#define LOGW(fmt, ...) if (LOG_COMPILE_LEVEL<=2 && AudioLogger::instance().level()<=AudioLogger::Warning) { LOG_OUT_PGMEM(AudioLogger::Warning, fmt, ##__VA_ARGS__);}
+#define LOGE(fmt, ...) if (LOG_COMPILE_LEVEL<=3 && AudioLogger::instance().level()<=AudioLogger::Error) { LOG_OUT_PGMEM(AudioLogger::Error, fmt, ##__VA_ARGS__);}
+
+// Log statements with a module specific compile time level: e.g. LOGI_M(COPY, ...) is removed if LOG_LEVEL_COPY > 1
+#define LOGD_M(module, fmt, ...) if (LOG_LEVEL_##module<=0) { LOGD(fmt, ##__VA_ARGS__);}
+#define LOGI_M(module, fmt, ...) if (LOG_LEVEL_##module<=1) { LOGI(fmt, ##__VA_ARGS__);}
+#define LOGW_M(module, fmt, ...) if (LOG_LEVEL_##module<=2) { LOGW(fmt, ##__VA_ARGS__);}
+#define LOGE_M(module, fmt, ...) if (LOG_LEVEL_##module<=3) { LOGE(fmt, ##__VA_ARGS__);}
     
 #else
 
@@ -153,6 +168,10 @@ class AudioLogger {
 #define LOGI(...) 
 #define LOGW(...) 
 #define LOGE(...) 
+#define LOGD_M(...) 
+#define LOGI_M(...) 
+#define LOGW_M(...) 
+#define LOGE_M(...) 
 
 #endif
 
@@ -160,15 +179,15 @@ class AudioLogger {
 #ifdef NO_TRACED
 #  define TRACED()
 #else
-#  define TRACED() if (AudioLogger::instance().level()<=AudioLogger::Debug) { LOG_OUT(AudioLogger::Debug, LOG_METHOD);}
+#  define TRACED() if (LOG_COMPILE_LEVEL<=0 && AudioLogger::instance().level()<=AudioLogger::Debug) { LOG_OUT(AudioLogger::Debug, LOG_METHOD);}
 #endif
 
 #ifdef NO_TRACEI
 #  define TRACEI()
 #else 
-#  define TRACEI() if (AudioLogger::instance().level()<=AudioLogger::Info) { LOG_OUT(AudioLogger::Info, LOG_METHOD);}
+#  define TRACEI() if (LOG_COMPILE_LEVEL<=1 && AudioLogger::instance().level()<=AudioLogger::Info) { LOG_OUT(AudioLogger::Info, LOG_METHOD);}
 #endif
-#define TRACEW() if (AudioLogger::instance().level()<=AudioLogger::Warning) { LOG_OUT(AudioLogger::Warning, LOG_METHOD);}
-#define TRACEE() if (AudioLogger::instance().level()<=AudioLogger::Error) { LOG_OUT(AudioLogger::Error, LOG_METHOD);}
+#define TRACEW() if (LOG_COMPILE_LEVEL<=2 && AudioLogger::instance().level()<=AudioLogger::Warning) { LOG_OUT(AudioLogger::Warning, LOG_METHOD);}
+#define TRACEE() if (LOG_COMPILE_LEVEL<=3 && AudioLogger::instance().level()<=AudioLogger::Error) { LOG_OUT(AudioLogger::Error, LOG_METHOD);}
 
 
@@ -0,0 +1,365 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#ifdef USE_STD_CONCURRENCY
+#  include <thread>
+#  include <chrono>
+#endif
+
+/// Number of log records which can be queued (must be a power of 2)
+#ifndef LOG_DEFERRED_RECORDS
+#define LOG_DEFERRED_RECORDS 32
+#endif
+
+/// Max number of arguments which are recorded per log statement
+#ifndef LOG_DEFERRED_MAX_ARGS
+#define LOG_DEFERRED_MAX_ARGS 6
+#endif
+
+/// Space for the copied string arguments per log statement
+#ifndef LOG_DEFERRED_TEXT_SIZE
+#define LOG_DEFERRED_TEXT_SIZE 32
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Logging backend which keeps the formatting and printing off the audio path:
+ * a log statement only records the format pointer, the file, the line and the raw
+ * arguments into a fixed size lock free queue. The formatting and output is done later
+ * by calling process() e.g. from the loop() or from a background thread (see start()).
+ * String arguments are copied (truncated to LOG_DEFERRED_TEXT_SIZE), so the format
+ * string and the file name must be static. If the queue is full the record is dropped
+ * and counted. Activate it with USE_DEFERRED_LOGGING.
+ * @ingroup tools
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioLoggerDeferred {
+  public:
+    /// provides the singleton instance
+    static AudioLoggerDeferred &instance() {
+        static AudioLoggerDeferred self;
+        return self;
+    }
+
+    /// Records a log statement: this is lock free and does not allocate any memory
+    template <typename... Args>
+    bool log(AudioLogger::LogLevel level, const char* file, int line, const char* fmt, Args... args) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[pos & (LOG_DEFERRED_RECORDS - 1)];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                dropped_count++;
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        Record &rec = slot->record;
+        rec.fmt = fmt;
+        rec.file = file;
+        rec.line = line;
+        rec.level = level;
+        rec.count = 0;
+        rec.text_len = 0;
+        int dummy[] = {0, (addArg(rec, args), 0)...};
+        (void)dummy;
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Formats and prints up to max queued records: call it e.g. in the loop(). Returns the number of printed records
+    int process(int max = LOG_DEFERRED_RECORDS) {
+        int result = 0;
+        Record rec;
+        while (result < max && pop(rec)) {
+            AudioLogger &logger = AudioLogger::instance();
+            logger.prefix(rec.file, rec.line, (AudioLogger::LogLevel)rec.level);
+            format(rec, logger.str(), LOG_PRINTF_BUFFER_SIZE);
+            logger.println();
+            result++;
+        }
+        return result;
+    }
+
+    /// Number of records which were lost because the queue was full
+    size_t dropped() {
+        return dropped_count.load();
+    }
+
+    /// Number of queued records
+    size_t available() {
+        return enqueue_pos.load() - dequeue_pos.load();
+    }
+
+#ifdef USE_STD_CONCURRENCY
+    /// Starts a background thread which prints the queued records
+    void start(int delayMs = 10) {
+        if (is_running) return;
+        is_running = true;
+        thread = std::thread([this, delayMs]() {
+            while (is_running) {
+                if (process() == 0) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+            }
+            process();
+        });
+    }
+
+    /// Stops the background thread
+    void stop() {
+        is_running = false;
+        if (thread.joinable()) thread.join();
+    }
+
+    ~AudioLoggerDeferred() { stop(); }
+#endif
+
+  protected:
+    enum ArgType : uint8_t { Signed, Unsigned, Float, Text, Pointer };
+    union Value {
+        long long i;
+        unsigned long long u;
+        double d;
+        const void* p;
+    };
+    struct Record {
+        const char* fmt;
+        const char* file;
+        uint16_t line;
+        uint8_t level;
+        uint8_t count;
+        uint8_t text_len;
+        uint8_t types[LOG_DEFERRED_MAX_ARGS];
+        Value args[LOG_DEFERRED_MAX_ARGS];
+        char text[LOG_DEFERRED_TEXT_SIZE];
+    };
+    struct Slot {
+        std::atomic<size_t> seq{0};
+        Record record;
+    };
+    Slot slots[LOG_DEFERRED_RECORDS];
+    std::atomic<size_t> enqueue_pos{0};
+    std::atomic<size_t> dequeue_pos{0};
+    std::atomic<size_t> dropped_count{0};
+#ifdef USE_STD_CONCURRENCY
+    std::atomic<bool> is_running{false};
+    std::thread thread;
+#endif
+
+    AudioLoggerDeferred() {
+        static_assert((LOG_DEFERRED_RECORDS & (LOG_DEFERRED_RECORDS - 1)) == 0,
+                      "LOG_DEFERRED_RECORDS must be a power of 2");
+        for (size_t j = 0; j < LOG_DEFERRED_RECORDS; j++) slots[j].seq.store(j);
+    }
+
+    /// Removes the oldest record from the queue
+    bool pop(Record &rec) {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots[pos & (LOG_DEFERRED_RECORDS - 1)];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        rec = slot->record;
+        slot->seq.store(pos + LOG_DEFERRED_RECORDS, std::memory_order_release);
+        return true;
+    }
+
+    Value* nextArg(Record &rec, ArgType type) {
+        if (rec.count >= LOG_DEFERRED_MAX_ARGS) return nullptr;
+        rec.types[rec.count] = type;
+        return &rec.args[rec.count++];
+    }
+
+    void addSigned(Record &rec, long long v) {
+        Value* p_value = nextArg(rec, Signed);
+        if (p_value != nullptr) p_value->i = v;
+    }
+
+    void addUnsigned(Record &rec, unsigned long long v) {
+        Value* p_value = nextArg(rec, Unsigned);
+        if (p_value != nullptr) p_value->u = v;
+    }
+
+    void addArg(Record &rec, bool v) { addSigned(rec, v); }
+    void addArg(Record &rec, char v) { addSigned(rec, v); }
+    void addArg(Record &rec, signed char v) { addSigned(rec, v); }
+    void addArg(Record &rec, short v) { addSigned(rec, v); }
+    void addArg(Record &rec, int v) { addSigned(rec, v); }
+    void addArg(Record &rec, long v) { addSigned(rec, v); }
+    void addArg(Record &rec, long long v) { addSigned(rec, v); }
+    void addArg(Record &rec, unsigned char v) { addUnsigned(rec, v); }
+    void addArg(Record &rec, unsigned short v) { addUnsigned(rec, v); }
+    void addArg(Record &rec, unsigned int v) { addUnsigned(rec, v); }
+    void addArg(Record &rec, unsigned long v) { addUnsigned(rec, v); }
+    void addArg(Record &rec, unsigned long long v) { addUnsigned(rec, v); }
+
+    void addArg(Record &rec, double v) {
+        Value* p_value = nextArg(rec, Float);
+        if (p_value != nullptr) p_value->d = v;
+    }
+
+    void addArg(Record &rec, float v) { addArg(rec, (double)v); }
+
+    /// Strings are copied because they might not be valid any more when we print
+    void addArg(Record &rec, const char* str) {
+        Value* p_value = nextArg(rec, Text);
+        if (p_value == nullptr) return;
+        p_value->u = rec.text_len;
+        if (str == nullptr) str = "(null)";
+        size_t avail = LOG_DEFERRED_TEXT_SIZE - rec.text_len;
+        if (avail == 0) {
+            // no space left: we point to the terminating 0 of the last string
+            p_value->u = LOG_DEFERRED_TEXT_SIZE - 1;
+            return;
+        }
+        size_t len = strlen(str);
+        if (len > avail - 1) len = avail - 1;
+        memcpy(rec.text + rec.text_len, str, len);
+        rec.text[rec.text_len + len] = 0;
+        rec.text_len += len + 1;
+    }
+
+    void addArg(Record &rec, char* str) { addArg(rec, (const char*)str); }
+
+    template <typename T>
+    void addArg(Record &rec, T* ptr) {
+        Value* p_value = nextArg(rec, Pointer);
+        if (p_value != nullptr) p_value->p = (const void*)ptr;
+    }
+
+    long long asSigned(const Record &rec, int idx) {
+        if (idx >= rec.count) return 0;
+        switch (rec.types[idx]) {
+            case Float: return (long long)rec.args[idx].d;
+            case Pointer: return (long long)(intptr_t)rec.args[idx].p;
+            default: return rec.args[idx].i;
+        }
+    }
+
+    double asDouble(const Record &rec, int idx) {
+        if (idx >= rec.count) return 0;
+        switch (rec.types[idx]) {
+            case Float: return rec.args[idx].d;
+            case Unsigned: return (double)rec.args[idx].u;
+            case Signed: return (double)rec.args[idx].i;
+            default: return 0;
+        }
+    }
+
+    const char* asText(const Record &rec, int idx) {
+        if (idx >= rec.count || rec.types[idx] != Text) return "?";
+        return rec.text + rec.args[idx].u;
+    }
+
+    /// Formats the record: each conversion is printed individually with snprintf
+    /// using the widest type of its kind
+    void format(const Record &rec, char* out, int len) {
+        const char* fmt = rec.fmt;
+        int pos = 0;
+        int arg = 0;
+        out[0] = 0;
+        while (*fmt != 0 && pos < len - 1) {
+            if (*fmt != '%') {
+                out[pos++] = *fmt++;
+                continue;
+            }
+            if (fmt[1] == '%') {
+                out[pos++] = '%';
+                fmt += 2;
+                continue;
+            }
+            // collect flags, width and precision
+            char spec[24];
+            int spec_len = 0;
+            spec[spec_len++] = *fmt++;
+            while (*fmt != 0 && strchr("-+ #0123456789.*", *fmt) != nullptr && spec_len < 16) {
+                if (*fmt == '*') {
+                    spec_len += snprintf(spec + spec_len, 16 - spec_len, "%d", (int)asSigned(rec, arg++));
+                    if (spec_len > 15) spec_len = 15;
+                } else {
+                    spec[spec_len++] = *fmt;
+                }
+                fmt++;
+            }
+            // the length modifiers are replaced by the recorded type
+            while (*fmt != 0 && strchr("hlLqjzt", *fmt) != nullptr) fmt++;
+            char conv = *fmt;
+            if (conv == 0) break;
+            fmt++;
+            int n = 0;
+            int avail = len - pos;
+            switch (conv) {
+                case 'd':
+                case 'i':
+                    strcpy(spec + spec_len, "lld");
+                    n = snprintf(out + pos, avail, spec, asSigned(rec, arg++));
+                    break;
+                case 'u':
+                case 'x':
+                case 'X':
+                case 'o':
+                    spec[spec_len++] = 'l';
+                    spec[spec_len++] = 'l';
+                    spec[spec_len++] = conv;
+                    spec[spec_len] = 0;
+                    n = snprintf(out + pos, avail, spec, (unsigned long long)asSigned(rec, arg++));
+                    break;
+                case 'c':
+                    spec[spec_len++] = conv;
+                    spec[spec_len] = 0;
+                    n = snprintf(out + pos, avail, spec, (int)asSigned(rec, arg++));
+                    break;
+                case 'f':
+                case 'F':
+                case 'e':
+                case 'E':
+                case 'g':
+                case 'G':
+                case 'a':
+                case 'A':
+                    spec[spec_len++] = conv;
+                    spec[spec_len] = 0;
+                    n = snprintf(out + pos, avail, spec, asDouble(rec, arg++));
+                    break;
+                case 's':
+                    spec[spec_len++] = conv;
+                    spec[spec_len] = 0;
+                    n = snprintf(out + pos, avail, spec, asText(rec, arg++));
+                    break;
+                case 'p':
+                    n = snprintf(out + pos, avail, "%p", arg < rec.count ? rec.args[arg].p : nullptr);
+                    arg++;
+                    break;
+                default:
+                    // unsupported conversion: we print it as is
+                    spec[spec_len++] = conv;
+                    spec[spec_len] = 0;
+                    n = snprintf(out + pos, avail, "%s", spec);
+                    break;
+            }
+            if (n < 0) break;
+            pos += n < avail ? n : avail - 1;
+        }
+        out[pos] = 0;
+    }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,476 @@
+#pragma once
+
+#include <atomic>
+#include "AudioConfig.h"
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/AudioPrint.h"
+#include "AudioTools/BufferSPSC.h"
+#include "AudioBasic/Collections/Vector.h"
+#ifdef USE_STD_CONCURRENCY
+#  include <thread>
+#  include <chrono>
+#endif
+
+/// Default size of the ring buffer of a cut in bytes
+#ifndef PIPELINE_BUFFER_SIZE
+#define PIPELINE_BUFFER_SIZE (4 * DEFAULT_BUFFER_SIZE)
+#endif
+
+/// Max number of bytes which are moved in one step
+#ifndef PIPELINE_COPY_SIZE
+#define PIPELINE_COPY_SIZE DEFAULT_BUFFER_SIZE
+#endif
+
+/// Max number of pending audio info changes per cut
+#ifndef PIPELINE_MAX_EVENTS
+#define PIPELINE_MAX_EVENTS 4
+#endif
+
+/// Sleep time in us when a thread has nothing to do
+#ifndef PIPELINE_IDLE_US
+#define PIPELINE_IDLE_US 500
+#endif
+
+/// Max number of cuts of an AudioPipeline
+#ifndef PIPELINE_MAX_CUTS
+#define PIPELINE_MAX_CUTS 8
+#endif
+
+#ifndef PIPELINE_STACK_SIZE
+#define PIPELINE_STACK_SIZE 8192
+#endif
+
+#ifndef PIPELINE_PRIORITY
+#define PIPELINE_PRIORITY 2
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Runs a function in a separate thread: we use a std::thread if USE_STD_CONCURRENCY
+ * is defined, otherwise a FreeRTOS task on the ESP32.
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PipelineThread {
+  public:
+    ~PipelineThread() { join(); }
+
+    /// Starts the thread which executes fn(arg)
+    bool start(void (*fn)(void *), void *arg, const char *name = "pipeline") {
+        p_fn = fn;
+        p_arg = arg;
+        is_done = false;
+#ifdef USE_STD_CONCURRENCY
+        thread = std::thread([this]() { run(this); });
+        return true;
+#elif defined(ESP32)
+        return xTaskCreate(run, name, PIPELINE_STACK_SIZE, this, PIPELINE_PRIORITY, &handle) == pdPASS;
+#else
+        LOGE("threads not supported: define USE_STD_CONCURRENCY");
+        is_done = true;
+        return false;
+#endif
+    }
+
+    /// Waits until the function has returned
+    void join() {
+#ifdef USE_STD_CONCURRENCY
+        if (thread.joinable()) thread.join();
+#else
+        while (!is_done) idle();
+#endif
+    }
+
+    bool isDone() { return is_done; }
+
+    /// Gives the other threads some time
+    static void idle() {
+#ifdef USE_STD_CONCURRENCY
+        std::this_thread::sleep_for(std::chrono::microseconds(PIPELINE_IDLE_US));
+#elif defined(ESP32)
+        vTaskDelay(1);
+#else
+        delay(1);
+#endif
+    }
+
+  protected:
+    void (*p_fn)(void *) = nullptr;
+    void *p_arg = nullptr;
+    std::atomic<bool> is_done{true};
+#ifdef USE_STD_CONCURRENCY
+    std::thread thread;
+#elif defined(ESP32)
+    TaskHandle_t handle = nullptr;
+#endif
+
+    static void run(void *ref) {
+        PipelineThread *self = (PipelineThread *)ref;
+        self->p_fn(self->p_arg);
+        self->is_done = true;
+#if !defined(USE_STD_CONCURRENCY) && defined(ESP32)
+        vTaskDelete(nullptr);
+#endif
+    }
+};
+
+/**
+ * @brief Cut point of an AudioPipeline: the upstream stage writes into a lock free
+ * single producer single consumer ring buffer and the worker thread of the downstream segment
+ * writes the data to the next stage. Audio info changes are forwarded in band: they are
+ * applied to the downstream stage when all data which was written before the change has been
+ * passed on. The end of the stream is signaled with setEnd().
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class PipelineHandoff : public AudioPrint {
+  public:
+    PipelineHandoff(Print &out, AudioBaseInfoDependent *notify, int bufferSize) {
+        p_out = &out;
+        p_notify = notify;
+        buffer.resize(bufferSize);
+        copy_buffer.resize(PIPELINE_COPY_SIZE);
+    }
+
+    /// Producer: adds the data; if blocking we wait until everything has been added
+    size_t write(const uint8_t *data, size_t len) override {
+        size_t result = 0;
+        while (result < len) {
+            result += buffer.writeArray(data + result, len - result);
+            if (result == len || !is_blocking) break;
+            overflows++;
+            PipelineThread::idle();
+        }
+        written += result;
+        return result;
+    }
+
+    int availableForWrite() override { return buffer.availableForWrite(); }
+
+    /// Producer: the change will be applied to the next stage in the sequence of the data
+    void setAudioInfo(AudioBaseInfo info) override {
+        cfg = info;
+        size_t head = event_head.load(std::memory_order_relaxed);
+        while (head - event_tail.load(std::memory_order_acquire) >= PIPELINE_MAX_EVENTS) {
+            if (!is_blocking) {
+                LOGE("too many audio info changes");
+                return;
+            }
+            PipelineThread::idle();
+        }
+        Event &event = events[head % PIPELINE_MAX_EVENTS];
+        event.pos = written;
+        event.info = info;
+        event_head.store(head + 1, std::memory_order_release);
+    }
+
+    /// Producer: no more data will be written
+    void setEnd() { is_end = true; }
+
+    /// Consumer: moves the available data to the next stage: returns the number of bytes
+    size_t process() {
+        size_t result = 0;
+        while (true) {
+            // write the data which was not accepted the last time
+            if (copy_pos < copy_len) {
+                size_t n = p_out->write(copy_buffer.data() + copy_pos, copy_len - copy_pos);
+                copy_pos += n;
+                result += n;
+                if (copy_pos < copy_len) break;
+            }
+            applyEvents();
+            int len = buffer.available();
+            if (len == 0) {
+                if (result == 0) underflows++;
+                break;
+            }
+            if (len > copy_buffer.size()) len = copy_buffer.size();
+            // we must not pass data which was written after a pending audio info change
+            if (hasEvent()) {
+                size_t max = nextEvent().pos - read;
+                if ((size_t)len > max) len = max;
+            }
+            copy_len = buffer.readArray(copy_buffer.data(), len);
+            copy_pos = 0;
+            read += copy_len;
+        }
+        return result;
+    }
+
+    /// Consumer: true if the end was signaled and all data has been passed on
+    bool isEnd() {
+        return is_end && buffer.available() == 0 && copy_pos >= copy_len && !hasEvent();
+    }
+
+    /// Defines if write() waits for free space
+    void setBlocking(bool flag) { is_blocking = flag; }
+
+    void reset() {
+        buffer.reset();
+        event_head = 0;
+        event_tail = 0;
+        copy_pos = copy_len = 0;
+        written = read = 0;
+        overflows = underflows = 0;
+        is_end = false;
+    }
+
+    Print &output() { return *p_out; }
+
+    /// Number of bytes in the ring buffer
+    int available() { return buffer.available(); }
+
+    /// Number of times the producer had to wait
+    uint32_t overflowCount() { return overflows; }
+
+    /// Number of times the consumer did not find any data
+    uint32_t underflowCount() { return underflows; }
+
+  protected:
+    struct Event {
+        size_t pos = 0;
+        AudioBaseInfo info;
+    };
+    Print *p_out = nullptr;
+    AudioBaseInfoDependent *p_notify = nullptr;
+    RingBufferSPSC<uint8_t> buffer;
+    Vector<uint8_t> copy_buffer{0};
+    size_t copy_pos = 0;
+    size_t copy_len = 0;
+    Event events[PIPELINE_MAX_EVENTS];
+    std::atomic<size_t> event_head{0};
+    std::atomic<size_t> event_tail{0};
+    // bytes written by the producer and read by the consumer
+    size_t written = 0;
+    size_t read = 0;
+    std::atomic<bool> is_end{false};
+    std::atomic<bool> is_blocking{true};
+    uint32_t overflows = 0;
+    uint32_t underflows = 0;
+
+    bool hasEvent() {
+        return event_tail.load(std::memory_order_relaxed) != event_head.load(std::memory_order_acquire);
+    }
+
+    Event &nextEvent() { return events[event_tail.load(std::memory_order_relaxed) % PIPELINE_MAX_EVENTS]; }
+
+    void applyEvents() {
+        while (hasEvent() && nextEvent().pos == read) {
+            if (p_notify != nullptr) p_notify->setAudioInfo(nextEvent().info);
+            event_tail.store(event_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+    }
+};
+
+/**
+ * @brief Runs the stages of a processing chain in separate threads, so that e.g. the
+ * decoding and the output can use different cores: The chain is cut at the points which are
+ * defined with addCut(). The upstream stage writes into the Print which is returned by
+ * addCut() and a worker thread passes the data on to the downstream stage. A separate thread
+ * copies the data from the source to the first stage. Audio info changes are forwarded to the
+ * stage after the cut and the end of the stream is propagated: each segment flushes its stages
+ * before the next segment is notified. We use std::thread if USE_STD_CONCURRENCY is defined,
+ * otherwise FreeRTOS tasks on the ESP32.
+ *
+ * Example: URLStream -> decoder -> (cut) -> VolumeStream -> I2SStream
+ * @code
+ * AudioPipeline pipeline;
+ * Print &cut = pipeline.addCut(volume);
+ * EncodedAudioStream decoder(&cut, new MP3DecoderHelix());
+ * pipeline.setSource(url, decoder);
+ * pipeline.begin();
+ * @endcode
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioPipeline {
+  public:
+    AudioPipeline() = default;
+
+    ~AudioPipeline() {
+        end();
+        for (int j = 0; j < cuts.size(); j++) {
+            delete cuts[j];
+            delete threads[j];
+        }
+    }
+
+    /// Defines the source: the data is copied by a separate thread to the first stage
+    void setSource(Stream &source, Print &firstStage) {
+        p_source = &source;
+        p_first = &firstStage;
+    }
+
+    /// Defines the source: audio info changes of the source are forwarded to the first stage
+    void setSource(AudioStream &source, AudioPrint &firstStage) {
+        setSource((Stream &)source, (Print &)firstStage);
+        source.setNotifyAudioChange(firstStage);
+    }
+
+    /// Defines the source: audio info changes of the source are forwarded to the first stage
+    void setSource(AudioStream &source, AudioStream &firstStage) {
+        setSource((Stream &)source, (Print &)firstStage);
+        source.setNotifyAudioChange(firstStage);
+    }
+
+    /// Adds a cut in front of the indicated stage: the upstream stage must write to the result
+    Print &addCut(AudioPrint &downstream, int bufferSize = PIPELINE_BUFFER_SIZE) {
+        return createCut(downstream, &downstream, bufferSize);
+    }
+
+    /// Adds a cut in front of the indicated stage: the upstream stage must write to the result
+    Print &addCut(AudioStream &downstream, int bufferSize = PIPELINE_BUFFER_SIZE) {
+        return createCut(downstream, &downstream, bufferSize);
+    }
+
+    /// Adds a cut in front of a stage which does not support audio info changes
+    Print &addCut(Print &downstream, int bufferSize = PIPELINE_BUFFER_SIZE) {
+        return createCut(downstream, nullptr, bufferSize);
+    }
+
+    /// Provides the handoff of the indicated cut (e.g. for the statistics)
+    PipelineHandoff &cut(int idx) { return *cuts[idx]; }
+
+    int cutCount() { return cuts.size(); }
+
+    /// The end of stream is assumed if the source did not provide any data for the indicated time (0 = never)
+    void setEndOfStreamTimeout(uint32_t ms) { eos_timeout_ms = ms; }
+
+    /// Starts one thread for the source and one for each cut
+    bool begin() {
+        TRACEI();
+        if (is_running) return true;
+        if (cuts.size() == 0 && p_source == nullptr) {
+            LOGE("nothing to run");
+            return false;
+        }
+        copy_buffer.resize(PIPELINE_COPY_SIZE);
+        for (int j = 0; j < cuts.size(); j++) {
+            cuts[j]->reset();
+            cuts[j]->setBlocking(true);
+        }
+        is_running = true;
+        bool result = true;
+        if (p_source != nullptr) {
+            result = source_thread.start(runSource, this, "pipeline-source");
+        }
+        for (int j = 0; j < cuts.size() && result; j++) {
+            thread_args[j].self = this;
+            thread_args[j].idx = j;
+            result = threads[j]->start(runCut, &thread_args[j], "pipeline-cut");
+        }
+        if (!result) {
+            LOGE("could not start threads");
+            end();
+        }
+        return result;
+    }
+
+    /// Stops all threads immediately
+    void end() {
+        is_running = false;
+        // release the producers which are waiting for free space
+        for (int j = 0; j < cuts.size(); j++) cuts[j]->setBlocking(false);
+        source_thread.join();
+        for (int j = 0; j < threads.size(); j++) threads[j]->join();
+    }
+
+    /// Signals the end of the stream if the data is written by the application into the first cut
+    void setEnd() {
+        if (cuts.size() > 0) cuts[0]->setEnd();
+    }
+
+    /// Returns false when the stream has been processed completely or after end()
+    bool isActive() {
+        if (!is_running) return false;
+        if (p_source != nullptr && !source_thread.isDone()) return true;
+        for (int j = 0; j < threads.size(); j++) {
+            if (!threads[j]->isDone()) return true;
+        }
+        return false;
+    }
+
+  protected:
+    struct ThreadArg {
+        AudioPipeline *self = nullptr;
+        int idx = 0;
+    };
+    Stream *p_source = nullptr;
+    Print *p_first = nullptr;
+    Vector<PipelineHandoff *> cuts{0};
+    Vector<PipelineThread *> threads{0};
+    ThreadArg thread_args[PIPELINE_MAX_CUTS];
+    PipelineThread source_thread;
+    Vector<uint8_t> copy_buffer{0};
+    std::atomic<bool> is_running{false};
+    uint32_t eos_timeout_ms = 0;
+
+    Print &createCut(Print &downstream, AudioBaseInfoDependent *notify, int bufferSize) {
+        if (is_running) {
+            LOGE("pipeline is running");
+        }
+        if (cuts.size() >= PIPELINE_MAX_CUTS) {
+            LOGE("max %d cuts", PIPELINE_MAX_CUTS);
+            return *cuts[cuts.size() - 1];
+        }
+        PipelineHandoff *p_cut = new PipelineHandoff(downstream, notify, bufferSize);
+        cuts.push_back(p_cut);
+        threads.push_back(new PipelineThread());
+        return *p_cut;
+    }
+
+    /// Copies the data from the source to the first stage
+    static void runSource(void *ref) {
+        AudioPipeline *self = (AudioPipeline *)ref;
+        uint32_t last_data = millis();
+        while (self->is_running) {
+            int len = self->p_source->available();
+            if (len > self->copy_buffer.size()) len = self->copy_buffer.size();
+            size_t n = len > 0 ? self->p_source->readBytes(self->copy_buffer.data(), len) : 0;
+            if (n > 0) {
+                self->writeAll(*self->p_first, self->copy_buffer.data(), n);
+                last_data = millis();
+                continue;
+            }
+            if (self->eos_timeout_ms > 0 && millis() - last_data >= self->eos_timeout_ms) {
+                LOGI("end of stream");
+                self->p_first->flush();
+                self->setEnd();
+                break;
+            }
+            PipelineThread::idle();
+        }
+    }
+
+    /// Passes the data of a cut on to the next stage
+    static void runCut(void *ref) {
+        ThreadArg *arg = (ThreadArg *)ref;
+        AudioPipeline *self = arg->self;
+        PipelineHandoff *p_cut = self->cuts[arg->idx];
+        while (self->is_running) {
+            size_t n = p_cut->process();
+            if (p_cut->isEnd()) {
+                // propagate the end of the stream
+                p_cut->output().flush();
+                if (arg->idx + 1 < self->cuts.size()) self->cuts[arg->idx + 1]->setEnd();
+                break;
+            }
+            if (n == 0) PipelineThread::idle();
+        }
+    }
+
+    void writeAll(Print &out, const uint8_t *data, size_t len) {
+        size_t result = 0;
+        while (result < len && is_running) {
+            size_t n = out.write(data + result, len - result);
+            result += n;
+            if (n == 0) PipelineThread::idle();
+        }
+    }
+};
+
+}  // namespace audio_tools
@@ -153,6 +153,8 @@ namespace audio_tools {
                     if (meta_active) {
                         copier.setCallbackOnWrite(decodeMetaData, this);
                     }
+                    p_decoder->setInputSize(p_source->streamSize());
+                    meta_out.setInputSize(p_source->streamSize());
                     copier.begin(*p_out_decoding, *p_input_stream);
                     timeout = millis() + p_source->timeoutAutoNext();
                     active = isActive;
@@ -287,11 +289,49 @@ namespace audio_tools {
             if (p_input_stream != nullptr) {
                 LOGD("open selected stream");
                 meta_out.begin();
+                p_decoder->setInputSize(p_source->streamSize());
+                meta_out.setInputSize(p_source->streamSize());
                 copier.begin(*p_out_decoding, *p_input_stream);
             }
             return p_input_stream != nullptr;
         }
 
+        /// Moves to the indicated time (in ms) in the actual stream: this is only supported if the source 
+        /// supports setStreamPosition() (e.g. files) and the decoder can determine the position 
+        virtual bool seek(uint32_t timeMs) {
+            TRACED();
+            if (p_input_stream == nullptr || p_decoder == nullptr) return false;
+            if (!p_source->isSeekSupported()) {
+                LOGW("seek not supported by source");
+                return false;
+            }
+            long pos = p_decoder->seekPosition(timeMs);
+            if (pos < 0) {
+                LOGW("seek not supported by decoder");
+                return false;
+            }
+            // we change the state only if the source could move to the new position
+            if (!p_source->setStreamPosition(pos)) {
+                LOGW("seek failed: %ld", pos);
+                return false;
+            }
+            p_decoder->setSeekPosition(pos, timeMs);
+            // avoid a hard cut to the new position
+            writeEnd();
+            timeout = millis() + p_source->timeoutAutoNext();
+            return true;
+        }
+
+        /// Provides the actual playing position in ms: 0 if not supported by the decoder
+        virtual uint32_t position() {
+            return p_decoder == nullptr ? 0 : p_decoder->positionMs();
+        }
+
+        /// Provides the duration of the actual stream in ms: 0 if not known
+        virtual uint32_t duration() {
+            return p_decoder == nullptr ? 0 : p_decoder->durationMs();
+        }
+
         /// Provides the actual stream (=e.g.file)
         virtual Stream* getStream(){
             return p_input_stream;
@@ -482,13 +482,13 @@ class OutputMixer : public Print {
 
     /// Write the data for an individual stream idx which will be mixed together 
     size_t write(int idx, const uint8_t *buffer_c, size_t bytes)  {
-        LOGD("write idx %d: %d",stream_idx, bytes);
+        LOGD_M(MIXER, "write idx %d: %d", idx, (int)bytes);
         size_t result = 0;
         RingBuffer<T>* p_buffer = idx<output_count ? buffers[idx] : nullptr;
         assert(p_buffer!=nullptr);
         size_t samples = bytes/sizeof(T);
         if (p_buffer->availableForWrite()<samples){
-            LOGW("Available Buffer too small %d: requested: %d -> increase the buffer size", p_buffer->availableForWrite(),  samples);
+            LOGW_M(MIXER, "Available Buffer too small %d: requested: %d -> increase the buffer size", p_buffer->availableForWrite(), (int)samples);
         } else {
             result = p_buffer->writeArray((T*)buffer_c, samples) * sizeof(T);
         }
@@ -507,7 +507,7 @@ class OutputMixer : public Print {
 
     /// Force output to final destination
     void flushMixer() {
-        LOGD("flush");
+        LOGD_M(MIXER, "flush");
         bool result = false;
 
         // determine ringbuffer with mininum available data
@@ -530,7 +530,7 @@ class OutputMixer : public Print {
             }
 
             // write output
-            LOGD("write to final out: %d", samples*sizeof(T));
+            LOGD_M(MIXER, "write to final out: %d", (int)(samples*sizeof(T)));
             p_final_output->write((uint8_t*)output.data(), samples*sizeof(T));
         }
         stream_idx = 0;
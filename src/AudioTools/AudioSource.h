@@ -57,6 +57,15 @@ public:
     /// Returns default setting go to the next
     virtual bool isAutoNext() {return true; }
 
+    /// Returns true if the actual stream supports setStreamPosition()
+    virtual bool isSeekSupported() { return false; }
+
+    /// Moves the actual stream to the indicated byte position: only supported by file based sources
+    virtual bool setStreamPosition(size_t pos) { return false; }
+
+    /// Provides the size of the actual stream in bytes: 0 if not known
+    virtual size_t streamSize() { return 0; }
+
 
 protected:
     int timeout_auto_next_value = 500;
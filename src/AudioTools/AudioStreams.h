@@ -221,13 +221,11 @@ class MemoryStream : public AudioStream {
   }
 
   virtual size_t write(const uint8_t *buffer, size_t size) override {
-    size_t result = 0;
-    for (size_t j = 0; j < size; j++) {
-      if (!write(buffer[j])) {
-        break;
-      }
-      result = j;
-    }
+    if (this->buffer==nullptr) return 0;
+    size_t result = availableForWrite();
+    if (size < result) result = size;
+    memcpy(this->buffer + write_pos, buffer, result);
+    write_pos += result;
     return result;
   }
 
@@ -259,15 +257,31 @@ class MemoryStream : public AudioStream {
 
   virtual size_t readBytes(uint8_t *buffer, size_t length) override {
     size_t count = 0;
+    // in loop mode available() rewinds at the end
     while (count < length) {
-      int c = read();
-      if (c < 0) break;
-      *buffer++ = (char)c;
-      count++;
+      int len = available();
+      if (len <= 0) break;
+      if ((size_t)len > length - count) len = length - count;
+      memcpy(buffer + count, this->buffer + read_pos, len);
+      read_pos += len;
+      count += len;
     }
     return count;
   }
 
+  /// Zero copy read: provides a pointer to the next (max len) bytes in the buffer and advances the read position
+  size_t readSpan(const uint8_t* &data, size_t len) {
+    int avail = available();
+    if (avail <= 0) {
+      data = nullptr;
+      return 0;
+    }
+    if ((size_t)avail < len) len = avail;
+    data = buffer + read_pos;
+    read_pos += len;
+    return len;
+  }
+
   virtual int peek() override {
     int result = -1;
     if (available() > 0) {
@@ -320,6 +334,18 @@ class MemoryStream : public AudioStream {
     return buffer;
   }
 
+  /// Provides the number of bytes which have been written
+  size_t size() {
+    return write_pos;
+  }
+
+  /// Sets the read position
+  bool seek(size_t pos) {
+    if ((int)pos > write_pos) return false;
+    read_pos = pos;
+    return true;
+  }
+
   void setRewindCallback(void (*cb)()){
     this->rewind = cb;
   }
@@ -835,13 +861,17 @@ class QueueStream : public AudioStream {
       : AudioStream() {
     callback_buffer_ptr = new NBuffer<T>(bufferSize, bufferCount);
     remove_oldest_data = autoRemoveOldestDataIfFull;
+    owns_buffer = true;
   }
   /// Create stream from any BaseBuffer subclass
   QueueStream(BaseBuffer<T> &buffer){
     callback_buffer_ptr = &buffer;
   }
 
-  virtual ~QueueStream() { delete callback_buffer_ptr; }
+  virtual ~QueueStream() {
+    // we must not delete a buffer which was provided by the caller
+    if (owns_buffer) delete callback_buffer_ptr;
+  }
 
   /// Activates the output
   virtual bool begin() override {
@@ -901,6 +931,7 @@ class QueueStream : public AudioStream {
   BaseBuffer<T> *callback_buffer_ptr;
   bool active;
   bool remove_oldest_data;
+  bool owns_buffer = false;
 
 };
 
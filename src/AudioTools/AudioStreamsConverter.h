@@ -1,11 +1,18 @@
 #pragma once
 #include "AudioTools/AudioStreams.h"
 
+/// Number of frames which are converted at once by the ChannelFormatConverterStream
+#ifndef CHANNEL_CONVERTER_BLOCK_FRAMES
+#define CHANNEL_CONVERTER_BLOCK_FRAMES 64
+#endif
+
 namespace audio_tools {
 
 
 /**
- * @brief Converter for reducing or increasing the number of Channels
+ * @brief Converter for reducing or increasing the number of Channels: The channels are
+ * mixed with a ChannelMatrixConverter (standard presets or a custom gain matrix) in blocks
+ * of CHANNEL_CONVERTER_BLOCK_FRAMES using buffers which are allocated in begin().
  * @ingroup transform
  * @author Phil Schatzmann
  * @copyright GPLv3
@@ -23,52 +30,95 @@ class ChannelFormatConverterStreamT : public AudioStream {
         ChannelFormatConverterStreamT(ChannelFormatConverterStreamT const&) = delete;
         ChannelFormatConverterStreamT& operator=(ChannelFormatConverterStreamT const&) = delete;
 
+        /// Starts the conversion with the standard mixing matrix
         bool begin(int fromChannels, int toChannels){
-          from_channels = fromChannels;
-          to_channels = toChannels;
-          factor = static_cast<float>(toChannels) / static_cast<float>(fromChannels);
+          if (!converter.setPreset(toChannels, fromChannels)) return false;
+          is_custom_matrix = false;
+          return setup();
+        }
 
-          converter.setSourceChannels(from_channels);
-          converter.setTargetChannels(to_channels);
+        /// Starts the conversion with a gain matrix of toChannels rows with fromChannels gains
+        bool begin(const float* matrix, int fromChannels, int toChannels){
+          if (!converter.setMatrix(matrix, toChannels, fromChannels)) return false;
+          is_custom_matrix = true;
+          return setup();
+        }
 
-          return true;
+        /// Provides access to the mixing matrix e.g. to change individual gains
+        ChannelMatrixConverter<T> &matrix() {
+          return converter;
         }
 
         virtual size_t write(const uint8_t *data, size_t size) override { 
-           if (from_channels==to_channels){
+           if (isPassthrough()){
               return p_print->write(data, size);
            }
-           size_t resultBytes = convert(data, size);
-           assert(resultBytes = factor*size);
-           p_print->write((uint8_t*)buffer.data(), resultBytes);
+           size_t in_frame_bytes = from_channels * sizeof(T);
+           size_t pos = 0;
+           if (rest_len>0){
+             // complete the frame of the last write
+             pos = in_frame_bytes - rest_len;
+             if (pos>size) pos = size;
+             memcpy(rest.data()+rest_len, data, pos);
+             rest_len += pos;
+             if (rest_len<in_frame_bytes) return size;
+             size_t result_bytes = converter.convert((uint8_t*)buffer.data(), rest.data(), in_frame_bytes);
+             p_print->write((uint8_t*)buffer.data(), result_bytes);
+             rest_len = 0;
+           }
+           // process in blocks of CHANNEL_CONVERTER_BLOCK_FRAMES
+           size_t frames = (size - pos) / in_frame_bytes;
+           while (frames>0){
+             size_t block = frames < CHANNEL_CONVERTER_BLOCK_FRAMES ? frames : CHANNEL_CONVERTER_BLOCK_FRAMES;
+             size_t result_bytes = converter.convert((uint8_t*)buffer.data(), (uint8_t*)data+pos, block*in_frame_bytes);
+             p_print->write((uint8_t*)buffer.data(), result_bytes);
+             pos += block*in_frame_bytes;
+             frames -= block;
+           }
+           // keep the incomplete frame for the next write
+           rest_len = size - pos;
+           if (rest_len>0) memcpy(rest.data(), data+pos, rest_len);
            return size;
         }
 
         size_t readBytes(uint8_t *data, size_t size) override {
            if (p_stream==nullptr) return 0;
-           if (from_channels==to_channels){
+           if (isPassthrough()){
               return p_stream->readBytes(data, size);
            }
-           size_t in_bytes = 1.0f / factor * size;
-           bufferTmp.resize(in_bytes);
-           p_stream->readBytes(bufferTmp.data(), in_bytes);
-           size_t resultBytes = convert(bufferTmp.data(), in_bytes);
-           assert(size==resultBytes);
-           memcpy(data, (uint8_t*)buffer.data(),  size);
-           return size;
+           size_t in_frame_bytes = from_channels * sizeof(T);
+           size_t out_frame_bytes = to_channels * sizeof(T);
+           size_t frames = size / out_frame_bytes;
+           size_t result = 0;
+           while (frames>0){
+             size_t block = frames < CHANNEL_CONVERTER_BLOCK_FRAMES ? frames : CHANNEL_CONVERTER_BLOCK_FRAMES;
+             size_t read = p_stream->readBytes((uint8_t*)buffer_in.data(), block*in_frame_bytes);
+             size_t read_frames = read / in_frame_bytes;
+             if (read_frames==0) break;
+             result += converter.convert(data+result, (uint8_t*)buffer_in.data(), read_frames*in_frame_bytes);
+             if (read_frames<block) break;
+             frames -= block;
+           }
+           return result;
         }
 
+        /// Changes the number of target channels: a custom matrix is kept
         void setAudioInfo(AudioBaseInfo cfg) override {
           AudioStream::setAudioInfo(cfg);
-          to_channels = cfg.channels;
+          if (cfg.channels==to_channels) return;
+          if (is_custom_matrix){
+            LOGW("channels %d ignored: the custom matrix defines %d", cfg.channels, to_channels);
+            return;
+          }
+          begin(from_channels, cfg.channels);
         }
 
         virtual int available() override {
-          return p_stream!=nullptr ? factor * p_stream->available() : 0;
+          return p_stream!=nullptr ? p_stream->available() / (from_channels*(int)sizeof(T)) * to_channels*(int)sizeof(T) : 0;
         }
 
         virtual int availableForWrite() override { 
-          return 1.0f / factor * p_print->availableForWrite();
+          return p_print->availableForWrite() / (to_channels*(int)sizeof(T)) * from_channels*(int)sizeof(T);
         }
 
   protected:
@@ -76,20 +126,29 @@ class ChannelFormatConverterStreamT : public AudioStream {
     Print *p_print=nullptr;
     int from_channels = 2;
     int to_channels = 2;
-    float factor = 1;
-    Vector<T> buffer;
-    Vector<uint8_t> bufferTmp;
-    ChannelConverter<T> converter;
-
-    size_t convert(const uint8_t *in_data, size_t size){
-        size_t result;
-        size_t result_samples = size/sizeof(T)*factor;
-        buffer.resize(result_samples);
-        result = converter.convert((uint8_t*)buffer.data(),(uint8_t*) in_data, size);
-        if (result!=result_samples*sizeof(T)){
-          LOGE("size %d -> result: %d - expeced: %d", (int) size, (int) result, static_cast<int>(result_samples*sizeof(T)));
-        }
-        return result;
+    Vector<T> buffer{0};
+    Vector<T> buffer_in{0};
+    Vector<uint8_t> rest{0};
+    size_t rest_len = 0;
+    ChannelMatrixConverter<T> converter;
+    bool is_custom_matrix = false;
+
+    /// We can copy the data if the matrix does not change it
+    bool isPassthrough() {
+      return from_channels==to_channels && converter.isIdentity();
+    }
+
+    /// allocates the buffers for one block
+    bool setup(){
+      from_channels = converter.sourceChannels();
+      to_channels = converter.targetChannels();
+      buffer.resize(CHANNEL_CONVERTER_BLOCK_FRAMES * to_channels);
+      rest.resize(from_channels * sizeof(T));
+      rest_len = 0;
+      if (p_stream!=nullptr){
+        buffer_in.resize(CHANNEL_CONVERTER_BLOCK_FRAMES * from_channels);
+      }
+      return true;
     }
 
 };
@@ -144,6 +203,15 @@ class ChannelFormatConverterStream : public AudioStream {
           return setupConverter(fromChannels, toChannels);
         }
 
+        /// Starts the conversion with a gain matrix of toChannels rows with fromChannels gains
+        bool begin(const float* matrix, int fromChannels, int toChannels, int bits_per_sample=16){
+          this->bits_per_sample = bits_per_sample;
+          p_matrix = matrix;
+          bool result = setupConverter(fromChannels, toChannels);
+          p_matrix = nullptr;
+          return result;
+        }
+
         virtual size_t write(const uint8_t *data, size_t size) override { 
             switch(bits_per_sample){
               case 8:
@@ -162,13 +230,13 @@ class ChannelFormatConverterStream : public AudioStream {
         size_t readBytes(uint8_t *data, size_t size) override {
             switch(bits_per_sample){
               case 8:
-                return static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->write(data,size);
+                return static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->readBytes(data,size);
               case 16:
-                return static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->write(data,size);
+                return static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->readBytes(data,size);
               case 24:
-                return static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->write(data,size);
+                return static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->readBytes(data,size);
               case 32:
-                return static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->write(data,size);
+                return static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->readBytes(data,size);
               default:
                 return 0;
             }
@@ -209,26 +277,29 @@ class ChannelFormatConverterStream : public AudioStream {
       Print *p_print=nullptr;
       void *converter;
       int bits_per_sample=0;
+      const float* p_matrix = nullptr;
+
+      template <typename T>
+      bool beginConverter(ChannelFormatConverterStreamT<T> *conv, int fromChannels, int toChannels){
+        converter = conv;
+        return p_matrix!=nullptr ? conv->begin(p_matrix, fromChannels, toChannels) : conv->begin(fromChannels, toChannels);
+      }
 
       bool setupConverter(int fromChannels, int toChannels){
-        bool result;
+        bool result = false;
         if (p_stream!=nullptr){
           switch(bits_per_sample){
             case 8:
-              converter = new ChannelFormatConverterStreamT<int8_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int8_t>(*p_stream), fromChannels, toChannels);
               break;
             case 16:
-              converter = new ChannelFormatConverterStreamT<int16_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int16_t>(*p_stream), fromChannels, toChannels);
               break;
             case 24:
-              converter = new ChannelFormatConverterStreamT<int24_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int24_t>(*p_stream), fromChannels, toChannels);
               break;
             case 32:
-              converter = new ChannelFormatConverterStreamT<int32_t>(*p_stream);
-              static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int32_t>(*p_stream), fromChannels, toChannels);
               break;
             default:
               result = false;
@@ -236,20 +307,16 @@ class ChannelFormatConverterStream : public AudioStream {
         } else {
           switch(bits_per_sample){
             case 8:
-              converter = new ChannelFormatConverterStreamT<int8_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int8_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int8_t>(*p_print), fromChannels, toChannels);
               break;
             case 16:
-              converter = new ChannelFormatConverterStreamT<int16_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int16_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int16_t>(*p_print), fromChannels, toChannels);
               break;
             case 24:
-              converter = new ChannelFormatConverterStreamT<int24_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int24_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int24_t>(*p_print), fromChannels, toChannels);
               break;
             case 32:
-              converter = new ChannelFormatConverterStreamT<int32_t>(*p_print);
-              static_cast<ChannelFormatConverterStreamT<int32_t>*>(converter)->begin(fromChannels,toChannels);
+              result = beginConverter(new ChannelFormatConverterStreamT<int32_t>(*p_print), fromChannels, toChannels);
               break;
             default:
               result = false;
@@ -576,7 +643,7 @@ class FormatConverterStream : public AudioStream {
           }
           bool result = numberFormatConverter.begin(from_cfg.bits_per_sample, to_cfg.bits_per_sample);
           if (result){
-            result =  channelFormatConverter.begin(to_cfg.bits_per_sample, from_cfg.channels, to_cfg.channels);
+            result =  channelFormatConverter.begin(from_cfg.channels, to_cfg.channels, from_cfg.bits_per_sample);
           }
           return result;
         }
@@ -0,0 +1,358 @@
+#pragma once
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/AudioPrint.h"
+#include "AudioCodecs/AudioEncoded.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Number of consecutive reads or writes w/o any progress before we give up
+#ifndef AUDIO_SYNC_MAX_RETRIES
+#define AUDIO_SYNC_MAX_RETRIES 10
+#endif
+
+/// Delay in ms before we retry a write which did not make any progress
+#ifndef AUDIO_SYNC_RETRY_DELAY_MS
+#define AUDIO_SYNC_RETRY_DELAY_MS 10
+#endif
+
+namespace audio_tools {
+enum RecordType : uint8_t { Undefined, Begin, Send, Receive, End };
+enum AudioType : uint8_t { PCM, MP3, AAC, WAV };
+enum TransmitRole : uint8_t { Sender, Receiver };
+
+/// Common Header for all records: len is the size of the record so that unknown records can be skipped
+struct AudioHeader {
+  AudioHeader() = default;
+  uint8_t app = 123;
+  RecordType rec = Undefined;
+  uint16_t seq = 0;
+  uint16_t len = sizeof(AudioHeader);
+  // record counter
+  void increment() {
+    static uint16_t static_count = 0;
+    seq = static_count++;
+  }
+};
+
+/// Protocal Record To Start
+struct AudioDataBegin : public AudioHeader {
+  AudioDataBegin() {
+    rec = Begin;
+    len = sizeof(AudioDataBegin);
+  }
+  AudioBaseInfo info;
+  AudioType type = PCM;
+};
+
+/// Protocol Record for Data
+struct AudioSendData : public AudioHeader {
+  AudioSendData() {
+    rec = Send;
+    len = sizeof(AudioSendData);
+  }
+  uint16_t size = 0;
+};
+
+/// Protocol Record for the credits: total is the cumulative number of bytes the writer is allowed to send
+struct AudioConfirmDataToReceive : public AudioHeader {
+  AudioConfirmDataToReceive() {
+    rec = Receive;
+    len = sizeof(AudioConfirmDataToReceive);
+  }
+  uint16_t size = 0;
+  uint32_t total = 0;
+};
+
+/// Protocol Record for End
+struct AudioDataEnd : public AudioHeader {
+  AudioDataEnd() {
+    rec = End;
+    len = sizeof(AudioDataEnd);
+  }
+};
+
+/// Reads the indicated number of bytes: blocks until all data is available (readBytes() waits with the stream
+/// timeout). Returns false if we did not get any data for AUDIO_SYNC_MAX_RETRIES reads (e.g. the peer was closed)
+inline bool audioSyncReadAll(Stream &in, void *data, size_t len) {
+  uint8_t *p_data = (uint8_t *)data;
+  size_t result = 0;
+  int retries = 0;
+  while (result < len) {
+    size_t n = in.readBytes(p_data + result, len - result);
+    if (n == 0) {
+      if (++retries >= AUDIO_SYNC_MAX_RETRIES) {
+        LOGE("read timeout: %u of %u bytes", (unsigned)result, (unsigned)len);
+        return false;
+      }
+      continue;
+    }
+    retries = 0;
+    result += n;
+  }
+  return true;
+}
+
+/// Writes the indicated number of bytes: short writes are continued. Returns false if
+/// the output did not accept any data for AUDIO_SYNC_MAX_RETRIES writes
+inline bool audioSyncWriteAll(Print &out, const void *data, size_t len) {
+  const uint8_t *p_data = (const uint8_t *)data;
+  size_t result = 0;
+  int retries = 0;
+  while (result < len) {
+    size_t n = out.write(p_data + result, len - result);
+    if (n == 0) {
+      if (++retries >= AUDIO_SYNC_MAX_RETRIES) {
+        LOGE("write timeout: %u of %u bytes", (unsigned)result, (unsigned)len);
+        return false;
+      }
+      delay(AUDIO_SYNC_RETRY_DELAY_MS);
+      continue;
+    }
+    retries = 0;
+    result += n;
+  }
+  return true;
+}
+
+/// Skips the indicated number of bytes
+inline bool audioSyncSkip(Stream &in, size_t len) {
+  uint8_t tmp;
+  for (size_t j = 0; j < len; j++) {
+    if (!audioSyncReadAll(in, &tmp, 1)) return false;
+  }
+  return true;
+}
+
+/// Reads the rest of the record which starts with the indicated header: returns false if the record is too short
+inline bool audioSyncReadRecord(Stream &in, AudioHeader &header, AudioHeader *record, size_t len) {
+  if (header.len < sizeof(AudioHeader)) {
+    // we can not determine the end of the record
+    LOGE("Invalid record length: %d", header.len);
+    return false;
+  }
+  if (header.len < len) {
+    LOGE("Record %d is too short: %d < %d", header.rec, header.len, (int)len);
+    audioSyncSkip(in, header.len - sizeof(AudioHeader));
+    return false;
+  }
+  memcpy(record, &header, sizeof(AudioHeader));
+  if (!audioSyncReadAll(in, (uint8_t *)record + sizeof(AudioHeader), len - sizeof(AudioHeader))) return false;
+  // skip any additional (unknown) data of a newer record version
+  return audioSyncSkip(in, header.len - len);
+}
+
+/**
+ * @brief Audio Writer which is synchronizing the amount of data
+ * that can be processed with the AudioSyncReader using a credit based
+ * sliding window: the reader grants cumulative credits (in bytes) and the
+ * writer sends as long as it has credits, so that multiple chunks are in
+ * flight. We only block when all credits are used up.
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioSyncWriter : public AudioPrint {
+ public:
+  AudioSyncWriter(Stream &dest) { p_dest = &dest; }
+
+  bool begin(AudioBaseInfo &info, AudioType type) {
+    is_sync = true;
+    granted = 0;
+    sent = 0;
+    AudioDataBegin begin;
+    begin.info = info;
+    begin.type = type;
+    begin.increment();
+    return audioSyncWriteAll(*p_dest, &begin, sizeof(begin));
+  }
+
+  size_t write(const uint8_t *data, size_t len) override {
+    size_t written_len = 0;
+    AudioSendData send;
+    while (written_len < len) {
+      // process the received credits: we wait only if we have none
+      if (!receiveCredits(credit() <= 0)) break;
+      size_t to_write_len = len - written_len;
+      if (to_write_len > (size_t)credit()) to_write_len = credit();
+      if (to_write_len > max_chunk_size) to_write_len = max_chunk_size;
+      if (to_write_len == 0) continue;
+      send.increment();
+      send.size = to_write_len;
+      // the receiver expects the full chunk after the header
+      if (!audioSyncWriteAll(*p_dest, &send, sizeof(send))) break;
+      if (!audioSyncWriteAll(*p_dest, data + written_len, to_write_len)) break;
+      written_len += to_write_len;
+      sent += to_write_len;
+    }
+    return written_len;
+  }
+
+  /// Provides the number of bytes which we can send w/o waiting
+  int availableForWrite() override {
+    receiveCredits(false);
+    return credit();
+  }
+
+  void end() {
+    AudioDataEnd end;
+    end.increment();
+    audioSyncWriteAll(*p_dest, &end, sizeof(end));
+  }
+
+  /// Defines the max size of a data record
+  void setMaxChunkSize(size_t size) { max_chunk_size = size; }
+
+ protected:
+  Stream *p_dest;
+  bool is_sync;
+  uint32_t granted = 0;
+  uint32_t sent = 0;
+  size_t max_chunk_size = DEFAULT_BUFFER_SIZE;
+
+  /// Number of bytes which we can send
+  int credit() { return (int32_t)(granted - sent); }
+
+  /// Processes the credit records: if wait is true we block until we get one. Returns false if the reading failed
+  bool receiveCredits(bool wait) {
+    AudioHeader header;
+    while (wait || p_dest->available() >= (int)sizeof(header)) {
+      if (!audioSyncReadAll(*p_dest, &header, sizeof(header))) return false;
+      if (header.rec == Receive) {
+        AudioConfirmDataToReceive rcv;
+        if (!audioSyncReadRecord(*p_dest, header, &rcv, sizeof(rcv))) continue;
+        // the credits are cumulative
+        if ((int32_t)(rcv.total - granted) > 0) granted = rcv.total;
+        wait = false;
+      } else {
+        // skip unknown record
+        AudioHeader tmp;
+        audioSyncReadRecord(*p_dest, header, &tmp, sizeof(tmp));
+      }
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Receving Audio Data over the wire and granting credits for more data
+ * when the data has been processed to synchronize the processing with the sender.
+ * The credits allow the sender to have up to the window size of data in flight.
+ * The audio data is processed by the EncodedAudioStream: data which is not
+ * accepted by the output is retried with the next copy(). If you have multiple
+ * readers, only one receiver should be used as confirmer!
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class AudioSyncReader : public AudioStream {
+ public:
+  AudioSyncReader(Stream &in, EncodedAudioStream &out,
+                  bool isConfirmer = true) {
+    p_in = &in;
+    p_out = &out;
+    is_confirmer = isConfirmer;
+  }
+
+  /// Defines the number of bytes which can be in flight
+  void setWindowSize(size_t size) { window_size = size; }
+
+  /// Processes the next record: data which was not accepted by the output is retried first
+  size_t copy() {
+    int processed = 0;
+    if (buffer_pos < buffer_len) {
+      return writeData();
+    }
+    if (!audioSyncReadAll(*p_in, &header, sizeof(header))) return 0;
+
+    switch (header.rec) {
+      case Begin:
+        audioDataBegin();
+        break;
+      case End:
+        audioDataEnd();
+        break;
+      case Send:
+        processed = receiveData();
+        break;
+      default: {
+        // skip unknown records
+        AudioHeader tmp;
+        audioSyncReadRecord(*p_in, header, &tmp, sizeof(tmp));
+      } break;
+    }
+    return processed;
+  }
+
+ protected:
+  Stream *p_in;
+  EncodedAudioStream *p_out;
+  AudioConfirmDataToReceive req;
+  AudioHeader header;
+  AudioDataBegin begin;
+  Vector<uint8_t> buffer{0};
+  size_t buffer_pos = 0;
+  size_t buffer_len = 0;
+  bool is_confirmer;
+  size_t window_size = DEFAULT_BUFFER_SIZE * 4;
+  uint32_t consumed = 0;
+  uint32_t granted = 0;
+
+  /// Starts the processing
+  void audioDataBegin() {
+    if (!audioSyncReadRecord(*p_in, header, &begin, sizeof(begin))) return;
+    p_out->begin();
+    p_out->setAudioInfo(begin.info);
+    consumed = 0;
+    granted = 0;
+    buffer_pos = 0;
+    buffer_len = 0;
+    grantCredits(true);
+  }
+
+  /// Ends the processing
+  void audioDataEnd() {
+    AudioDataEnd end;
+    if (!audioSyncReadRecord(*p_in, header, &end, sizeof(end))) return;
+    p_out->end();
+  }
+
+  // Receives audio data
+  int receiveData() {
+    AudioSendData data;
+    if (!audioSyncReadRecord(*p_in, header, &data, sizeof(data))) return 0;
+    // receive audio data with a reused buffer
+    if (buffer.size() < data.size) buffer.resize(data.size);
+    buffer_pos = 0;
+    buffer_len = 0;
+    if (!audioSyncReadAll(*p_in, buffer.data(), data.size)) return 0;
+    buffer_len = data.size;
+    return writeData();
+  }
+
+  /// Writes the open data to the output: we grant credits only for the accepted bytes
+  int writeData() {
+    size_t open = buffer_len - buffer_pos;
+    size_t result = p_out->write((const uint8_t *)buffer.data() + buffer_pos, open);
+    if (result > open) result = open;
+    buffer_pos += result;
+    consumed += result;
+    grantCredits(false);
+    return result;
+  }
+
+  /// Grant new credits to the writer: we collect the credits and send them when we have half a window
+  void grantCredits(bool force) {
+    // only one reader should be used as confirmer
+    if (!is_confirmer) return;
+    uint32_t total = consumed + window_size;
+    uint32_t open = total - granted;
+    if (!force && open < window_size / 2) return;
+    req.size = open > 0xFFFF ? 0xFFFF : open;
+    req.total = total;
+    req.increment();
+    audioSyncWriteAll(*p_in, &req, sizeof(req));
+    p_in->flush();
+    granted = total;
+  }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,515 @@
+#pragma once
+
+#include <stdio.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/AudioPrint.h"
+#include "AudioTools/AudioStreamsConverter.h"
+#include "AudioCodecs/AudioEncoded.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Size of the copy buffer of a worker
+#ifndef BATCH_COPY_SIZE
+#define BATCH_COPY_SIZE (4 * DEFAULT_BUFFER_SIZE)
+#endif
+
+/// Max time in ms an idle worker waits before it tries to steal again
+#ifndef BATCH_IDLE_MS
+#define BATCH_IDLE_MS 10
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Processing chain of a BatchTranscoder worker: it is created once per worker by
+ * the factory and reused for all jobs of the worker, so that the codecs and buffers do not
+ * need to be allocated for each job.
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class TranscodeChain {
+  public:
+    virtual ~TranscodeChain() = default;
+    /// Prepares the chain for the next job: returns the stage which receives the input data
+    virtual Print *begin(Print &out) = 0;
+    /// Processes the remaining data at the end of a job: returns false if the job failed
+    virtual bool end() = 0;
+    /// Duration of the processed audio in seconds
+    virtual float audioSeconds() { return 0.0f; }
+    /// Number of bytes which were written to the output
+    virtual size_t bytesOut() { return 0; }
+};
+
+/**
+ * @brief Decode -> convert -> encode chain: the decoded data is converted to the
+ * bits_per_sample and channels of the target format (0 = unchanged: by default we keep the
+ * channels and use 16 bits) and then encoded.
+ * The encoder is started when the decoder reports the audio info (or with the default info
+ * if the decoder does not provide any). The chain takes the ownership of the codecs.
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class CodecTranscodeChain : public TranscodeChain {
+  public:
+    CodecTranscodeChain(AudioDecoder *decoder, AudioEncoder *encoder, AudioBaseInfo target = AudioBaseInfo())
+        : enc_stream(output, *encoder), dec_stream((AudioPrint *)&pcm, decoder) {
+        p_decoder = decoder;
+        p_encoder = encoder;
+        target_info = target;
+        target_info.sample_rate = 0;
+        pcm.p_chain = this;
+        converter.setStream(enc_stream);
+        default_info = enc_stream.defaultConfig();
+    }
+
+    ~CodecTranscodeChain() {
+        delete p_decoder;
+        delete p_encoder;
+    }
+
+    /// Audio info which is used if the decoder does not report any
+    void setDefaultInfo(AudioBaseInfo info) { default_info = info; }
+
+    Print *begin(Print &out) override {
+        output.p_out = &out;
+        output.count = 0;
+        pcm.count = 0;
+        is_encoder_active = false;
+        is_valid = true;
+        if (!dec_stream.begin()) return nullptr;
+        return &dec_stream;
+    }
+
+    bool end() override {
+        dec_stream.end();
+        // make sure that we have an encoder result even if we did not get any data
+        if (!is_encoder_active) startEncoder(default_info);
+        enc_stream.end();
+        return is_valid && pcm.count > 0;
+    }
+
+    float audioSeconds() override {
+        int bytes_per_second = pcm_info.sample_rate * pcm_info.channels * pcm_info.bits_per_sample / 8;
+        return bytes_per_second > 0 ? (float)pcm.count / bytes_per_second : 0.0f;
+    }
+
+    size_t bytesOut() override { return output.count; }
+
+  protected:
+    /// Counts the encoded bytes and forwards them to the output of the actual job
+    class OutputPrint : public Print {
+      public:
+        Print *p_out = nullptr;
+        size_t count = 0;
+        size_t write(const uint8_t *data, size_t len) override {
+            size_t result = p_out->write(data, len);
+            count += result;
+            return result;
+        }
+        size_t write(uint8_t ch) override { return write(&ch, 1); }
+        int availableForWrite() override { return p_out->availableForWrite(); }
+    };
+
+    /// Receives the decoded data
+    class PCMPrint : public AudioPrint {
+      public:
+        CodecTranscodeChain *p_chain = nullptr;
+        size_t count = 0;
+        size_t write(const uint8_t *data, size_t len) override {
+            if (!p_chain->is_encoder_active) p_chain->startEncoder(p_chain->default_info);
+            count += len;
+            // the converter reports the converted size, but we have consumed all data
+            p_chain->p_pcm_out->write(data, len);
+            return len;
+        }
+        void setAudioInfo(AudioBaseInfo info) override {
+            AudioPrint::setAudioInfo(info);
+            p_chain->startEncoder(info);
+        }
+    };
+
+    AudioDecoder *p_decoder = nullptr;
+    AudioEncoder *p_encoder = nullptr;
+    OutputPrint output;
+    EncodedAudioPrint enc_stream;
+    FormatConverterStream converter;
+    PCMPrint pcm;
+    EncodedAudioPrint dec_stream;
+    Print *p_pcm_out = nullptr;
+    AudioBaseInfo target_info;
+    AudioBaseInfo default_info;
+    AudioBaseInfo pcm_info;
+    AudioBaseInfo converter_from;
+    AudioBaseInfo converter_to;
+    bool is_encoder_active = false;
+    bool is_converter_active = false;
+    bool is_valid = true;
+
+    void startEncoder(AudioBaseInfo from) {
+        if (is_encoder_active) {
+            if (from == pcm_info) return;
+            LOGW("audio info changed within a job");
+            enc_stream.end();
+        }
+        pcm_info = from;
+        AudioBaseInfo to = from;
+        if (target_info.channels > 0) to.channels = target_info.channels;
+        if (target_info.bits_per_sample > 0) to.bits_per_sample = target_info.bits_per_sample;
+        p_pcm_out = &enc_stream;
+        if (to.channels != from.channels || to.bits_per_sample != from.bits_per_sample) {
+            // the converter allocates its implementation in begin(), so we only restart it
+            // if the formats have changed
+            if (!is_converter_active || !(from == converter_from) || !(to == converter_to)) {
+                is_converter_active = converter.begin(from, to);
+                converter_from = from;
+                converter_to = to;
+            }
+            if (is_converter_active) {
+                p_pcm_out = &converter;
+            } else {
+                LOGE("conversion not supported");
+                is_valid = false;
+            }
+        }
+        enc_stream.begin(to);
+        is_encoder_active = true;
+    }
+};
+
+/**
+ * @brief Result of a TranscodeJob
+ * @ingroup concurrency
+ */
+struct TranscodeJobResult {
+    bool ok = false;
+    /// index of the worker which processed the job
+    int worker = -1;
+    size_t bytes_in = 0;
+    size_t bytes_out = 0;
+    float audio_seconds = 0.0f;
+    uint32_t process_ms = 0;
+    /// Input throughput in bytes per second
+    float throughput() { return process_ms > 0 ? 1000.0f * bytes_in / process_ms : 0.0f; }
+    /// Audio seconds processed per second
+    float realTimeFactor() { return process_ms > 0 ? 1000.0f * audio_seconds / process_ms : 0.0f; }
+};
+
+/**
+ * @brief A job of the BatchTranscoder: provides the input and the output
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class TranscodeJob {
+  public:
+    virtual ~TranscodeJob() = default;
+    /// Called by the worker before the processing: returns false if the job can not be processed
+    virtual bool open() { return true; }
+    /// Called by the worker after the processing
+    virtual void close() {}
+    /// The encoded input data: a readBytes() result of 0 marks the end
+    virtual Stream &input() = 0;
+    /// Receives the result
+    virtual Print &output() = 0;
+    virtual const char *name() { return ""; }
+    /// Result which is available after the processing
+    TranscodeJobResult result;
+};
+
+/**
+ * @brief TranscodeJob which reads from a file and writes the result to a file
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class FileTranscodeJob : public TranscodeJob {
+  public:
+    FileTranscodeJob(const char *inputPath, const char *outputPath) {
+        in_path = inputPath;
+        out_path = outputPath;
+    }
+
+    bool open() override {
+        file_in.p_file = fopen(in_path, "rb");
+        if (file_in.p_file == nullptr) {
+            LOGE("could not open %s", in_path);
+            return false;
+        }
+        file_out.p_file = fopen(out_path, "wb");
+        if (file_out.p_file == nullptr) {
+            LOGE("could not create %s", out_path);
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() override {
+        file_in.close();
+        file_out.close();
+    }
+
+    Stream &input() override { return file_in; }
+
+    Print &output() override { return file_out; }
+
+    const char *name() override { return in_path; }
+
+  protected:
+    class FileStream : public Stream {
+      public:
+        FILE *p_file = nullptr;
+        void close() {
+            if (p_file != nullptr) fclose(p_file);
+            p_file = nullptr;
+        }
+        size_t readBytes(uint8_t *data, size_t len) override { return fread(data, 1, len, p_file); }
+        size_t write(const uint8_t *data, size_t len) override { return fwrite(data, 1, len, p_file); }
+        size_t write(uint8_t ch) override { return write(&ch, 1); }
+        int available() override { return feof(p_file) ? 0 : DEFAULT_BUFFER_SIZE; }
+        int availableForWrite() override { return DEFAULT_BUFFER_SIZE; }
+        int read() override { return fgetc(p_file); }
+        int peek() override {
+            int ch = fgetc(p_file);
+            if (ch != EOF) ungetc(ch, p_file);
+            return ch;
+        }
+    };
+    const char *in_path;
+    const char *out_path;
+    FileStream file_in;
+    FileStream file_out;
+};
+
+/**
+ * @brief Overall statistics of a BatchTranscoder
+ * @ingroup concurrency
+ */
+struct BatchStatistics {
+    uint32_t jobs = 0;
+    uint32_t failed = 0;
+    uint32_t steals = 0;
+    size_t bytes_in = 0;
+    size_t bytes_out = 0;
+    float audio_seconds = 0.0f;
+    uint32_t wall_ms = 0;
+    /// Audio seconds which were processed per second
+    float realTimeFactor() { return wall_ms > 0 ? 1000.0f * audio_seconds / wall_ms : 0.0f; }
+};
+
+/**
+ * @brief Transcodes many inputs in parallel: the jobs are processed by a fixed number of
+ * worker threads. Each worker has its own job queue and its own TranscodeChain which is
+ * created by the factory and reused for all jobs of the worker. A worker without jobs
+ * steals from the end of the queue of another worker. Requires USE_STD_CONCURRENCY.
+ * @code
+ * BatchTranscoder batch([](int worker) -> TranscodeChain * {
+ *   return new CodecTranscodeChain(new WAVDecoder(), new OpusAudioEncoder());
+ * }, 4);
+ * batch.begin();
+ * batch.add(job);
+ * batch.wait();
+ * @endcode
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class BatchTranscoder {
+  public:
+    /// Defines the factory for the chains and the number of workers (0 = number of cores)
+    BatchTranscoder(TranscodeChain *(*factory)(int worker), int workers = 0) {
+        p_factory = factory;
+        worker_count = workers > 0 ? workers : std::thread::hardware_concurrency();
+        if (worker_count <= 0) worker_count = 1;
+    }
+
+    ~BatchTranscoder() { end(); }
+
+    /// Defines a callback which is called by the worker after each job
+    void setOnJobDone(void (*cb)(TranscodeJob &job)) { p_on_done = cb; }
+
+    /// Starts the workers
+    bool begin() {
+        TRACEI();
+        if (is_running) return true;
+        stats = BatchStatistics();
+        start_ms = millis();
+        is_running = true;
+        for (int j = 0; j < worker_count; j++) {
+            Worker *p_worker = new Worker();
+            p_worker->p_chain = p_factory(j);
+            p_worker->buffer.resize(BATCH_COPY_SIZE);
+            workers.push_back(p_worker);
+        }
+        for (int j = 0; j < worker_count; j++) {
+            workers[j]->thread = std::thread(&BatchTranscoder::run, this, j);
+        }
+        return true;
+    }
+
+    /// Adds a job: the job must stay valid until it has been processed
+    void add(TranscodeJob &job) {
+        if (workers.size() == 0) {
+            LOGE("not started");
+            return;
+        }
+        pending++;
+        Worker *p_worker = workers[next_worker++ % workers.size()];
+        {
+            std::lock_guard<std::mutex> lock(p_worker->mutex);
+            p_worker->jobs.push_back(&job);
+        }
+        idle_cv.notify_one();
+    }
+
+    /// Waits until all jobs have been processed or the processing was stopped with end()
+    void wait() {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [this]() { return pending == 0 || !is_running; });
+    }
+
+    /// Stops the workers: unprocessed jobs are discarded
+    void end() {
+        if (!is_running) return;
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            is_running = false;
+        }
+        idle_cv.notify_all();
+        done_cv.notify_all();
+        // all workers must have stopped before we release a queue which might be stolen from
+        for (int j = 0; j < workers.size(); j++) {
+            if (workers[j]->thread.joinable()) workers[j]->thread.join();
+        }
+        for (int j = 0; j < workers.size(); j++) {
+            delete workers[j]->p_chain;
+            delete workers[j];
+        }
+        workers.clear();
+        {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            pending = 0;
+        }
+        done_cv.notify_all();
+    }
+
+    /// Number of jobs which are queued or in process
+    int pendingJobs() { return pending; }
+
+    BatchStatistics statistics() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        BatchStatistics result = stats;
+        result.wall_ms = millis() - start_ms;
+        return result;
+    }
+
+  protected:
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::deque<TranscodeJob *> jobs;
+        TranscodeChain *p_chain = nullptr;
+        Vector<uint8_t> buffer{0};
+    };
+    TranscodeChain *(*p_factory)(int worker) = nullptr;
+    void (*p_on_done)(TranscodeJob &job) = nullptr;
+    int worker_count = 1;
+    Vector<Worker *> workers{0};
+    std::atomic<bool> is_running{false};
+    std::atomic<int> pending{0};
+    std::atomic<uint32_t> next_worker{0};
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    std::mutex stats_mutex;
+    BatchStatistics stats;
+    uint64_t start_ms = 0;
+
+    void run(int idx) {
+        Worker &worker = *workers[idx];
+        while (is_running) {
+            TranscodeJob *p_job = nextJob(idx);
+            if (p_job == nullptr) {
+                std::unique_lock<std::mutex> lock(idle_mutex);
+                idle_cv.wait_for(lock, std::chrono::milliseconds(BATCH_IDLE_MS));
+                continue;
+            }
+            process(worker, idx, *p_job);
+            if (p_on_done != nullptr) p_on_done(*p_job);
+            {
+                std::lock_guard<std::mutex> lock(done_mutex);
+                pending--;
+            }
+            done_cv.notify_all();
+        }
+    }
+
+    /// Takes the next job from the own queue or steals one from the end of another queue
+    TranscodeJob *nextJob(int idx) {
+        TranscodeJob *result = popJob(*workers[idx], true);
+        for (int j = 1; result == nullptr && j < workers.size(); j++) {
+            result = popJob(*workers[(idx + j) % workers.size()], false);
+            if (result != nullptr) {
+                std::lock_guard<std::mutex> lock(stats_mutex);
+                stats.steals++;
+            }
+        }
+        return result;
+    }
+
+    TranscodeJob *popJob(Worker &worker, bool front) {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.jobs.empty()) return nullptr;
+        TranscodeJob *result = nullptr;
+        if (front) {
+            result = worker.jobs.front();
+            worker.jobs.pop_front();
+        } else {
+            result = worker.jobs.back();
+            worker.jobs.pop_back();
+        }
+        return result;
+    }
+
+    void process(Worker &worker, int idx, TranscodeJob &job) {
+        uint64_t start = millis();
+        TranscodeJobResult &result = job.result;
+        result = TranscodeJobResult();
+        result.worker = idx;
+        if (job.open()) {
+            Print *p_in = worker.p_chain->begin(job.output());
+            if (p_in != nullptr) {
+                while (true) {
+                    size_t len = job.input().readBytes(worker.buffer.data(), worker.buffer.size());
+                    if (len == 0) break;
+                    result.bytes_in += len;
+                    // decoders report the decoded size, so we can not retry partial writes
+                    p_in->write(worker.buffer.data(), len);
+                }
+                result.ok = worker.p_chain->end();
+            }
+            job.close();
+            result.bytes_out = worker.p_chain->bytesOut();
+            result.audio_seconds = worker.p_chain->audioSeconds();
+        }
+        result.process_ms = millis() - start;
+        if (!result.ok) LOGW("job failed: %s", job.name());
+
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats.jobs++;
+        if (!result.ok) stats.failed++;
+        stats.bytes_in += result.bytes_in;
+        stats.bytes_out += result.bytes_out;
+        stats.audio_seconds += result.audio_seconds;
+    }
+};
+
+}  // namespace audio_tools
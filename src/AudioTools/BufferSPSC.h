@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <string.h>
+#include "AudioTools/Buffers.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Lock free single producer single consumer ring buffer: One thread
+ * (e.g. an audio callback) can read while an other thread writes w/o any locking.
+ * The bulk operations readArray() and writeArray() copy the data with at most two
+ * memcpy calls. reset() and resize() are not thread safe. The head and tail are free
+ * running counters, so the capacity is rounded up to a power of 2: this way the
+ * position stays consistent when the counters wrap around.
+ * @ingroup buffers
+ * @ingroup concurrency
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ * @tparam T
+ */
+template <typename T>
+class RingBufferSPSC : public BaseBuffer<T> {
+ public:
+  RingBufferSPSC(int size = 0) { resize(size); }
+
+  ~RingBufferSPSC() { delete[] p_buffer; }
+
+  T read() override {
+    T result = 0;
+    readArray(&result, 1);
+    return result;
+  }
+
+  T peek() override {
+    if (available() == 0) return 0;
+    return p_buffer[tail.load(std::memory_order_relaxed) & (max_size - 1)];
+  }
+
+  bool isFull() override { return availableForWrite() == 0; }
+
+  bool write(T data) override { return writeArray(&data, 1) == 1; }
+
+  /// Reads up to len entries: to be called by the consumer only
+  int readArray(T data[], int len) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    size_t h = head.load(std::memory_order_acquire);
+    int result = MIN((int)(h - t), len);
+    if (result <= 0) return 0;
+    size_t pos = t & (max_size - 1);
+    int first = MIN(result, (int)(max_size - pos));
+    memcpy(data, p_buffer + pos, first * sizeof(T));
+    memcpy(data + first, p_buffer, (result - first) * sizeof(T));
+    tail.store(t + result, std::memory_order_release);
+    return result;
+  }
+
+  /// Writes up to len entries: to be called by the producer only
+  int writeArray(const T data[], int len) {
+    size_t h = head.load(std::memory_order_relaxed);
+    size_t t = tail.load(std::memory_order_acquire);
+    int result = MIN((int)(max_size - (h - t)), len);
+    if (result <= 0) return 0;
+    size_t pos = h & (max_size - 1);
+    int first = MIN(result, (int)(max_size - pos));
+    memcpy(p_buffer + pos, data, first * sizeof(T));
+    memcpy(p_buffer, data + first, (result - first) * sizeof(T));
+    head.store(h + result, std::memory_order_release);
+    return result;
+  }
+
+  void reset() override {
+    head.store(0);
+    tail.store(0);
+  }
+
+  int available() override {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  int availableForWrite() override { return max_size - available(); }
+
+  T *address() override { return p_buffer; }
+
+  /// Defines the capacity: the size is rounded up to the next power of 2
+  void resize(int len) {
+    delete[] p_buffer;
+    p_buffer = nullptr;
+    max_size = 0;
+    if (len > 0) {
+      max_size = 1;
+      while (max_size < (size_t)len) max_size <<= 1;
+      p_buffer = new T[max_size];
+      assert(p_buffer != nullptr);
+    }
+    reset();
+  }
+
+  /// Returns the maximum capacity of the buffer
+  int size() { return max_size; }
+
+ protected:
+  T *p_buffer = nullptr;
+  size_t max_size = 0;
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+};
+
+}  // namespace audio_tools
@@ -478,6 +478,174 @@ class ChannelConverter {
 
 };
 
+/**
+ * @brief Mixes the source channels into the target channels with a gain matrix (target x source):
+ * target[i] = sum(gain[i][j] * source[j]). If no matrix is defined we use the standard presets:
+ * mono to stereo, stereo to mono, 5.1 (L R C LFE Ls Rs) to stereo and mono (ITU-R BS.775 w/o LFE) 
+ * and otherwise the logic of the ChannelReducer and ChannelEnhancer. 8 and 16 bit data is processed 
+ * with fixed point gains and 32 bit accumulators, 24 and 32 bits with 64 bit accumulators. The result
+ * is clipped.
+ * @ingroup convert
+ * @tparam T 
+ */
+template<typename T>
+class ChannelMatrixConverter {
+    public:
+        ChannelMatrixConverter() = default;
+
+        ChannelMatrixConverter(int channelCountOfTarget, int channelCountOfSource){
+            setPreset(channelCountOfTarget, channelCountOfSource);
+        }
+
+        /// Defines the standard matrix for the indicated channels
+        bool setPreset(int channelCountOfTarget, int channelCountOfSource){
+            if (!setup(channelCountOfTarget, channelCountOfSource)) return false;
+            int to = to_channels;
+            int from = from_channels;
+            const float c = 0.7071f;
+            if (from==6 && to==2){
+                // L + C + Ls and R + C + Rs: normalized to avoid clipping
+                float n = 1.0f / (1.0f + c + c);
+                setGainInternal(0, 0, n); setGainInternal(0, 2, c*n); setGainInternal(0, 4, c*n);
+                setGainInternal(1, 1, n); setGainInternal(1, 2, c*n); setGainInternal(1, 5, c*n);
+            } else if (from==6 && to==1){
+                float n = 1.0f / (2.0f + c + c + c);
+                setGainInternal(0, 0, n); setGainInternal(0, 1, n); setGainInternal(0, 2, c*n);
+                setGainInternal(0, 4, c*n); setGainInternal(0, 5, c*n);
+            } else if (from>to){
+                // copy the first channels and combine the remaining channels into the last one
+                for (int j=0;j<to-1;j++) setGainInternal(j, j, 1.0f);
+                float n = 1.0f / (from - to + 1);
+                for (int j=to-1;j<from;j++) setGainInternal(to-1, j, n);
+            } else {
+                // copy the channels and repeat the last one
+                for (int j=0;j<to;j++) setGainInternal(j, j<from ? j : from-1, 1.0f);
+            }
+            updateFixedGains();
+            return true;
+        }
+
+        /// Defines the gain matrix as array of to_channels rows with from_channels gains
+        bool setMatrix(const float* matrix, int channelCountOfTarget, int channelCountOfSource){
+            if (!setup(channelCountOfTarget, channelCountOfSource)) return false;
+            memcpy(gains.data(), matrix, to_channels*from_channels*sizeof(float));
+            updateFixedGains();
+            return true;
+        }
+
+        /// Changes an individual gain
+        void setGain(int targetChannel, int sourceChannel, float gain){
+            setGainInternal(targetChannel, sourceChannel, gain);
+            updateFixedGains();
+        }
+
+        float gain(int targetChannel, int sourceChannel){
+            return gains[targetChannel*from_channels+sourceChannel];
+        }
+
+        int sourceChannels() { return from_channels; }
+
+        int targetChannels() { return to_channels; }
+
+        /// Returns true if the matrix just copies the channels
+        bool isIdentity() {
+            if (from_channels!=to_channels) return false;
+            for (int i=0;i<to_channels;i++){
+                for (int j=0;j<from_channels;j++){
+                    if (gains[i*from_channels+j] != (i==j ? 1.0f : 0.0f)) return false;
+                }
+            }
+            return true;
+        }
+
+        /// Determine the size of the conversion result
+        size_t resultSize(size_t inSize){
+            return inSize / (sizeof(T)*from_channels) * sizeof(T) * to_channels;
+        }
+
+        /// Mixes the complete frames of the source into the target: target and source must not overlap
+        size_t convert(uint8_t*target, uint8_t*src, size_t size) {
+            int frame_count = size/(sizeof(T)*from_channels);
+            if (sizeof(T)<=2){
+                mix<int32_t>((T*)target, (T*)src, frame_count);
+            } else {
+                mix<int64_t>((T*)target, (T*)src, frame_count);
+            }
+            return frame_count * to_channels * sizeof(T);
+        }
+
+    protected:
+        Vector<float> gains{0};
+        Vector<int32_t> fixed_gains{0};
+        int from_channels = 0;
+        int to_channels = 0;
+        int shift = 0;
+
+        bool setup(int channelCountOfTarget, int channelCountOfSource){
+            if (channelCountOfTarget<=0 || channelCountOfSource<=0){
+                LOGE("Invalid channels: %d -> %d", channelCountOfSource, channelCountOfTarget);
+                return false;
+            }
+            from_channels = channelCountOfSource;
+            to_channels = channelCountOfTarget;
+            gains.resize(to_channels*from_channels);
+            fixed_gains.resize(to_channels*from_channels);
+            for (int j=0;j<gains.size();j++) gains[j] = 0.0f;
+            return true;
+        }
+
+        void setGainInternal(int targetChannel, int sourceChannel, float gain){
+            gains[targetChannel*from_channels+sourceChannel] = gain;
+        }
+
+        static int64_t maxSampleValue(int24_t*) { return 8388607; }
+        template <typename X> 
+        static int64_t maxSampleValue(X*) { return NumberConverter::maxValueT<X>(); }
+
+        /// Determines the fixed point gains so that the accumulator can not overflow
+        void updateFixedGains(){
+            float max_sum = 1.0f;
+            for (int i=0;i<to_channels;i++){
+                float sum = 0.0f;
+                for (int j=0;j<from_channels;j++){
+                    float gain = gains[i*from_channels+j];
+                    sum += gain < 0.0f ? -gain : gain;
+                }
+                if (sum>max_sum) max_sum = sum;
+            }
+            if (sizeof(T)<=2){
+                shift = 16;
+                while (shift>0 && max_sum * maxSampleValue((T*)nullptr) * (1<<shift) >= 2147483647.0f) shift--;
+            } else {
+                shift = 24;
+            }
+            for (int j=0;j<gains.size();j++){
+                fixed_gains[j] = gains[j] * (1<<shift);
+            }
+        }
+
+        template <typename Acc>
+        void mix(T* target, T* source, int frame_count){
+            const Acc max_value = maxSampleValue((T*)nullptr);
+            const int32_t *p_gains = fixed_gains.data();
+            for (int f=0; f<frame_count; f++){
+                const int32_t *row = p_gains;
+                for (int i=0;i<to_channels;i++){
+                    Acc sum = 0;
+                    for (int j=0;j<from_channels;j++){
+                        sum += (Acc)(int32_t)source[j] * row[j];
+                    }
+                    row += from_channels;
+                    sum >>= shift;
+                    if (sum>max_value) sum = max_value;
+                    if (sum<-max_value-1) sum = -max_value-1;
+                    *target++ = static_cast<T>((int32_t)sum);
+                }
+                source += from_channels;
+            }
+        }
+};
+
 /**
  * @brief Combines multiple converters
  * @ingroup convert
@@ -749,7 +917,8 @@ class ConverterNChannels : public BaseConverter<T> {
 /**
  * @brief Removes any silence from the buffer that is longer then n samples with a amplitude
  * below the indicated threshhold. If you process multiple channels you need to multiply the
- * channels with the number of samples to indicate n
+ * channels with the number of samples to indicate n. For a voice activity detection with
+ * an adaptive threshold use the VADStream.
  * @ingroup convert
  * @tparam T 
  */
@@ -771,11 +940,15 @@ class SilenceRemovalConverter : public BaseConverter<T>  {
     size_t write_count = 0;
     T *audio = (T *)data;
 
-    // find relevant data
+    // find relevant data: we count the samples since the last audible value
     T *p_buffer = (T *)data;
     for (int j = 0; j < sample_count; j++) {
-      int pos = findLastAudioPos(audio, j);
-      if (pos < n) {
+      if (abs(audio[j]) > amplidude_limit) {
+        samples_since_audio = 0;
+      } else if (samples_since_audio <= n) {
+        samples_since_audio++;
+      }
+      if (samples_since_audio < n) {
         write_count++;
         *p_buffer++ = audio[j];
       }
@@ -785,9 +958,6 @@ class SilenceRemovalConverter : public BaseConverter<T>  {
     size_t write_size = write_count * sizeof(T);
     LOGI("filtered silence from %d -> %d", (int)size, (int)write_size);
 
-    // number of empty samples of prior buffer
-    priorLastAudioPos =  findLastAudioPos(audio, sample_count - 1);
-
     // return new data size
     return write_size;
   }
@@ -796,32 +966,16 @@ class SilenceRemovalConverter : public BaseConverter<T>  {
   bool active = false;
   const uint8_t *buffer = nullptr;
   int n;
-  int priorLastAudioPos = 0;
+  int samples_since_audio = 0;
   int amplidude_limit = 0;
 
   void set(int n = 5, int aplidudeLimit = 2) {
     LOGI("begin(n=%d, aplidudeLimit=%d", n, aplidudeLimit);
     this->n = n;
     this->amplidude_limit = aplidudeLimit;
-    this->priorLastAudioPos = n+1;  // ignore first values
+    this->samples_since_audio = n+1;  // ignore first values
     this->active = n > 0;
   }
-
-
-  // find last position which contains audible data
-  int findLastAudioPos(T *audio, int pos) {
-    for (int j = 0; j < n; j++) {
-      // we are before the start of the current buffer
-      if (pos - j <= 0) {
-        return priorLastAudioPos;
-      }
-      // we are in the current buffer
-      if (abs(audio[pos - j]) > amplidude_limit) {
-        return j;
-      }
-    }
-    return n + 1;
-  }
 };
 
 /**
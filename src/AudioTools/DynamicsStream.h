@@ -0,0 +1,344 @@
+#pragma once
+#include <math.h>
+#include "AudioTools/AudioStreams.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Number of frames after which the compressor and AGC gains are recalculated
+#ifndef DYNAMICS_CONTROL_FRAMES
+#define DYNAMICS_CONTROL_FRAMES 16
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Configuration for the DynamicsStream
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct DynamicsConfig : public AudioBaseInfo {
+    DynamicsConfig() {
+        channels = 2;
+        sample_rate = 44100;
+        bits_per_sample = 16;
+    }
+    /// if true the gain is determined from all channels, otherwise each channel is processed individually
+    bool linked = true;
+
+    /// activates the slow automatic gain control
+    bool agc = false;
+    /// target rms level in dBFS
+    float agc_target_db = -20.0f;
+    float agc_max_gain_db = 20.0f;
+    float agc_min_gain_db = -20.0f;
+    /// max change of the gain in dB per second
+    float agc_speed_db = 3.0f;
+    /// input below this level does not change the gain
+    float agc_gate_db = -50.0f;
+
+    /// activates the compressor
+    bool compressor = true;
+    /// use rms (true) or peak (false) detection
+    bool rms = true;
+    float threshold_db = -18.0f;
+    float ratio = 4.0f;
+    float knee_db = 6.0f;
+    float attack_ms = 10.0f;
+    float release_ms = 100.0f;
+    float makeup_db = 0.0f;
+
+    /// activates the brick wall look ahead limiter
+    bool limiter = true;
+    float limit_db = -1.0f;
+    float lookahead_ms = 5.0f;
+    float limiter_release_ms = 50.0f;
+};
+
+/**
+ * @brief Dynamic range processing with an automatic gain control, a compressor (with
+ * soft knee) and a brick wall look ahead limiter which are applied in this order. The
+ * levels are tracked per sample and the gains are recalculated every DYNAMICS_CONTROL_FRAMES
+ * frames and then smoothed per sample with the attack and release times. The limiter
+ * delays the signal by lookahead_ms and uses the minimum of the required gain in the look
+ * ahead window, smoothed with a moving average, so that the limit is never exceeded.
+ * Only 16 bits are supported.
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class DynamicsStream : public AudioStream {
+  public:
+    DynamicsStream() = default;
+
+    /// Constructor which assigns Print output
+    DynamicsStream(Print &out) { setTarget(out); }
+
+    /// Constructor which assigns Stream input or output
+    DynamicsStream(Stream &io) { setTarget(io); }
+
+    void setTarget(Print &out) { p_out = &out; }
+
+    void setTarget(Stream &io) {
+        p_in = &io;
+        p_out = &io;
+    }
+
+    DynamicsConfig defaultConfig() {
+        DynamicsConfig c;
+        return c;
+    }
+
+    bool begin(DynamicsConfig cfg) {
+        TRACED();
+        if (cfg.bits_per_sample != 16) {
+            LOGE("Unsupported bits_per_sample: %d", cfg.bits_per_sample);
+            return false;
+        }
+        this->cfg = cfg;
+        info = cfg;
+        float rate = cfg.sample_rate;
+        attack_coef = timeCoef(cfg.attack_ms, rate);
+        release_coef = timeCoef(cfg.release_ms, rate);
+        detect_coef = timeCoef(10.0f, rate);
+        agc_coef = timeCoef(1000.0f, rate);
+        limiter_release_coef = timeCoef(cfg.limiter_release_ms, rate);
+        agc_step_db = cfg.agc_speed_db * DYNAMICS_CONTROL_FRAMES / rate;
+        limit = cfg.limiter ? dbToFactor(cfg.limit_db) : 0.0f;
+        lookahead = cfg.limiter ? cfg.lookahead_ms * rate / 1000.0f : 0;
+        if (cfg.limiter && lookahead < 1) lookahead = 1;
+
+        groups = cfg.linked ? 1 : cfg.channels;
+        detectors.resize(groups);
+        for (int j = 0; j < groups; j++) {
+            Detector &det = detectors[j];
+            det = Detector();
+            det.min_value.resize(lookahead + 1);
+            det.min_index.resize(lookahead + 1);
+            det.average.resize(lookahead > 0 ? lookahead : 1);
+            for (int i = 0; i < det.average.size(); i++) det.average[i] = 1.0f;
+            det.average_sum = det.average.size();
+        }
+        frame_values.resize(cfg.channels);
+        delay.resize(lookahead * cfg.channels);
+        memset(delay.data(), 0, delay.size() * sizeof(float));
+        delay_pos = 0;
+        frame_index = 0;
+        control_count = 0;
+        is_active = true;
+        return true;
+    }
+
+    bool begin(AudioBaseInfo info) {
+        DynamicsConfig c = cfg;
+        c.sample_rate = info.sample_rate;
+        c.channels = info.channels;
+        c.bits_per_sample = info.bits_per_sample;
+        return begin(c);
+    }
+
+    void end() override { is_active = false; }
+
+    void setAudioInfo(AudioBaseInfo info) override {
+        TRACED();
+        if (p_notify != nullptr) p_notify->setAudioInfo(info);
+        begin(info);
+    }
+
+    /// Writes the processed data to the output
+    size_t write(const uint8_t *data, size_t len) override {
+        if (p_out == nullptr) return 0;
+        if (is_active) process((int16_t *)data, len / sizeof(int16_t));
+        return p_out->write(data, len);
+    }
+
+    /// Reads the processed data from the input
+    size_t readBytes(uint8_t *data, size_t len) override {
+        if (p_in == nullptr) return 0;
+        size_t result = p_in->readBytes(data, len);
+        if (is_active) process((int16_t *)data, result / sizeof(int16_t));
+        return result;
+    }
+
+    int available() override { return p_in == nullptr ? 0 : p_in->available(); }
+
+    int availableForWrite() override { return p_out == nullptr ? 0 : p_out->availableForWrite(); }
+
+    /// Actual gain reduction of the compressor in dB (of the first channel)
+    float compressorGainDb() { return factorToDb(detectors[0].comp_gain); }
+
+    /// Actual gain reduction of the limiter in dB (of the first channel)
+    float limiterGainDb() { return factorToDb(detectors[0].limiter_gain); }
+
+    /// Actual gain of the AGC in dB (of the first channel)
+    float agcGainDb() { return detectors[0].agc_gain_db; }
+
+    /// Latency in frames which is caused by the look ahead of the limiter
+    int latency() { return lookahead; }
+
+  protected:
+    struct Detector {
+        float env = 0.0f;
+        float agc_env = 0.0f;
+        float agc_gain_db = 0.0f;
+        float agc_gain = 1.0f;
+        float comp_target = 1.0f;
+        float comp_gain = 1.0f;
+        float limiter_gain = 1.0f;
+        // sliding minimum of the required limiter gain
+        Vector<float> min_value;
+        Vector<uint32_t> min_index;
+        int min_head = 0;
+        int min_count = 0;
+        // moving average of the sliding minimum
+        Vector<float> average;
+        int average_pos = 0;
+        double average_sum = 0;
+    };
+    DynamicsConfig cfg;
+    Print *p_out = nullptr;
+    Stream *p_in = nullptr;
+    Vector<Detector> detectors;
+    Vector<float> frame_values;
+    Vector<float> delay;
+    int delay_pos = 0;
+    int groups = 1;
+    int lookahead = 0;
+    uint32_t frame_index = 0;
+    int control_count = 0;
+    bool is_active = false;
+    float attack_coef = 0, release_coef = 0, detect_coef = 0, agc_coef = 0;
+    float limiter_release_coef = 0, agc_step_db = 0, limit = 0;
+
+    static float timeCoef(float ms, float rate) {
+        return ms <= 0.0f ? 1.0f : 1.0f - expf(-1000.0f / (ms * rate));
+    }
+
+    static float dbToFactor(float db) { return powf(10.0f, db / 20.0f); }
+
+    static float factorToDb(float factor) { return factor <= 0.0f ? -120.0f : 20.0f * log10f(factor); }
+
+    void process(int16_t *data, size_t samples) {
+        int channels = cfg.channels;
+        int group_channels = cfg.linked ? channels : 1;
+        float *frame = frame_values.data();
+        for (size_t pos = 0; pos + channels <= samples; pos += channels) {
+            bool is_control = ++control_count >= DYNAMICS_CONTROL_FRAMES;
+            if (is_control) control_count = 0;
+            for (int g = 0; g < groups; g++) {
+                Detector &det = detectors[g];
+                int first = cfg.linked ? 0 : g;
+                float peak = 0.0f;
+                float square = 0.0f;
+                for (int ch = first; ch < first + group_channels; ch++) {
+                    float value = data[pos + ch] / 32768.0f;
+                    frame[ch] = value;
+                    float abs_value = fabsf(value);
+                    if (abs_value > peak) peak = abs_value;
+                    if (value * value > square) square = value * value;
+                }
+                if (cfg.agc) det.agc_env += agc_coef * (square - det.agc_env);
+                // level detection after the agc
+                float agc_square = square * det.agc_gain * det.agc_gain;
+                if (cfg.rms) {
+                    det.env += detect_coef * (agc_square - det.env);
+                } else {
+                    float level = peak * det.agc_gain;
+                    det.env = level > det.env ? level : det.env + release_coef * (level - det.env);
+                }
+                if (is_control) updateControl(det);
+
+                // smooth the compressor gain per sample
+                float coef = det.comp_target < det.comp_gain ? attack_coef : release_coef;
+                det.comp_gain += coef * (det.comp_target - det.comp_gain);
+                float gain = det.agc_gain * det.comp_gain;
+                for (int ch = first; ch < first + group_channels; ch++) frame[ch] *= gain;
+                if (lookahead > 0) limitGain(det, peak * gain);
+            }
+            output(data + pos, frame);
+            frame_index++;
+        }
+    }
+
+    /// recalculates the agc and compressor gains
+    void updateControl(Detector &det) {
+        if (cfg.agc) {
+            float level_db = 10.0f * log10f(det.agc_env + 1e-12f);
+            if (level_db > cfg.agc_gate_db) {
+                float diff = cfg.agc_target_db - (level_db + det.agc_gain_db);
+                if (diff > agc_step_db) diff = agc_step_db;
+                if (diff < -agc_step_db) diff = -agc_step_db;
+                det.agc_gain_db += diff;
+                if (det.agc_gain_db > cfg.agc_max_gain_db) det.agc_gain_db = cfg.agc_max_gain_db;
+                if (det.agc_gain_db < cfg.agc_min_gain_db) det.agc_gain_db = cfg.agc_min_gain_db;
+                det.agc_gain = dbToFactor(det.agc_gain_db);
+            }
+        }
+        float gain_db = cfg.makeup_db;
+        if (cfg.compressor) {
+            float level_db = cfg.rms ? 10.0f * log10f(det.env + 1e-12f) : factorToDb(det.env);
+            float over = level_db - cfg.threshold_db;
+            float slope = 1.0f / cfg.ratio - 1.0f;
+            float knee = cfg.knee_db;
+            if (2.0f * over <= -knee) {
+                // below the knee: no change
+            } else if (knee > 0.0f && 2.0f * fabsf(over) < knee) {
+                float x = over + knee / 2.0f;
+                gain_db += slope * x * x / (2.0f * knee);
+            } else {
+                gain_db += slope * over;
+            }
+        }
+        det.comp_target = dbToFactor(gain_db);
+    }
+
+    /// determines the limiter gain from the peak of the frame which enters the look ahead buffer
+    void limitGain(Detector &det, float peak) {
+        float required = peak > limit ? limit / peak : 1.0f;
+        // sliding minimum over lookahead + 1 frames
+        int capacity = det.min_value.size();
+        while (det.min_count > 0) {
+            int back = (det.min_head + det.min_count - 1) % capacity;
+            if (det.min_value[back] < required) break;
+            det.min_count--;
+        }
+        int back = (det.min_head + det.min_count) % capacity;
+        det.min_value[back] = required;
+        det.min_index[back] = frame_index;
+        det.min_count++;
+        while (frame_index - det.min_index[det.min_head] > (uint32_t)lookahead) {
+            det.min_head = (det.min_head + 1) % capacity;
+            det.min_count--;
+        }
+        float minimum = det.min_value[det.min_head];
+        // the moving average over the look ahead is always below the minimum of the delayed frame
+        det.average_sum += minimum - det.average[det.average_pos];
+        det.average[det.average_pos] = minimum;
+        if (++det.average_pos >= det.average.size()) det.average_pos = 0;
+        float target = det.average_sum / det.average.size();
+        if (target < det.limiter_gain) {
+            det.limiter_gain = target;
+        } else {
+            det.limiter_gain += limiter_release_coef * (target - det.limiter_gain);
+        }
+    }
+
+    /// writes the delayed frame with the limiter gain
+    void output(int16_t *data, float *frame) {
+        int channels = cfg.channels;
+        for (int ch = 0; ch < channels; ch++) {
+            float value = frame[ch];
+            if (lookahead > 0) {
+                float *p_delay = delay.data() + delay_pos * channels + ch;
+                float delayed = *p_delay;
+                *p_delay = value;
+                value = delayed * detectors[cfg.linked ? 0 : ch].limiter_gain;
+            }
+            value *= 32768.0f;
+            if (value > 32767.0f) value = 32767.0f;
+            if (value < -32768.0f) value = -32768.0f;
+            data[ch] = (int16_t)value;
+        }
+        if (lookahead > 0 && ++delay_pos >= lookahead) delay_pos = 0;
+    }
+};
+
+}  // namespace audio_tools
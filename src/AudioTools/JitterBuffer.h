@@ -0,0 +1,482 @@
+#pragma once
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/AudioPrint.h"
+#include "AudioCodecs/AudioEncoded.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Number of packets which can be stored in the jitter buffer
+#ifndef JITTER_BUFFER_SLOTS
+#define JITTER_BUFFER_SLOTS 16
+#endif
+
+/// Max size of a packet (w/o the sequence number)
+#ifndef JITTER_BUFFER_MAX_PACKET_SIZE
+#define JITTER_BUFFER_MAX_PACKET_SIZE 512
+#endif
+
+/// Number of frames w/o late packets or underruns after which the target depth is reduced
+#ifndef JITTER_BUFFER_ADAPT_FRAMES
+#define JITTER_BUFFER_ADAPT_FRAMES 250
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Adds a 16 bit sequence number (big endian) in front of each written packet, so that
+ * the receiving JitterBufferStream can restore the order and detect the lost packets.
+ * Each write must contain exactly one packet (e.g. one encoded Opus frame) and the output
+ * must send each write as one datagram (e.g. UDPStream).
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class SequenceNumberPrint : public AudioPrint {
+  public:
+    SequenceNumberPrint() = default;
+
+    SequenceNumberPrint(Print &out) { setOutput(out); }
+
+    void setOutput(Print &out) { p_out = &out; }
+
+    /// Restarts the numbering with the indicated sequence number
+    bool begin(uint16_t startSeq = 0) {
+        seq = startSeq;
+        return true;
+    }
+
+    /// Sends the data as one packet which starts with the sequence number
+    size_t write(const uint8_t *data, size_t len) override {
+        if (p_out == nullptr) return 0;
+        packet.resize(len + 2);
+        packet[0] = seq >> 8;
+        packet[1] = seq & 0xFF;
+        memcpy(packet.data() + 2, data, len);
+        seq++;
+        size_t result = p_out->write(packet.data(), packet.size());
+        return result == packet.size() ? len : 0;
+    }
+
+    int availableForWrite() override {
+        return p_out == nullptr ? 0 : p_out->availableForWrite();
+    }
+
+    /// Provides the next sequence number
+    uint16_t sequenceNumber() { return seq; }
+
+  protected:
+    Print *p_out = nullptr;
+    Vector<uint8_t> packet{0};
+    uint16_t seq = 0;
+};
+
+/**
+ * @brief Config for JitterBufferStream: the depths are defined in packets.
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct JitterBufferConfig : public AudioBaseInfo {
+    JitterBufferConfig() {
+        bits_per_sample = 16;
+        channels = 2;
+    }
+    /// number of packets which can be stored: rounded up to a power of 2
+    int slots = JITTER_BUFFER_SLOTS;
+    /// max size of a packet w/o sequence number
+    int max_packet_size = JITTER_BUFFER_MAX_PACKET_SIZE;
+    /// number of packets which are buffered before the playback starts
+    int min_depth = 2;
+    /// upper limit of the (adaptive) target depth
+    int max_depth = 8;
+    /// adjust the target depth to the observed jitter
+    bool adaptive = true;
+    /// number of consecutive concealed packets before we stop and wait for the buffer to fill again
+    int max_concealment = 5;
+};
+
+/**
+ * @brief Statistics of the JitterBufferStream
+ * @ingroup communications
+ */
+struct JitterBufferStatistics {
+    uint32_t received = 0;
+    uint32_t duplicates = 0;
+    uint32_t late = 0;
+    uint32_t lost = 0;
+    uint32_t dropped = 0;
+    uint32_t underruns = 0;
+};
+
+/**
+ * @brief Receives packets with a sequence number (see SequenceNumberPrint) e.g. from a
+ * UDPStream and provides the decoded PCM data in the correct order via readBytes():
+ * Duplicates are removed, late packets are dropped and the packets are reordered.
+ * The playback starts when the buffer holds the target depth which is increased
+ * on late packets and underruns and reduced again if the transmission is stable.
+ * Missing packets are concealed by the decoder (e.g. Opus PLC or in-band FEC) or, for PCM
+ * data and decoders w/o concealment support, by repeating the last packet with a fade out.
+ * The packets are provided with write() or are read from the input in readBytes(). This
+ * class is not thread safe: call write() and readBytes() from the same task.
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class JitterBufferStream : public AudioStream {
+  public:
+    JitterBufferStream() = default;
+
+    /// Jitter buffer for PCM packets which are received from the indicated input
+    JitterBufferStream(Stream &in) { setInput(in); }
+
+    /// Jitter buffer for encoded packets which are received from the indicated input
+    JitterBufferStream(Stream &in, AudioDecoder &decoder) {
+        setInput(in);
+        setDecoder(decoder);
+    }
+
+    /// Defines the input from which the packets are received: one packet per datagram
+    void setInput(Stream &in) { p_in = &in; }
+
+    /// Defines the decoder for the packets: if not defined we expect PCM data
+    void setDecoder(AudioDecoder &decoder) { p_decoder = &decoder; }
+
+    JitterBufferConfig defaultConfig() {
+        JitterBufferConfig c;
+        return c;
+    }
+
+    bool begin() override { return begin(cfg); }
+
+    bool begin(JitterBufferConfig config) {
+        TRACEI();
+        cfg = config;
+        // the slot index must stay consistent when the 16 bit sequence number wraps around
+        int slots = 2;
+        while (slots < cfg.slots && slots < 0x8000) slots <<= 1;
+        if (slots != cfg.slots) {
+            LOGI("slots: %d -> %d", cfg.slots, slots);
+            cfg.slots = slots;
+        }
+        if (cfg.min_depth < 1) cfg.min_depth = 1;
+        if (cfg.max_depth < cfg.min_depth) cfg.max_depth = cfg.min_depth;
+        if (cfg.max_depth >= cfg.slots) {
+            LOGW("max_depth %d too big for %d slots", cfg.max_depth, cfg.slots);
+            cfg.max_depth = cfg.slots - 1;
+        }
+        slot_data.resize(cfg.slots * cfg.max_packet_size);
+        slot_len.resize(cfg.slots);
+        slot_seq.resize(cfg.slots);
+        packet.resize(cfg.max_packet_size + 2);
+        target_depth = cfg.min_depth;
+        stats = JitterBufferStatistics();
+        clear();
+        if (p_decoder != nullptr) {
+            Print *p_print = &frame;
+            p_decoder->setOutputStream(*p_print);
+            p_decoder->begin();
+        }
+        is_active = true;
+        return true;
+    }
+
+    void end() override {
+        if (p_decoder != nullptr) p_decoder->end();
+        is_active = false;
+    }
+
+    /// Adds a packet which starts with the 16 bit sequence number
+    size_t write(const uint8_t *data, size_t len) override {
+        if (!is_active || len < 2) return 0;
+        if (len - 2 > (size_t)cfg.max_packet_size) {
+            LOGE("packet too big: %d", (int)len);
+            stats.dropped++;
+            return len;
+        }
+        uint16_t seq = (data[0] << 8) | data[1];
+        if (!has_seq) {
+            next_seq = seq;
+            has_seq = true;
+        }
+        int16_t diff = seq - next_seq;
+        if (diff < 0 && !is_started && count - diff < cfg.slots) {
+            // we have not started yet: so we can still accept an earlier packet
+            next_seq = seq;
+            diff = 0;
+        }
+        if (diff < 0) {
+            // it's too late: we have already played or concealed the packet
+            LOGD("late packet: %u", seq);
+            stats.late++;
+            increaseDepth();
+            return len;
+        }
+        if (diff >= cfg.slots) {
+            // the sender has restarted or we have lost too much: resync
+            LOGW("resync at %u (expected %u)", seq, next_seq);
+            stats.dropped += count;
+            clear();
+            next_seq = seq;
+            has_seq = true;
+        }
+        int idx = seq & (cfg.slots - 1);
+        if (slot_len[idx] >= 0) {
+            if (slot_seq[idx] == seq) {
+                stats.duplicates++;
+                return len;
+            }
+            // replace an outdated packet
+            LOGD("replacing packet %u with %u", slot_seq[idx], seq);
+            removeSlot(idx);
+            stats.dropped++;
+        }
+        memcpy(slot_data.data() + idx * cfg.max_packet_size, data + 2, len - 2);
+        slot_len[idx] = len - 2;
+        slot_seq[idx] = seq;
+        count++;
+        stats.received++;
+        return len;
+    }
+
+    /// Reads all available packets from the input
+    void receive() {
+        if (p_in == nullptr) return;
+        // limit the number of packets to the capacity
+        for (int j = 0; j < cfg.slots; j++) {
+            int size = p_in->available();
+            if (size <= 0) break;
+            if (size > packet.size()) {
+                LOGE("packet too big: %d", size);
+                size = packet.size();
+            }
+            size_t len = p_in->readBytes(packet.data(), size);
+            if (len == 0) break;
+            write(packet.data(), len);
+        }
+    }
+
+    /// Provides the PCM data
+    size_t readBytes(uint8_t *data, size_t len) override {
+        if (!is_active) return 0;
+        receive();
+        size_t result = 0;
+        while (result < len) {
+            size_t avail = frame.size() - frame_pos;
+            if (avail == 0) {
+                if (!playout()) break;
+                continue;
+            }
+            size_t n = avail < len - result ? avail : len - result;
+            memcpy(data + result, frame.data() + frame_pos, n);
+            frame_pos += n;
+            result += n;
+        }
+        return result;
+    }
+
+    int available() override {
+        if (!is_active) return 0;
+        receive();
+        int avail = frame.size() - frame_pos;
+        if (avail > 0) return avail;
+        return isReady() ? DEFAULT_BUFFER_SIZE : 0;
+    }
+
+    int availableForWrite() override { return cfg.max_packet_size + 2; }
+
+    /// Number of packets in the buffer
+    int depth() { return count; }
+
+    /// Actual target depth
+    int targetDepth() { return target_depth; }
+
+    /// Returns true while we wait for the buffer to fill
+    bool isBuffering() { return is_buffering; }
+
+    JitterBufferStatistics &statistics() { return stats; }
+
+    /// Removes all packets
+    void clear() {
+        for (int j = 0; j < slot_len.size(); j++) slot_len[j] = -1;
+        count = 0;
+        has_seq = false;
+        is_started = false;
+        is_buffering = true;
+        concealed = 0;
+        stable_frames = 0;
+        frame.clear();
+        frame_pos = 0;
+    }
+
+  protected:
+    /// The decoded PCM data of the actual packet
+    class FrameBuffer : public Print {
+      public:
+        size_t write(const uint8_t *data, size_t len) override {
+            int pos = buffer.size();
+            buffer.resize(pos + len);
+            memcpy(buffer.data() + pos, data, len);
+            return len;
+        }
+        size_t write(uint8_t ch) override { return write(&ch, 1); }
+        int availableForWrite() override { return DEFAULT_BUFFER_SIZE; }
+        void clear() { buffer.clear(); }
+        void set(const uint8_t *data, size_t len) {
+            clear();
+            write(data, len);
+        }
+        size_t size() { return buffer.size(); }
+        uint8_t *data() { return buffer.data(); }
+
+      protected:
+        Vector<uint8_t> buffer{0};
+    };
+
+    JitterBufferConfig cfg;
+    Stream *p_in = nullptr;
+    AudioDecoder *p_decoder = nullptr;
+    Vector<uint8_t> slot_data{0};
+    Vector<int> slot_len{0};
+    Vector<uint16_t> slot_seq{0};
+    Vector<uint8_t> packet{0};
+    FrameBuffer frame;
+    Vector<uint8_t> last_frame{0};
+    size_t frame_pos = 0;
+    JitterBufferStatistics stats;
+    uint16_t next_seq = 0;
+    bool has_seq = false;
+    bool is_active = false;
+    bool is_buffering = true;
+    bool is_started = false;
+    int count = 0;
+    int target_depth = 2;
+    int concealed = 0;
+    int stable_frames = 0;
+
+    bool isReady() {
+        return is_buffering ? count >= target_depth : true;
+    }
+
+    /// Provides the slot index if the packet is available, otherwise -1
+    int slotIndex(uint16_t seq) {
+        int idx = seq & (cfg.slots - 1);
+        return slot_len[idx] >= 0 && slot_seq[idx] == seq ? idx : -1;
+    }
+
+    void removeSlot(int idx) {
+        slot_len[idx] = -1;
+        count--;
+    }
+
+    void increaseDepth() {
+        stable_frames = 0;
+        if (cfg.adaptive && target_depth < cfg.max_depth) {
+            target_depth++;
+            LOGI("target depth: %d", target_depth);
+        }
+    }
+
+    /// Reduces the latency if the transmission was stable for some time
+    void adapt() {
+        if (!cfg.adaptive) return;
+        if (++stable_frames < JITTER_BUFFER_ADAPT_FRAMES) return;
+        stable_frames = 0;
+        if (target_depth > cfg.min_depth) {
+            target_depth--;
+            LOGI("target depth: %d", target_depth);
+        }
+        // skip one packet if we have more then needed
+        if (count > target_depth + 1) dropNext();
+    }
+
+    void dropNext() {
+        int idx = slotIndex(next_seq);
+        if (idx >= 0) {
+            removeSlot(idx);
+            stats.dropped++;
+        }
+        next_seq++;
+    }
+
+    /// Provides the next frame: returns false if there is nothing to play
+    bool playout() {
+        frame.clear();
+        frame_pos = 0;
+        if (is_buffering) {
+            if (count < target_depth) return false;
+            is_buffering = false;
+            is_started = true;
+        }
+        // limit the latency
+        while (count > cfg.max_depth) dropNext();
+
+        int idx = slotIndex(next_seq);
+        if (idx >= 0) {
+            decode(slot_data.data() + idx * cfg.max_packet_size, slot_len[idx]);
+            removeSlot(idx);
+            next_seq++;
+            concealed = 0;
+            adapt();
+            return true;
+        }
+
+        // the packet is missing
+        if (count == 0) {
+            if (concealed == 0) {
+                stats.underruns++;
+                increaseDepth();
+            }
+            if (concealed >= cfg.max_concealment) {
+                // give up and wait for the buffer to fill again: the concealed packets
+                // might still arrive, so we accept them again
+                is_buffering = true;
+                is_started = false;
+                return false;
+            }
+        }
+        stats.lost++;
+        conceal();
+        next_seq++;
+        concealed++;
+        return frame.size() > 0;
+    }
+
+    void decode(const uint8_t *data, size_t len) {
+        if (p_decoder != nullptr) {
+            p_decoder->write(data, len);
+        } else {
+            frame.set(data, len);
+        }
+        // keep the result for the concealment
+        last_frame.resize(frame.size());
+        memcpy(last_frame.data(), frame.data(), frame.size());
+    }
+
+    void conceal() {
+        // use the decoder (with fec from the next packet if available)
+        if (p_decoder != nullptr) {
+            int next = slotIndex(next_seq + 1);
+            const uint8_t *p_next = next >= 0 ? slot_data.data() + next * cfg.max_packet_size : nullptr;
+            if (p_decoder->conceal(p_next, next >= 0 ? slot_len[next] : 0) && frame.size() > 0) {
+                return;
+            }
+            frame.clear();
+        }
+        // repeat the last frame and fade out over max_concealment frames
+        if (cfg.bits_per_sample != 16 || last_frame.size() == 0) return;
+        frame.set(last_frame.data(), last_frame.size());
+        int16_t *p_data = (int16_t *)frame.data();
+        int channels = cfg.channels > 0 ? cfg.channels : 1;
+        int frames = frame.size() / sizeof(int16_t) / channels;
+        float total = (float)frames * cfg.max_concealment;
+        float start = (float)frames * concealed;
+        for (int j = 0; j < frames; j++) {
+            float factor = 1.0f - (start + j) / total;
+            if (factor < 0.0f) factor = 0.0f;
+            for (int ch = 0; ch < channels; ch++) {
+                p_data[j * channels + ch] = factor * p_data[j * channels + ch];
+            }
+        }
+    }
+};
+
+}  // namespace audio_tools
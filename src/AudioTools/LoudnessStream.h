@@ -0,0 +1,366 @@
+#pragma once
+#include <math.h>
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/VolumeStream.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Number of taps per phase of the 4x oversampling filter for the true peak
+#ifndef LOUDNESS_TRUE_PEAK_TAPS
+#define LOUDNESS_TRUE_PEAK_TAPS 12
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Config for LoudnessStream
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct LoudnessConfig : public AudioBaseInfo {
+    LoudnessConfig() {
+        sample_rate = 44100;
+        bits_per_sample = 16;
+        channels = 2;
+    }
+    /// Target loudness for the normalization in LUFS (EBU R128: -23, ReplayGain 2.0: -18)
+    float target_lufs = -23.0f;
+    /// The normalization gain is limited, so that the true peak stays below this value in dBTP
+    float max_true_peak_db = -1.0f;
+    /// Determine the true peak with 4x oversampling (otherwise we use the sample peak)
+    bool true_peak = true;
+};
+
+/**
+ * @brief Loudness measurement according to EBU R128 / ITU-R BS.1770: The data is passed on
+ * unchanged and K-weighted in a single pass. We keep the energy of the last 30 blocks of
+ * 100ms to provide the momentary (400ms) and short-term (3s) loudness. The gated integrated loudness
+ * is determined from a histogram of the 400ms blocks with a resolution of 0.1 LU, so
+ * the memory is bounded independent of the length of the track. The true peak is determined with
+ * 4x oversampling. From this we calculate the normalization gain which can be applied to a VolumeStream.
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class LoudnessStream : public AudioStream {
+  public:
+    LoudnessStream() = default;
+
+    /// Constructor which assigns Print output
+    LoudnessStream(Print &out) { setTarget(out); }
+
+    /// Constructor which assigns Stream input or output
+    LoudnessStream(Stream &io) { setTarget(io); }
+
+    void setTarget(Print &out) { p_out = &out; }
+
+    void setTarget(Stream &io) {
+        p_in = &io;
+        p_out = &io;
+    }
+
+    LoudnessConfig defaultConfig() {
+        LoudnessConfig c;
+        return c;
+    }
+
+    bool begin(LoudnessConfig cfg) {
+        TRACED();
+        this->cfg = cfg;
+        info = cfg;
+        sample_bytes = cfg.bits_per_sample / 8;
+        if (sample_bytes != 2 && sample_bytes != 3 && sample_bytes != 4) {
+            LOGE("Unsupported bits_per_sample: %d", cfg.bits_per_sample);
+            return false;
+        }
+        max_value = NumberConverter::maxValue(cfg.bits_per_sample);
+        setupFilter(cfg.sample_rate);
+        setupTruePeak();
+        channel_states.resize(cfg.channels);
+        histogram.resize(histogram_size);
+        block_frames = cfg.sample_rate / 10;
+        reset();
+        is_active = true;
+        return true;
+    }
+
+    bool begin(AudioBaseInfo info) {
+        LoudnessConfig c = cfg;
+        c.sample_rate = info.sample_rate;
+        c.channels = info.channels;
+        c.bits_per_sample = info.bits_per_sample;
+        return begin(c);
+    }
+
+    void end() override { is_active = false; }
+
+    /// Restarts the measurement e.g. for a new track
+    void reset() {
+        for (int j = 0; j < channel_states.size(); j++) channel_states[j] = ChannelState();
+        for (int j = 0; j < histogram.size(); j++) histogram[j] = 0;
+        for (int j = 0; j < 30; j++) block_energy[j] = 0.0f;
+        block_count = 0;
+        block_pos = 0;
+        frame_count = 0;
+        channel = 0;
+        sample_peak = 0.0f;
+        true_peak = 0.0f;
+    }
+
+    void setAudioInfo(AudioBaseInfo info) override {
+        TRACED();
+        if (p_notify != nullptr) p_notify->setAudioInfo(info);
+        begin(info);
+    }
+
+    /// Measures the data and writes it unchanged to the output
+    size_t write(const uint8_t *data, size_t len) override {
+        if (is_active) measure(data, len);
+        return p_out == nullptr ? len : p_out->write(data, len);
+    }
+
+    /// Reads the data from the input and measures it
+    size_t readBytes(uint8_t *data, size_t len) override {
+        if (p_in == nullptr) return 0;
+        size_t result = p_in->readBytes(data, len);
+        if (is_active) measure(data, result);
+        return result;
+    }
+
+    int available() override { return p_in == nullptr ? 0 : p_in->available(); }
+
+    int availableForWrite() override { return p_out == nullptr ? DEFAULT_BUFFER_SIZE : p_out->availableForWrite(); }
+
+    /// Loudness of the last 400ms in LUFS
+    float momentaryLoudness() { return toLufs(averageEnergy(4)); }
+
+    /// Loudness of the last 3s in LUFS
+    float shortTermLoudness() { return toLufs(averageEnergy(30)); }
+
+    /// Gated loudness of all the data since begin() or reset() in LUFS
+    float integratedLoudness() {
+        // absolute gate at -70 LUFS is given by the histogram range
+        float energy = histogramEnergy(0);
+        if (energy <= 0.0f) return min_lufs;
+        // relative gate 10 LU below the loudness of the blocks above the absolute gate
+        int relative_bin = (toLufs(energy) - 10.0f - min_lufs) * 10.0f + 0.5f;
+        if (relative_bin < 0) relative_bin = 0;
+        return toLufs(histogramEnergy(relative_bin));
+    }
+
+    /// Maximum sample peak in dBFS
+    float samplePeakDb() { return toDb(sample_peak); }
+
+    /// Maximum true peak in dBTP (or sample peak if the true peak is deactivated)
+    float truePeakDb() { return toDb(cfg.true_peak ? true_peak : sample_peak); }
+
+    /// Gain in dB to reach the target loudness w/o exceeding the max true peak
+    float normalizationGainDb() {
+        float lufs = integratedLoudness();
+        if (lufs <= min_lufs) return 0.0f;
+        float gain = cfg.target_lufs - lufs;
+        float max_gain = cfg.max_true_peak_db - truePeakDb();
+        return gain < max_gain ? gain : max_gain;
+    }
+
+    /// Normalization gain as factor
+    float normalizationGain() { return powf(10.0f, normalizationGainDb() / 20.0f); }
+
+    /// Applies the normalization gain to the VolumeStream
+    void applyNormalization(VolumeStream &volume) {
+        LOGI("normalization: %f dB", normalizationGainDb());
+        volume.setNormalizationGain(normalizationGain());
+    }
+
+  protected:
+    /// Biquad states of the K-weighting filter and oversampling history
+    struct ChannelState {
+        float z1[2] = {0, 0};
+        float z2[2] = {0, 0};
+        float energy = 0.0f;
+        float history[LOUDNESS_TRUE_PEAK_TAPS] = {0};
+        int history_pos = 0;
+    };
+    const float min_lufs = -70.0f;
+    // 0.1 LU bins from -70 to +5 LUFS
+    const int histogram_size = 751;
+    LoudnessConfig cfg;
+    Print *p_out = nullptr;
+    Stream *p_in = nullptr;
+    bool is_active = false;
+    int sample_bytes = 2;
+    float max_value = 32767;
+    // K-weighting: high shelf and high pass
+    float b[2][3];
+    float a[2][3];
+    float true_peak_coef[4][LOUDNESS_TRUE_PEAK_TAPS];
+    Vector<ChannelState> channel_states{0};
+    Vector<uint32_t> histogram{0};
+    float block_energy[30];
+    int block_count = 0;
+    int block_pos = 0;
+    int block_frames = 4410;
+    int frame_count = 0;
+    int channel = 0;
+    float sample_peak = 0.0f;
+    float true_peak = 0.0f;
+
+    /// Calculates the K-weighting filter coefficients for the sample rate (ITU-R BS.1770)
+    void setupFilter(float rate) {
+        double f0 = 1681.974450955533;
+        double gain = 3.999843853973347;
+        double q = 0.7071752369554196;
+        double k = tan(M_PI * f0 / rate);
+        double vh = pow(10.0, gain / 20.0);
+        double vb = pow(vh, 0.4996667741545416);
+        double a0 = 1.0 + k / q + k * k;
+        b[0][0] = (vh + vb * k / q + k * k) / a0;
+        b[0][1] = 2.0 * (k * k - vh) / a0;
+        b[0][2] = (vh - vb * k / q + k * k) / a0;
+        a[0][1] = 2.0 * (k * k - 1.0) / a0;
+        a[0][2] = (1.0 - k / q + k * k) / a0;
+
+        f0 = 38.13547087602444;
+        q = 0.5003270373238773;
+        k = tan(M_PI * f0 / rate);
+        a0 = 1.0 + k / q + k * k;
+        b[1][0] = 1.0;
+        b[1][1] = -2.0;
+        b[1][2] = 1.0;
+        a[1][1] = 2.0 * (k * k - 1.0) / a0;
+        a[1][2] = (1.0 - k / q + k * k) / a0;
+    }
+
+    /// Polyphase coefficients of a windowed sinc low pass for the 4x oversampling
+    void setupTruePeak() {
+        const int len = 4 * LOUDNESS_TRUE_PEAK_TAPS;
+        for (int phase = 0; phase < 4; phase++) {
+            float sum = 0.0f;
+            for (int tap = 0; tap < LOUDNESS_TRUE_PEAK_TAPS; tap++) {
+                int n = tap * 4 + phase;
+                float x = (n - (len - 1) / 2.0f) / 4.0f;
+                float sinc = x == 0.0f ? 1.0f : sinf(M_PI * x) / (M_PI * x);
+                float window = 0.5f - 0.5f * cosf(2.0f * M_PI * (n + 0.5f) / len);
+                true_peak_coef[phase][tap] = sinc * window;
+                sum += sinc * window;
+            }
+            for (int tap = 0; tap < LOUDNESS_TRUE_PEAK_TAPS; tap++) true_peak_coef[phase][tap] /= sum;
+        }
+    }
+
+    void measure(const uint8_t *data, size_t len) {
+        size_t samples = len / sample_bytes;
+        for (size_t j = 0; j < samples; j++) {
+            float value = sample(data, j) / max_value;
+            ChannelState &state = channel_states[channel];
+            float abs_value = fabsf(value);
+            if (abs_value > sample_peak) sample_peak = abs_value;
+            if (cfg.true_peak) updateTruePeak(state, value);
+            float filtered = kWeighting(state, value);
+            state.energy += filtered * filtered;
+            if (++channel >= cfg.channels) {
+                channel = 0;
+                if (++frame_count >= block_frames) addBlock();
+            }
+        }
+    }
+
+    float sample(const uint8_t *data, size_t idx) {
+        switch (sample_bytes) {
+            case 2:
+                return ((int16_t *)data)[idx];
+            case 3:
+                return (int32_t)((int24_t *)data)[idx];
+            default:
+                return ((int32_t *)data)[idx];
+        }
+    }
+
+    float kWeighting(ChannelState &state, float value) {
+        for (int stage = 0; stage < 2; stage++) {
+            // transposed direct form II
+            float out = b[stage][0] * value + state.z1[stage];
+            state.z1[stage] = b[stage][1] * value - a[stage][1] * out + state.z2[stage];
+            state.z2[stage] = b[stage][2] * value - a[stage][2] * out;
+            value = out;
+        }
+        return value;
+    }
+
+    void updateTruePeak(ChannelState &state, float value) {
+        state.history[state.history_pos] = value;
+        if (++state.history_pos >= LOUDNESS_TRUE_PEAK_TAPS) state.history_pos = 0;
+        for (int phase = 0; phase < 4; phase++) {
+            float sum = 0.0f;
+            int pos = state.history_pos;
+            for (int tap = LOUDNESS_TRUE_PEAK_TAPS - 1; tap >= 0; tap--) {
+                sum += true_peak_coef[phase][tap] * state.history[pos];
+                if (++pos >= LOUDNESS_TRUE_PEAK_TAPS) pos = 0;
+            }
+            sum = fabsf(sum);
+            if (sum > true_peak) true_peak = sum;
+        }
+        if (fabsf(value) > true_peak) true_peak = fabsf(value);
+    }
+
+    /// Channel weight: the surround channels of 5.1 are weighted with +1.5 dB and the LFE is ignored
+    float channelWeight(int ch) {
+        if (cfg.channels != 6) return 1.0f;
+        if (ch == 3) return 0.0f;
+        return ch >= 4 ? 1.41f : 1.0f;
+    }
+
+    /// Completes a block of 100ms and adds the 400ms gating block to the histogram
+    void addBlock() {
+        float energy = 0.0f;
+        for (int ch = 0; ch < cfg.channels; ch++) {
+            energy += channelWeight(ch) * channel_states[ch].energy / frame_count;
+            channel_states[ch].energy = 0.0f;
+        }
+        frame_count = 0;
+        block_energy[block_pos] = energy;
+        if (++block_pos >= 30) block_pos = 0;
+        block_count++;
+        if (block_count >= 4) {
+            float lufs = toLufs(averageEnergy(4));
+            if (lufs >= min_lufs) {
+                int bin = (lufs - min_lufs) * 10.0f + 0.5f;
+                if (bin >= histogram_size) bin = histogram_size - 1;
+                histogram[bin]++;
+            }
+        }
+    }
+
+    /// Average energy of the last n blocks of 100ms
+    float averageEnergy(int n) {
+        if (n > block_count) n = block_count;
+        if (n == 0) return 0.0f;
+        float sum = 0.0f;
+        int pos = block_pos;
+        for (int j = 0; j < n; j++) {
+            if (--pos < 0) pos = 29;
+            sum += block_energy[pos];
+        }
+        return sum / n;
+    }
+
+    /// Average energy of the gating blocks in the histogram starting from the indicated bin
+    float histogramEnergy(int from) {
+        double sum = 0.0;
+        uint32_t count = 0;
+        for (int j = from; j < histogram_size; j++) {
+            if (histogram[j] == 0) continue;
+            float lufs = min_lufs + j / 10.0f;
+            sum += histogram[j] * pow(10.0, (lufs + 0.691) / 10.0);
+            count += histogram[j];
+        }
+        return count == 0 ? 0.0f : sum / count;
+    }
+
+    float toLufs(float energy) {
+        return energy <= 0.0f ? -120.0f : -0.691f + 10.0f * log10f(energy);
+    }
+
+    float toDb(float value) { return value <= 0.0f ? -120.0f : 20.0f * log10f(value); }
+};
+
+}  // namespace audio_tools
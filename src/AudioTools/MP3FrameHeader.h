@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace audio_tools {
+
+/**
+ * @brief Information which is available in the 4 byte header of a MPEG audio frame
+ * @ingroup tools
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct MP3FrameHeader {
+  int version = 0;            // 10 = MPEG1, 20 = MPEG2, 25 = MPEG2.5
+  int layer = 0;              // 1,2 or 3
+  int bit_rate = 0;           // in bits per second
+  int sample_rate = 0;        // in Hz
+  int channels = 0;
+  int samples_per_frame = 0;
+  int frame_length = 0;       // in bytes including the header
+
+  /// Parses the 4 header bytes: returns false if this is not a valid frame header
+  bool parse(const uint8_t *h) {
+    if (h[0] != 0xFF || (h[1] & 0xE0) != 0xE0) return false;
+    int version_bits = (h[1] >> 3) & 3;
+    int layer_bits = (h[1] >> 1) & 3;
+    int bitrate_idx = h[2] >> 4;
+    int rate_idx = (h[2] >> 2) & 3;
+    int padding = (h[2] >> 1) & 1;
+    if (version_bits == 1 || layer_bits == 0 || bitrate_idx == 0 || bitrate_idx == 15 || rate_idx == 3) return false;
+
+    static const uint16_t bitrates[2][3][15] = {
+        {{0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448},
+         {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384},
+         {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320}},
+        {{0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256},
+         {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160},
+         {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160}}};
+    static const uint16_t rates[3] = {44100, 48000, 32000};
+
+    version = version_bits == 3 ? 10 : (version_bits == 2 ? 20 : 25);
+    layer = 4 - layer_bits;
+    bool is_mpeg1 = version == 10;
+    bit_rate = bitrates[is_mpeg1 ? 0 : 1][layer - 1][bitrate_idx] * 1000;
+    sample_rate = rates[rate_idx] / (is_mpeg1 ? 1 : (version == 20 ? 2 : 4));
+    channels = (h[3] >> 6) == 3 ? 1 : 2;
+    if (layer == 1) {
+      samples_per_frame = 384;
+      frame_length = (12 * bit_rate / sample_rate + padding) * 4;
+    } else {
+      samples_per_frame = (layer == 3 && !is_mpeg1) ? 576 : 1152;
+      frame_length = samples_per_frame / 8 * bit_rate / sample_rate + padding;
+    }
+    return frame_length > 4;
+  }
+
+  /// Offset of the Xing/Info header in the first frame
+  int xingOffset() {
+    if (version == 10) return 4 + (channels == 1 ? 17 : 32);
+    return 4 + (channels == 1 ? 9 : 17);
+  }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string.h>
+#include "AudioConfig.h"
+#include "AudioTools/AudioLogger.h"
+#include "AudioBasic/Collections/Vector.h"
+#include "AudioTools/MP3FrameHeader.h"
+
+namespace audio_tools {
+
+/**
+ * @brief Determines the mime type from the first bytes of the audio data. We support
+ * RIFF/WAVE, ID3 and MPEG audio frames, AAC ADTS, FLAC, Ogg (with the Opus, Vorbis and FLAC
+ * mapping) and raw PCM. Additional formats can be added with setCheck(). The data should
+ * contain at least MIME_DETECTOR_MIN_SIZE bytes.
+ * @ingroup tools
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class MimeDetector {
+  public:
+    MimeDetector() = default;
+
+    /// Adds a custom check which is executed before the built in checks
+    void setCheck(const char* mime, bool (*check)(const uint8_t* data, size_t len)) {
+        Check c;
+        c.mime = mime;
+        c.check = check;
+        checks.push_back(c);
+    }
+
+    /// Defines the result if the format could not be determined
+    void setDefaultMime(const char* mime) {
+        default_mime = mime;
+    }
+
+    /// Determines the mime type of the data
+    const char* detect(const uint8_t* data, size_t len) {
+        const char* result = detectFormat(data, len);
+        LOGI("mime: %s", result == nullptr ? "n/a" : result);
+        return result;
+    }
+
+  protected:
+    struct Check {
+        const char* mime = nullptr;
+        bool (*check)(const uint8_t* data, size_t len) = nullptr;
+    };
+    Vector<Check> checks;
+    const char* default_mime = nullptr;
+
+    const char* detectFormat(const uint8_t* data, size_t len) {
+        for (auto &c : checks) {
+            if (c.check(data, len)) return c.mime;
+        }
+        if (len < 4) return default_mime;
+        if (len >= 12 && memcmp(data, "RIFF", 4) == 0 && memcmp(data + 8, "WAVE", 4) == 0) return "audio/vnd.wave";
+        if (memcmp(data, "fLaC", 4) == 0) return "audio/flac";
+        if (memcmp(data, "OggS", 4) == 0) return oggMime(data, len);
+        if (memcmp(data, "ID3", 3) == 0) return "audio/mpeg";
+        if (isADTS(data, len)) return "audio/aac";
+        if (isMP3(data, len)) return "audio/mpeg";
+        if (isPCM(data, len)) return "audio/pcm";
+        return default_mime;
+    }
+
+    /// Determines the codec from the first page of the ogg container
+    const char* oggMime(const uint8_t* data, size_t len) {
+        if (len > 27) {
+            size_t payload = 27 + data[26];
+            if (payload + 8 <= len) {
+                const uint8_t* start = data + payload;
+                if (memcmp(start, "OpusHead", 8) == 0) return "audio/ogg;codecs=opus";
+                if (memcmp(start, "\x01vorbis", 7) == 0) return "audio/ogg;codecs=vorbis";
+                if (memcmp(start, "\x7F" "FLAC", 5) == 0) return "audio/ogg;codecs=flac";
+            }
+        }
+        return "audio/ogg";
+    }
+
+    /// AAC ADTS: 12 bit sync word with layer 0 and a valid sampling rate index
+    bool isADTS(const uint8_t* data, size_t len) {
+        if (len < 3 || data[0] != 0xFF || (data[1] & 0xF6) != 0xF0) return false;
+        int rate_idx = (data[2] >> 2) & 0xF;
+        if (rate_idx > 12) return false;
+        // we can not check the frame length
+        if (len < 6) return true;
+        // confirm with the next frame if possible
+        size_t frame_len = ((data[3] & 0x03) << 11) | (data[4] << 3) | (data[5] >> 5);
+        if (frame_len < 7) return false;
+        if (frame_len + 2 <= len) {
+            return data[frame_len] == 0xFF && (data[frame_len + 1] & 0xF6) == 0xF0;
+        }
+        return true;
+    }
+
+    /// MPEG audio frame header: confirmed with the next frame if the data is long enough
+    bool isMP3(const uint8_t* data, size_t len) {
+        MP3FrameHeader header;
+        if (!header.parse(data)) return false;
+        size_t next = header.frame_length;
+        if (next + 4 <= len) {
+            MP3FrameHeader next_header;
+            return next_header.parse(data + next);
+        }
+        return true;
+    }
+
+    /// Heuristic for 16 bit signed PCM: audio changes slowly, so the difference of
+    /// consecutive samples is small compared to the amplitude of encoded (random) data
+    bool isPCM(const uint8_t* data, size_t len) {
+        size_t samples = len / 2;
+        if (samples < 16) return false;
+        uint32_t smooth = 0;
+        for (size_t j = 1; j < samples; j++) {
+            int32_t diff = (int32_t)pcmSample(data, j) - pcmSample(data, j - 1);
+            if (diff < 0) diff = -diff;
+            // allow for interleaved stereo by comparing with the previous frame as well
+            int32_t diff2 = j > 1 ? (int32_t)pcmSample(data, j) - pcmSample(data, j - 2) : diff;
+            if (diff2 < 0) diff2 = -diff2;
+            if (diff < 4096 || diff2 < 4096) smooth++;
+        }
+        return smooth * 10 >= (samples - 1) * 9;
+    }
+
+    /// Provides the indicated little endian 16 bit sample: the data might not be aligned
+    int16_t pcmSample(const uint8_t* data, size_t idx) {
+        return (int16_t)(data[idx * 2] | (data[idx * 2 + 1] << 8));
+    }
+};
+
+}  // namespace audio_tools
@@ -0,0 +1,822 @@
+#pragma once
+#include <stdlib.h>
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/AudioPrint.h"
+#include "AudioTools/JitterBuffer.h"
+#include "AudioCodecs/AudioEncoded.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Default MTU: the max payload is reduced by the IP, UDP and RTP header
+#ifndef RTP_MTU
+#define RTP_MTU 1500
+#endif
+
+/// Default interval for the RTCP sender and receiver reports
+#ifndef RTCP_INTERVAL_MS
+#define RTCP_INTERVAL_MS 5000
+#endif
+
+/// Max size of a received RTCP packet
+#ifndef RTCP_MAX_PACKET_SIZE
+#define RTCP_MAX_PACKET_SIZE 512
+#endif
+
+namespace audio_tools {
+
+/**
+ * @brief Supported RTP payload formats
+ * @ingroup communications
+ */
+enum RTPPayloadFormat { RTP_L16, RTP_PCMU, RTP_PCMA, RTP_OPUS };
+
+/**
+ * @brief Information of a parsed RTP header
+ * @ingroup communications
+ */
+struct RTPHeaderInfo {
+    uint8_t payload_type = 0;
+    bool marker = false;
+    uint16_t seq = 0;
+    uint32_t timestamp = 0;
+    uint32_t ssrc = 0;
+    /// offset of the payload
+    int header_len = 0;
+    /// length of the payload w/o padding
+    int payload_len = 0;
+};
+
+/**
+ * @brief Statistics of a RTP session: on the sender side the loss and jitter are
+ * reported by the receiver with RTCP receiver reports.
+ * @ingroup communications
+ */
+struct RTPStatistics {
+    uint32_t packets = 0;
+    uint32_t octets = 0;
+    /// cumulative number of lost packets
+    int32_t lost = 0;
+    /// fraction of lost packets in the last report interval (in 1/256)
+    uint8_t fraction_lost = 0;
+    /// interarrival jitter in timestamp units
+    uint32_t jitter = 0;
+    /// round trip time in ms: -1 if not known
+    int rtt_ms = -1;
+};
+
+/**
+ * @brief Encoding and decoding of RTP and RTCP headers (RFC 3550)
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class RTPHeader {
+  public:
+    static const int SIZE = 12;
+
+    static void put16(uint8_t *p, uint16_t value) {
+        p[0] = value >> 8;
+        p[1] = value & 0xFF;
+    }
+
+    static void put32(uint8_t *p, uint32_t value) {
+        put16(p, value >> 16);
+        put16(p + 2, value & 0xFFFF);
+    }
+
+    static uint16_t get16(const uint8_t *p) { return (p[0] << 8) | p[1]; }
+
+    static uint32_t get32(const uint8_t *p) {
+        return ((uint32_t)get16(p) << 16) | get16(p + 2);
+    }
+
+    /// Writes the fixed 12 byte header
+    static void write(uint8_t *p, uint8_t payloadType, bool marker, uint16_t seq,
+                      uint32_t timestamp, uint32_t ssrc) {
+        p[0] = 0x80;  // version 2, no padding, extension or csrc
+        p[1] = (marker ? 0x80 : 0) | (payloadType & 0x7F);
+        put16(p + 2, seq);
+        put32(p + 4, timestamp);
+        put32(p + 8, ssrc);
+    }
+
+    /// Parses the header incl. the csrc list, the extension and the padding
+    static bool parse(const uint8_t *p, size_t len, RTPHeaderInfo &info) {
+        if (len < SIZE || (p[0] >> 6) != 2) return false;
+        int csrc_count = p[0] & 0x0F;
+        int header_len = SIZE + 4 * csrc_count;
+        if (p[0] & 0x10) {
+            // header extension
+            if ((int)len < header_len + 4) return false;
+            header_len += 4 + 4 * get16(p + header_len + 2);
+        }
+        int padding = (p[0] & 0x20) ? p[len - 1] : 0;
+        if ((int)len < header_len + padding) return false;
+        info.marker = p[1] & 0x80;
+        info.payload_type = p[1] & 0x7F;
+        info.seq = get16(p + 2);
+        info.timestamp = get32(p + 4);
+        info.ssrc = get32(p + 8);
+        info.header_len = header_len;
+        info.payload_len = len - header_len - padding;
+        return true;
+    }
+
+    /// Random value for the ssrc and the initial sequence number and timestamp
+    static uint32_t randomValue() {
+        return ((uint32_t)rand() << 16) ^ (uint32_t)rand() ^ (uint32_t)millis();
+    }
+
+    /// Middle 32 bits of the NTP timestamp derived from millis() (used for LSR and DLSR)
+    static uint32_t ntpMiddle() {
+        uint32_t sec, frac;
+        ntp(sec, frac);
+        return (sec << 16) | (frac >> 16);
+    }
+
+    /// NTP timestamp: we do not have a wall clock, so the time is relative to the start
+    static void ntp(uint32_t &sec, uint32_t &frac) {
+        uint64_t ms = millis();
+        sec = ms / 1000;
+        frac = ((ms % 1000) << 32) / 1000;
+    }
+};
+
+/**
+ * @brief Config for the RTPSenderStream and RTPReceiverStream
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct RTPConfig : public AudioBaseInfo {
+    RTPConfig() {
+        sample_rate = 8000;
+        channels = 1;
+        bits_per_sample = 16;
+    }
+    RTPPayloadFormat format = RTP_L16;
+    /// payload type: if -1 we use the static type of the format or 96 for dynamic formats
+    int payload_type = -1;
+    /// RTP clock rate: if 0 we use the sample rate (or 48000 for Opus)
+    int clock_rate = 0;
+    /// duration of one packet in ms (for Opus this must match the frame size of the encoder)
+    int packet_time_ms = 20;
+    /// MTU of the network: the packets are limited to the MTU w/o IP and UDP header
+    int mtu = RTP_MTU;
+    /// synchronization source identifier: if 0 a random value is used
+    uint32_t ssrc = 0;
+    /// canonical name which is sent with the RTCP reports
+    const char *cname = "arduino-audio-tools";
+    /// interval of the RTCP reports: 0 to deactivate
+    int rtcp_interval_ms = RTCP_INTERVAL_MS;
+    /// receiver: number of packets which can be buffered
+    int slots = JITTER_BUFFER_SLOTS;
+    /// receiver: number of packets which are buffered before the playback starts
+    int min_depth = 2;
+    /// receiver: upper limit of the buffered packets
+    int max_depth = 8;
+
+    /// Provides the effective payload type
+    int payloadType() {
+        if (payload_type >= 0) return payload_type;
+        switch (format) {
+            case RTP_PCMU:
+                return 0;
+            case RTP_PCMA:
+                return 8;
+            case RTP_L16:
+                // static types only exist for 44100 Hz
+                if (sample_rate == 44100 && channels <= 2) return channels == 2 ? 10 : 11;
+                return 96;
+            default:
+                return 96;
+        }
+    }
+
+    /// Provides the effective clock rate
+    int clockRate() {
+        if (clock_rate > 0) return clock_rate;
+        return format == RTP_OPUS ? 48000 : sample_rate;
+    }
+
+    /// Max size of the payload: MTU - IP header (20) - UDP header (8) - RTP header
+    int maxPayloadSize() { return mtu - 28 - RTPHeader::SIZE; }
+
+    /// Bytes per frame in the payload: 0 for frame based formats
+    int payloadBytesPerFrame() {
+        switch (format) {
+            case RTP_L16:
+                return 2 * channels;
+            case RTP_PCMU:
+            case RTP_PCMA:
+                return channels;
+            default:
+                return 0;
+        }
+    }
+};
+
+/**
+ * @brief Sends the written PCM data as RTP packets to the output, which must send each
+ * write as one datagram (e.g. UDPStream). L16 data is converted to network byte order.
+ * For the other formats an encoder must be provided (e.g. G711_ULAWEncoder, G711_ALAWEncoder
+ * or OpusAudioEncoder): sample based formats are split into packets with the configured packet
+ * time (limited by the MTU) and for Opus each encoded frame is sent as one packet. The encoded
+ * data is written directly after the reserved header, so the header does not need to be copied.
+ * Optionally RTCP sender reports are sent and the receiver reports are evaluated
+ * (see setRTCP()).
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class RTPSenderStream : public AudioPrint {
+  public:
+    RTPSenderStream() = default;
+
+    RTPSenderStream(Print &out) { setOutput(out); }
+
+    RTPSenderStream(Print &out, AudioEncoder &encoder) {
+        setOutput(out);
+        setEncoder(encoder);
+    }
+
+    void setOutput(Print &out) { p_out = &out; }
+
+    /// Defines the encoder: not needed for L16
+    void setEncoder(AudioEncoder &encoder) { p_encoder = &encoder; }
+
+    /// Defines the stream (e.g. a UDPStream with port + 1) which is used for RTCP
+    void setRTCP(Stream &rtcp) { p_rtcp = &rtcp; }
+
+    RTPConfig defaultConfig() {
+        RTPConfig c;
+        return c;
+    }
+
+    bool begin() { return begin(cfg); }
+
+    bool begin(RTPConfig config) {
+        TRACEI();
+        cfg = config;
+        AudioPrint::cfg = config;
+        if (p_out == nullptr) {
+            LOGE("output not defined");
+            return false;
+        }
+        if (cfg.format == RTP_L16 && cfg.bits_per_sample != 16) {
+            LOGE("L16 requires 16 bits_per_sample");
+            return false;
+        }
+        if (cfg.format != RTP_L16 && p_encoder == nullptr) {
+            LOGE("encoder not defined");
+            return false;
+        }
+        ssrc = cfg.ssrc != 0 ? cfg.ssrc : RTPHeader::randomValue();
+        seq = RTPHeader::randomValue();
+        timestamp = RTPHeader::randomValue();
+        marker = true;
+        stats = RTPStatistics();
+        last_rtcp_ms = 0;
+
+        int max_payload = cfg.maxPayloadSize();
+        int frame_bytes = cfg.payloadBytesPerFrame();
+        int frames = cfg.packet_time_ms * cfg.sample_rate / 1000;
+        if (frame_bytes > 0) {
+            // sample based: the packet size is limited by the mtu
+            if (frames * frame_bytes > max_payload) {
+                frames = max_payload / frame_bytes;
+                LOGW("packet time reduced to %d frames", frames);
+            }
+            payload_size = frames * frame_bytes;
+        } else {
+            payload_size = max_payload;
+        }
+        if (payload_size <= 0) {
+            LOGE("invalid packet size");
+            return false;
+        }
+        timestamp_increment = (uint64_t)frames * cfg.clockRate() / cfg.sample_rate;
+        packet.resize(RTPHeader::SIZE + payload_size);
+        payload_pos = 0;
+        has_odd_byte = false;
+
+        if (p_encoder != nullptr) {
+            packet_writer.p_sender = this;
+            Print *p_print = &packet_writer;
+            p_encoder->setOutputStream(*p_print);
+            p_encoder->setAudioInfo(cfg);
+            p_encoder->begin();
+        }
+        is_active = true;
+        return true;
+    }
+
+    /// Sends the last incomplete packet
+    void end() {
+        if (!is_active) return;
+        if (p_encoder != nullptr) p_encoder->end();
+        if (payload_pos > 0) sendPacket(payload_pos, timestamp_increment * payload_pos / payload_size);
+        sendReport();
+        is_active = false;
+    }
+
+    /// Provides the PCM data which will be sent
+    size_t write(const uint8_t *data, size_t len) override {
+        if (!is_active) return 0;
+        size_t result = 0;
+        if (p_encoder != nullptr) {
+            result = p_encoder->write(data, len);
+        } else {
+            result = writePayload(data, len, true);
+        }
+        receiveReports();
+        if (isReportDue()) sendReport();
+        return result;
+    }
+
+    int availableForWrite() override { return payload_size; }
+
+    /// Statistics: the loss, jitter and rtt are provided by the receiver reports
+    RTPStatistics &statistics() { return stats; }
+
+    uint16_t sequenceNumber() { return seq; }
+
+    uint32_t rtpTimestamp() { return timestamp; }
+
+    uint32_t ssrcValue() { return ssrc; }
+
+  protected:
+    /// Collects the output of the encoder
+    class PacketWriter : public Print {
+      public:
+        RTPSenderStream *p_sender = nullptr;
+        size_t write(const uint8_t *data, size_t len) override {
+            return p_sender->writePayload(data, len, false);
+        }
+        size_t write(uint8_t ch) override { return write(&ch, 1); }
+        int availableForWrite() override { return p_sender->payload_size; }
+    };
+
+    RTPConfig cfg;
+    Print *p_out = nullptr;
+    Stream *p_rtcp = nullptr;
+    AudioEncoder *p_encoder = nullptr;
+    PacketWriter packet_writer;
+    Vector<uint8_t> packet{0};
+    Vector<uint8_t> rtcp_packet{0};
+    RTPStatistics stats;
+    int payload_size = 0;
+    int payload_pos = 0;
+    // L16: first byte of a sample which was split by a write
+    uint8_t odd_byte = 0;
+    bool has_odd_byte = false;
+    uint32_t timestamp_increment = 0;
+    uint32_t ssrc = 0;
+    uint16_t seq = 0;
+    uint32_t timestamp = 0;
+    uint32_t last_sr = 0;
+    uint64_t last_rtcp_ms = 0;
+    bool marker = true;
+    bool is_active = false;
+
+    /// Adds the payload to the packet: swap is used to convert the L16 data to big endian
+    size_t writePayload(const uint8_t *data, size_t len, bool swap) {
+        if (cfg.payloadBytesPerFrame() == 0) {
+            // frame based: one write is one packet
+            if ((int)len > payload_size) {
+                LOGE("frame too big for mtu: %d", (int)len);
+                return len;
+            }
+            memcpy(packet.data() + RTPHeader::SIZE, data, len);
+            sendPacket(len, timestamp_increment);
+            return len;
+        }
+        size_t pos = 0;
+        if (swap && has_odd_byte && len > 0) {
+            // complete the sample which was split by the last write
+            uint8_t *p_payload = packet.data() + RTPHeader::SIZE + payload_pos;
+            p_payload[0] = data[0];
+            p_payload[1] = odd_byte;
+            has_odd_byte = false;
+            payload_pos += 2;
+            pos = 1;
+            sendFullPacket();
+        }
+        while (pos < len) {
+            size_t n = payload_size - payload_pos;
+            if (n > len - pos) n = len - pos;
+            uint8_t *p_payload = packet.data() + RTPHeader::SIZE + payload_pos;
+            if (swap) {
+                // L16: network byte order; an incomplete sample is kept for the next write
+                n &= ~(size_t)1;
+                if (n == 0) {
+                    odd_byte = data[pos];
+                    has_odd_byte = true;
+                    break;
+                }
+                for (size_t j = 0; j < n; j += 2) {
+                    p_payload[j] = data[pos + j + 1];
+                    p_payload[j + 1] = data[pos + j];
+                }
+            } else {
+                memcpy(p_payload, data + pos, n);
+            }
+            payload_pos += n;
+            pos += n;
+            sendFullPacket();
+        }
+        return len;
+    }
+
+    /// Sends the packet if the payload is complete
+    void sendFullPacket() {
+        if (payload_pos == payload_size) {
+            sendPacket(payload_size, timestamp_increment);
+            payload_pos = 0;
+        }
+    }
+
+    void sendPacket(int len, uint32_t tsIncrement) {
+        RTPHeader::write(packet.data(), cfg.payloadType(), marker, seq, timestamp, ssrc);
+        size_t size = RTPHeader::SIZE + len;
+        if (p_out->write(packet.data(), size) != size) {
+            LOGW("packet %u not sent", seq);
+        }
+        marker = false;
+        seq++;
+        timestamp += tsIncrement;
+        stats.packets++;
+        stats.octets += len;
+    }
+
+    bool isReportDue() {
+        if (p_rtcp == nullptr || cfg.rtcp_interval_ms <= 0 || stats.packets == 0) return false;
+        return millis() - last_rtcp_ms >= (uint64_t)cfg.rtcp_interval_ms;
+    }
+
+    /// Sends a compound RTCP packet with a sender report and the cname
+    void sendReport() {
+        if (p_rtcp == nullptr || stats.packets == 0) return;
+        last_rtcp_ms = millis();
+        int cname_len = strlen(cfg.cname);
+        // sdes: header + ssrc + type + len + cname + end, padded to 32 bits
+        int sdes_len = (8 + 2 + cname_len + 1 + 3) / 4 * 4;
+        rtcp_packet.resize(28 + sdes_len);
+        memset(rtcp_packet.data(), 0, rtcp_packet.size());
+        uint8_t *p = rtcp_packet.data();
+        uint32_t sec, frac;
+        RTPHeader::ntp(sec, frac);
+        p[0] = 0x80;
+        p[1] = 200;
+        RTPHeader::put16(p + 2, 6);
+        RTPHeader::put32(p + 4, ssrc);
+        RTPHeader::put32(p + 8, sec);
+        RTPHeader::put32(p + 12, frac);
+        RTPHeader::put32(p + 16, timestamp);
+        RTPHeader::put32(p + 20, stats.packets);
+        RTPHeader::put32(p + 24, stats.octets);
+        last_sr = (sec << 16) | (frac >> 16);
+        p += 28;
+        p[0] = 0x81;
+        p[1] = 202;
+        RTPHeader::put16(p + 2, sdes_len / 4 - 1);
+        RTPHeader::put32(p + 4, ssrc);
+        p[8] = 1;  // CNAME
+        p[9] = cname_len;
+        memcpy(p + 10, cfg.cname, cname_len);
+        p_rtcp->write(rtcp_packet.data(), rtcp_packet.size());
+    }
+
+    /// Evaluates the receiver reports
+    void receiveReports() {
+        if (p_rtcp == nullptr) return;
+        uint8_t buffer[RTCP_MAX_PACKET_SIZE];
+        while (p_rtcp->available() > 0) {
+            int len = p_rtcp->readBytes(buffer, RTCP_MAX_PACKET_SIZE);
+            if (len <= 0) break;
+            int pos = 0;
+            // compound packet
+            while (pos + 8 <= len) {
+                const uint8_t *p = buffer + pos;
+                int size = (RTPHeader::get16(p + 2) + 1) * 4;
+                if ((p[0] >> 6) != 2 || pos + size > len) break;
+                int count = p[0] & 0x1F;
+                // report blocks of a RR (201) or SR (200)
+                int offset = p[1] == 201 ? 8 : p[1] == 200 ? 28 : -1;
+                for (int j = 0; offset > 0 && j < count && offset + 24 * (j + 1) <= size; j++) {
+                    evaluateReportBlock(p + offset + 24 * j);
+                }
+                pos += size;
+            }
+        }
+    }
+
+    void evaluateReportBlock(const uint8_t *p) {
+        if (RTPHeader::get32(p) != ssrc) return;
+        stats.fraction_lost = p[4];
+        int32_t lost = ((uint32_t)p[5] << 16) | (p[6] << 8) | p[7];
+        // 24 bit signed
+        if (lost & 0x800000) lost -= 0x1000000;
+        stats.lost = lost;
+        stats.jitter = RTPHeader::get32(p + 12);
+        uint32_t lsr = RTPHeader::get32(p + 16);
+        uint32_t dlsr = RTPHeader::get32(p + 20);
+        if (lsr != 0 && lsr == last_sr) {
+            uint32_t rtt = RTPHeader::ntpMiddle() - lsr - dlsr;
+            stats.rtt_ms = (uint64_t)rtt * 1000 / 65536;
+        }
+        LOGI("report: lost %d, jitter %u, rtt %d ms", (int)stats.lost, stats.jitter, stats.rtt_ms);
+    }
+};
+
+/**
+ * @brief Receives RTP packets e.g. from a UDPStream and provides the PCM data via
+ * readBytes(): the header is parsed and stripped, packets with a different payload type are
+ * ignored and the packets are passed to a JitterBufferStream which restores the order,
+ * removes the duplicates and conceals the lost packets. For PCMU, PCMA and Opus a decoder
+ * must be provided. Optionally RTCP receiver reports are sent and the sender reports
+ * are evaluated (see setRTCP()). The playout is driven by the sequence numbers, so the
+ * RTP timestamps are not used.
+ * @ingroup communications
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class RTPReceiverStream : public AudioStream {
+  public:
+    RTPReceiverStream() = default;
+
+    RTPReceiverStream(Stream &in) { setInput(in); }
+
+    RTPReceiverStream(Stream &in, AudioDecoder &decoder) {
+        setInput(in);
+        setDecoder(decoder);
+    }
+
+    /// Defines the input from which the packets are received: one packet per datagram
+    void setInput(Stream &in) { p_in = &in; }
+
+    /// Defines the decoder: not needed for L16
+    void setDecoder(AudioDecoder &decoder) { p_decoder = &decoder; }
+
+    /// Defines the stream (e.g. a UDPStream with port + 1) which is used for RTCP
+    void setRTCP(Stream &rtcp) { p_rtcp = &rtcp; }
+
+    RTPConfig defaultConfig() {
+        RTPConfig c;
+        return c;
+    }
+
+    bool begin() override { return begin(cfg); }
+
+    bool begin(RTPConfig config) {
+        TRACEI();
+        cfg = config;
+        info = config;
+        if (cfg.format != RTP_L16 && p_decoder == nullptr) {
+            LOGE("decoder not defined");
+            return false;
+        }
+        packet.resize(cfg.mtu - 28);
+        JitterBufferConfig jc = jitter.defaultConfig();
+        jc.copyFrom(cfg);
+        jc.slots = cfg.slots;
+        jc.max_packet_size = cfg.maxPayloadSize();
+        jc.min_depth = cfg.min_depth;
+        jc.max_depth = cfg.max_depth;
+        if (p_decoder != nullptr) jitter.setDecoder(*p_decoder);
+        resetStatistics();
+        has_ssrc = false;
+        last_rtcp_ms = 0;
+        ssrc = RTPHeader::randomValue();
+        is_active = jitter.begin(jc);
+        return is_active;
+    }
+
+    void end() override {
+        jitter.end();
+        is_active = false;
+    }
+
+    /// Adds a RTP packet
+    size_t write(const uint8_t *data, size_t len) override {
+        if (!is_active) return 0;
+        if (len > packet.size()) {
+            LOGE("packet too big: %d", (int)len);
+            return len;
+        }
+        memcpy(packet.data(), data, len);
+        processPacket(len);
+        return len;
+    }
+
+    /// Reads all available packets from the input
+    void receive() {
+        if (p_in == nullptr) return;
+        for (int j = 0; j < cfg.slots; j++) {
+            int size = p_in->available();
+            if (size <= 0) break;
+            if (size > packet.size()) {
+                LOGE("packet too big: %d", size);
+                size = packet.size();
+            }
+            size_t len = p_in->readBytes(packet.data(), size);
+            if (len == 0) break;
+            processPacket(len);
+        }
+    }
+
+    /// Provides the PCM data
+    size_t readBytes(uint8_t *data, size_t len) override {
+        if (!is_active) return 0;
+        receive();
+        receiveReports();
+        if (isReportDue()) sendReport();
+        return jitter.readBytes(data, len);
+    }
+
+    int available() override {
+        if (!is_active) return 0;
+        receive();
+        return jitter.available();
+    }
+
+    int availableForWrite() override { return packet.size(); }
+
+    /// Statistics of the received packets
+    RTPStatistics &statistics() {
+        stats.lost = expectedPackets() - (int32_t)stats.packets;
+        return stats;
+    }
+
+    /// Provides access to the jitter buffer e.g. for its statistics
+    JitterBufferStream &jitterBuffer() { return jitter; }
+
+  protected:
+    RTPConfig cfg;
+    Stream *p_in = nullptr;
+    Stream *p_rtcp = nullptr;
+    AudioDecoder *p_decoder = nullptr;
+    JitterBufferStream jitter;
+    Vector<uint8_t> packet{0};
+    RTPStatistics stats;
+    uint32_t ssrc = 0;
+    uint32_t sender_ssrc = 0;
+    bool has_ssrc = false;
+    bool is_active = false;
+    // sequence number tracking (RFC 3550 A.1)
+    uint16_t base_seq = 0;
+    uint16_t max_seq = 0;
+    uint32_t cycles = 0;
+    uint32_t expected_prior = 0;
+    uint32_t received_prior = 0;
+    // jitter (RFC 3550 A.8): scaled by 16
+    uint32_t jitter_q4 = 0;
+    int32_t last_transit = 0;
+    bool has_transit = false;
+    // sender reports
+    uint32_t last_sr = 0;
+    uint64_t last_sr_ms = 0;
+    uint64_t last_rtcp_ms = 0;
+
+    void resetStatistics() {
+        stats = RTPStatistics();
+        cycles = 0;
+        expected_prior = 0;
+        received_prior = 0;
+        jitter_q4 = 0;
+        has_transit = false;
+        last_sr = 0;
+    }
+
+    int32_t expectedPackets() {
+        if (stats.packets == 0) return 0;
+        return (cycles + max_seq) - base_seq + 1;
+    }
+
+    void processPacket(size_t len) {
+        RTPHeaderInfo header;
+        if (!RTPHeader::parse(packet.data(), len, header)) {
+            LOGW("invalid rtp packet");
+            return;
+        }
+        if (header.payload_type != cfg.payloadType()) {
+            LOGD("ignored payload type: %d", header.payload_type);
+            return;
+        }
+        if (!has_ssrc || header.ssrc != sender_ssrc) {
+            if (has_ssrc) {
+                LOGI("new ssrc: %u", header.ssrc);
+                jitter.clear();
+            }
+            resetStatistics();
+            sender_ssrc = header.ssrc;
+            has_ssrc = true;
+            base_seq = header.seq;
+            max_seq = header.seq;
+        }
+        updateStatistics(header);
+
+        uint8_t *p_payload = packet.data() + header.header_len;
+        if (cfg.format == RTP_L16) {
+            // convert from network byte order
+            for (int j = 0; j + 1 < header.payload_len; j += 2) {
+                uint8_t tmp = p_payload[j];
+                p_payload[j] = p_payload[j + 1];
+                p_payload[j + 1] = tmp;
+            }
+        }
+        // the jitter buffer expects the sequence number in front of the payload: so we
+        // just overwrite the end of the header which has already been parsed
+        RTPHeader::put16(p_payload - 2, header.seq);
+        jitter.write(p_payload - 2, header.payload_len + 2);
+    }
+
+    void updateStatistics(RTPHeaderInfo &header) {
+        stats.packets++;
+        stats.octets += header.payload_len;
+        int16_t delta = header.seq - max_seq;
+        if (delta > 0) {
+            if (header.seq < max_seq) cycles += 0x10000;
+            max_seq = header.seq;
+        }
+        // interarrival jitter
+        // 64 bit arithmetic: millis() * clock rate overflows 32 bits after a few minutes
+        uint32_t arrival = (uint32_t)((uint64_t)millis() * cfg.clockRate() / 1000);
+        int32_t transit = (int32_t)(arrival - header.timestamp);
+        if (has_transit) {
+            int32_t d = transit - last_transit;
+            if (d < 0) d = -d;
+            jitter_q4 += d - ((jitter_q4 + 8) >> 4);
+            stats.jitter = jitter_q4 >> 4;
+        }
+        last_transit = transit;
+        has_transit = true;
+    }
+
+    bool isReportDue() {
+        if (p_rtcp == nullptr || cfg.rtcp_interval_ms <= 0 || !has_ssrc) return false;
+        return millis() - last_rtcp_ms >= (uint64_t)cfg.rtcp_interval_ms;
+    }
+
+    /// Sends a receiver report with one report block for the sender
+    void sendReport() {
+        last_rtcp_ms = millis();
+        int32_t expected = expectedPackets();
+        int32_t lost = expected - (int32_t)stats.packets;
+        int32_t expected_interval = expected - expected_prior;
+        int32_t lost_interval = expected_interval - (int32_t)(stats.packets - received_prior);
+        expected_prior = expected;
+        received_prior = stats.packets;
+        uint8_t fraction = 0;
+        if (expected_interval > 0 && lost_interval > 0) {
+            fraction = (lost_interval << 8) / expected_interval;
+        }
+        stats.fraction_lost = fraction;
+        stats.lost = lost;
+        // clamp to 24 bit signed
+        if (lost > 0x7FFFFF) lost = 0x7FFFFF;
+        if (lost < -0x800000) lost = -0x800000;
+
+        uint32_t dlsr = 0;
+        if (last_sr != 0) {
+            dlsr = (millis() - last_sr_ms) * 65536 / 1000;
+        }
+        uint8_t p[32];
+        p[0] = 0x81;
+        p[1] = 201;
+        RTPHeader::put16(p + 2, 7);
+        RTPHeader::put32(p + 4, ssrc);
+        RTPHeader::put32(p + 8, sender_ssrc);
+        p[12] = fraction;
+        p[13] = (lost >> 16) & 0xFF;
+        p[14] = (lost >> 8) & 0xFF;
+        p[15] = lost & 0xFF;
+        RTPHeader::put32(p + 16, cycles + max_seq);
+        RTPHeader::put32(p + 20, stats.jitter);
+        RTPHeader::put32(p + 24, last_sr);
+        RTPHeader::put32(p + 28, dlsr);
+        p_rtcp->write(p, sizeof(p));
+    }
+
+    /// Evaluates the sender reports for the LSR and DLSR of the receiver report
+    void receiveReports() {
+        if (p_rtcp == nullptr) return;
+        uint8_t buffer[RTCP_MAX_PACKET_SIZE];
+        while (p_rtcp->available() > 0) {
+            int len = p_rtcp->readBytes(buffer, RTCP_MAX_PACKET_SIZE);
+            if (len <= 0) break;
+            int pos = 0;
+            while (pos + 8 <= len) {
+                const uint8_t *p = buffer + pos;
+                int size = (RTPHeader::get16(p + 2) + 1) * 4;
+                if ((p[0] >> 6) != 2 || pos + size > len) break;
+                if (p[1] == 200 && size >= 28 && RTPHeader::get32(p + 4) == sender_ssrc) {
+                    last_sr = (RTPHeader::get32(p + 8) << 16) | (RTPHeader::get32(p + 12) >> 16);
+                    last_sr_ms = millis();
+                }
+                pos += size;
+            }
+        }
+    }
+};
+
+}  // namespace audio_tools
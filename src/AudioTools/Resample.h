@@ -103,7 +103,7 @@ class ResampleStream : public AudioStream {
 
     /// influence the sample rate
     void setStepSize(float step){
-        LOGI("setStepSize: %f", step);
+        LOGI_M(RESAMPLE, "setStepSize: %f", step);
         step_size = step;
     }
 
@@ -148,7 +148,7 @@ class ResampleStream : public AudioStream {
                 size_t written=0;
                 // resample to ringbuffer
                 write(&ring_buffer, read_buffer.data(), read_size, written);
-                LOGD("written: %d", (int)written);
+                LOGD_M(RESAMPLE, "written: %d", (int)written);
             } else {
                 LOGE("bytes_read==0");
             }
@@ -0,0 +1,378 @@
+#pragma once
+#include <math.h>
+#include "AudioTools/AudioStreams.h"
+#include "AudioTools/Buffers.h"
+#include "AudioBasic/Collections/Vector.h"
+
+namespace audio_tools {
+
+/**
+ * @brief What should happen with the audio data which is classified as silence
+ * @ingroup transform
+ */
+enum VADAction {
+    /// the data is not changed: we only report the state changes
+    VADPass,
+    /// the silence is removed
+    VADDrop,
+    /// the silence is replaced with 0 values, so that the timing is kept
+    VADMute,
+    /// the silence is removed and the marker (e.g. comfort noise frame) is written once at the start of the silence
+    VADMarker
+};
+
+/**
+ * @brief Config for VADStream
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+struct VADConfig : public AudioBaseInfo {
+    VADConfig() {
+        sample_rate = 16000;
+        bits_per_sample = 16;
+        channels = 1;
+    }
+    /// Length of a analysis frame in ms
+    int frame_ms = 10;
+    /// A frame is active if the energy is this number of dB above the noise floor
+    float threshold_db = 9.0f;
+    /// Frames below this level (in dBFS) are always silent
+    float min_level_db = -60.0f;
+    /// Frames with a higher zero crossing rate (0 - 1.0) are classified as noise unless they are very loud
+    float max_zero_crossing_rate = 0.5f;
+    /// Number of active frames which are needed to switch to the active state
+    int attack_frames = 2;
+    /// Number of silent frames after which we switch back to the silent state
+    int hangover_frames = 30;
+    /// Adaption rate (0 - 1.0) of the noise floor
+    float noise_adapt = 0.05f;
+    /// Action for silent data
+    VADAction action = VADDrop;
+};
+
+/**
+ * @brief Voice activity detection: The data is split into frames of frame_ms for which we
+ * calculate the energy and the zero crossing rate while the samples are copied, so the
+ * processing cost is constant per sample. A frame is active if it is sufficiently above the
+ * adaptive noise floor. We switch to the active state after attack_frames consecutive active frames
+ * (which are kept and output) and back to the silent state after hangover_frames silent frames.
+ * Silent data is processed according to the defined VADAction and the state changes are reported
+ * to the callback. This can be used as replacement for the SilenceRemovalConverter.
+ * @ingroup transform
+ * @author Phil Schatzmann
+ * @copyright GPLv3
+ */
+class VADStream : public AudioStream {
+  public:
+    VADStream() = default;
+
+    /// Constructor which assigns Print output
+    VADStream(Print &out) { setTarget(out); }
+
+    /// Constructor which assigns Stream input or output
+    VADStream(Stream &io) { setTarget(io); }
+
+    void setTarget(Print &out) { p_out = &out; }
+
+    void setTarget(Stream &io) {
+        p_in = &io;
+        p_out = &io;
+    }
+
+    VADConfig defaultConfig() {
+        VADConfig c;
+        return c;
+    }
+
+    bool begin(VADConfig cfg) {
+        TRACED();
+        this->cfg = cfg;
+        info = cfg;
+        sample_bytes = cfg.bits_per_sample / 8;
+        if (sample_bytes != 2 && sample_bytes != 3 && sample_bytes != 4) {
+            LOGE("Unsupported bits_per_sample: %d", cfg.bits_per_sample);
+            return false;
+        }
+        frame_samples = cfg.sample_rate * cfg.frame_ms / 1000 * cfg.channels;
+        if (frame_samples <= 0) frame_samples = cfg.channels;
+        frame_bytes = frame_samples * sample_bytes;
+        int attack = cfg.attack_frames < 1 ? 1 : cfg.attack_frames;
+        pending.resize(frame_bytes * attack);
+        threshold_factor = powf(10.0f, cfg.threshold_db / 10.0f);
+        min_energy = powf(10.0f, cfg.min_level_db / 10.0f);
+        noise_floor = min_energy;
+        max_value = NumberConverter::maxValue(cfg.bits_per_sample);
+        reset();
+        is_active = true;
+        return true;
+    }
+
+    bool begin(AudioBaseInfo info) {
+        VADConfig c = cfg;
+        c.sample_rate = info.sample_rate;
+        c.channels = info.channels;
+        c.bits_per_sample = info.bits_per_sample;
+        return begin(c);
+    }
+
+    /// Outputs the data of the incomplete frame
+    void end() override {
+        // unconfirmed candidates are treated as silence
+        size_t len = pending_frames * frame_bytes + frame_pos;
+        if (len > 0) processFrame(pending.data(), len, is_voice);
+        reset();
+        is_active = false;
+    }
+
+    void setAudioInfo(AudioBaseInfo info) override {
+        TRACED();
+        if (p_notify != nullptr) p_notify->setAudioInfo(info);
+        begin(info);
+    }
+
+    /// Defines the callback which is called when the state changes
+    void setCallback(void (*callback)(bool active, void* ref), void* ref = nullptr) {
+        this->callback = callback;
+        p_ref = ref;
+    }
+
+    /// Defines the data which is written at the start of a silence with the VADMarker action
+    void setMarker(const uint8_t* data, size_t len) {
+        p_marker = data;
+        marker_len = len;
+    }
+
+    /// Writes the data w/o silence to the output
+    size_t write(const uint8_t* data, size_t len) override {
+        if (!is_active) return p_out == nullptr ? 0 : p_out->write(data, len);
+        p_sink = p_out;
+        process(data, len);
+        return len;
+    }
+
+    /// Reads the data w/o silence from the input
+    size_t readBytes(uint8_t* data, size_t len) override {
+        if (p_in == nullptr) return 0;
+        if (!is_active) return p_in->readBytes(data, len);
+        int reserve = pending.size() + marker_len;
+        if (read_buffer.available() == 0 && read_buffer.size() < (int)len + reserve) {
+            read_buffer.resize(len + reserve);
+        }
+        // read as long as we have data but no result
+        while (read_buffer.available() == 0) {
+            int read_len = read_buffer.availableForWrite() - reserve;
+            if (read_len > (int)len) read_len = len;
+            size_t result = p_in->readBytes(data, read_len);
+            if (result == 0) break;
+            p_sink = nullptr;
+            process(data, result);
+        }
+        return read_buffer.readArray(data, len);
+    }
+
+    int available() override {
+        return p_in == nullptr ? 0 : p_in->available() + read_buffer.available();
+    }
+
+    int availableForWrite() override {
+        return p_out == nullptr ? 0 : p_out->availableForWrite();
+    }
+
+    /// Returns true if we are in the active (=voice) state
+    bool isVoice() { return is_voice; }
+
+    /// Provides the energy of the last frame in dBFS
+    float energyDb() { return toDb(last_energy); }
+
+    /// Provides the actual noise floor in dBFS
+    float noiseFloorDb() { return toDb(noise_floor); }
+
+    /// Provides the zero crossing rate of the last frame
+    float zeroCrossingRate() { return last_zcr; }
+
+  protected:
+    VADConfig cfg;
+    Print* p_out = nullptr;
+    Stream* p_in = nullptr;
+    Print* p_sink = nullptr;
+    RingBuffer<uint8_t> read_buffer{0};
+    Vector<uint8_t> pending;
+    void (*callback)(bool active, void* ref) = nullptr;
+    void* p_ref = nullptr;
+    const uint8_t* p_marker = nullptr;
+    size_t marker_len = 0;
+    bool is_active = false;
+    bool is_voice = false;
+    int sample_bytes = 2;
+    int frame_samples = 0;
+    int frame_bytes = 0;
+    // position in the actual frame
+    int frame_pos = 0;
+    int pending_frames = 0;
+    int hangover = 0;
+    float max_value = 32767;
+    float threshold_factor = 1.0f;
+    float min_energy = 0.0f;
+    float noise_floor = 0.0f;
+    float last_energy = 0.0f;
+    float last_zcr = 0.0f;
+    // running statistics of the actual frame
+    float energy_sum = 0.0f;
+    int zero_crossings = 0;
+    // number of samples of the actual frame which are in energy_sum
+    int stat_samples = 0;
+    bool last_negative = false;
+
+    void reset() {
+        frame_pos = 0;
+        pending_frames = 0;
+        hangover = 0;
+        is_voice = false;
+        resetFrame();
+    }
+
+    void resetFrame() {
+        energy_sum = 0.0f;
+        zero_crossings = 0;
+        stat_samples = 0;
+    }
+
+    /// Copies the samples into the frame and updates the statistics
+    void process(const uint8_t* data, size_t len) {
+        size_t pos = 0;
+        while (pos < len) {
+            uint8_t* frame = pending.data() + pending_frames * frame_bytes;
+            int copy_len = frame_bytes - frame_pos;
+            if (copy_len > (int)(len - pos)) copy_len = len - pos;
+            memcpy(frame + frame_pos, data + pos, copy_len);
+            updateStatistics(frame, frame_pos + copy_len);
+            frame_pos += copy_len;
+            pos += copy_len;
+            if (frame_pos == frame_bytes) {
+                evaluateFrame(frame);
+                frame_pos = 0;
+                resetFrame();
+            }
+        }
+    }
+
+    void updateStatistics(uint8_t* frame, int to) {
+        // only complete samples are evaluated: a partial sample is completed by the next write
+        int end = to / sample_bytes;
+        for (int j = stat_samples; j < end; j++) {
+            float value = sample(frame, j) / max_value;
+            energy_sum += value * value;
+            // zero crossings are determined on the first channel
+            if (j % info.channels == 0) {
+                bool negative = value < 0.0f;
+                if (negative != last_negative) zero_crossings++;
+                last_negative = negative;
+            }
+        }
+        if (end > stat_samples) stat_samples = end;
+    }
+
+    float sample(uint8_t* frame, int idx) {
+        switch (sample_bytes) {
+            case 2:
+                return ((int16_t*)frame)[idx];
+            case 3:
+                return (int32_t)((int24_t*)frame)[idx];
+            default:
+                return ((int32_t*)frame)[idx];
+        }
+    }
+
+    /// Classifies the frame with the help of the running statistics
+    bool isFrameActive() {
+        // normalize by the number of evaluated samples
+        int samples = stat_samples;
+        if (samples == 0) return is_voice;
+        last_energy = energy_sum / samples;
+        int channel_samples = (samples + info.channels - 1) / info.channels;
+        last_zcr = (float)zero_crossings / channel_samples;
+        float threshold = noise_floor * threshold_factor;
+        if (threshold < min_energy) threshold = min_energy;
+        bool result = last_energy > threshold;
+        if (result && last_zcr > cfg.max_zero_crossing_rate) {
+            result = last_energy > threshold * 4;
+        }
+        // adapt the noise floor: fast to lower values, slow in the active state
+        if (last_energy < noise_floor) {
+            noise_floor += (last_energy - noise_floor) * 0.5f;
+        } else if (!result) {
+            noise_floor += (last_energy - noise_floor) * cfg.noise_adapt;
+        } else {
+            noise_floor += (last_energy - noise_floor) * cfg.noise_adapt * 0.01f;
+        }
+        if (noise_floor < min_energy / 100) noise_floor = min_energy / 100;
+        return result;
+    }
+
+    /// Determines the state with the attack and hangover logic
+    void evaluateFrame(uint8_t* frame) {
+        bool active = isFrameActive();
+        if (is_voice) {
+            if (active) {
+                hangover = cfg.hangover_frames;
+            } else if (hangover > 0) {
+                hangover--;
+            } else {
+                setVoice(false);
+            }
+            processFrame(frame, frame_bytes, is_voice);
+            return;
+        }
+
+        if (!active) {
+            // the collected candidates were not confirmed
+            if (pending_frames > 0) processFrame(pending.data(), pending_frames * frame_bytes, false);
+            processFrame(frame, frame_bytes, false);
+            pending_frames = 0;
+            return;
+        }
+
+        pending_frames++;
+        if (pending_frames >= cfg.attack_frames) {
+            setVoice(true);
+            hangover = cfg.hangover_frames;
+            processFrame(pending.data(), pending_frames * frame_bytes, true);
+            pending_frames = 0;
+        }
+    }
+
+    void setVoice(bool voice) {
+        LOGI("voice: %s", voice ? "true" : "false");
+        is_voice = voice;
+        if (!voice && cfg.action == VADMarker && p_marker != nullptr) {
+            output(p_marker, marker_len);
+        }
+        if (callback != nullptr) callback(voice, p_ref);
+    }
+
+    void processFrame(const uint8_t* data, size_t len, bool voice) {
+        if (voice || cfg.action == VADPass) {
+            output(data, len);
+            return;
+        }
+        if (cfg.action == VADMute) {
+            uint8_t* mute = (uint8_t*)data;
+            memset(mute, 0, len);
+            output(mute, len);
+        }
+    }
+
+    void output(const uint8_t* data, size_t len) {
+        if (p_sink != nullptr) {
+            p_sink->write(data, len);
+        } else {
+            read_buffer.writeArray((uint8_t*)data, len);
+        }
+    }
+
+    float toDb(float energy) {
+        return energy <= 0.0f ? -120.0f : 10.0f * log10f(energy);
+    }
+};
+
+}  // namespace audio_tools
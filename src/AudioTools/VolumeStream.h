@@ -3,6 +3,12 @@
 #include "AudioTools/AudioStreams.h"
 #include "AudioTools/AudioPrint.h"
 #include "AudioTools/VolumeControl.h"
+#include "AudioBasic/Collections/Vector.h"
+
+/// Default number of samples of the linear ramp when the volume is changed
+#ifndef VOLUME_RAMP_SAMPLES
+#define VOLUME_RAMP_SAMPLES 256
+#endif
 
 namespace audio_tools {
 
@@ -18,12 +24,17 @@ struct VolumeStreamConfig : public AudioBaseInfo {
   }
   bool allow_boost = false;
   float volume=1.0;  // start_volume
+  /// number of samples (per channel) over which a volume change is ramped to avoid clicks
+  int ramp_samples = VOLUME_RAMP_SAMPLES;
 };
 
 
 /**
  * @brief Adjust the volume of the related input or output: To work properly the class needs to know the 
  * bits per sample and number of channels!
+ * The gains are precalculated per channel as fixed point values (Q15 for 16 bits, Q31 for 24 and 32 bits
+ * or Q24 if boost is allowed), so that the processing is done with saturating integer arithmetic only.
+ * Volume changes are ramped linearly over ramp_samples to avoid clicks.
  * AudioChanges are forwareded to the related Print or Stream class.
  * @ingroup transform
  * @author Phil Schatzmann
@@ -34,11 +45,6 @@ class VolumeStream : public AudioStream {
         /// Default Constructor
         VolumeStream() = default;
 
-        /// Destructor
-        ~VolumeStream() {
-            cleanup();
-        };
-
         /// Constructor which assigns Print output
         VolumeStream(Print &out) {
             setTarget(out);
@@ -96,9 +102,6 @@ class VolumeStream : public AudioStream {
             TRACED();
             info = cfg;
             max_value = NumberConverter::maxValue(info.bits_per_sample);
-            if (info.channels>max_channels){
-              max_channels = info.channels;
-            }
 
             // usually we use a exponential volume control - except if we allow values > 1.0
             if (cfg.allow_boost){
@@ -107,8 +110,11 @@ class VolumeStream : public AudioStream {
               setVolumeControl(pot_vc);
             }
 
-            // set start volume
-            setVolume(cfg.volume); 
+            // set start volume without ramp
+            setup();
+            for (int j=0;j<info.channels;j++){
+              setChannelVolume(cfg.volume, j, false);
+            }
 
             return true;
         }
@@ -175,64 +181,119 @@ class VolumeStream : public AudioStream {
             }
         }
 
-        /// Sets the volume for one channel
+        /// Sets the volume for one channel: the change is ramped over ramp_samples
         void setVolume(float vol, int channel){
             if (channel<info.channels){
-              setup(vol);
-              float volume_value = volumeValue(vol);
-              LOGI("setVolume: %f", volume_value);
-              float factor = volumeControl().getVolumeFactor(volume_value);
-              factor_for_channel[channel]=factor;
+              setup();
+              setChannelVolume(vol, channel, true);
             } else {
               LOGE("Invalid channel %d - max: %d", channel, info.channels-1);
             }
         }
 
+        /// Defines an additional gain factor (e.g. for the loudness normalization) which is applied on top of the volume
+        void setNormalizationGain(float factor){
+            normalization = factor;
+            // before begin() we just keep the factor
+            if (!is_active) return;
+            int bits = gain_bits;
+            setup();
+            // if the fixed point format has changed we can't ramp
+            bool ramp = bits == gain_bits;
+            for (int j=0;j<info.channels;j++){
+              setChannelVolume(gains[j].volume, j, ramp);
+            }
+        }
+
+        /// Provides the additional gain factor
+        float normalizationGain() {
+            return normalization;
+        }
+
         /// Provides the current volume setting
         float volume() {
-            return volume_values[0];
+            return volume(0);
         }
 
         /// Provides the current volume setting for the indicated channel
         float volume(int channel) {
-            return channel>=info.channels? 0 : volume_values[channel];
+            if (channel>=info.channels) return 0;
+            return channel>=gains.size() ? info.volume : gains[channel].volume;
         }
 
     protected:
+        /// Fixed point gain of a channel with the linear ramp to the target gain
+        struct ChannelGain {
+            float volume = 1.0f;
+            int32_t gain = 0;
+            int32_t target = 0;
+            int32_t step = 0;
+            int ramp = 0;
+        };
         Print *p_out=nullptr;
         Stream *p_in=nullptr;
         VolumeStreamConfig info;
         LinearVolumeControl linear_vc{true};
         SimulatedAudioPot pot_vc;
         CachedVolumeControl cached_volume{pot_vc};
-        float *volume_values = nullptr;
-        float *factor_for_channel = nullptr;
+        Vector<ChannelGain> gains{0};
         bool is_active = false;
-        float max_value = 32767; // max value for clipping
-        int max_channels=0;
-
-        void setup(float vol) {
-            is_active = vol!=1.0f;
-            if (info.channels>max_channels){
-              cleanup();
+        bool is_unity = true;
+        bool is_ramping = false;
+        bool is_wide = false;
+        float normalization = 1.0f;
+        int gain_bits = 15;
+        int32_t unity_gain = 1 << 15;
+        int32_t max_value = 32767; // max value for clipping
+
+        void setup() {
+            is_active = true;
+            // Q15 for 16 bits; Q31 for 24 and 32 bits which needs some headroom for a boost
+            bool boost = info.allow_boost || normalization > 1.0f;
+            gain_bits = info.bits_per_sample == 16 ? 15 : (boost ? 24 : 31);
+            unity_gain = toFixed(1.0f);
+            if (gains.size() != info.channels){
+              gains.resize(info.channels);
+              for (int j=0;j<info.channels;j++){
+                gains[j] = ChannelGain();
+                gains[j].gain = gains[j].target = unity_gain;
+              }
             }
-            if (factor_for_channel==nullptr){
-              factor_for_channel = new float[info.channels];
+        }
+
+        void setChannelVolume(float vol, int channel, bool ramp){
+            float volume_value = volumeValue(vol);
+            LOGI("setVolume: %f", volume_value);
+            float factor = volumeControl().getVolumeFactor(volume_value) * normalization;
+            ChannelGain &g = gains[channel];
+            g.volume = volume_value;
+            g.target = toFixed(factor);
+            g.ramp = ramp ? info.ramp_samples : 0;
+            g.step = g.ramp > 0 ? ((int64_t)g.target - g.gain) / g.ramp : 0;
+            if (g.step == 0){
+              g.gain = g.target;
+              g.ramp = 0;
             }
-            if (volume_values==nullptr){
-              volume_values = new float[info.channels];
+            updateState();
+        }
+
+        void updateState() {
+            is_unity = true;
+            is_ramping = false;
+            is_wide = false;
+            for (int j=0;j<gains.size();j++){
+              if (gains[j].ramp > 0) is_ramping = true;
+              if (gains[j].gain > unity_gain || gains[j].target > unity_gain) is_wide = true;
+              if (gains[j].gain != unity_gain) is_unity = false;
             }
+            if (is_ramping) is_unity = false;
         }
 
-        void cleanup() {
-          if (factor_for_channel!=nullptr) {
-            delete []factor_for_channel;
-            factor_for_channel = nullptr;
-          } 
-          if (volume_values!=nullptr) {
-            delete []volume_values;
-            volume_values = nullptr;
-          }
+        int32_t toFixed(float factor) {
+            double result = (double)factor * ((int64_t)1 << gain_bits);
+            if (result > INT32_MAX) return INT32_MAX;
+            if (result < 0) return 0;
+            return result;
         }
 
         float volumeValue(float vol){
@@ -249,58 +310,67 @@ class VolumeStream : public AudioStream {
             return cached_volume;
         }
 
-        float factorForChannel(int channel){
-            return factor_for_channel==nullptr ? 1.0 : factor_for_channel[channel];
-        }
-
         void applyVolume(const uint8_t *buffer, size_t size){
+            if (is_unity) return;
             switch(info.bits_per_sample){
                 case 16:
-                    applyVolume16((int16_t*)buffer, size/2);
+                    // w/o boost the Q15 product fits into 32 bits
+                    if (is_wide){
+                      applyGain<int16_t, int64_t>((int16_t*)buffer, size/2);
+                    } else {
+                      applyGain<int16_t, int32_t>((int16_t*)buffer, size/2);
+                    }
                     break;
                 case 24:
-                    applyVolume24((int24_t*)buffer, size/3);
+                    applyGain<int24_t, int64_t>((int24_t*)buffer, size/3);
                     break;
                 case 32:
-                    applyVolume32((int32_t*)buffer, size/4);
+                    applyGain<int32_t, int64_t>((int32_t*)buffer, size/4);
                     break;
                 default:
                     LOGE("Unsupported bits_per_sample: %d", info.bits_per_sample);
             }
         }
 
-        void applyVolume16(int16_t* data, size_t size){
-            for (size_t j=0;j<size;j++){
-                float result = factorForChannel(j%info.channels) * data[j];
-                if (!info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                data[j]= static_cast<int16_t>(result);
+        /// Multiplies the samples with the fixed point gains of the channels
+        template <typename T, typename Acc>
+        void applyGain(T* data, size_t size) {
+            int channels = info.channels;
+            ChannelGain *p_gain = gains.data();
+            size_t frames = size / channels;
+            // frames with ramp
+            while (is_ramping && frames > 0){
+              for (int ch=0; ch<channels; ch++){
+                ChannelGain &g = p_gain[ch];
+                if (g.ramp > 0){
+                  g.gain = --g.ramp == 0 ? g.target : g.gain + g.step;
+                }
+                data[ch] = scale<T, Acc>(data[ch], g.gain);
+              }
+              data += channels;
+              frames--;
+              bool ramping = false;
+              for (int ch=0; ch<channels; ch++){
+                if (p_gain[ch].ramp > 0) ramping = true;
+              }
+              if (!ramping) updateState();
             }
-        }
-
-        void applyVolume24(int24_t* data, size_t size) {
-            for (size_t j=0;j<size;j++){
-                float result = factorForChannel(j%info.channels) * data[j];
-                if (!info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                int32_t result1 = result;
-                data[j]= static_cast<int24_t>(result1);
+            // frames with constant gain
+            for (size_t f=0; f<frames; f++){
+              for (int ch=0; ch<channels; ch++){
+                data[ch] = scale<T, Acc>(data[ch], p_gain[ch].gain);
+              }
+              data += channels;
             }
         }
 
-        void applyVolume32(int32_t* data, size_t size) {
-            for (size_t j=0;j<size;j++){
-                float result = factorForChannel(j%info.channels) * data[j];
-                if (!info.allow_boost){
-                    if (result>max_value) result = max_value;
-                    if (result<-max_value) result = -max_value;
-                } 
-                data[j]= static_cast<int32_t>(result);
-            }
+        /// Saturating fixed point multiplication
+        template <typename T, typename Acc>
+        inline T scale(T sample, int32_t gain) {
+            Acc result = ((Acc)(int32_t)sample * gain) >> gain_bits;
+            if (result > max_value) result = max_value;
+            if (result < -max_value) result = -max_value;
+            return static_cast<T>((int32_t)result);
         }
 };
 